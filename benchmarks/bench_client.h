@@ -0,0 +1,77 @@
+// Loopback client helpers shared by the server benchmarks: blocking
+// TCP_NODELAY connections to 127.0.0.1, full sends, and counting
+// responses by their fixed body. Nothing here allocates, so timed loops
+// that count allocations can use it.
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace benchclient {
+
+/// Blocking connection to 127.0.0.1:@p port with Nagle off, or -1.
+inline int connect_to(std::uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+inline bool send_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t n = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data.remove_prefix(static_cast<std::size_t>(n));
+    }
+    return true;
+}
+
+/// Read until @p count responses have arrived, each recognised by the
+/// blank line followed by @p body (responses must not carry other bodies).
+/// Matches across reads without buffering.
+inline bool read_responses(int fd, std::size_t count, std::string_view body = "pong") {
+    char tail[64] = "\r\n\r\n";
+    const std::size_t len = 4 + body.copy(tail + 4, sizeof(tail) - 4);
+    const std::string_view want(tail, len);
+    char buf[64 * 1024];
+    std::size_t seen = 0;
+    std::size_t match = 0; // chars of want matched so far
+    while (seen < count) {
+        const ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) return false;
+        for (ssize_t i = 0; i < n; ++i) {
+            const char c = buf[i];
+            // On a mismatch fall back to the longest prefix of want that
+            // ends the matched text plus c.
+            while (match > 0 && want[match] != c) {
+                std::size_t k = match - 1;
+                while (k > 0 && want.substr(0, k) != want.substr(match - k, k)) --k;
+                match = k;
+            }
+            if (want[match] == c) ++match;
+            if (match == len) {
+                ++seen;
+                match = 0;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace benchclient
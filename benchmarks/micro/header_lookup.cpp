@@ -0,0 +1,96 @@
+// Request-header container microbench: a 17-field Chrome navigation header
+// set is loaded into a HeaderMap (the old per-request map) and into Headers
+// (known-name slots + unknown vector, values borrowed), then the six
+// headers the server and common middleware read are looked up: by string
+// key in the map, by name and by HeaderId in Headers.
+// Usage: header_lookup [iterations]
+#include <socketify/headers.h>
+#include <socketify/http.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace socketify;
+using Steady = std::chrono::steady_clock;
+
+template <class Fn>
+static double ns_per_op(long iters, Fn&& fn) {
+    auto t0 = Steady::now();
+    for (long i = 0; i < iters; ++i) fn();
+    return std::chrono::duration<double, std::nano>(Steady::now() - t0).count() /
+           static_cast<double>(iters);
+}
+
+static const std::vector<std::pair<std::string, std::string>> kFields = {
+    {"Host", "app.example.com"},
+    {"Connection", "keep-alive"},
+    {"sec-ch-ua", "\"Chromium\";v=\"128\", \"Not;A=Brand\";v=\"24\""},
+    {"sec-ch-ua-mobile", "?0"},
+    {"sec-ch-ua-platform", "\"Windows\""},
+    {"Upgrade-Insecure-Requests", "1"},
+    {"User-Agent", "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36"},
+    {"Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8"},
+    {"Sec-Fetch-Site", "same-origin"},
+    {"Sec-Fetch-Mode", "navigate"},
+    {"Sec-Fetch-User", "?1"},
+    {"Sec-Fetch-Dest", "document"},
+    {"Referer", "https://app.example.com/dashboard"},
+    {"Accept-Encoding", "gzip, deflate, br, zstd"},
+    {"Accept-Language", "en-US,en;q=0.9"},
+    {"Cookie", "session=eyJ1aWQiOjQyfQ; theme=dark"},
+    {"X-Tenant", "acme"},
+};
+
+static constexpr std::string_view kLookups[] = {"Host",   "Accept-Encoding", "Connection",
+                                                "Cookie", "Origin",          "X-Request-Id"};
+static constexpr HeaderId kLookupIds[] = {HeaderId::Host,   HeaderId::AcceptEncoding,
+                                          HeaderId::Connection, HeaderId::Cookie,
+                                          HeaderId::Origin, HeaderId::XRequestId};
+
+int main(int argc, char** argv) {
+    const long iters = argc > 1 ? std::atol(argv[1]) : 1000000;
+    std::size_t sink = 0;
+
+    const double map_build = ns_per_op(iters, [&] {
+        HeaderMap m;
+        for (const auto& [k, v] : kFields) m.try_emplace(k, v);
+        sink += m.size();
+    });
+
+    Headers h; // reused like the per-connection instance in the server
+    const double headers_build = ns_per_op(iters, [&] {
+        h.clear();
+        for (const auto& [k, v] : kFields) h.add(k, v);
+        sink += h.size();
+    });
+
+    HeaderMap m;
+    for (const auto& [k, v] : kFields) m.try_emplace(k, v);
+
+    const double map_find = ns_per_op(iters, [&] {
+        for (std::string_view k : kLookups) {
+            auto it = m.find(std::string(k));
+            if (it != m.end()) sink += it->second.size();
+        }
+    });
+
+    const double headers_name = ns_per_op(iters, [&] {
+        for (std::string_view k : kLookups) sink += h.get(k).size();
+    });
+
+    const double headers_id = ns_per_op(iters, [&] {
+        for (HeaderId id : kLookupIds) sink += h.get(id).size();
+    });
+
+    std::printf("iterations=%ld, %zu fields, %zu lookups\n", iters, kFields.size(), std::size(kLookups));
+    std::printf("build   HeaderMap          %8.1f ns/op\n", map_build);
+    std::printf("build   Headers (borrow)   %8.1f ns/op\n", headers_build);
+    std::printf("lookup  HeaderMap::find    %8.1f ns/op\n", map_find);
+    std::printf("lookup  Headers by name    %8.1f ns/op\n", headers_name);
+    std::printf("lookup  Headers by id      %8.1f ns/op\n", headers_id);
+    return sink == 0 ? 1 : 0;
+}
@@ -0,0 +1,186 @@
+// Multipart upload microbench: a body of mixed parts (small form fields,
+// ~100 KiB and 8 MiB files, 1 KiB files) totalling 1 GiB by default is
+// generated on the fly and fed to body::MultipartParser in 64 KiB pieces,
+// as a streaming route receives it, once per scanner ISA. With --disk the
+// file parts go through save_multipart() into that directory. For
+// comparison, the buffered body::multipart() parses up to 256 MiB held in
+// memory. Output is GB/s and the process's peak RSS after each run.
+// Usage: multipart_upload [total_mib] [--disk dir]
+#include <socketify/body.h>
+#include <socketify/detail/http_scan.h>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace socketify;
+using Steady = std::chrono::steady_clock;
+
+static const std::string kBoundary = "----socketifyBench7MA4YWxkTrZu0gW";
+
+// Writes the upload into a sink piece by piece; part payloads are cut
+// from one random block so the boundary never occurs by accident.
+class UploadGen {
+public:
+    explicit UploadGen(std::uint64_t total) : total_(total), block_(std::size_t{1} << 20, '\0') {
+        std::mt19937 rng(42);
+        for (char& c : block_) c = static_cast<char>(rng());
+    }
+
+    template <class Sink>
+    std::uint64_t run(Sink&& sink) const {
+        static constexpr std::size_t kSizes[] = {24, 100 * 1024, 8 << 20, 1024, 40, 100 * 1024};
+        std::uint64_t body = 0;
+        auto put = [&](const char* p, std::size_t n) {
+            sink(p, n);
+            body += n;
+        };
+        for (std::size_t i = 0; body < total_; ++i) {
+            const std::size_t size = kSizes[i % std::size(kSizes)];
+            std::string head = "--" + kBoundary + "\r\n";
+            if (size < 64) {
+                head += "Content-Disposition: form-data; name=\"field" + std::to_string(i) + "\"\r\n\r\n";
+            } else {
+                head += "Content-Disposition: form-data; name=\"file" + std::to_string(i) +
+                        "\"; filename=\"f" + std::to_string(i) + ".bin\"\r\n"
+                        "Content-Type: application/octet-stream\r\n\r\n";
+            }
+            put(head.data(), head.size());
+            for (std::size_t left = size; left > 0;) {
+                const std::size_t n = std::min(left, block_.size());
+                put(block_.data(), n);
+                left -= n;
+            }
+            put("\r\n", 2);
+        }
+        const std::string tail = "--" + kBoundary + "--\r\n";
+        put(tail.data(), tail.size());
+        return body;
+    }
+
+private:
+    std::uint64_t total_;
+    std::string block_;
+};
+
+// Copies the generated stream into a 64 KiB "receive buffer" and hands
+// each full buffer on, like reads from a socket.
+template <class Feed>
+struct Chunker {
+    Feed feed;
+    std::string buf = std::string(64 * 1024, '\0');
+    std::size_t used = 0;
+    void operator()(const char* p, std::size_t n) {
+        while (n > 0) {
+            const std::size_t k = std::min(n, buf.size() - used);
+            std::memcpy(buf.data() + used, p, k);
+            used += k;
+            p += k;
+            n -= k;
+            if (used == buf.size()) flush();
+        }
+    }
+    void flush() {
+        if (used) feed(std::string_view(buf.data(), used));
+        used = 0;
+    }
+};
+template <class Feed> Chunker(Feed) -> Chunker<Feed>;
+
+static double peak_rss_mib() {
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    return static_cast<double>(ru.ru_maxrss) / 1024.0;
+}
+
+static double seconds_since(Steady::time_point t0) {
+    return std::chrono::duration<double>(Steady::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    std::uint64_t total_mib = 1024;
+    const char* disk = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--disk") == 0 && i + 1 < argc) {
+            disk = argv[++i];
+        } else {
+            total_mib = std::strtoull(argv[i], nullptr, 10);
+        }
+    }
+    const UploadGen gen(total_mib << 20);
+    std::uint64_t sink = 0;
+
+    // Generation + 64 KiB copies alone, to put the parser numbers in context.
+    {
+        Chunker c{[&](std::string_view v) { sink += static_cast<unsigned char>(v[0]); }};
+        const auto t0 = Steady::now();
+        const std::uint64_t bytes = gen.run(c);
+        c.flush();
+        const double s = seconds_since(t0);
+        std::printf("%-28s %7.2f GB/s  %10llu bytes  peak RSS %7.1f MiB\n", "generate+copy only",
+                    static_cast<double>(bytes) / s / 1e9, static_cast<unsigned long long>(bytes),
+                    peak_rss_mib());
+    }
+
+    std::vector<detail::ScanIsa> isas{detail::ScanIsa::Scalar};
+    if (detail::best_scan_isa() >= detail::ScanIsa::Sse42) isas.push_back(detail::ScanIsa::Sse42);
+    if (detail::best_scan_isa() >= detail::ScanIsa::Avx2) isas.push_back(detail::ScanIsa::Avx2);
+    for (detail::ScanIsa isa : isas) {
+        detail::set_scan_isa(isa);
+        body::MultipartParser::Callbacks cb;
+        cb.on_part_data = [&sink](const body::PartInfo&, std::string_view d) {
+            sink += d.size();
+            return true;
+        };
+        body::MultipartParser p(kBoundary, std::move(cb));
+        Chunker c{[&](std::string_view v) { p.feed(v); }};
+        const auto t0 = Steady::now();
+        const std::uint64_t bytes = gen.run(c);
+        c.flush();
+        const double s = seconds_since(t0);
+        const std::string label = std::string("stream ") + detail::scan_isa_name(isa);
+        std::printf("%-28s %7.2f GB/s  %4zu parts %s  peak RSS %7.1f MiB\n", label.c_str(),
+                    static_cast<double>(bytes) / s / 1e9, p.parts(), p.finish() ? "ok " : "BAD",
+                    peak_rss_mib());
+    }
+    detail::set_scan_isa(detail::best_scan_isa());
+
+    if (disk) {
+        body::MultipartUpload up;
+        body::MultipartParser p(kBoundary, body::save_multipart(disk, up));
+        Chunker c{[&](std::string_view v) { p.feed(v); }};
+        const auto t0 = Steady::now();
+        const std::uint64_t bytes = gen.run(c);
+        c.flush();
+        const double s = seconds_since(t0);
+        std::printf("%-28s %7.2f GB/s  %4zu files %s  peak RSS %7.1f MiB\n", "stream to disk",
+                    static_cast<double>(bytes) / s / 1e9, up.files.size(), p.finish() ? "ok " : "BAD",
+                    peak_rss_mib());
+        for (const auto& f : up.files) std::remove(f.path.c_str());
+    }
+
+    // Buffered: the whole body in memory, then every part copied out.
+    {
+        const UploadGen small(std::min<std::uint64_t>(total_mib, 256) << 20);
+        std::string whole;
+        small.run([&](const char* p, std::size_t n) { whole.append(p, n); });
+        Request req;
+        req.mutable_headers()["Content-Type"] = "multipart/form-data; boundary=" + kBoundary;
+        const std::size_t bytes = whole.size();
+        req.set_body_storage(std::move(whole));
+        const auto t0 = Steady::now();
+        auto mp = body::multipart(req);
+        const double s = seconds_since(t0);
+        std::printf("%-28s %7.2f GB/s  %4zu files %s  peak RSS %7.1f MiB (%zu MiB body)\n",
+                    "buffered body::multipart", static_cast<double>(bytes) / s / 1e9,
+                    mp ? mp->files.size() : 0, mp ? "ok " : "BAD", peak_rss_mib(), bytes >> 20);
+    }
+    return sink == 0 ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+// Router lookup microbench: tables of 10, 100 and 1000 routes shaped like
+// a REST API (per resource: list, create, get/put/delete by :id, and a
+// *path wildcard), looked up for the first resource, the last one, a
+// parameterless path and a path with no route. Router::match() (radix tree, params bound for the
+// winner) runs next to a linear scan that splits the path and binds a
+// ParamMap per candidate, the way the router used to.
+// Usage: router_match [iterations]
+#include <socketify/router.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace socketify;
+using Steady = std::chrono::steady_clock;
+
+template <class Fn>
+static double ns_per_op(long iters, Fn&& fn) {
+    auto t0 = Steady::now();
+    for (long i = 0; i < iters; ++i) fn();
+    return std::chrono::duration<double, std::nano>(Steady::now() - t0).count() /
+           static_cast<double>(iters);
+}
+
+namespace {
+
+struct Pattern {
+    Method method;
+    std::string text;
+};
+
+std::vector<std::string_view> split(std::string_view s) {
+    std::vector<std::string_view> out;
+    std::size_t start = 0;
+    while (start < s.size()) {
+        std::size_t pos = s.find('/', start);
+        if (pos == std::string_view::npos) pos = s.size();
+        if (pos > start) out.push_back(s.substr(start, pos - start));
+        start = pos + 1;
+    }
+    return out;
+}
+
+// The pre-tree lookup: every candidate re-splits the path and binds into
+// its own map.
+bool linear_match(const std::vector<Pattern>& table, Method m, std::string_view path, ParamMap& params) {
+    for (const auto& p : table) {
+        if (p.method != m) continue;
+        ParamMap candidate;
+        const auto segs = split(p.text);
+        const auto parts = split(path);
+        std::size_t i = 0, j = 0;
+        bool ok = true;
+        for (; ok && i < parts.size() && j < segs.size(); ++i, ++j) {
+            if (segs[j].front() == ':') candidate[std::string(segs[j].substr(1))] = std::string(parts[i]);
+            else if (segs[j].front() == '*') { i = parts.size(); ++j; break; }
+            else ok = parts[i] == segs[j];
+        }
+        if (!ok || i != parts.size() || (j != segs.size() && segs[j].front() != '*')) continue;
+        params = std::move(candidate);
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const long iters = argc > 1 ? std::atol(argv[1]) : 1000000;
+    std::size_t sink = 0;
+
+    std::printf("%-6s %-8s %12s %12s\n", "routes", "lookup", "tree ns/op", "linear ns/op");
+    for (const int n : {10, 100, 1000}) {
+        Router router;
+        std::vector<Pattern> table;
+        auto add = [&](Method m, std::string text) {
+            router.AddRoute(m, text, [](Request&, Response&) {});
+            table.push_back({m, std::move(text)});
+        };
+        const int resources = n / 5;
+        for (int r = 0; r < resources; ++r) {
+            const std::string base = "/api/v1/resource" + std::to_string(r);
+            add(Method::GET, base);
+            add(Method::POST, base);
+            add(Method::GET, base + "/:id");
+            add(Method::PUT, base + "/:id");
+            add(Method::GET, base + "/:id/files/*path");
+        }
+        router.build();
+
+        const std::string last = "/api/v1/resource" + std::to_string(resources - 1);
+        const struct {
+            const char* name;
+            std::string path;
+        } lookups[] = {{"first", "/api/v1/resource0/42"},
+                       {"last", last + "/42"},
+                       {"wild", last + "/42/files/a/b.txt"},
+                       {"static", last},
+                       {"miss", "/api/v2/none"}};
+        for (const auto& l : lookups) {
+            ParamMap params;
+            const double tree = ns_per_op(iters, [&] {
+                sink += router.match(Method::GET, l.path, &params) != nullptr;
+            });
+            const double linear = ns_per_op(iters / 10 + 1, [&] {
+                sink += linear_match(table, Method::GET, l.path, params);
+            });
+            std::printf("%-6d %-8s %12.1f %12.1f\n", n, l.name, tree, linear);
+        }
+    }
+    return sink == 0 ? 1 : 0;
+}
@@ -0,0 +1,71 @@
+// Response-head serialization microbench (no sockets).
+// Measures detail::serialize_response for a /ping-style JSON reply and a
+// response carrying ten extra headers, plus the Date cache on its own.
+// Usage: serialize_response [iterations]
+#include <socketify/detail/output_queue.h>
+#include <socketify/detail/response_writer.h>
+#include <socketify/request.h>
+#include <socketify/response.h>
+#include <socketify/server.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace socketify;
+using Steady = std::chrono::steady_clock;
+
+template <class Fn>
+static double ns_per_op(long iters, Fn&& fn) {
+    auto t0 = Steady::now();
+    for (long i = 0; i < iters; ++i) fn();
+    return std::chrono::duration<double, std::nano>(Steady::now() - t0).count() /
+           static_cast<double>(iters);
+}
+
+int main(int argc, char** argv) {
+    const long iters = argc > 1 ? std::atol(argv[1]) : 2000000;
+
+    Request req;
+    req.set_version("HTTP/1.1");
+    ServerOptions opts;
+    detail::DateCache date;
+    detail::OutputQueue q;
+    std::size_t sink = 0;
+
+    const double ping = ns_per_op(iters, [&] {
+        Response res;
+        res.set_header("Content-Type", "application/json");
+        res.send(R"({"ok":true})");
+        detail::serialize_response(q, req, res, opts, date.now(), false, false);
+        sink += q.size();
+        q.clear();
+    });
+
+    const double many = ns_per_op(iters, [&] {
+        Response res;
+        res.set_header("Content-Type", "application/json");
+        res.set_header("Cache-Control", "no-store");
+        res.set_header("X-Request-Id", "0123456789abcdef");
+        res.set_header("X-Frame-Options", "DENY");
+        res.set_header("X-Content-Type-Options", "nosniff");
+        res.set_header("Referrer-Policy", "no-referrer");
+        res.set_header("Strict-Transport-Security", "max-age=63072000");
+        res.set_header("Access-Control-Allow-Origin", "*");
+        res.set_header("ETag", "\"abc\"");
+        res.set_header("Vary", "Origin");
+        res.send(R"({"ok":true})");
+        detail::serialize_response(q, req, res, opts, date.now(), false, false);
+        sink += q.size();
+        q.clear();
+    });
+
+    const double date_ns = ns_per_op(iters, [&] { sink += date.now().size(); });
+
+    std::printf("iterations=%ld\n", iters);
+    std::printf("serialize /ping          %8.1f ns/op\n", ping);
+    std::printf("serialize +10 headers    %8.1f ns/op\n", many);
+    std::printf("DateCache::now           %8.1f ns/op\n", date_ns);
+    return sink == 0 ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+// Inbound read-path microbench over a socketpair (in-process, no network).
+// Compares receiving into a 16 KiB stack buffer and appending it to
+// detail::Buffer (the old path) with readv straight into the buffer's spare
+// tail plus a spill area (the current Worker::read_input_ path).
+// Usage: socket_read [megabytes]
+#include <socketify/detail/buffer.h>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace socketify;
+using Steady = std::chrono::steady_clock;
+
+// Stream @p total bytes through a fresh socketpair and time the reader.
+template <class ReadFn>
+static double gb_per_s(std::size_t total, ReadFn&& read_some) {
+    int sv[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) return 0;
+    std::thread writer([&] {
+        std::vector<char> chunk(256 * 1024, 'u');
+        std::size_t left = total;
+        while (left > 0) {
+            ssize_t n = ::write(sv[1], chunk.data(), std::min(left, chunk.size()));
+            if (n <= 0) break;
+            left -= static_cast<std::size_t>(n);
+        }
+        ::close(sv[1]);
+    });
+
+    detail::Buffer in;
+    std::size_t got = 0;
+    auto t0 = Steady::now();
+    while (true) {
+        ssize_t n = read_some(sv[0], in);
+        if (n <= 0) break;
+        got += static_cast<std::size_t>(n);
+        in.consume(in.size()); // stand-in for the parser taking everything
+    }
+    const double secs = std::chrono::duration<double>(Steady::now() - t0).count();
+    writer.join();
+    ::close(sv[0]);
+    return static_cast<double>(got) / secs / 1e9;
+}
+
+int main(int argc, char** argv) {
+    const std::size_t total = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2048) << 20;
+
+    const double bounce = gb_per_s(total, [](int fd, detail::Buffer& in) {
+        char buf[16 * 1024];
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n > 0) in.append(buf, static_cast<std::size_t>(n));
+        return n;
+    });
+
+    const double direct = gb_per_s(total, [](int fd, detail::Buffer& in) {
+        char spill[64 * 1024];
+        iovec iov[2];
+        iov[0].iov_base = in.prepare(0);
+        iov[0].iov_len = in.writable();
+        iov[1].iov_base = spill;
+        iov[1].iov_len = sizeof(spill);
+        ssize_t n = ::readv(fd, iov, 2);
+        if (n > 0) {
+            const auto got = static_cast<std::size_t>(n);
+            const std::size_t head = std::min(got, iov[0].iov_len);
+            in.commit(head);
+            if (got > head) in.append(spill, got - head);
+        }
+        return n;
+    });
+
+    std::printf("bounce 16K + append   %6.2f GB/s\n", bounce);
+    std::printf("readv into tail       %6.2f GB/s\n", direct);
+    return 0;
+}
@@ -0,0 +1,16 @@
+-- wrk script: send N pipelined GET /ping requests per write (default 16).
+-- Usage: wrk -s pipeline.lua http://127.0.0.1:19080 -- 16
+local depth = 16
+
+init = function(args)
+  if args[1] then depth = tonumber(args[1]) end
+  local r = {}
+  for i = 1, depth do
+    r[i] = wrk.format("GET", "/ping")
+  end
+  req = table.concat(r)
+end
+
+request = function()
+  return req
+end
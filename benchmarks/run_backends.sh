@@ -0,0 +1,40 @@
+#!/usr/bin/env bash
+# epoll vs io_uring event-loop backends on /ping, plain and pipelined.
+# Requires the wrk binary from run_all.sh (benchmarks/wrk) or wrk on PATH.
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+BENCH="${ROOT}/benchmarks"
+BUILD="${ROOT}/build-bench"
+DURATION="${DURATION:-8}"
+CONCURRENCY="${CONCURRENCY:-100}"
+DEPTH="${DEPTH:-16}"
+PORT="${PORT:-19080}"
+
+WRK="${BENCH}/wrk"
+[[ -x "${WRK}" ]] || WRK="$(command -v wrk)"
+
+echo "==> build Socketify (Release)"
+cmake -S "${ROOT}" -B "${BUILD}" -DCMAKE_BUILD_TYPE=Release \
+    -DSOCKETIFY_BUILD_EXAMPLES=OFF -DSOCKETIFY_BUILD_TESTS=OFF
+cmake --build "${BUILD}" -j"$(nproc)" --target socketify
+
+g++ -std=c++20 -O3 -DNDEBUG -I"${ROOT}/include" \
+    "${BENCH}/servers/socketify_ping.cpp" "${BUILD}/libsocketify.a" \
+    -lssl -lcrypto -lz -pthread \
+    -o "${BENCH}/servers/socketify_ping"
+
+for backend in epoll uring; do
+  "${BENCH}/servers/socketify_ping" "${PORT}" "${backend}" &
+  PID=$!
+  sleep 0.5
+  echo "==> ${backend}: /ping"
+  "${WRK}" -t4 -c"${CONCURRENCY}" -d"${DURATION}s" --latency \
+      "http://127.0.0.1:${PORT}/ping" | grep -E "Requests/sec|99%"
+  echo "==> ${backend}: /ping pipelined x${DEPTH}"
+  "${WRK}" -t4 -c"${CONCURRENCY}" -d"${DURATION}s" --latency \
+      -s "${BENCH}/pipeline.lua" "http://127.0.0.1:${PORT}" -- "${DEPTH}" \
+      | grep -E "Requests/sec|99%"
+  kill "${PID}"
+  wait "${PID}" 2>/dev/null || true
+done
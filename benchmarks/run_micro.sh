@@ -0,0 +1,30 @@
+#!/usr/bin/env bash
+# Build and run the in-process microbenchmarks in benchmarks/micro/.
+# Usage: ./benchmarks/run_micro.sh [name ...]   (default: all)
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+BENCH="${ROOT}/benchmarks"
+BUILD="${ROOT}/build-bench"
+
+cmake -S "${ROOT}" -B "${BUILD}" -DCMAKE_BUILD_TYPE=Release \
+    -DSOCKETIFY_BUILD_EXAMPLES=OFF -DSOCKETIFY_BUILD_TESTS=OFF
+cmake --build "${BUILD}" -j"$(nproc)" --target socketify
+
+if [[ $# -gt 0 ]]; then
+  NAMES=("$@")
+else
+  NAMES=()
+  for f in "${BENCH}"/micro/*.cpp; do NAMES+=("$(basename "${f}" .cpp)"); done
+fi
+
+mkdir -p "${BUILD}/micro"
+for name in "${NAMES[@]}"; do
+  g++ -std=c++20 -O3 -DNDEBUG \
+      -I"${ROOT}/include" -I"${BUILD}/generated/include" \
+      "${BENCH}/micro/${name}.cpp" "${BUILD}/libsocketify.a" \
+      -lssl -lcrypto -lz -pthread \
+      -o "${BUILD}/micro/${name}"
+  echo "==> ${name}"
+  "${BUILD}/micro/${name}"
+done
@@ -0,0 +1,102 @@
+// Connection-churn microbench: short-lived connections against an
+// in-process server, mimicking load-balancer health checks
+// (connect, GET /health with Connection: close, read, close).
+// Usage: conn_churn [clients] [seconds] [workers]
+#include <socketify/socketify.h>
+
+#include "../bench_client.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace socketify;
+using namespace benchclient;
+using Steady = std::chrono::steady_clock;
+
+static bool one_check(uint16_t port) {
+    const int fd = connect_to(port);
+    if (fd < 0) return false;
+    // RST on close so the client side does not pile up TIME_WAIT sockets.
+    linger lg{1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    static const char req[] = "GET /health HTTP/1.1\r\nHost: lb\r\nConnection: close\r\n\r\n";
+    bool ok = false;
+    if (send_all(fd, req)) {
+        char buf[512];
+        ssize_t n;
+        std::size_t total = 0;
+        while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0) total += static_cast<std::size_t>(n);
+        ok = total > 12 && std::memcmp(buf, "HTTP/1.1 200", 12) == 0;
+    }
+    ::close(fd);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    const int clients = argc > 1 ? std::atoi(argv[1]) : 8;
+    const int seconds = argc > 2 ? std::atoi(argv[2]) : 5;
+    const unsigned workers = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 1;
+
+    ServerOptions opts;
+    opts.workers = workers;
+    Server server(opts);
+    server.Get("/health", [](Request&, Response& res) { res.send("ok"); });
+    if (!server.Run("127.0.0.1", 0)) {
+        std::fprintf(stderr, "bind failed: %s\n", server.last_error().c_str());
+        return 1;
+    }
+    const uint16_t port = server.port();
+
+    std::atomic<bool> stop{false};
+    std::vector<std::vector<double>> lat(static_cast<std::size_t>(clients));
+    std::vector<long> fails(static_cast<std::size_t>(clients), 0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < clients; ++i) {
+        threads.emplace_back([&, i] {
+            auto& l = lat[static_cast<std::size_t>(i)];
+            while (!stop.load(std::memory_order_relaxed)) {
+                auto t0 = Steady::now();
+                if (!one_check(port)) {
+                    ++fails[static_cast<std::size_t>(i)];
+                    continue;
+                }
+                l.push_back(std::chrono::duration<double, std::micro>(Steady::now() - t0).count());
+            }
+        });
+    }
+
+    auto t0 = Steady::now();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop.store(true);
+    for (auto& t : threads) t.join();
+    const double secs = std::chrono::duration<double>(Steady::now() - t0).count();
+
+    std::vector<double> all;
+    long failed = 0;
+    for (std::size_t i = 0; i < lat.size(); ++i) {
+        all.insert(all.end(), lat[i].begin(), lat[i].end());
+        failed += fails[i];
+    }
+    std::sort(all.begin(), all.end());
+    auto pct = [&](double p) {
+        return all.empty() ? 0.0 : all[static_cast<std::size_t>(p * static_cast<double>(all.size() - 1))];
+    };
+
+    std::printf("clients=%d workers=%u seconds=%.1f\n", clients, workers, secs);
+    std::printf("connections/s: %.0f  (ok=%zu failed=%ld)\n",
+                static_cast<double>(all.size()) / secs, all.size(), failed);
+    std::printf("latency p50=%.1fus p99=%.1fus\n", pct(0.50), pct(0.99));
+
+    server.Stop();
+    server.Wait();
+    return 0;
+}
@@ -0,0 +1,98 @@
+// Worker placement bench: keep-alive clients (pinned round-robin across the
+// allowed CPUs) against an in-process server whose workers either float,
+// are pinned, or are pinned with reuseport CPU steering. Reports req/s,
+// latency and the cross-CPU wakeup rate (readable events whose packets were
+// processed on a CPU other than the worker's, via SO_INCOMING_CPU).
+// Usage: cpu_steering [none|pin|steer] [clients] [seconds] [workers]
+#include <socketify/socketify.h>
+#include <socketify/detail/cpu_affinity.h>
+
+#include "../bench_client.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace socketify;
+using namespace benchclient;
+
+static const char kReq[] = "GET /ping HTTP/1.1\r\nHost: bench\r\n\r\n";
+using Steady = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    const std::string mode = argc > 1 ? argv[1] : "steer";
+    const int clients = argc > 2 ? std::atoi(argv[2]) : 8;
+    const int seconds = argc > 3 ? std::atoi(argv[3]) : 5;
+    const unsigned workers = argc > 4 ? static_cast<unsigned>(std::atoi(argv[4]))
+                                      : static_cast<unsigned>(detail::allowed_cpus().size());
+
+    ServerOptions opts;
+    opts.workers = workers;
+    opts.track_cpu_locality = true;
+    opts.pin_workers = mode != "none";
+    opts.numa_local = mode != "none";
+    opts.reuseport_cpu_steering = mode == "steer";
+    Server server(opts);
+    server.Get("/ping", [](Request&, Response& res) { res.send("pong"); });
+    if (!server.Run("127.0.0.1", 0)) {
+        std::fprintf(stderr, "bind failed: %s\n", server.last_error().c_str());
+        return 1;
+    }
+    const uint16_t port = server.port();
+    const std::vector<int> cpus = detail::allowed_cpus();
+
+    std::atomic<bool> stop{false};
+    std::vector<std::vector<double>> lat(static_cast<std::size_t>(clients));
+    std::vector<std::thread> threads;
+    for (int i = 0; i < clients; ++i) {
+        threads.emplace_back([&, i] {
+            if (!cpus.empty()) {
+                detail::pin_current_thread(cpus[static_cast<std::size_t>(i) % cpus.size()]);
+            }
+            auto& l = lat[static_cast<std::size_t>(i)];
+            int fd = connect_to(port);
+            while (fd >= 0 && !stop.load(std::memory_order_relaxed)) {
+                auto t0 = Steady::now();
+                if (!send_all(fd, kReq) || !read_responses(fd, 1)) break;
+                l.push_back(std::chrono::duration<double, std::micro>(Steady::now() - t0).count());
+            }
+            if (fd >= 0) ::close(fd);
+        });
+    }
+
+    auto t0 = Steady::now();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop.store(true);
+    for (auto& t : threads) t.join();
+    const double secs = std::chrono::duration<double>(Steady::now() - t0).count();
+
+    std::vector<double> all;
+    for (const auto& l : lat) all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+    auto pct = [&](double p) {
+        return all.empty() ? 0.0 : all[static_cast<std::size_t>(p * static_cast<double>(all.size() - 1))];
+    };
+    const ServerStats st = server.stats();
+
+    std::printf("mode=%s clients=%d workers=%u seconds=%.1f steering=%s\n", mode.c_str(),
+                clients, workers, secs, server.cpu_steering() ? "on" : "off");
+    std::printf("requests/s: %.0f\n", static_cast<double>(all.size()) / secs);
+    std::printf("latency p50=%.1fus p99=%.1fus\n", pct(0.50), pct(0.99));
+    std::printf("cross-CPU wakeups: %.1f%% (%llu of %llu)\n",
+                st.wakeups ? 100.0 * static_cast<double>(st.cross_cpu_wakeups) /
+                                 static_cast<double>(st.wakeups)
+                           : 0.0,
+                static_cast<unsigned long long>(st.cross_cpu_wakeups),
+                static_cast<unsigned long long>(st.wakeups));
+
+    server.Stop();
+    server.Wait();
+    return 0;
+}
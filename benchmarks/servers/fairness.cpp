@@ -0,0 +1,103 @@
+// Fairness bench: one abusive client pipelines deep batches of requests at
+// a single worker while well-behaved keep-alive clients send one request
+// at a time. Reports the well-behaved clients' latency percentiles and the
+// abuser's throughput, so budget settings can be compared.
+// Usage: fairness [depth] [good_clients] [seconds] [request_budget] [read_budget] [level|edge]
+#include <socketify/socketify.h>
+
+#include "../bench_client.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace socketify;
+using namespace benchclient;
+using Steady = std::chrono::steady_clock;
+
+static const char kReq[] = "GET /ping HTTP/1.1\r\nHost: bench\r\n\r\n";
+
+int main(int argc, char** argv) {
+    const int depth = argc > 1 ? std::atoi(argv[1]) : 1000;
+    const int good = argc > 2 ? std::atoi(argv[2]) : 4;
+    const int seconds = argc > 3 ? std::atoi(argv[3]) : 5;
+    const unsigned request_budget = argc > 4 ? static_cast<unsigned>(std::atoi(argv[4])) : 64;
+    const std::size_t read_budget = argc > 5 ? static_cast<std::size_t>(std::atoll(argv[5]))
+                                             : 256 * 1024;
+    const bool edge = argc > 6 && std::strcmp(argv[6], "edge") == 0;
+
+    ServerOptions opts;
+    opts.workers = 1;
+    opts.request_budget = request_budget;
+    opts.read_budget = read_budget;
+    opts.edge_triggered = edge;
+    Server server(opts);
+    server.Get("/ping", [](Request&, Response& res) { res.send("pong"); });
+    if (!server.Run("127.0.0.1", 0)) {
+        std::fprintf(stderr, "bind failed: %s\n", server.last_error().c_str());
+        return 1;
+    }
+    const uint16_t port = server.port();
+
+    std::atomic<bool> stop{false};
+    std::atomic<long> flooded{0};
+    std::thread abuser([&] {
+        std::string batch;
+        for (int i = 0; i < depth; ++i) batch += kReq;
+        int fd = connect_to(port);
+        while (fd >= 0 && !stop.load(std::memory_order_relaxed)) {
+            if (!send_all(fd, batch) || !read_responses(fd, static_cast<std::size_t>(depth))) break;
+            flooded.fetch_add(depth, std::memory_order_relaxed);
+        }
+        if (fd >= 0) ::close(fd);
+    });
+
+    std::vector<std::vector<double>> lat(static_cast<std::size_t>(good));
+    std::vector<std::thread> threads;
+    for (int i = 0; i < good; ++i) {
+        threads.emplace_back([&, i] {
+            auto& l = lat[static_cast<std::size_t>(i)];
+            int fd = connect_to(port);
+            while (fd >= 0 && !stop.load(std::memory_order_relaxed)) {
+                auto t0 = Steady::now();
+                if (!send_all(fd, kReq) || !read_responses(fd, 1)) break;
+                l.push_back(std::chrono::duration<double, std::micro>(Steady::now() - t0).count());
+            }
+            if (fd >= 0) ::close(fd);
+        });
+    }
+
+    auto t0 = Steady::now();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop.store(true);
+    for (auto& t : threads) t.join();
+    const double secs = std::chrono::duration<double>(Steady::now() - t0).count();
+    // The abuser may be mid-batch; closing the server unblocks it.
+    server.Stop();
+    abuser.join();
+
+    std::vector<double> all;
+    for (const auto& l : lat) all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+    auto pct = [&](double p) {
+        return all.empty() ? 0.0 : all[static_cast<std::size_t>(p * static_cast<double>(all.size() - 1))];
+    };
+
+    std::printf("depth=%d good=%d request_budget=%u read_budget=%zu mode=%s seconds=%.1f\n",
+                depth, good, request_budget, read_budget, edge ? "edge" : "level", secs);
+    std::printf("well-behaved: %.0f req/s  p50=%.1fus p99=%.1fus p99.9=%.1fus max=%.1fus\n",
+                static_cast<double>(all.size()) / secs, pct(0.50), pct(0.99), pct(0.999),
+                all.empty() ? 0.0 : all.back());
+    std::printf("abuser: %.0f req/s\n", static_cast<double>(flooded.load()) / secs);
+    server.Wait();
+    return 0;
+}
@@ -0,0 +1,211 @@
+// h2load-style bench: an in-process server with ServerOptions::http2 on,
+// driven by N client connections that each keep M requests in flight,
+// once as HTTP/1.1 (M pipelined requests per connection) and once as h2c
+// with prior knowledge (M concurrent streams per connection). Reports
+// req/s and per-request latency for both, so the cost of HTTP/2 framing,
+// HPACK and flow control shows up next to the HTTP/1.1 baseline.
+// Usage: h2_load [connections] [streams] [seconds] [workers]
+#include <socketify/socketify.h>
+#include <socketify/detail/hpack.h>
+
+#include "../bench_client.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace socketify;
+using namespace benchclient;
+using Steady = std::chrono::steady_clock;
+
+namespace {
+
+double micros(Steady::time_point from) {
+    return std::chrono::duration<double, std::micro>(Steady::now() - from).count();
+}
+
+// HTTP/1.1: keep `depth` pipelined requests outstanding; every response has
+// the same length (fixed-width Date), measured from the first one.
+void run_h1(uint16_t port, int depth, const std::atomic<bool>& stop, std::vector<double>& lat) {
+    const int fd = connect_to(port);
+    if (fd < 0) return;
+    static const std::string_view req = "GET /ping HTTP/1.1\r\nHost: bench\r\n\r\n";
+    std::deque<Steady::time_point> sent;
+    std::string batch;
+    for (int i = 0; i < depth; ++i) batch += req;
+    for (int i = 0; i < depth; ++i) sent.push_back(Steady::now());
+    if (!send_all(fd, batch)) return;
+
+    std::string buf;
+    std::size_t resp_len = 0;
+    char chunk[65536];
+    while (!stop.load(std::memory_order_relaxed)) {
+        const ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) break;
+        buf.append(chunk, static_cast<std::size_t>(n));
+        if (resp_len == 0) {
+            const auto end = buf.find("\r\n\r\n");
+            if (end == std::string::npos) continue;
+            resp_len = end + 4 + 2; // body "ok"
+        }
+        std::size_t done = buf.size() / resp_len;
+        buf.erase(0, done * resp_len);
+        batch.clear();
+        for (; done > 0; --done) {
+            lat.push_back(micros(sent.front()));
+            sent.pop_front();
+            sent.push_back(Steady::now());
+            batch += req;
+        }
+        if (!batch.empty() && !send_all(fd, batch)) break;
+    }
+    ::close(fd);
+}
+
+std::string h2_frame(std::uint8_t type, std::uint8_t flags, std::uint32_t stream, std::string_view payload) {
+    std::string out;
+    const auto len = payload.size();
+    out += {static_cast<char>(len >> 16), static_cast<char>(len >> 8), static_cast<char>(len),
+            static_cast<char>(type), static_cast<char>(flags), static_cast<char>(stream >> 24),
+            static_cast<char>(stream >> 16), static_cast<char>(stream >> 8), static_cast<char>(stream)};
+    out.append(payload);
+    return out;
+}
+
+std::string be32(std::uint32_t v) {
+    return {static_cast<char>(v >> 24), static_cast<char>(v >> 16), static_cast<char>(v >> 8),
+            static_cast<char>(v)};
+}
+
+// h2c: keep `depth` streams open; a stream is done at END_STREAM. Response
+// header blocks are not decoded: the fields are not needed and HPACK
+// decoding is the server's cost, not the client's.
+void run_h2(uint16_t port, int depth, const std::atomic<bool>& stop, std::vector<double>& lat) {
+    const int fd = connect_to(port);
+    if (fd < 0) return;
+    detail::hpack::Encoder enc;
+    std::uint32_t next_id = 1;
+    std::unordered_map<std::uint32_t, Steady::time_point> open;
+    std::string out = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+    out += h2_frame(0x4, 0, 0, std::string("\x00\x04", 2) + be32(0x7fffffff)); // INITIAL_WINDOW_SIZE
+    out += h2_frame(0x8, 0, 0, be32(0x7fffffff - 65535));
+    auto request = [&] {
+        std::string block;
+        enc.field(block, ":method", "GET");
+        enc.field(block, ":scheme", "http");
+        enc.field(block, ":path", "/ping");
+        enc.field(block, ":authority", "bench");
+        out += h2_frame(0x1, 0x4 | 0x1, next_id, block);
+        open.emplace(next_id, Steady::now());
+        next_id += 2;
+    };
+    for (int i = 0; i < depth; ++i) request();
+    if (!send_all(fd, out)) return;
+
+    std::string buf;
+    std::uint64_t data_seen = 0;
+    char chunk[65536];
+    while (!stop.load(std::memory_order_relaxed)) {
+        const ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) break;
+        buf.append(chunk, static_cast<std::size_t>(n));
+        out.clear();
+        std::size_t pos = 0;
+        while (buf.size() - pos >= 9) {
+            const auto* u = reinterpret_cast<const unsigned char*>(buf.data() + pos);
+            const std::size_t len = (std::size_t{u[0]} << 16) | (std::size_t{u[1]} << 8) | u[2];
+            if (buf.size() - pos - 9 < len) break;
+            const std::uint8_t type = u[3];
+            const std::uint8_t flags = u[4];
+            const std::uint32_t id =
+                ((std::uint32_t{u[5]} << 24) | (std::uint32_t{u[6]} << 16) | (std::uint32_t{u[7]} << 8) | u[8]) &
+                0x7fffffff;
+            if (type == 0x4 && (flags & 0x1) == 0) out += h2_frame(0x4, 0x1, 0, {});
+            if (type == 0x0) data_seen += len;
+            if ((type == 0x0 || type == 0x1) && (flags & 0x1) != 0) {
+                if (auto it = open.find(id); it != open.end()) {
+                    lat.push_back(micros(it->second));
+                    open.erase(it);
+                    request();
+                }
+            }
+            if (type == 0x3) open.erase(id);
+            pos += 9 + len;
+        }
+        buf.erase(0, pos);
+        if (data_seen >= (1u << 30)) {
+            out += h2_frame(0x8, 0, 0, be32(static_cast<std::uint32_t>(data_seen)));
+            data_seen = 0;
+        }
+        if (!out.empty() && !send_all(fd, out)) break;
+    }
+    ::close(fd);
+}
+
+void report(const char* name, std::vector<std::vector<double>>& lat, double secs) {
+    std::vector<double> all;
+    for (auto& l : lat) all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+    auto pct = [&](double p) {
+        return all.empty() ? 0.0 : all[static_cast<std::size_t>(p * static_cast<double>(all.size() - 1))];
+    };
+    std::printf("%-8s req/s: %9.0f  latency p50=%.1fus p99=%.1fus\n", name,
+                static_cast<double>(all.size()) / secs, pct(0.50), pct(0.99));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int conns = argc > 1 ? std::atoi(argv[1]) : 4;
+    const int streams = argc > 2 ? std::atoi(argv[2]) : 32;
+    const int seconds = argc > 3 ? std::atoi(argv[3]) : 5;
+    const unsigned workers = argc > 4 ? static_cast<unsigned>(std::atoi(argv[4])) : 1;
+
+    ServerOptions opts;
+    opts.workers = workers;
+    opts.http2 = true;
+    Server server(opts);
+    server.Get("/ping", [](Request&, Response& res) { res.send("ok"); });
+    if (!server.Run("127.0.0.1", 0)) {
+        std::fprintf(stderr, "bind failed: %s\n", server.last_error().c_str());
+        return 1;
+    }
+    const uint16_t port = server.port();
+    std::printf("connections=%d streams=%d workers=%u seconds=%d\n", conns, streams, workers, seconds);
+
+    for (const bool h2 : {false, true}) {
+        std::atomic<bool> stop{false};
+        std::vector<std::vector<double>> lat(static_cast<std::size_t>(conns));
+        std::vector<std::thread> threads;
+        for (int i = 0; i < conns; ++i) {
+            threads.emplace_back([&, i] {
+                auto& l = lat[static_cast<std::size_t>(i)];
+                if (h2) run_h2(port, streams, stop, l);
+                else run_h1(port, streams, stop, l);
+            });
+        }
+        const auto t0 = Steady::now();
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        stop.store(true);
+        const double secs = std::chrono::duration<double>(Steady::now() - t0).count();
+        for (auto& t : threads) t.join(); // requests are always in flight, so recv() returns
+        report(h2 ? "h2c" : "http/1.1", lat, secs);
+    }
+
+    server.Stop();
+    server.Wait();
+    return 0;
+}
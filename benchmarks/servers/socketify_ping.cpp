@@ -1,7 +1,9 @@
 // Minimal ping server for throughput benchmarks.
+// Usage: socketify_ping [port] [epoll|uring]
 #include <socketify/socketify.h>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 using namespace socketify;
 
@@ -12,6 +14,7 @@ int main(int argc, char** argv) {
     ServerOptions opts;
     opts.workers = 0; // all cores
     opts.compression.min_size = 1u << 30; // effectively off for tiny /ping bodies
+    if (argc > 2 && std::strcmp(argv[2], "uring") == 0) opts.io_backend = IoBackend::IoUring;
     Server server(opts);
 
     server.Get("/ping", [](Request&, Response& res) {
@@ -23,7 +26,8 @@ int main(int argc, char** argv) {
         std::fprintf(stderr, "bind failed: %s\n", server.last_error().c_str());
         return 1;
     }
-    std::fprintf(stderr, "socketify ping on %u\n", server.port());
+    std::fprintf(stderr, "socketify ping on %u (%s)\n", server.port(),
+                 server.io_backend() == IoBackend::IoUring ? "io_uring" : "epoll");
     server.Wait();
     return 0;
 }
@@ -16,14 +16,23 @@
  *     res.send("ok\n");
  * });
  * @endcode
+ *
+ * For large uploads, MultipartParser takes the body in pieces (from a
+ * Route::OnBody() handler) and hands each part's bytes on as they arrive,
+ * so memory stays constant whatever the file sizes; save_multipart()
+ * writes the file parts straight to disk.
  */
 
 #include "socketify/request.h"
 
 #include <nlohmann/json.hpp>
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -63,6 +72,123 @@ struct MultipartData {
  */
 std::optional<MultipartData> multipart(const Request& req);
 
+/**
+ * @brief The boundary parameter of a multipart Content-Type ("" when
+ *        absent or not multipart).
+ */
+std::string multipart_boundary(const Request& req);
+
+/** @brief Headers of one multipart part. */
+struct PartInfo {
+    std::string name;         ///< Form field name.
+    std::string filename;     ///< Client-provided file name ("" for fields).
+    std::string content_type; ///< Part Content-Type ("" when absent).
+    /** @brief True for file parts (a filename or a Content-Type was sent). */
+    bool is_file() const noexcept { return !filename.empty() || !content_type.empty(); }
+};
+
+/**
+ * @brief Push parser for multipart/form-data bodies.
+ *
+ * Feed the body in pieces of any size; each part's data reaches
+ * Callbacks::on_part_data as views into the fed bytes (a piece of a
+ * delimiter split across feeds is held back and delivered from a small
+ * internal buffer). Memory use is bounded by the part-header limit,
+ * independent of part sizes. Delimiters are found with the vectorized
+ * search of detail/http_scan.h.
+ *
+ * @code
+ * auto mp = std::make_shared<body::MultipartParser>(boundary, body::MultipartParser::Callbacks{
+ *     .on_part_data = [](const body::PartInfo& part, std::string_view data) {
+ *         return sink(part.name, data);           // false aborts the parse
+ *     }});
+ * mp->feed(chunk);                                // per body piece
+ * if (!mp->finish()) reject(mp->error());         // after the last piece
+ * @endcode
+ */
+class MultipartParser {
+public:
+    /** @brief Part events; any may be empty. */
+    struct Callbacks {
+        std::function<void(const PartInfo&)> on_part_begin;
+        /// Called zero or more times per part; false stops with an error.
+        std::function<bool(const PartInfo&, std::string_view data)> on_part_data;
+        std::function<void(const PartInfo&)> on_part_end;
+    };
+
+    /**
+     * @param boundary  The Content-Type boundary (see multipart_boundary()).
+     *                  1-70 characters without CR or LF, else the parser
+     *                  starts in the error state.
+     * @param cb        Part events.
+     * @param max_header_bytes Cap on one part's header block.
+     */
+    MultipartParser(std::string_view boundary, Callbacks cb, std::size_t max_header_bytes = 16 * 1024);
+
+    /**
+     * @brief Parse the next piece of the body.
+     * @return false once the body is malformed or a callback said stop.
+     */
+    bool feed(std::string_view chunk);
+
+    /** @brief End of input: true when the closing delimiter was seen. */
+    bool finish();
+
+    /** @brief True after the closing delimiter (the epilogue is ignored). */
+    bool done() const noexcept { return state_ == State::Epilogue; }
+    /** @brief True after a parse error. */
+    bool failed() const noexcept { return state_ == State::Error; }
+    /** @brief Why parsing failed ("" otherwise). */
+    const std::string& error() const noexcept { return error_; }
+    /** @brief Parts begun so far. */
+    std::size_t parts() const noexcept { return parts_; }
+
+private:
+    enum class State : std::uint8_t {
+        Preamble, AfterDelimiter, CloseDash, DelimiterLf, Headers, Data, Epilogue, Error
+    };
+
+    std::size_t scan_data_(std::string_view in);
+    bool emit_(std::string_view data);
+    void header_line_(std::string_view line);
+    void fail_(std::string msg);
+
+    std::string delim_; ///< "\r\n--" + boundary
+    Callbacks cb_;
+    std::size_t max_header_bytes_;
+    State state_{State::Preamble};
+    std::string carry_;  ///< held-back prefix of delim_ (or the virtual leading CRLF)
+    std::string line_;   ///< partial header line
+    std::size_t header_bytes_{0};
+    PartInfo part_;
+    std::size_t parts_{0};
+    std::string error_;
+};
+
+/** @brief A file part written to disk by save_multipart(). */
+struct SavedFile {
+    std::string name;         ///< Form field name.
+    std::string filename;     ///< Client-provided file name.
+    std::string content_type; ///< Part Content-Type ("" when absent).
+    std::string path;         ///< Where the bytes are (caller removes it).
+    std::uint64_t size{0};    ///< Bytes written.
+};
+
+/** @brief Result of a multipart upload parsed with save_multipart(). */
+struct MultipartUpload {
+    ParamMap fields;              ///< Non-file form fields.
+    std::vector<SavedFile> files; ///< Stored files, in order of appearance.
+};
+
+/**
+ * @brief Callbacks that write each file part to a new file in @p dir
+ *        ("upload-XXXXXX") and collect the other fields into @p out.
+ *        A field longer than @p max_field_bytes or a failed write stops
+ *        the parse. @p out must outlive the parser.
+ */
+MultipartParser::Callbacks save_multipart(std::string dir, MultipartUpload& out,
+                                          std::size_t max_field_bytes = 64 * 1024);
+
 /** @brief True when the Content-Type is application/json (params ignored). */
 bool is_json(const Request& req);
 /** @brief True when the Content-Type is application/x-www-form-urlencoded. */
@@ -0,0 +1,75 @@
+#pragma once
+/**
+ * @file body_stream.h
+ * @brief Streaming request bodies: receive upload bytes as they arrive.
+ *
+ * A route with an OnBody() handler gets the request body in pieces instead
+ * of one buffered string, so uploads of any size run in constant memory:
+ *
+ * @code
+ * server.Post("/upload", [](Request&, Response& res) {
+ *     res.send("stored\n");                    // runs once the body is in
+ * }).OnBody([](Request& req, std::string_view chunk, BodyStream& s) {
+ *     append_to_store(req.path(), chunk);      // runs per received piece
+ *     if (store_is_behind()) {
+ *         s.pause();                           // stop reading the socket
+ *         when_store_drains([s]() mutable { s.resume(); });
+ *     }
+ * });
+ * @endcode
+ *
+ * The body handler runs on the worker loop with the request head (method,
+ * path, params, headers); Request::body() stays empty. After the last
+ * piece, middleware and the ordinary handler run as for any request.
+ * A paused stream reads nothing from the client, and the read timeout is
+ * off while it waits. ServerOptions::max_stream_body_size caps bodies of
+ * streaming routes separately from max_body_size.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+namespace socketify {
+
+class Request;
+
+/**
+ * @brief Flow-control handle for one streamed request body.
+ *
+ * Copies share the same stream; pause() and resume() may be called from
+ * any thread.
+ */
+class BodyStream {
+public:
+    struct Impl; ///< Internal shared state (server-managed).
+
+    BodyStream() = default;
+    /** @brief Internal: wrap the shared state. */
+    explicit BodyStream(std::shared_ptr<Impl> impl) : impl_(std::move(impl)) {}
+
+    /** @brief Stop reading the body after the current piece. */
+    void pause();
+
+    /** @brief Continue reading a paused body. */
+    void resume();
+
+    /** @brief True while paused. */
+    bool paused() const;
+
+    /** @brief Body bytes delivered so far. */
+    std::uint64_t received() const;
+
+    /** @brief True when this handle is bound to a request. */
+    bool valid() const noexcept { return impl_ != nullptr; }
+
+private:
+    std::shared_ptr<Impl> impl_;
+};
+
+/** @brief Receives one piece of a streamed request body. */
+using BodyHandler = std::function<void(Request&, std::string_view chunk, BodyStream&)>;
+
+} // namespace socketify
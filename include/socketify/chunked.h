@@ -0,0 +1,112 @@
+#pragma once
+/**
+ * @file chunked.h
+ * @brief Producer-driven chunked responses on keep-alive connections.
+ *
+ * Start a stream inside a normal handler; the returned Writer is a
+ * thread-safe handle that outlives the handler and sends each write() as
+ * one `Transfer-Encoding: chunked` chunk. After end() the connection goes
+ * back to keep-alive and serves the next request:
+ *
+ * @code
+ * server.Get("/export.csv", [&jobs](Request& req, Response& res) {
+ *     res.set_content_type("text/csv");
+ *     chunked::Writer w = chunked::start(req, res);
+ *     jobs.submit([w]() mutable {
+ *         for (auto& row : db.rows()) w.write(to_csv(row));  // blocks when the client is slow
+ *         w.trailer("X-Row-Count", std::to_string(db.count()));
+ *         w.end();
+ *     });
+ * });
+ * @endcode
+ */
+
+#include "socketify/request.h"
+#include "socketify/response.h"
+
+#include <functional>
+#include <memory>
+#include <string_view>
+
+namespace socketify::chunked {
+
+/**
+ * @brief Thread-safe handle to a chunked response body.
+ *
+ * Copies share the same stream. Backpressure: once the unwritten backlog
+ * passes ServerOptions::output_high_water, write() blocks until it falls to
+ * output_low_water. On any worker's event loop (handlers, Pulse callbacks,
+ * resumed coroutines) it never blocks: write() is accepted while ready()
+ * and returns false past the mark, with the stream still alive; continue
+ * from on_drain() there. end() is never refused. Dropping every handle
+ * without end() aborts the stream: the connection closes without the last
+ * chunk, so the client sees a truncated body.
+ *
+ * An HTTP/1.0 client gets the body unframed and the connection closes at
+ * end(); trailers are dropped. For HEAD requests only the head is sent:
+ * what the handler wrote is discarded and later writes return false.
+ */
+class Writer {
+public:
+    struct Impl; ///< Internal shared state (server-managed).
+
+    Writer() = default;
+    /** @brief Internal: wrap the shared state. */
+    explicit Writer(std::shared_ptr<Impl> impl) : impl_(std::move(impl)) {}
+
+    /**
+     * @brief Send @p data as one chunk (empty data sends nothing).
+     * @return false after end(), once the client disconnected, or on an
+     *         event loop while the backlog is past the high mark.
+     */
+    bool write(std::string_view data);
+
+    /**
+     * @brief Add a trailer field, sent after the last chunk by end().
+     * @return false after end(), or when the name is not a token or the
+     *         value holds control characters other than tab.
+     */
+    bool trailer(std::string_view name, std::string_view value);
+
+    /**
+     * @brief Finish the body: the last chunk and the trailers. Exactly
+     *        one end() takes effect.
+     * @return false when already ended or the client disconnected.
+     */
+    bool end();
+
+    /** @brief Close the connection without finishing the body. */
+    void abort();
+
+    /** @brief True until end() or until the client disconnects. */
+    bool alive() const;
+
+    /** @brief True while the backlog is at or below output_high_water. */
+    bool ready() const;
+
+    /**
+     * @brief Run @p fn once when the backlog falls to output_low_water, on
+     *        the connection's worker thread (at once, on the calling
+     *        thread, when it already has). Not called once the stream is
+     *        gone.
+     */
+    void on_drain(std::function<void()> fn);
+
+    /** @brief True when this handle is bound to a response. */
+    bool valid() const noexcept { return impl_ != nullptr; }
+
+private:
+    std::shared_ptr<Impl> impl_;
+};
+
+/**
+ * @brief Turn the current response into a chunked stream.
+ *
+ * Status and headers already set on @p res are kept; the server sends the
+ * head when the handler returns, then whatever the Writer produces.
+ *
+ * @return A Writer for the body (also usable from other threads).
+ */
+Writer start(Request& req, Response& res);
+
+} // namespace socketify::chunked
@@ -56,6 +56,15 @@ bool is_compressible_type(std::string_view ct, const Options& opts);
  */
 Encoding negotiate_accept_encoding(std::string_view accept_enc, const Options& opts);
 
+/**
+ * @brief Weight an Accept-Encoding header value gives @p coding (e.g. "br").
+ *
+ * Parses the q-values: an explicit entry for the coding wins over "*";
+ * a coding that is not listed (and no "*") gets 0.
+ * @return q in [0, 1]; 0 means not acceptable.
+ */
+double accept_encoding_q(std::string_view accept_enc, std::string_view coding);
+
 /**
  * @brief gzip-compress @p src into @p out.
  * @param src   Bytes to compress.
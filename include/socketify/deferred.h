@@ -0,0 +1,93 @@
+#pragma once
+/**
+ * @file deferred.h
+ * @brief Deferred responses: return from the handler now, answer later.
+ *
+ * A handler that waits on something slow (a database, another service)
+ * can hand the response to a Deferred and return at once; the worker keeps
+ * serving other connections and sends the response when the handle is
+ * finished, from any thread:
+ *
+ * @code
+ * server.Get("/report", [&jobs](Request& req, Response& res) {
+ *     Deferred d = defer(res);
+ *     jobs.submit([d, id = std::string(req.query_value("id"))]() mutable {
+ *         d.json(build_report(id));           // runs on a job thread
+ *     });
+ * });
+ * @endcode
+ *
+ * Headers already set on the response (e.g. by middleware) are kept. Later
+ * pipelined requests on the same connection wait for the deferred one, so
+ * responses stay in order. If every handle is dropped without finishing,
+ * the client gets a 500.
+ *
+ * For plain blocking code, Route::Blocking() is simpler: the server runs
+ * the handler on the ServerOptions::blocking_threads pool and defers for
+ * you.
+ */
+
+#include "socketify/http.h"
+#include "socketify/response.h"
+
+#include <nlohmann/json.hpp>
+
+#include <functional>
+#include <memory>
+#include <string_view>
+
+namespace socketify {
+
+/**
+ * @brief Thread-safe handle to a response that is finished later.
+ *
+ * Copies share the same response. Exactly one finish (send(), json(),
+ * send_status() or finish()) takes effect; later ones return false.
+ */
+class Deferred {
+public:
+    struct Impl; ///< Internal shared state (server-managed).
+
+    Deferred() = default;
+    /** @brief Internal: wrap the shared state. */
+    explicit Deferred(std::shared_ptr<Impl> impl) : impl_(std::move(impl)) {}
+
+    /**
+     * @brief Fill in the response under the handle's lock and send it.
+     * @param fill Called with the pending response; anything it leaves
+     *             unended is ended with what it has (200 by default).
+     * @return false when already finished or the client went away.
+     */
+    bool finish(const std::function<void(Response&)>& fill);
+
+    /** @brief Finish with @p body (see Response::send()). */
+    bool send(std::string_view body, std::string_view content_type = "text/plain; charset=utf-8");
+
+    /** @brief Finish with a JSON body (see Response::json()). */
+    bool json(const nlohmann::json& j);
+
+    /** @brief Finish with a status code and its reason phrase. */
+    bool send_status(Status s);
+
+    /** @brief True until finished or the client disconnects. */
+    bool alive() const;
+
+    /** @brief True when this handle is bound to a response. */
+    bool valid() const noexcept { return impl_ != nullptr; }
+
+private:
+    std::shared_ptr<Impl> impl_;
+};
+
+/**
+ * @brief Take over @p res: the handler may return without ending it.
+ *
+ * After this call @p res is an empty placeholder; use the returned handle
+ * for everything else (middleware running after the handler sees the
+ * placeholder, not the final response).
+ *
+ * @return An invalid handle when @p res was already ended.
+ */
+Deferred defer(Response& res);
+
+} // namespace socketify
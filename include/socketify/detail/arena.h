@@ -0,0 +1,74 @@
+#pragma once
+/**
+ * @file arena.h
+ * @brief Request-scoped monotonic memory for Request/Response internals.
+ *
+ * The router's temporaries, the Response header map and Set-Cookie list
+ * and the Request locals are allocated from the worker's arena and freed
+ * all at once when the response has been serialized, instead of node by
+ * node through the global heap.
+ */
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+namespace socketify::detail {
+
+/**
+ * @brief A monotonic arena rewound after every request (not thread-safe).
+ *
+ * The first block is allocated on first use, i.e. on the worker thread,
+ * and reused for every request, so a request that fits in it costs no
+ * heap allocation for its arena-backed containers. A request that needs
+ * more spills into blocks from the default resource, which release()
+ * returns. A size of 0 disables the arena: resource() is then the default
+ * resource (the global heap).
+ */
+class RequestArena {
+public:
+    explicit RequestArena(std::size_t size) noexcept : size_(size) {}
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    /** @brief Memory for the request in progress. */
+    std::pmr::memory_resource* resource() {
+        if (size_ == 0) return std::pmr::get_default_resource();
+        if (!mono_) {
+            block_ = std::make_unique<std::byte[]>(size_);
+            mono_.emplace(block_.get(), size_, std::pmr::get_default_resource());
+        }
+        return &*mono_;
+    }
+
+    /** @brief Free everything handed out; the first block is kept. */
+    void release() noexcept {
+        if (mono_) mono_->release();
+    }
+
+    /**
+     * @brief Marks a request in progress. The outermost scope releases the
+     *        arena, so it must outlive every object allocated from it.
+     */
+    class Scope {
+    public:
+        explicit Scope(RequestArena& arena) noexcept : arena_(arena) { ++arena_.depth_; }
+        ~Scope() {
+            if (--arena_.depth_ == 0) arena_.release();
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        RequestArena& arena_;
+    };
+
+private:
+    std::size_t size_;
+    unsigned depth_{0};
+    std::unique_ptr<std::byte[]> block_;
+    std::optional<std::pmr::monotonic_buffer_resource> mono_;
+};
+
+} // namespace socketify::detail
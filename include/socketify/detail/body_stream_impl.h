@@ -0,0 +1,32 @@
+#pragma once
+/**
+ * @file body_stream_impl.h
+ * @brief Shared state between a BodyStream handle and the connection that
+ *        reads the body. Internal API.
+ */
+
+#include "socketify/body_stream.h"
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+namespace socketify {
+
+/**
+ * @brief Internal shared state for one streamed body.
+ *
+ * The worker checks @ref paused after each piece; resume() calls
+ * @ref notify, which posts to the owning loop. Once the body is complete
+ * or the connection goes away the worker sets @ref closed and drops
+ * @ref notify, and later calls are no-ops.
+ */
+struct BodyStream::Impl {
+    mutable std::mutex mu;
+    bool paused{false};
+    bool closed{false};
+    std::uint64_t received{0};
+    std::function<void()> notify; ///< Posts a resume to the owning loop.
+};
+
+} // namespace socketify
@@ -5,11 +5,13 @@
  *
  * The buffer keeps a single contiguous allocation with a read cursor, so
  * consuming from the front is O(1) and the storage is compacted lazily.
+ * Readers can receive straight into the writable tail (prepare/commit)
+ * instead of bouncing through a temporary.
  */
 
 #include <cstddef>
 #include <cstring>
-#include <string>
+#include <memory>
 #include <string_view>
 
 namespace socketify::detail {
@@ -17,32 +19,58 @@ namespace socketify::detail {
 /**
  * @brief FIFO byte buffer with cheap front-consumption.
  *
- * Producers call append(); consumers call data()/size() then consume(n).
- * Memory is reclaimed automatically once the read cursor grows large.
+ * Producers call append(), or prepare() + commit() to fill the tail in
+ * place; consumers call data()/size() then consume(n). The consumed prefix
+ * is reclaimed when the tail next needs room. Spare capacity is not
+ * zero-filled.
  */
 class Buffer {
 public:
     Buffer() = default;
+    Buffer(Buffer&&) noexcept = default;
+    Buffer& operator=(Buffer&&) noexcept = default;
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
 
     /** @brief Append raw bytes to the end of the buffer. */
     void append(const char* p, std::size_t n) {
         if (n == 0) return;
-        maybe_compact_();
-        storage_.append(p, n);
+        std::memcpy(prepare(n), p, n);
+        tail_ += n;
     }
 
     /** @brief Append a string view. */
     void append(std::string_view sv) { append(sv.data(), sv.size()); }
 
+    /**
+     * @brief Make at least @p n bytes writable at the tail.
+     * @return Start of the writable region (writable() bytes long); valid
+     *         until the next call that may reallocate. prepare(0) never
+     *         reallocates: it exposes the spare room as it is.
+     */
+    char* prepare(std::size_t n) {
+        if (cap_ - tail_ < n) make_room_(n);
+        return data_.get() + tail_;
+    }
+
+    /** @brief Bytes that can be written after the last prepare(). */
+    std::size_t writable() const noexcept { return cap_ - tail_; }
+
+    /** @brief Publish @p n bytes written into the prepared region. */
+    void commit(std::size_t n) noexcept { tail_ += n <= writable() ? n : writable(); }
+
     /** @brief Pointer to the first unread byte. */
-    const char* data() const noexcept { return storage_.data() + head_; }
+    const char* data() const noexcept { return data_.get() + head_; }
 
     /** @brief Number of unread bytes. */
-    std::size_t size() const noexcept { return storage_.size() - head_; }
+    std::size_t size() const noexcept { return tail_ - head_; }
 
     /** @brief True when there are no unread bytes. */
     bool empty() const noexcept { return size() == 0; }
 
+    /** @brief Bytes currently allocated (read + unread + spare). */
+    std::size_t capacity() const noexcept { return cap_; }
+
     /** @brief View over the unread bytes. */
     std::string_view view() const noexcept { return {data(), size()}; }
 
@@ -52,29 +80,53 @@ public:
      */
     void consume(std::size_t n) {
         head_ += (n > size()) ? size() : n;
-        if (head_ == storage_.size()) {
-            storage_.clear();
-            head_ = 0;
-        }
+        if (head_ == tail_) head_ = tail_ = 0;
     }
 
-    /** @brief Drop all content. */
-    void clear() noexcept {
-        storage_.clear();
-        head_ = 0;
+    /**
+     * @brief Remove @p n unread bytes starting @p off bytes into data(),
+     * moving the bytes after them down. Both are clamped to size().
+     */
+    void erase(std::size_t off, std::size_t n) {
+        const std::size_t live = size();
+        if (off >= live) return;
+        if (n > live - off) n = live - off;
+        char* p = data_.get() + head_ + off;
+        std::memmove(p, p + n, live - off - n);
+        tail_ -= n;
+        if (head_ == tail_) head_ = tail_ = 0;
     }
 
+    /** @brief Drop all content. */
+    void clear() noexcept { head_ = tail_ = 0; }
+
 private:
-    void maybe_compact_() {
-        // Compact when the dead prefix dominates the allocation.
-        if (head_ > 4096 && head_ > storage_.size() / 2) {
-            storage_.erase(0, head_);
+    void make_room_(std::size_t n) {
+        const std::size_t live = size();
+        // Slide the live bytes down when that frees enough room and leaves
+        // the allocation at most half full; otherwise grow geometrically.
+        if (cap_ - live >= n && live <= cap_ / 2) {
+            std::memmove(data_.get(), data_.get() + head_, live);
             head_ = 0;
+            tail_ = live;
+            return;
         }
+        std::size_t want = cap_ ? cap_ * 2 : kMinCapacity;
+        while (want < live + n) want *= 2;
+        std::unique_ptr<char[]> grown(new char[want]);
+        if (live) std::memcpy(grown.get(), data_.get() + head_, live);
+        data_ = std::move(grown);
+        cap_ = want;
+        head_ = 0;
+        tail_ = live;
     }
 
-    std::string storage_;
+    static constexpr std::size_t kMinCapacity = 4096;
+
+    std::unique_ptr<char[]> data_;
+    std::size_t cap_{0};
     std::size_t head_{0};
+    std::size_t tail_{0};
 };
 
 } // namespace socketify::detail
@@ -0,0 +1,51 @@
+#pragma once
+/**
+ * @file chunked_impl.h
+ * @brief Shared state between a chunked::Writer handle and the server
+ *        connection that owns the socket. Internal API.
+ */
+
+#include "socketify/chunked.h"
+#include "socketify/detail/stream_limit.h"
+
+#include <functional>
+#include <mutex>
+#include <string>
+
+namespace socketify::chunked {
+
+/**
+ * @brief Internal shared state for one chunked response.
+ *
+ * Writers append framed chunks to @ref pending under @ref mu and invoke
+ * @ref notify, which the server wires to "flush this connection on its
+ * event-loop thread", as for SSE. Once @ref ended is set and pending has
+ * drained, the worker hands the connection back to HTTP keep-alive.
+ */
+struct Writer::Impl {
+    std::mutex mu;
+    std::string pending;           ///< Bytes waiting to be written.
+    std::string trailers;          ///< "Name: value\r\n" lines for end().
+    bool framed{true};             ///< Chunked framing; false for HTTP/1.0.
+    bool ended{false};             ///< end() queued the last chunk.
+    bool closed{false};            ///< Connection is gone (or HEAD); drop writes.
+    bool close_requested{false};   ///< abort(), or every handle dropped early.
+    std::function<void()> notify;  ///< Wakes the owning event loop.
+    std::function<void()> drain;   ///< on_drain() callback.
+    detail::StreamLimit limit;     ///< Always OverflowAction::Block; see limit_stream().
+};
+
+/**
+ * @brief Limit @p impl by the worker's marks (lock held or not yet shared).
+ *
+ * Dropping or cutting a chunk would corrupt the body, so writes block;
+ * an event loop, which can not wait, gets false from write() past the
+ * high mark and continues from on_drain().
+ */
+inline void limit_stream(Writer::Impl& impl, const detail::StreamPolicy& policy) {
+    impl.limit.apply(policy);
+    impl.limit.action = detail::OverflowAction::Block;
+    impl.limit.loop_fallback = detail::OverflowAction::Drop;
+}
+
+} // namespace socketify::chunked
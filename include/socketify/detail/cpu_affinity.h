@@ -0,0 +1,48 @@
+#pragma once
+/**
+ * @file cpu_affinity.h
+ * @brief Worker CPU placement: pinning, NUMA-local memory policy and
+ *        SO_REUSEPORT steering by receiving CPU (Linux).
+ */
+
+#include <string>
+#include <vector>
+
+namespace socketify::detail {
+
+/** @brief CPUs the calling process may run on, ascending. */
+std::vector<int> allowed_cpus();
+
+/**
+ * @brief CPU for each of @p workers workers.
+ * @param requested Explicit list, reused round-robin; when empty the
+ *                  allowed CPUs are used in order.
+ */
+std::vector<int> plan_worker_cpus(const std::vector<int>& requested, unsigned workers);
+
+/** @brief Restrict the calling thread to @p cpu. */
+bool pin_current_thread(int cpu);
+
+/**
+ * @brief Make the calling thread's future allocations node-local
+ *        (MPOL_LOCAL), so memory it touches first lives on its node.
+ */
+bool prefer_local_memory();
+
+/** @brief CPU the calling thread runs on, or -1. */
+int current_cpu() noexcept;
+
+/** @brief CPU that last processed packets for socket @p fd, or -1. */
+int incoming_cpu(int fd) noexcept;
+
+/**
+ * @brief Attach a classic BPF program to the SO_REUSEPORT group of
+ *        listener @p fd that picks the socket whose worker is pinned to
+ *        the CPU handling the incoming packet.
+ * @param cpus cpus[i] is the CPU of the worker owning the i-th socket
+ *             added to the group; workers sharing a CPU split its flows
+ *             by receive hash, unknown CPUs fall back to cpu % size.
+ */
+bool attach_reuseport_cpu_steering(int fd, const std::vector<int>& cpus, std::string& err);
+
+} // namespace socketify::detail
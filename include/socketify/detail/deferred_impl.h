@@ -0,0 +1,48 @@
+#pragma once
+/**
+ * @file deferred_impl.h
+ * @brief Shared state between a Deferred handle and the connection that
+ *        waits for it. Internal API.
+ */
+
+#include "socketify/deferred.h"
+#include "socketify/middleware.h"
+#include "socketify/request.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace socketify {
+
+/**
+ * @brief Internal shared state for one deferred response.
+ *
+ * The worker installs @ref deliver once the handler has returned; a finish
+ * before that only stores the response and the worker picks it up when it
+ * adopts the handle. The worker holds a weak reference, so dropping the
+ * last user handle unfinished lands in the destructor, which answers 500.
+ */
+struct Deferred::Impl {
+    std::mutex mu;
+    Response res;                              ///< Response being built.
+    bool done{false};                          ///< Finished (or abandoned).
+    bool closed{false};                        ///< Connection is gone.
+    std::function<void(Response&&)> deliver;   ///< Posts to the owning loop.
+    const Handler* offload{nullptr};           ///< Route::Blocking() handler.
+
+    ~Impl();
+};
+
+namespace detail {
+
+/**
+ * @brief Run the offloaded handler of @p impl against @p req on the
+ *        calling thread and finish the deferred response with its result.
+ *        Exceptions become a 500, as on the loop thread.
+ */
+void run_offloaded(const std::shared_ptr<Deferred::Impl>& impl, Request& req);
+
+} // namespace detail
+
+} // namespace socketify
@@ -1,9 +1,11 @@
 #pragma once
 /**
  * @file file_io.h
- * @brief File helpers used for zero-copy static file / send_file streaming.
+ * @brief File helpers used for zero-copy static file / send_file streaming
+ *        and request-body spooling.
  */
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <string_view>
@@ -39,6 +41,17 @@ public:
      */
     bool open(std::string_view path);
 
+    /**
+     * @brief Create an unnamed read/write file in directory @p dir
+     *        (O_TMPFILE, or mkstemp + unlink where that is unsupported).
+     *        It disappears when closed.
+     * @return true on success.
+     */
+    bool open_temp(std::string_view dir);
+
+    /** @brief Write @p n bytes at offset size() and grow size(). */
+    bool append(const char* p, std::size_t n);
+
     /** @brief Close the descriptor. Idempotent. */
     void close() noexcept;
 
@@ -63,4 +76,8 @@ private:
  */
 bool read_file_range(std::string_view path, std::uint64_t offset, std::uint64_t len, std::string& out);
 
+/** @brief read_file_range() from an open file (positioned reads, so the
+ *         descriptor may be shared). */
+bool read_file_range(const FileHandle& file, std::uint64_t offset, std::uint64_t len, std::string& out);
+
 } // namespace socketify::detail
@@ -0,0 +1,115 @@
+#pragma once
+/**
+ * @file hpack.h
+ * @brief HPACK (RFC 7541) header compression for HTTP/2. Internal API.
+ *
+ * The Decoder keeps the peer's dynamic table and decodes complete header
+ * blocks; the Encoder keeps ours, indexes repeated response fields and
+ * Huffman-codes literals when that is shorter. One pair per connection.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace socketify::detail::hpack {
+
+/** @brief Entries of the RFC 7541 Appendix A static table (1-based). */
+inline constexpr std::size_t kStaticTableSize = 61;
+
+/** @brief Per-entry overhead counted against the table size (RFC 7541 4.1). */
+inline constexpr std::size_t kEntryOverhead = 32;
+
+/** @brief Append the HPACK integer @p v with a @p prefix-bit prefix; @p first holds the flag bits. */
+void encode_integer(std::string& out, std::uint64_t v, int prefix, std::uint8_t first);
+
+/**
+ * @brief Decode an HPACK integer with a @p prefix-bit prefix at @p p.
+ * @return false when truncated or larger than 2^32.
+ */
+bool decode_integer(const std::uint8_t*& p, const std::uint8_t* end, int prefix, std::uint64_t& v);
+
+/** @brief Bytes huffman_encode() would produce for @p s. */
+std::size_t huffman_length(std::string_view s) noexcept;
+
+/** @brief Append the Huffman coding of @p s (padded with EOS bits). */
+void huffman_encode(std::string& out, std::string_view s);
+
+/**
+ * @brief Append the decoding of Huffman-coded @p in.
+ * @return false on EOS, on padding longer than 7 bits or not all ones.
+ */
+bool huffman_decode(std::string_view in, std::string& out);
+
+/** @brief Name/value pair held in a dynamic table. */
+struct Field {
+    std::string name;
+    std::string value;
+    std::size_t size() const noexcept { return name.size() + value.size() + kEntryOverhead; }
+};
+
+/** @brief Decodes header blocks from one peer. */
+class Decoder {
+public:
+    /** @brief Called per decoded field; false stops decoding (and fails it). */
+    using Emit = std::function<bool(std::string_view name, std::string_view value)>;
+
+    /** @param max_table Our SETTINGS_HEADER_TABLE_SIZE (the peer's ceiling). */
+    explicit Decoder(std::size_t max_table = 4096) : limit_(max_table), max_(max_table) {}
+
+    /**
+     * @brief Decode one complete header block.
+     * @return false on a compression error (the connection must close).
+     */
+    bool decode(std::string_view block, const Emit& emit);
+
+    /** @brief Bytes held in the dynamic table. */
+    std::size_t table_size() const noexcept { return size_; }
+
+private:
+    bool lookup_(std::uint64_t index, std::string_view& name, std::string_view& value) const;
+    bool read_string_(const std::uint8_t*& p, const std::uint8_t* end, std::string& out);
+    void insert_(std::string name, std::string value);
+    void evict_to_(std::size_t max);
+
+    std::size_t limit_; ///< what we advertised
+    std::size_t max_;   ///< current size, set by the peer's size updates
+    std::size_t size_{0};
+    std::deque<Field> table_; ///< newest first
+    std::string name_buf_, value_buf_;
+};
+
+/** @brief Encodes header blocks for one peer. */
+class Encoder {
+public:
+    /** @brief Apply the peer's SETTINGS_HEADER_TABLE_SIZE (announced in the next block). */
+    void set_max_table_size(std::size_t n);
+
+    /** @brief Append the ":status" field for @p code. */
+    void status(std::string& out, unsigned code);
+
+    /**
+     * @brief Append one field. @p name must be lower-case. Sensitive
+     *        fields (and large values) are never indexed.
+     */
+    void field(std::string& out, std::string_view name, std::string_view value, bool sensitive = false);
+
+    /** @brief Bytes held in the dynamic table. */
+    std::size_t table_size() const noexcept { return size_; }
+
+private:
+    void flush_size_update_(std::string& out);
+    static void literal_(std::string& out, std::string_view s);
+    void insert_(std::string_view name, std::string_view value);
+
+    std::size_t max_{4096};
+    std::size_t size_{0};
+    std::size_t min_update_{SIZE_MAX}; ///< smallest size set since the last block
+    bool update_pending_{false};
+    std::deque<Field> table_; ///< newest first
+};
+
+} // namespace socketify::detail::hpack
@@ -0,0 +1,229 @@
+#pragma once
+/**
+ * @file http2.h
+ * @brief HTTP/2 (RFC 9113) connection engine: framing, stream states, flow
+ *        control and HPACK, without any I/O. Internal API.
+ *
+ * The worker feeds the Session what it reads from the socket and writes
+ * out what the Session produces. Requests that arrived completely (header
+ * block and body) are queued for the worker, which routes them as usual
+ * and answers with respond(); response bodies go out as DATA frames as the
+ * peer's flow-control windows allow. One Session per connection.
+ */
+
+#include "socketify/detail/file_io.h"
+#include "socketify/detail/hpack.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace socketify::detail::h2 {
+
+/** @brief Client connection preface (RFC 9113 3.4). */
+inline constexpr std::string_view kPreface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+/** @brief RST_STREAM / GOAWAY error codes (RFC 9113 7). */
+enum class ErrorCode : std::uint32_t {
+    NoError = 0x0,
+    ProtocolError = 0x1,
+    InternalError = 0x2,
+    FlowControlError = 0x3,
+    SettingsTimeout = 0x4,
+    StreamClosed = 0x5,
+    FrameSizeError = 0x6,
+    RefusedStream = 0x7,
+    Cancel = 0x8,
+    CompressionError = 0x9,
+    ConnectError = 0xa,
+    EnhanceYourCalm = 0xb,
+    InadequateSecurity = 0xc,
+    Http11Required = 0xd,
+};
+
+/** @brief A request whose header block and body arrived completely. */
+struct IncomingRequest {
+    std::uint32_t stream{0};
+    std::string method;
+    std::string scheme;
+    std::string authority;
+    std::string path; ///< :path, the request-target
+    std::vector<std::pair<std::string, std::string>> fields; ///< lower-case names; cookies joined
+    std::string body;
+};
+
+/** @brief What we advertise and enforce. */
+struct SessionLimits {
+    std::uint32_t max_concurrent_streams{100};
+    std::uint32_t initial_window{1u << 20}; ///< receive window per stream and connection (at least 65535)
+    std::size_t max_header_list{64 * 1024}; ///< decoded field bytes; larger gets 431
+    std::size_t max_body{0};                ///< 0 = unlimited; larger gets 413
+    /**
+     * Body bytes held across all streams until next_request() hands them
+     * off; the connection window only reopens for bytes handed off or
+     * dropped, and is at least this large so one body of that size fits.
+     * A stream that would pass it is refused (REFUSED_STREAM). 0 = no cap:
+     * the connection window reopens as bytes arrive.
+     */
+    std::size_t max_buffered{0};
+    /**
+     * RST_STREAM frames the peer may send per second; one more ends the
+     * connection with GOAWAY(ENHANCE_YOUR_CALM) ("rapid reset",
+     * CVE-2023-44487). 0 = unlimited.
+     */
+    std::uint32_t max_resets_per_second{200};
+};
+
+/** @brief Response body: bytes, then optionally a file range. */
+struct ResponseBody {
+    std::string data;
+    std::shared_ptr<const FileHandle> file; ///< the Response's
+    std::uint64_t offset{0};
+    std::uint64_t length{0};
+    bool empty() const noexcept { return data.empty() && length == 0; }
+};
+
+/** @brief Response field; the name is lower-cased on the way out. */
+using Field = std::pair<std::string_view, std::string_view>;
+
+/** @brief Server side of one HTTP/2 connection. */
+class Session {
+public:
+    explicit Session(SessionLimits limits = {});
+
+    /**
+     * @brief Consume bytes from the peer, starting with its preface.
+     * @return Bytes used; an incomplete frame is left for the next call.
+     *         A connection error queues GOAWAY and sets failed().
+     */
+    std::size_t feed(std::string_view in);
+
+    /** @brief Pop the next complete request (its body no longer counts
+     *         against SessionLimits::max_buffered). */
+    bool next_request(IncomingRequest& out);
+
+    /**
+     * @brief Answer @p stream. An empty @p body ends the stream with the
+     *        HEADERS frame (HEAD requests, 204, ...).
+     * @return false when the stream is gone (reset by the peer). The call
+     *         is still needed then: until it (or reset()) comes, a request
+     *         the peer cancelled counts against max_concurrent_streams,
+     *         since its handler may still be running.
+     */
+    bool respond(std::uint32_t stream, unsigned status, const std::vector<Field>& fields,
+                 ResponseBody body);
+
+    /** @brief Abandon @p stream with RST_STREAM(@p code) (or forget a
+     *         peer-cancelled one, see respond()). */
+    void reset(std::uint32_t stream, ErrorCode code);
+
+    /**
+     * @brief Append DATA frames for pending bodies to output() while the
+     *        windows allow, until it holds about @p budget bytes.
+     */
+    void pump(std::size_t budget);
+
+    /** @brief Bytes to write to the peer; the caller empties it. */
+    std::string& output() noexcept { return out_; }
+
+    /** @brief A body waits for output room (not for a window update). */
+    bool can_pump() const noexcept;
+
+    /** @brief Open streams (received, being answered or sending). */
+    std::size_t open_streams() const noexcept { return streams_.size(); }
+
+    /** @brief Requests the peer cancelled that have not been answered. */
+    std::size_t cancelled_unanswered() const noexcept { return cancelled_.size(); }
+
+    /** @brief A connection error happened: flush output() and close. */
+    bool failed() const noexcept { return failed_; }
+
+    /** @brief The peer sent GOAWAY and every stream is finished. */
+    bool finished() const noexcept { return peer_goaway_ && streams_.empty(); }
+
+private:
+    enum class FrameType : std::uint8_t {
+        Data = 0x0,
+        Headers = 0x1,
+        Priority = 0x2,
+        RstStream = 0x3,
+        Settings = 0x4,
+        PushPromise = 0x5,
+        Ping = 0x6,
+        GoAway = 0x7,
+        WindowUpdate = 0x8,
+        Continuation = 0x9,
+    };
+
+    struct Stream {
+        IncomingRequest req;
+        bool remote_closed{false};   ///< END_STREAM received
+        bool responded{false};       ///< respond() called
+        bool malformed{false};       ///< header block was rejected
+        std::size_t header_bytes{0};
+        std::int64_t content_length{-1};
+        std::int64_t send_window{0};
+        std::uint32_t recv_unacked{0};
+        std::size_t held{0};         ///< body bytes counted in buffered_
+        ResponseBody body;
+        std::size_t data_off{0};
+    };
+
+    void frame_(FrameType type, std::uint8_t flags, std::uint32_t stream, std::string_view payload);
+    void frame_head_(std::size_t len, FrameType type, std::uint8_t flags, std::uint32_t stream);
+    void fail_(ErrorCode code);
+    void stream_error_(std::uint32_t stream, ErrorCode code);
+    void reject_(std::uint32_t stream, unsigned status);
+    void window_update_(std::uint32_t stream, std::uint32_t increment);
+    void release_(std::size_t n);
+    void drop_body_(Stream& s);
+    void send_headers_(std::uint32_t stream, const std::string& block, bool end_stream);
+
+    bool on_frame_(FrameType type, std::uint8_t flags, std::uint32_t stream, std::string_view payload);
+    bool on_headers_(std::uint8_t flags, std::uint32_t stream, std::string_view payload);
+    bool on_header_block_(std::uint32_t stream, bool end_stream);
+    bool on_data_(std::uint8_t flags, std::uint32_t stream, std::string_view payload);
+    bool on_settings_(std::uint8_t flags, std::uint32_t stream, std::string_view payload);
+    bool on_window_update_(std::uint32_t stream, std::string_view payload);
+    void on_request_complete_(std::uint32_t stream, Stream& s);
+    void finish_stream_(std::uint32_t stream);
+    bool on_peer_reset_();
+
+    SessionLimits limits_;
+    hpack::Decoder decoder_;
+    hpack::Encoder encoder_;
+    std::string out_;
+    std::string block_;    ///< header block being assembled (HEADERS + CONTINUATION)
+    std::string scratch_;  ///< lower-cased field names
+    std::unordered_map<std::uint32_t, Stream> streams_;
+    std::deque<std::uint32_t> sending_; ///< streams with body bytes left, round-robin
+    std::deque<IncomingRequest> ready_;
+    std::unordered_set<std::uint32_t> cancelled_; ///< reset by the peer, handler not answered yet
+
+    bool preface_done_{false};
+    bool settings_seen_{false};
+    bool failed_{false};
+    bool peer_goaway_{false};
+    std::uint32_t continuation_stream_{0}; ///< != 0 while a header block is open
+    std::uint8_t continuation_flags_{0};
+    std::uint32_t last_stream_{0};
+    std::uint32_t peer_max_frame_{16384};
+    std::int64_t peer_initial_window_{65535};
+    std::int64_t conn_send_window_{65535};
+    std::uint32_t conn_window_{65535};     ///< the receive window we advertise
+    std::uint32_t conn_recv_unacked_{0};   ///< received since the last WINDOW_UPDATE(0)
+    std::uint32_t conn_released_{0};       ///< of those, handed off or dropped
+    std::size_t buffered_{0};              ///< body bytes held (with max_buffered)
+    std::chrono::steady_clock::time_point resets_since_{}; ///< start of the current second
+    std::uint32_t resets_{0};                               ///< peer resets in it
+};
+
+} // namespace socketify::detail::h2
@@ -7,14 +7,35 @@
  * Feed bytes with consume() as they arrive from the socket; the parser
  * consumes only what belongs to the current message, so pipelined requests
  * are handled correctly by the caller (leftover bytes stay in its buffer).
+ * Start-line and header lines are located and validated with the SIMD
+ * scanners in http_scan.h.
+ *
+ * In zero-copy mode the parser copies nothing out of the input: it records
+ * offsets from the start of the message and resolves them against the
+ * bytes passed to the latest consume(). The caller must then keep every
+ * consumed byte of the current message, at the same position relative to
+ * its start, until it is done with the parsed request, and pass only the
+ * new bytes after them to consume(). Body bytes that are not borrowed
+ * (chunked, spooled or streamed bodies) do not count: the caller may drop
+ * them once consumed, see retained_bytes().
+ *
+ * A body can bypass memory: set_spool() writes bodies above a size to an
+ * unnamed temp file, and set_body_sink() hands the bytes to a callback as
+ * they arrive (with set_stop_after_headers() the caller decides per
+ * message, after seeing the head).
  */
 
+#include "socketify/detail/file_io.h"
+#include "socketify/headers.h"
 #include "socketify/http.h"
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <vector>
 
 namespace socketify::detail {
 
@@ -39,7 +60,7 @@ enum class ParseState : std::uint8_t {
  * p.set_limits(16 * 1024, 8 * 1024 * 1024);
  * std::size_t used = p.consume(buf.data(), buf.size());
  * buf.consume(used);
- * if (p.complete()) { ... p.method(), p.path(), p.headers(), p.body_view() ... }
+ * if (p.complete()) { ... p.method(), p.path(), p.header(HeaderId::Host) ... }
  * else if (p.error()) { ... respond with p.error_status() ... }
  * @endcode
  */
@@ -47,12 +68,82 @@ class HttpParser {
 public:
   HttpParser();
 
+  /** @brief Receives body bytes; returning false ends consume() early. */
+  using BodySink = std::function<bool(std::string_view)>;
+
   /** @brief Cap header bytes and body bytes; exceeded limits set Error. */
   void set_limits(std::size_t max_header_bytes, std::size_t max_body_bytes) {
     max_header_bytes_ = max_header_bytes;
     max_body_bytes_ = max_body_bytes;
+    body_limit_ = max_body_bytes;
+  }
+
+  /**
+   * @brief Body limit for the current message only (0 = none); set it
+   *        after headers_done(). A larger declared Content-Length fails
+   *        with 413 at once. reset() restores the set_limits() value.
+   */
+  void set_body_limit(std::size_t max_body_bytes);
+
+  /** @brief Return from consume() right after the header section. */
+  void set_stop_after_headers(bool on) noexcept { stop_after_headers_ = on; }
+
+  /** @brief True once the header section has been parsed. */
+  bool headers_done() const noexcept {
+    return state_ != ParseState::StartLine && state_ != ParseState::Headers &&
+           state_ != ParseState::Error;
   }
 
+  /**
+   * @brief Deliver the body of the current message to @p sink instead of
+   *        keeping it; call after headers_done(). When the sink returns
+   *        false, consume() returns after that piece. In zero-copy mode the
+   *        head is released too: the caller may drop the retained bytes,
+   *        and target(), header() etc. return "" from then on.
+   */
+  void set_body_sink(BodySink sink);
+
+  /** @brief True when the current body goes to a sink. */
+  bool body_streamed() const noexcept { return static_cast<bool>(sink_); }
+
+  /**
+   * @brief Write bodies larger than @p threshold bytes to an unnamed file
+   *        in @p dir rather than memory (0 disables). Content-Length bodies
+   *        are spooled from the first byte, chunked ones once they grow
+   *        past the threshold.
+   */
+  void set_spool(std::size_t threshold, std::string dir) {
+    spool_threshold_ = threshold;
+    spool_dir_ = std::move(dir);
+  }
+
+  /** @brief True when the current body is in the spool file. */
+  bool body_spooled() const noexcept { return spool_.valid(); }
+
+  /** @brief Take the spool file (size() is the body length). */
+  FileHandle take_body_file() noexcept { return std::move(spool_); }
+
+  /**
+   * @brief Bytes of the current message the caller must keep (zero-copy
+   *        mode): the head and a borrowed body. Consumed bytes beyond
+   *        this may be discarded.
+   */
+  std::size_t retained_bytes() const noexcept { return msg_bytes_; }
+
+  /**
+   * @brief Record offsets into the caller's input instead of copying
+   *        start-line, headers and Content-Length bodies (see file comment).
+   *        Chunked bodies are still decoded into owned storage. Takes effect
+   *        at the next message boundary.
+   */
+  void set_zero_copy(bool on) noexcept {
+    want_zero_copy_ = on;
+    if (state_ == ParseState::StartLine && msg_bytes_ == 0)
+      zero_copy_ = on;
+  }
+  /** @brief True when the current message is parsed in zero-copy mode. */
+  bool zero_copy() const noexcept { return zero_copy_; }
+
   /**
    * @brief Feed bytes from the socket.
    * @return Number of bytes consumed from [data, data+len). Bytes past the
@@ -76,26 +167,76 @@ public:
   /** @brief Parsed method. */
   Method method() const noexcept { return method_; }
   /** @brief Raw request-target as received. */
-  std::string_view target() const noexcept { return target_; }
+  std::string_view target() const noexcept {
+    return zero_copy_ ? at_(target_span_) : std::string_view(target_);
+  }
   /** @brief Target without the query string (still percent-encoded). */
-  std::string_view path() const noexcept { return path_; }
+  std::string_view path() const noexcept {
+    return zero_copy_ ? at_(path_span_) : std::string_view(path_);
+  }
   /** @brief Query-string portion after '?' ("" when absent). */
-  std::string_view query_string() const noexcept { return query_; }
+  std::string_view query_string() const noexcept {
+    return zero_copy_ ? at_(query_span_) : std::string_view(query_);
+  }
   /** @brief Version string, e.g. "HTTP/1.1". */
-  std::string_view version() const noexcept { return version_; }
+  std::string_view version() const noexcept {
+    return zero_copy_ ? at_(version_span_) : std::string_view(version_);
+  }
 
   // --- Headers & body ---
-  /** @brief Parsed headers (case-insensitive keys). */
-  const HeaderMap &headers() const noexcept { return headers_; }
+  /**
+   * @brief Parsed headers (owned copies). Empty in zero-copy mode; use
+   *        header() or for_each_field() there.
+   */
+  const Headers &headers() const noexcept { return headers_; }
+
+  /** @brief Take the parsed headers (copying mode); the parser keeps none. */
+  Headers take_headers() noexcept { return std::move(headers_); }
+
+  /**
+   * @brief Value of header @p name in either mode ("" when absent). In
+   *        zero-copy mode repeated fields yield the first value.
+   */
+  std::string_view header(std::string_view name) const;
+
+  /** @brief Same as header(name) for a well-known header. */
+  std::string_view header(HeaderId id) const noexcept;
+
+  /**
+   * @brief Call @p fn(name, value) or @p fn(id, name, value) for every
+   *        header field. In zero-copy mode fields come in arrival order,
+   *        repeats included.
+   */
+  template <class Fn> void for_each_field(Fn &&fn) const {
+    if (!zero_copy_) {
+      headers_.for_each(fn);
+      return;
+    }
+    for (const FieldSpan &f : fields_) {
+      if constexpr (std::is_invocable_v<Fn &, HeaderId, std::string_view,
+                                        std::string_view>)
+        fn(f.id, at_(f.name), at_(f.value));
+      else
+        fn(at_(f.name), at_(f.value));
+    }
+  }
+
+  /** @brief True when body_view() points into the caller's input. */
+  bool body_borrowed() const noexcept {
+    return zero_copy_ && !chunked_ && !sink_ && !spool_.valid();
+  }
   /** @brief Declared Content-Length (0 for chunked until complete). */
   std::size_t content_length() const noexcept { return content_length_; }
   /** @brief True when the request carries a body. */
   bool has_body() const noexcept { return content_length_ > 0 || !body_storage_.empty(); }
   /** @brief Body contents; complete only when state()==Complete. */
   std::string_view body_view() const noexcept { return body_; }
-  /** @brief Take ownership of the body (parser keeps an empty body). */
+  /**
+   * @brief Take ownership of the body (parser keeps an empty body). A
+   *        borrowed body is copied.
+   */
   std::string take_body() {
-    std::string b = std::move(body_storage_);
+    std::string b = body_borrowed() ? std::string(body_) : std::move(body_storage_);
     body_storage_.clear();
     body_ = {};
     return b;
@@ -113,6 +254,30 @@ private:
   std::size_t parse_chunk_data_end_(const char *data, std::size_t len);
   std::size_t parse_chunk_trailer_(const char *data, std::size_t len);
 
+  std::size_t take_header_line_(const char *data, std::size_t len,
+                                std::string_view &line, bool &got);
+  void start_line_(std::string_view line);
+  bool header_line_(std::string_view line);
+  void end_headers_();
+  bool joined_header_(HeaderId id, std::string &out) const;
+
+  /// Message-relative byte range (zero-copy mode).
+  struct Span {
+    std::uint32_t off{0};
+    std::uint32_t len{0};
+  };
+  struct FieldSpan {
+    Span name;
+    Span value;
+    HeaderId id;
+  };
+  std::string_view at_(Span s) const noexcept {
+    return s.len ? std::string_view(base_ + s.off, s.len) : std::string_view();
+  }
+  Span span_(const char *p, std::size_t n) const noexcept {
+    return {static_cast<std::uint32_t>(p - base_), static_cast<std::uint32_t>(n)};
+  }
+
   void fail_(std::string msg, Status st) {
     state_ = ParseState::Error;
     err_msg_ = std::move(msg);
@@ -127,25 +292,43 @@ private:
     return true;
   }
   bool grow_body_bytes_(std::size_t n) {
-    if (max_body_bytes_ && body_storage_.size() + n > max_body_bytes_) {
+    if (body_limit_ && body_received_ + n > body_limit_) {
       fail_("Body too large", Status::PayloadTooLarge);
       return false;
     }
     return true;
   }
 
+  bool keeps_(ParseState st) const noexcept {
+    return st == ParseState::StartLine || st == ParseState::Headers ||
+           (st == ParseState::Body && !sink_ && !spool_.valid());
+  }
+  bool spool_open_();
+  bool take_body_bytes_(const char *p, std::size_t n);
+
   static inline char ascii_lower_(char c) noexcept;
   static bool iequal_ascii_(std::string_view a, std::string_view b) noexcept;
 
   // state
   ParseState state_{ParseState::StartLine};
+  bool want_zero_copy_{false};
+  bool zero_copy_{false};
   std::string line_buf_;
+  // zero-copy: the message starts at base_ (as of the last consume()) and
+  // msg_bytes_ of it were consumed; an unfinished line starts at line_start_.
+  const char *base_{nullptr};
+  std::size_t msg_bytes_{0};
+  bool line_open_{false};
+  std::size_t line_start_{0};
+  Span target_span_, path_span_, query_span_, version_span_;
+  std::vector<FieldSpan> fields_;
+  std::size_t body_off_{0};
   Method method_{Method::UNKNOWN};
   std::string target_;
   std::string path_;
   std::string query_;
   std::string version_;
-  HeaderMap headers_;
+  Headers headers_;
   bool chunked_{false};
   std::size_t content_length_{0};
   std::size_t body_received_{0};
@@ -158,6 +341,14 @@ private:
   std::size_t header_bytes_{0};
   std::size_t max_header_bytes_{16 * 1024};
   std::size_t max_body_bytes_{16 * 1024 * 1024};
+  std::size_t body_limit_{16 * 1024 * 1024}; ///< current message
+
+  bool stop_after_headers_{false};
+  BodySink sink_;
+  bool hold_{false}; ///< the sink asked consume() to return
+  std::size_t spool_threshold_{0};
+  std::string spool_dir_;
+  FileHandle spool_;
 };
 
 } // namespace socketify::detail
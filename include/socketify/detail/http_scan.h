@@ -0,0 +1,61 @@
+#pragma once
+/**
+ * @file http_scan.h
+ * @brief Vectorized byte scanners used by the HTTP/1.1 parser: line ends,
+ *        field-name (token) characters and field-value characters; and
+ *        the substring search behind multipart boundaries.
+ *
+ * Each scanner has a scalar version and x86 versions (SSE4.2, AVX2) built
+ * with per-function target attributes, so the library needs no -m flags.
+ * The best version the CPU supports is picked once at startup.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace socketify::detail {
+
+/** @brief Instruction set the scanners run on. */
+enum class ScanIsa : std::uint8_t {
+    Scalar, ///< Portable byte loops (memchr for line ends).
+    Sse42,  ///< 16-byte SSE2 compares and PCMPESTRI range matching.
+    Avx2    ///< 32-byte compares; token scans stay on SSE4.2.
+};
+
+/** @brief Best ISA this CPU and build support. */
+ScanIsa best_scan_isa() noexcept;
+
+/** @brief ISA currently used by the scanners. */
+ScanIsa scan_isa() noexcept;
+
+/**
+ * @brief Select the scanner ISA (tests, benchmarks). Requests above
+ *        best_scan_isa() are clamped. Not meant to race with parsing.
+ */
+void set_scan_isa(ScanIsa isa) noexcept;
+
+/** @brief "scalar", "sse4.2" or "avx2". */
+const char* scan_isa_name(ScanIsa isa) noexcept;
+
+/** @brief First '\\n' in [p, end), or @p end. */
+const char* find_newline(const char* p, const char* end) noexcept;
+
+/** @brief First byte in [p, end) that is not an RFC 9110 tchar, or @p end. */
+const char* find_non_token(const char* p, const char* end) noexcept;
+
+/**
+ * @brief First byte in [p, end) not allowed in a field value (a control
+ *        character other than HTAB, or DEL), or @p end. obs-text passes.
+ */
+const char* find_invalid_value(const char* p, const char* end) noexcept;
+
+/**
+ * @brief First occurrence of the @p n-byte @p needle in [p, end), or
+ *        @p end. The vector versions test the needle's first and last
+ *        byte at every position of a block and compare the rest only
+ *        where both match. @p n must be at least 2.
+ */
+const char* find_delimiter(const char* p, const char* end, const char* needle,
+                           std::size_t n) noexcept;
+
+} // namespace socketify::detail
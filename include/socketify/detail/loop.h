@@ -1,64 +1,185 @@
 #pragma once
 /**
  * @file loop.h
- * @brief Minimal epoll-based event loop used by each worker thread.
+ * @brief Minimal readiness event loop used by each worker thread.
  *
- * The loop multiplexes socket readiness, supports cross-thread wakeups via
- * eventfd (used by SSE broadcasts), and tracks per-connection deadlines with
- * a monotonic-clock deadline heap.
+ * The loop multiplexes socket readiness through epoll(7) or, when asked
+ * for and supported by the kernel, io_uring(7); there it can also accept
+ * connections, receive their input (multishot accept and recv into a
+ * provided-buffer ring) and write their output (linked sendmsg / splice
+ * submissions) itself. It also
+ * supports cross-thread wakeups via eventfd (used by SSE broadcasts), and
+ * owns a hierarchical timer wheel for per-connection deadlines; wait()
+ * never sleeps past the next due timer slot.
  */
 
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <mutex>
+#include <string_view>
+#include <sys/uio.h>
 #include <vector>
 
+#include "socketify/detail/timer_wheel.h"
+
 namespace socketify::detail {
 
 /** @brief Readiness event delivered by EventLoop::wait(). */
 struct LoopEvent {
-    void* data{nullptr};   ///< User pointer registered with add()/mod().
+    std::uint64_t data{0}; ///< Token registered with add()/mod().
     bool readable{false};  ///< EPOLLIN (or error/hup, reported as readable).
     bool writable{false};  ///< EPOLLOUT.
     bool error{false};     ///< EPOLLERR / EPOLLHUP / EPOLLRDHUP.
+    /// Connection accepted by the kernel for an add_listener() fd, or -1.
+    int accepted{-1};
+    /// Input the kernel received for an add_stream() fd; valid until the
+    /// next wait().
+    std::string_view received;
+    /// The fd's send() completed; `sent` and `file_sent` tell how.
+    bool send_done{false};
+    /// Bytes of send()'s iovecs written, or -errno when the socket failed.
+    std::int64_t sent{0};
+    /// Bytes send() took from its file (see EventLoop::unsent()), or -1
+    /// when the file ended before the requested length.
+    std::int64_t file_sent{0};
+};
+
+/** @brief Kernel interface backing an EventLoop. */
+enum class LoopBackend : std::uint8_t {
+    Epoll,   ///< epoll(7); always available.
+    IoUring  ///< io_uring(7): multishot accept/recv, linked sends, polls for the rest.
 };
 
 /**
- * @brief Thin epoll wrapper with an eventfd wakeup channel.
+ * @brief Thin epoll / io_uring wrapper with an eventfd wakeup channel.
+ *
+ * Both backends are level-triggered by default and report identical
+ * LoopEvents, so the worker code is backend-agnostic. The epoll backend can
+ * be switched to edge-triggered mode (see set_edge_triggered()).
  *
  * Not thread-safe except for wakeup() and post(), which may be called from
  * any thread.
  */
 class EventLoop {
 public:
-    EventLoop();
+    /**
+     * @brief Create the loop.
+     * @param backend Preferred backend. LoopBackend::IoUring silently falls
+     *                back to epoll when the kernel lacks io_uring (or it is
+     *                disabled by policy); check backend() afterwards.
+     */
+    explicit EventLoop(LoopBackend backend = LoopBackend::Epoll);
     ~EventLoop();
 
     EventLoop(const EventLoop&) = delete;
     EventLoop& operator=(const EventLoop&) = delete;
 
-    /** @brief True when epoll and eventfd were created successfully. */
-    bool valid() const noexcept { return epfd_ >= 0; }
+    /** @brief True when the backend and eventfd were created successfully. */
+    bool valid() const noexcept { return wake_fd_ >= 0 && (epfd_ >= 0 || uring_ != nullptr); }
+
+    /** @brief Backend actually in use. */
+    LoopBackend backend() const noexcept {
+        return uring_ ? LoopBackend::IoUring : LoopBackend::Epoll;
+    }
+
+    /**
+     * @brief Register fds added or modified from now on with EPOLLET.
+     *
+     * The owner must then drain each fd to EAGAIN (or remember to come
+     * back to it); mod() re-arms and reports readiness that is already
+     * present. Ignored by the io_uring backend.
+     */
+    void set_edge_triggered(bool on) noexcept { edge_ = on; }
+
+    /** @brief True when fds are registered edge-triggered. */
+    bool edge_triggered() const noexcept { return edge_ && !uring_; }
 
     /**
      * @brief Register @p fd.
      * @param read  Subscribe to readability.
      * @param write Subscribe to writability.
-     * @param data  Opaque pointer returned in LoopEvent::data.
+     * @param data  Opaque token returned in LoopEvent::data; 0 is reserved
+     *              for the wakeup channel.
      */
-    bool add(int fd, bool read, bool write, void* data);
+    bool add(int fd, bool read, bool write, std::uint64_t data);
 
     /** @brief Update interest set for a registered fd. */
-    bool mod(int fd, bool read, bool write, void* data);
+    bool mod(int fd, bool read, bool write, std::uint64_t data);
+
+    /**
+     * @brief Register the listening socket @p fd.
+     *
+     * With multishot accept (see receives_input()) wait() reports each new
+     * connection as an event whose `accepted` holds its fd; otherwise this
+     * is add(fd, true, false, data) and the owner calls accept4() on
+     * readability.
+     */
+    bool add_listener(int fd, std::uint64_t data);
+
+    /**
+     * @brief Register a connected socket whose input the loop may receive.
+     *
+     * With multishot recv (see receives_input()) the kernel reads into the
+     * loop's buffer ring and wait() hands the bytes over in
+     * LoopEvent::received; end of stream and socket errors come as an
+     * error event. mod() with @p read false stops receiving (bytes already
+     * in flight are still delivered). Otherwise this is
+     * add(fd, true, false, data).
+     */
+    bool add_stream(int fd, std::uint64_t data);
 
-    /** @brief Remove @p fd from the interest set. */
+    /**
+     * @brief True when add_listener() / add_stream() fds are accepted and
+     *        read by the kernel (io_uring on Linux 6.0+). The owner must
+     *        then never read such an fd itself: its bytes would overtake
+     *        completions still waiting in the ring.
+     */
+    bool receives_input() const noexcept { return multishot_; }
+
+    /// Iovecs one send() takes at most.
+    static constexpr std::size_t kSendIov = 64;
+
+    /**
+     * @brief True when add_stream() fds are also written by the kernel
+     *        (io_uring on Linux 6.0+, together with receives_input()). The
+     *        owner then writes such an fd only through send().
+     */
+    bool sends_output() const noexcept { return multishot_; }
+
+    /**
+     * @brief Write @p cnt iovecs (at most kSendIov), then up to
+     *        @p file_len bytes of @p file_fd from @p file_off, to the
+     *        add_stream() fd @p fd as one linked submission.
+     *
+     * The iovecs are sent in full unless the socket fails. File bytes are
+     * spliced through a pipe: what the socket does not take at once stays
+     * there (unsent()) and leads the next send(), so a send() with no
+     * iovecs and no file just flushes it. One send() per fd may be in
+     * flight; its result arrives as a LoopEvent with send_done set, and
+     * the memory behind @p iov must stay untouched until then.
+     */
+    bool send(int fd, const iovec* iov, std::size_t cnt, int file_fd = -1,
+              std::uint64_t file_off = 0, std::size_t file_len = 0);
+
+    /** @brief File bytes send() took for @p fd that are not written yet. */
+    std::size_t unsent(int fd) const noexcept;
+
+    /**
+     * @brief Remove @p fd from the interest set.
+     *
+     * A stream with a send() in flight is shut down so the send ends
+     * promptly; its completion is still reported, and the fd must stay
+     * open until then.
+     */
     bool del(int fd);
 
     /**
      * @brief Wait for events.
      * @param out        Receives ready events (cleared first).
-     * @param timeout_ms Max wait; -1 blocks indefinitely.
+     * @param timeout_ms Max wait; -1 blocks indefinitely. Shortened to the
+     *                   next timer slot when timers are armed.
      * @return Number of events, 0 on timeout, -1 on error.
      */
     int wait(std::vector<LoopEvent>& out, int timeout_ms);
@@ -75,9 +196,34 @@ public:
     /** @brief Run queued post() callbacks. Called by the loop owner. */
     void run_posted();
 
+    /** @brief Timers serviced by this loop (loop thread only). */
+    TimerWheel& timers() noexcept { return timers_; }
+
+    /** @brief Fire expired timers. Called by the loop owner after wait(). */
+    std::size_t run_timers() { return timers_.advance(TimerWheel::Clock::now()); }
+
 private:
+    struct Uring; ///< io_uring state; defined in loop_uring.cpp.
+
+    // io_uring backend (loop_uring.cpp).
+    bool uring_open_();
+    void uring_close_() noexcept;
+    bool uring_arm_(int fd, bool read, bool write, std::uint64_t data);
+    bool uring_listen_(int fd, std::uint64_t data);
+    bool uring_stream_(int fd, std::uint64_t data);
+    bool uring_disarm_(int fd);
+    bool uring_send_(int fd, const iovec* iov, std::size_t cnt, int file_fd,
+                     std::uint64_t file_off, std::size_t file_len);
+    std::size_t uring_unsent_(int fd) const noexcept;
+    int uring_wait_(std::vector<LoopEvent>& out, int timeout_ms);
+
     int epfd_{-1};
     int wake_fd_{-1};
+    bool edge_{false};
+    bool multishot_{false};
+    Uring* uring_{nullptr};
+
+    TimerWheel timers_;
 
     std::mutex posted_mu_;
     std::vector<std::function<void()>> posted_;
@@ -0,0 +1,212 @@
+#pragma once
+/**
+ * @file output_queue.h
+ * @brief Scatter-gather output queue for socket writes.
+ *
+ * Response heads are built in place in a growable "open" segment; large
+ * bodies are queued by move (or shared) as their own segments and handed
+ * to writev/sendmsg as iovecs, so a buffered body is never copied next to
+ * its header block.
+ */
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace socketify::detail {
+
+/**
+ * @brief FIFO of byte segments drained with gather()/consume().
+ *
+ * Small payloads are coalesced into the open tail segment (one memcpy is
+ * cheaper than an extra iovec); anything at or above kInlineMax becomes a
+ * separate segment without copying. A segment is closed to appends once
+ * part of it has been sent, and its memory is released as soon as all of
+ * it has, so a stream whose socket never fully drains holds only what is
+ * still pending (plus one recycled head buffer). pin() does the same for
+ * bytes handed to the kernel for an asynchronous send.
+ */
+class OutputQueue {
+public:
+    /// Bodies below this size are copied into the open segment.
+    static constexpr std::size_t kInlineMax = 4096;
+    /// Spare head capacity kept across clear() for the next response.
+    static constexpr std::size_t kSpareMax = 64 * 1024;
+
+    OutputQueue() = default;
+
+    /**
+     * @brief The open tail segment for in-place appends (e.g. a response
+     *        head). Invalidated by the next push().
+     */
+    std::string& open_segment() {
+        // A tail that is partly sent stays closed: appending would keep its
+        // sent prefix alive for as long as the stream runs.
+        if (segs_.size() == head_ || segs_.size() <= pinned_ || segs_.back().sealed ||
+            (head_ + 1 == segs_.size() && off_ > 0)) {
+            segs_.emplace_back();
+            segs_.back().owned.swap(spare_);
+        }
+        return segs_.back().owned;
+    }
+
+    /** @brief Copy @p sv onto the tail. */
+    void append(std::string_view sv) {
+        if (sv.empty()) return;
+        open_segment().append(sv);
+        bytes_ += sv.size();
+    }
+
+    /** @brief Queue an owned buffer, moving it unless it is small. */
+    void push(std::string&& s) {
+        if (s.size() < kInlineMax) {
+            append(s);
+            return;
+        }
+        Segment seg;
+        seg.owned = std::move(s);
+        seg.sealed = true;
+        bytes_ += seg.owned.size();
+        segs_.push_back(std::move(seg));
+    }
+
+    /** @brief Queue a shared immutable buffer (no copy). */
+    void push(std::shared_ptr<const std::string> s) {
+        if (!s || s->empty()) return;
+        Segment seg;
+        bytes_ += s->size();
+        seg.shared = std::move(s);
+        seg.sealed = true;
+        segs_.push_back(std::move(seg));
+    }
+
+    /**
+     * @brief Record bytes appended directly through open_segment().
+     * @param n Bytes appended since the segment was obtained.
+     */
+    void commit(std::size_t n) noexcept { bytes_ += n; }
+
+    /** @brief True when nothing is queued. */
+    bool empty() const noexcept { return bytes_ == 0; }
+
+    /** @brief Pending byte count. */
+    std::size_t size() const noexcept { return bytes_; }
+
+    /**
+     * @brief Fill up to @p max iovecs with the pending bytes, in order.
+     * @return Number of iovecs written.
+     */
+    std::size_t gather(iovec* iov, std::size_t max) const noexcept {
+        std::size_t n = 0;
+        std::size_t off = off_;
+        for (std::size_t i = head_; i < segs_.size() && n < max; ++i) {
+            std::string_view v = segs_[i].view();
+            if (v.size() > off) {
+                iov[n].iov_base = const_cast<char*>(v.data() + off);
+                iov[n].iov_len = v.size() - off;
+                ++n;
+            }
+            off = 0;
+        }
+        return n;
+    }
+
+    /**
+     * @brief Keep the pending bytes where the next gather() finds them
+     *        until consume() has passed them: later appends start a new
+     *        segment. For sends that complete after the call returns; call
+     *        it before gather().
+     */
+    void pin() {
+        for (std::size_t i = head_; i < segs_.size(); ++i) {
+            // A short string keeps its bytes inline, in segs_ itself, which
+            // moves when segs_ grows; put them on the heap.
+            std::string& s = segs_[i].owned;
+            const char* p = s.data();
+            const auto* self = reinterpret_cast<const char*>(&s);
+            if (p >= self && p < self + sizeof(s)) s.reserve(sizeof(s) + 1);
+        }
+        pinned_ = segs_.size();
+    }
+
+    /** @brief Drop @p n bytes from the front (after a successful write). */
+    void consume(std::size_t n) {
+        bytes_ -= n < bytes_ ? n : bytes_;
+        while (head_ < segs_.size()) {
+            std::size_t len = segs_[head_].view().size();
+            if (off_ + n < len) {
+                off_ += n;
+                return;
+            }
+            n -= len - off_;
+            off_ = 0;
+            recycle_(segs_[head_]);
+            ++head_;
+            if (head_ >= kCompactMin && head_ * 2 >= segs_.size()) {
+                // Sent segments are empty shells by now; dropping them keeps
+                // segs_ from growing with a queue that never fully drains.
+                segs_.erase(segs_.begin(), segs_.begin() + static_cast<std::ptrdiff_t>(head_));
+                pinned_ -= pinned_ < head_ ? pinned_ : head_;
+                head_ = 0;
+            }
+        }
+        segs_.clear();
+        head_ = pinned_ = 0;
+    }
+
+    /**
+     * @brief Bytes of memory the queue keeps alive: pending and recycled
+     *        buffers plus the segment table.
+     */
+    std::size_t footprint() const noexcept {
+        std::size_t n = spare_.capacity() + segs_.capacity() * sizeof(Segment);
+        for (const Segment& s : segs_) n += s.owned.capacity() + (s.shared ? s.shared->size() : 0);
+        return n;
+    }
+
+    /** @brief Drop everything queued. */
+    void clear() {
+        for (std::size_t i = head_; i < segs_.size(); ++i) recycle_(segs_[i]);
+        segs_.clear();
+        head_ = off_ = bytes_ = pinned_ = 0;
+    }
+
+private:
+    struct Segment {
+        std::string owned;
+        std::shared_ptr<const std::string> shared;
+        bool sealed{false}; ///< No further appends (moved/shared body).
+
+        std::string_view view() const noexcept {
+            return shared ? std::string_view(*shared) : std::string_view(owned);
+        }
+    };
+
+    // Keep a sent head buffer for the next open segment if it beats the
+    // spare; free everything else the segment holds.
+    void recycle_(Segment& s) {
+        if (!s.sealed && s.owned.capacity() > spare_.capacity() &&
+            s.owned.capacity() <= kSpareMax) {
+            s.owned.clear();
+            spare_.swap(s.owned);
+        }
+        std::string().swap(s.owned);
+        s.shared.reset();
+    }
+
+    /// Sent segments tolerated at the front before consume() compacts.
+    static constexpr std::size_t kCompactMin = 16;
+
+    std::vector<Segment> segs_;
+    std::size_t head_{0}; ///< First unsent segment.
+    std::size_t off_{0};  ///< Bytes already sent from segs_[head_].
+    std::size_t pinned_{0}; ///< Segments below this index take no appends.
+    std::size_t bytes_{0};
+    std::string spare_;   ///< Recycled head buffer.
+};
+
+} // namespace socketify::detail
@@ -5,6 +5,7 @@
  */
 
 #include "socketify/pulse.h"
+#include "socketify/detail/stream_limit.h"
 
 #include <atomic>
 #include <cstdint>
@@ -25,6 +26,7 @@ struct Channel::Impl {
     bool close_requested{false};
     bool close_fired{false};
     std::function<void()> notify;
+    detail::StreamLimit limit;
 
     Options opts{};
     std::string protocol;
@@ -45,16 +47,22 @@ struct Channel::Impl {
 
     std::weak_ptr<Impl> self;
 
+    /**
+     * @brief Append bytes and wake the loop.
+     * @return false when closed or refused by @ref limit.
+     */
     bool enqueue(std::string_view bytes) {
         std::function<void()> n;
+        bool ok = false;
         {
-            std::lock_guard<std::mutex> lk(mu);
+            std::unique_lock<std::mutex> lk(mu);
             if (closed) return false;
-            pending.append(bytes);
-            n = notify;
+            ok = limit.admit(lk, pending, bytes.size(), closed, close_requested);
+            if (ok) pending.append(bytes);
+            n = notify; // also delivers a close requested by the limit
         }
         if (n) n();
-        return true;
+        return ok;
     }
 };
 
@@ -0,0 +1,78 @@
+#pragma once
+/**
+ * @file response_writer.h
+ * @brief HTTP/1.1 response head serialization (server hot path), and
+ *        the same mapping onto HTTP/2 streams.
+ *
+ * Status lines come from a compile-time table, the Date value from a
+ * per-worker cache that is reformatted at most once per second, and the
+ * header filter relies on Response::KnownHeader flags instead of
+ * lower-casing every header name.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace socketify {
+class Request;
+class Response;
+struct ServerOptions;
+} // namespace socketify
+
+namespace socketify::detail {
+
+class OutputQueue;
+
+namespace h2 {
+class Session;
+} // namespace h2
+
+/**
+ * @brief Cached IMF-fixdate ("Sun, 06 Nov 1994 08:49:37 GMT").
+ *
+ * One instance per worker thread; not thread-safe.
+ */
+class DateCache {
+public:
+    /** @brief Date for the current wall-clock second. */
+    std::string_view now() noexcept;
+
+    /** @brief Date for @p unix_seconds (reformats only when it changes). */
+    std::string_view at(std::int64_t unix_seconds) noexcept;
+
+private:
+    std::int64_t sec_{-1};
+    char buf_[32]{};
+};
+
+/**
+ * @brief Complete status line ("HTTP/1.1 404 Not Found\r\n") for codes
+ *        with a known reason phrase; empty for anything else.
+ */
+std::string_view status_line(unsigned code) noexcept;
+
+/**
+ * @brief Serialize the response head into @p q and queue the buffered body
+ *        (by move) after it. File/Stream/Chunked/Pulse responses emit only the
+ *        head.
+ * @param date Value for the Date header (see DateCache).
+ */
+void serialize_response(OutputQueue& q, const Request& req, Response& res,
+                        const ServerOptions& opts, std::string_view date,
+                        bool head_request, bool close_connection);
+
+/** @brief Whether the connection should close after this exchange. */
+bool wants_close(const Request& req, const Response& res);
+
+/**
+ * @brief Answer HTTP/2 @p stream with a Buffered or File response: the same
+ *        fields serialize_response() writes (less the connection ones) and
+ *        the body as DATA frames, a File body read from its range.
+ * @return false when a File response's file no longer opens.
+ */
+bool serialize_response_h2(h2::Session& session, std::uint32_t stream, const Request& req,
+                           Response& res, const ServerOptions& opts, std::string_view date,
+                           bool head_request);
+
+} // namespace socketify::detail
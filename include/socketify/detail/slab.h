@@ -0,0 +1,122 @@
+#pragma once
+/**
+ * @file slab.h
+ * @brief Chunked object pool with generation-checked handles.
+ *
+ * Objects live in fixed-size chunks, so addresses stay stable and are
+ * recycled through a LIFO freelist (the most recently freed, cache-warm
+ * object is handed out first). A handle packs (generation << 32 | index);
+ * releasing a slot bumps its generation, so a stale handle simply fails
+ * get() instead of needing a hash lookup to detect it.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace socketify::detail {
+
+/**
+ * @brief Per-thread pool of T (not thread-safe).
+ *
+ * T must be default-constructible; objects are constructed once per slot
+ * and reused, so the owner resets state on release. Handles are never 0
+ * and never have a zero generation, leaving those values free for
+ * sentinel tokens.
+ */
+template <class T, std::size_t ChunkSize = 256>
+class Slab {
+public:
+    using Handle = std::uint64_t;
+
+    Slab() = default;
+    Slab(const Slab&) = delete;
+    Slab& operator=(const Slab&) = delete;
+
+    /**
+     * @brief Take a free object, growing by one chunk when exhausted.
+     * @param[out] h Handle for the returned object.
+     */
+    T* acquire(Handle& h) {
+        if (free_.empty()) grow_();
+        std::uint32_t idx = free_.back();
+        free_.pop_back();
+        Entry& e = entry_(idx);
+        e.live = true;
+        ++live_;
+        h = (static_cast<Handle>(e.gen) << 32) | idx;
+        return &e.value;
+    }
+
+    /** @brief Object for @p h, or nullptr when released/stale. */
+    T* get(Handle h) noexcept {
+        auto idx = static_cast<std::uint32_t>(h);
+        if (idx >= capacity_) return nullptr;
+        Entry& e = entry_(idx);
+        if (!e.live || e.gen != static_cast<std::uint32_t>(h >> 32)) return nullptr;
+        return &e.value;
+    }
+
+    /** @brief Return @p h to the freelist; stale handles are ignored. */
+    void release(Handle h) {
+        if (!get(h)) return;
+        auto idx = static_cast<std::uint32_t>(h);
+        Entry& e = entry_(idx);
+        e.live = false;
+        if (++e.gen == 0) e.gen = 1;
+        --live_;
+        free_.push_back(idx);
+    }
+
+    /** @brief Handles of every live object (e.g. for shutdown). */
+    std::vector<Handle> live_handles() const {
+        std::vector<Handle> out;
+        out.reserve(live_);
+        for (std::uint32_t i = 0; i < capacity_; ++i) {
+            const Entry& e = chunks_[i / ChunkSize][i % ChunkSize];
+            if (e.live) out.push_back((static_cast<Handle>(e.gen) << 32) | i);
+        }
+        return out;
+    }
+
+    /**
+     * @brief Allocate chunks up front until @p n slots exist. Called from
+     *        the owning thread, so first-touch places them on its node.
+     */
+    void reserve(std::size_t n) {
+        while (capacity_ < n) grow_();
+    }
+
+    /** @brief Number of live objects. */
+    std::size_t size() const noexcept { return live_; }
+
+    /** @brief Number of slots allocated so far (live + free). */
+    std::size_t capacity() const noexcept { return capacity_; }
+
+private:
+    struct Entry {
+        T value{};
+        std::uint32_t gen{1};
+        bool live{false};
+    };
+
+    Entry& entry_(std::uint32_t idx) noexcept { return chunks_[idx / ChunkSize][idx % ChunkSize]; }
+
+    void grow_() {
+        chunks_.push_back(std::make_unique<Entry[]>(ChunkSize));
+        free_.reserve(free_.size() + ChunkSize);
+        // Push in reverse so the lowest index is handed out first.
+        for (std::size_t i = ChunkSize; i-- > 0;) {
+            free_.push_back(static_cast<std::uint32_t>(capacity_ + i));
+        }
+        capacity_ += static_cast<std::uint32_t>(ChunkSize);
+    }
+
+    std::vector<std::unique_ptr<Entry[]>> chunks_;
+    std::vector<std::uint32_t> free_;
+    std::uint32_t capacity_{0};
+    std::size_t live_{0};
+};
+
+} // namespace socketify::detail
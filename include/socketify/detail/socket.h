@@ -8,9 +8,12 @@
  * for both plain and TLS connections.
  */
 
+#include <sys/uio.h>
+
 #include <cstddef>
 #include <cstdint>
 #include <string>
+#include <string_view>
 
 // Forward-declare OpenSSL types so this header does not require openssl headers.
 typedef struct ssl_st SSL;
@@ -67,18 +70,39 @@ public:
      */
     IoResult handshake();
 
+    /** @brief Protocol chosen by ALPN during the handshake, or empty. */
+    std::string_view alpn() const noexcept;
+
     /**
      * @brief Read up to @p len bytes into @p buf.
      * @param[out] out Number of bytes read on Ok.
      */
     IoResult read(char* buf, std::size_t len, std::size_t& out);
 
+    /**
+     * @brief Scatter-read into @p count buffers (readv(2) on plain sockets;
+     *        TLS fills the first non-empty buffer only).
+     * @param[out] out Number of bytes read on Ok, spread over the buffers in
+     *                 order.
+     */
+    IoResult readv(const iovec* iov, std::size_t count, std::size_t& out);
+
     /**
      * @brief Write up to @p len bytes from @p buf.
      * @param[out] out Number of bytes written on Ok (may be a short write).
      */
     IoResult write(const char* buf, std::size_t len, std::size_t& out);
 
+    /**
+     * @brief Gather-write @p count buffers (sendmsg(2) on plain sockets).
+     *
+     * Under TLS the leading buffers are coalesced into a single SSL_write
+     * record of at most 16 KiB; a first buffer that large is written
+     * directly without copying.
+     * @param[out] out Number of bytes written on Ok (may be a short write).
+     */
+    IoResult writev(const iovec* iov, std::size_t count, std::size_t& out);
+
     /**
      * @brief Zero-copy file transmission (sendfile(2) on plain sockets;
      *        read+write fallback under TLS).
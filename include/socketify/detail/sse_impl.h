@@ -6,6 +6,7 @@
  */
 
 #include "socketify/sse.h"
+#include "socketify/detail/stream_limit.h"
 
 #include <functional>
 #include <mutex>
@@ -26,18 +27,24 @@ struct Session::Impl {
     bool closed{false};               ///< Connection is gone; drop sends.
     bool close_requested{false};      ///< User asked to close the stream.
     std::function<void()> notify;     ///< Wakes the owning event loop.
+    detail::StreamLimit limit;        ///< Slow-consumer policy (set on adoption).
 
-    /** @brief Append bytes and wake the loop. @return false when closed. */
+    /**
+     * @brief Append bytes and wake the loop.
+     * @return false when closed or refused by @ref limit.
+     */
     bool enqueue(std::string_view bytes) {
         std::function<void()> n;
+        bool ok = false;
         {
-            std::lock_guard<std::mutex> lk(mu);
+            std::unique_lock<std::mutex> lk(mu);
             if (closed) return false;
-            pending.append(bytes);
-            n = notify;
+            ok = limit.admit(lk, pending, bytes.size(), closed, close_requested);
+            if (ok) pending.append(bytes);
+            n = notify; // also delivers a close requested by the limit
         }
         if (n) n();
-        return true;
+        return ok;
     }
 };
 
@@ -0,0 +1,132 @@
+#pragma once
+/**
+ * @file stream_limit.h
+ * @brief Backlog limit shared by the SSE and Pulse connection states:
+ *        what a producer does when the consumer stops reading.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace socketify::detail {
+
+/**
+ * @brief True on worker event-loop threads (set by the worker when it
+ *        starts). Block never waits on one: a loop that sleeps can not
+ *        drain its own connections, and two loops sending to each other's
+ *        connections would deadlock.
+ */
+inline thread_local bool t_event_loop_thread = false;
+
+/** @brief What enqueue() does with bytes that would pass the high mark. */
+enum class OverflowAction : std::uint8_t {
+    Drop,  ///< Discard them; the send reports false.
+    Close, ///< Ask the worker to close the connection.
+    Block  ///< Wait until the backlog falls to the low mark.
+};
+
+/** @brief Per-worker tallies of what the limits did (bumped by producers). */
+struct StreamCounters {
+    std::atomic<std::uint64_t> drops{0};  ///< Sends refused by Drop.
+    std::atomic<std::uint64_t> closes{0}; ///< Streams closed by Close.
+    std::atomic<std::uint64_t> blocks{0}; ///< Sends that waited under Block.
+};
+
+/** @brief A worker's limit settings (ServerOptions), copied into each stream. */
+struct StreamPolicy {
+    std::size_t high{0};
+    std::size_t low{0};
+    OverflowAction action{OverflowAction::Close};
+    StreamCounters* counters{nullptr};
+};
+
+/**
+ * @brief The policy of the worker whose loop runs on this thread, so a
+ *        stream started in a handler is limited from its first write;
+ *        nullptr elsewhere.
+ */
+inline thread_local const StreamPolicy* t_stream_policy = nullptr;
+
+/**
+ * @brief Per-stream limit, guarded by the owning Impl's mutex.
+ *
+ * The backlog is the Impl's pending bytes plus @ref in_flight, the bytes
+ * the worker already moved into the socket queue but has not written. The
+ * worker installs the limit when it adopts the connection (chunked
+ * streams get it at start()) and refreshes in_flight after every flush;
+ * until then the stream is unlimited.
+ *
+ * Block on an event-loop thread never waits: the send is admitted while
+ * the backlog is still within the high mark, as ready() checks, and past
+ * it @ref loop_fallback applies.
+ */
+struct StreamLimit {
+    std::size_t high{0}; ///< 0 = unlimited.
+    std::size_t low{0};
+    OverflowAction action{OverflowAction::Close};
+    OverflowAction loop_fallback{OverflowAction::Close}; ///< Drop or Close.
+    StreamCounters* counters{nullptr};
+
+    std::size_t in_flight{0};
+    std::condition_variable drained; ///< Signalled at the low mark and on close.
+
+    /**
+     * @brief Decide whether @p add more bytes may be appended to @p pending.
+     * @param lk              Lock on the owning Impl's mutex (may be released
+     *                        while blocking).
+     * @param closed          Impl::closed; re-checked after waiting.
+     * @param close_requested Impl::close_requested; set by Close.
+     * @return true to append, false to discard.
+     */
+    bool admit(std::unique_lock<std::mutex>& lk, const std::string& pending, std::size_t add,
+               const bool& closed, bool& close_requested) {
+        if (high == 0 || pending.size() + in_flight + add <= high) return true;
+        switch (action) {
+        case OverflowAction::Drop:
+            return drop_();
+        case OverflowAction::Close:
+            return close_(close_requested);
+        case OverflowAction::Block:
+            if (t_event_loop_thread) {
+                if (pending.size() + in_flight <= high) return true;
+                return loop_fallback == OverflowAction::Drop ? drop_() : close_(close_requested);
+            }
+            if (counters) counters->blocks.fetch_add(1, std::memory_order_relaxed);
+            drained.wait(lk, [&] { return closed || pending.size() + in_flight <= low; });
+            return !closed;
+        }
+        return true;
+    }
+
+    /** @brief Take the marks, action and counters of @p p (lock held). */
+    void apply(const StreamPolicy& p) {
+        high = p.high;
+        low = p.low;
+        action = p.action;
+        counters = p.counters;
+    }
+
+    /** @brief Worker side: record the unwritten socket backlog (lock held). */
+    void set_in_flight(std::size_t n) {
+        in_flight = n;
+        if (action == OverflowAction::Block && n <= low) drained.notify_all();
+    }
+
+private:
+    bool drop_() {
+        if (counters) counters->drops.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    bool close_(bool& close_requested) {
+        if (!close_requested && counters) counters->closes.fetch_add(1, std::memory_order_relaxed);
+        close_requested = true;
+        return false;
+    }
+};
+
+} // namespace socketify::detail
@@ -0,0 +1,83 @@
+#pragma once
+/**
+ * @file thread_pool.h
+ * @brief Fixed-size worker pool with a bounded job queue, used to run
+ *        Route::Blocking() handlers and offload() calls off the event loops.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace socketify::detail {
+
+/**
+ * @brief Runs submitted jobs on @p threads threads in FIFO order.
+ *
+ * try_submit() never blocks: a full queue is reported to the caller, who
+ * sheds the request (503) instead of stalling an event loop.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param threads  Number of threads (at least one is started).
+     * @param capacity Max jobs waiting for a thread (0 = unbounded).
+     */
+    ThreadPool(unsigned threads, std::size_t capacity);
+
+    /** @brief Finish running jobs, drop queued ones and join the threads. */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /** @brief Queue @p job. @return false when the queue is full or stopping. */
+    bool try_submit(std::function<void()> job);
+
+    /** @brief Jobs waiting for a thread. */
+    std::size_t pending() const;
+
+    /** @brief Number of pool threads. */
+    std::size_t threads() const noexcept { return threads_.size(); }
+
+private:
+    void run_();
+
+    mutable std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> queue_;
+    std::vector<std::thread> threads_;
+    std::size_t capacity_;
+    bool stop_{false};
+};
+
+/**
+ * @brief A ThreadPool started on first get(), for work that may never
+ *        come (offload() without ServerOptions::blocking_threads).
+ */
+class LazyThreadPool {
+public:
+    LazyThreadPool(unsigned threads, std::size_t capacity) noexcept
+        : threads_(threads), capacity_(capacity) {}
+
+    /** @brief The pool, started by the first caller (thread-safe). */
+    ThreadPool& get();
+
+    /** @brief Join the pool if it was started; get() starts a new one. */
+    void reset();
+
+private:
+    unsigned threads_;
+    std::size_t capacity_;
+    std::mutex mu_;
+    std::atomic<ThreadPool*> ready_{nullptr};
+    std::unique_ptr<ThreadPool> pool_;
+};
+
+} // namespace socketify::detail
@@ -0,0 +1,125 @@
+#pragma once
+/**
+ * @file timer_wheel.h
+ * @brief Hierarchical timing wheel used for per-connection deadlines.
+ *
+ * Four levels of 64 slots at 1 ms resolution cover ~4.6 hours; longer
+ * timers are parked in the top level and re-cascaded until due. Arm,
+ * re-arm and cancel are O(1) (intrusive list unlink/link); advancing skips
+ * empty slots through per-level occupancy bitmaps.
+ */
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace socketify::detail {
+
+class TimerWheel;
+
+/**
+ * @brief Intrusive timer node. Embed one per owner (e.g. a connection).
+ *
+ * The callback is a plain function pointer plus context so firing never
+ * allocates, and the owner may destroy the timer from inside its own
+ * callback. Destroying an armed timer cancels it.
+ */
+class Timer {
+public:
+    using Callback = void (*)(void* ctx);
+
+    Timer() = default;
+    Timer(Callback fn, void* ctx) noexcept : fn_(fn), ctx_(ctx) {}
+    ~Timer();
+
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+    /** @brief Set the function invoked on expiry. */
+    void set_callback(Callback fn, void* ctx) noexcept {
+        fn_ = fn;
+        ctx_ = ctx;
+    }
+
+    /** @brief True while linked into a wheel. */
+    bool armed() const noexcept { return wheel_ != nullptr; }
+
+private:
+    friend class TimerWheel;
+
+    Timer* prev_{nullptr};
+    Timer* next_{nullptr};
+    TimerWheel* wheel_{nullptr};
+    std::uint64_t expires_{0}; ///< Absolute tick.
+    std::uint16_t slot_{0};    ///< level * 64 + index, or kDetached.
+    Callback fn_{nullptr};
+    void* ctx_{nullptr};
+};
+
+/**
+ * @brief Per-loop hierarchical timing wheel (not thread-safe).
+ */
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TimerWheel(Clock::time_point origin = Clock::now());
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /** @brief (Re-)arm @p t to fire at @p when (never earlier). */
+    void arm(Timer& t, Clock::time_point when);
+
+    /** @brief (Re-)arm @p t to fire @p after from now. */
+    void arm_after(Timer& t, Clock::duration after) { arm(t, Clock::now() + after); }
+
+    /** @brief Unlink @p t; no-op when not armed. */
+    void cancel(Timer& t) noexcept;
+
+    /**
+     * @brief Fire every timer due at or before @p now.
+     * @return Number of callbacks invoked.
+     */
+    std::size_t advance(Clock::time_point now);
+
+    /**
+     * @brief Milliseconds until the next slot needs attention, or -1 when
+     *        no timer is armed. May undershoot (a cascade is due) but
+     *        never overshoots a deadline.
+     */
+    int next_timeout_ms(Clock::time_point now) const;
+
+    /** @brief Number of armed timers. */
+    std::size_t size() const noexcept { return count_; }
+
+    /** @brief True when no timer is armed. */
+    bool empty() const noexcept { return count_ == 0; }
+
+private:
+    static constexpr unsigned kBits = 6;
+    static constexpr unsigned kSlots = 1u << kBits;
+    static constexpr unsigned kMask = kSlots - 1;
+    static constexpr unsigned kLevels = 4;
+    static constexpr std::uint64_t kSpan = std::uint64_t{1} << (kBits * kLevels);
+    static constexpr std::uint16_t kDetached = 0xFFFF;
+
+    struct Level {
+        std::array<Timer, kSlots> heads; ///< Circular-list sentinels.
+        std::uint64_t occupied{0};       ///< Bit i set when heads[i] is non-empty.
+    };
+
+    std::uint64_t tick_of_(Clock::time_point t) const noexcept;
+    void link_(Timer& t);
+    void unlink_(Timer& t) noexcept;
+    void cascade_(unsigned level);
+
+    Clock::time_point origin_;
+    std::uint64_t now_{0}; ///< Last processed tick.
+    std::size_t count_{0};
+    std::array<Level, kLevels> levels_;
+};
+
+} // namespace socketify::detail
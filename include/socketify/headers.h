@@ -0,0 +1,393 @@
+#pragma once
+/**
+ * @file headers.h
+ * @brief Interned well-known request header names and the flat header
+ *        container used by the parser and Request.
+ *
+ * header_id() maps a name to a HeaderId through a compile-time perfect hash
+ * (first and last eight bytes, case-folded a word at a time, into 256
+ * slots; one word-wise compare confirms), so looking up "Host" or
+ * "content-length" costs no allocation and no map probe.
+ * Headers keeps known fields in fixed slots and the rest in a small vector.
+ */
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <forward_list>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace socketify {
+
+/** @brief Well-known request header names; Unknown for everything else. */
+enum class HeaderId : std::uint8_t {
+    Accept, AcceptCharset, AcceptEncoding, AcceptLanguage,
+    AccessControlRequestHeaders, AccessControlRequestMethod,
+    AccessControlRequestPrivateNetwork,
+    Authorization, CacheControl, Connection,
+    ContentDisposition, ContentEncoding, ContentLanguage, ContentLength, ContentType,
+    Cookie, Date, Dnt, EarlyData, Expect, Forwarded, From, Host,
+    IfMatch, IfModifiedSince, IfNoneMatch, IfRange, IfUnmodifiedSince,
+    KeepAlive, MaxForwards, Origin, Pragma, Priority, ProxyAuthorization,
+    Range, Referer,
+    SecChUa, SecChUaMobile, SecChUaPlatform,
+    SecFetchDest, SecFetchMode, SecFetchSite, SecFetchUser,
+    SecWebSocketExtensions, SecWebSocketKey, SecWebSocketProtocol, SecWebSocketVersion,
+    Te, Trailer, TransferEncoding, Upgrade, UpgradeInsecureRequests, UserAgent, Via,
+    XApiKey, XCsrfToken, XForwardedFor, XForwardedHost, XForwardedProto, XRealIp,
+    XRequestId, XRequestedWith,
+    Unknown = 0xFF
+};
+
+/** @brief Number of well-known header names (HeaderId values below Unknown). */
+inline constexpr std::size_t kKnownHeaderCount = 62;
+
+namespace detail {
+
+/// Canonical spelling of every HeaderId, in enum order.
+inline constexpr std::array<std::string_view, kKnownHeaderCount> kHeaderNames{
+    "Accept", "Accept-Charset", "Accept-Encoding", "Accept-Language",
+    "Access-Control-Request-Headers", "Access-Control-Request-Method",
+    "Access-Control-Request-Private-Network",
+    "Authorization", "Cache-Control", "Connection",
+    "Content-Disposition", "Content-Encoding", "Content-Language", "Content-Length", "Content-Type",
+    "Cookie", "Date", "DNT", "Early-Data", "Expect", "Forwarded", "From", "Host",
+    "If-Match", "If-Modified-Since", "If-None-Match", "If-Range", "If-Unmodified-Since",
+    "Keep-Alive", "Max-Forwards", "Origin", "Pragma", "Priority", "Proxy-Authorization",
+    "Range", "Referer",
+    "Sec-CH-UA", "Sec-CH-UA-Mobile", "Sec-CH-UA-Platform",
+    "Sec-Fetch-Dest", "Sec-Fetch-Mode", "Sec-Fetch-Site", "Sec-Fetch-User",
+    "Sec-WebSocket-Extensions", "Sec-WebSocket-Key", "Sec-WebSocket-Protocol", "Sec-WebSocket-Version",
+    "TE", "Trailer", "Transfer-Encoding", "Upgrade", "Upgrade-Insecure-Requests", "User-Agent", "Via",
+    "X-Api-Key", "X-CSRF-Token", "X-Forwarded-For", "X-Forwarded-Host", "X-Forwarded-Proto", "X-Real-IP",
+    "X-Request-Id", "X-Requested-With"};
+
+/// Up to 8 bytes of @p p as a little-endian word, zero-padded.
+constexpr std::uint64_t header_word(const char* p, std::size_t n) noexcept {
+    if (!std::is_constant_evaluated() && std::endian::native == std::endian::little) {
+        // Overlapping loads instead of a byte loop.
+        if (n == 8) {
+            std::uint64_t w;
+            std::memcpy(&w, p, 8);
+            return w;
+        }
+        if (n >= 4) {
+            std::uint32_t lo, hi;
+            std::memcpy(&lo, p, 4);
+            std::memcpy(&hi, p + n - 4, 4);
+            return lo | std::uint64_t{hi} << (8 * (n - 4));
+        }
+        if (n == 0) return 0;
+        const auto at = [p](std::size_t i) {
+            return std::uint64_t{static_cast<unsigned char>(p[i])} << (8 * i);
+        };
+        return at(0) | at(n / 2) | at(n - 1);
+    }
+    std::uint64_t w = 0;
+    for (std::size_t i = 0; i < n; ++i) w |= std::uint64_t{static_cast<unsigned char>(p[i])} << (8 * i);
+    return w;
+}
+
+/// ASCII-lowercase the eight bytes of @p x at once.
+constexpr std::uint64_t header_lower_word(std::uint64_t x) noexcept {
+    constexpr std::uint64_t kOnes = 0x0101010101010101ull;
+    const std::uint64_t low7 = x & (0x7f * kOnes);
+    const std::uint64_t ge_a = low7 + (0x80 - 'A') * kOnes;     // bit 7: >= 'A'
+    const std::uint64_t gt_z = low7 + (0x80 - 'Z' - 1) * kOnes; // bit 7: > 'Z'
+    const std::uint64_t upper = ~x & (ge_a ^ gt_z) & (0x80 * kOnes);
+    return x | (upper >> 2);
+}
+
+/// Mixes the (lowercased) first and last eight bytes and the length; the
+/// multiplier was searched so that the top 8 bits are distinct for every
+/// known name.
+constexpr std::size_t header_slot(std::string_view s) noexcept {
+    const std::size_t n = s.size();
+    const std::uint64_t head = header_lower_word(header_word(s.data(), n < 8 ? n : 8));
+    const std::uint64_t tail = n > 8 ? header_lower_word(header_word(s.data() + n - 8, 8)) : 0;
+    return static_cast<std::size_t>(((head ^ std::rotl(tail, 29) ^ n) * 0x436959d1f4d2c10bull) >> 56);
+}
+
+/// Known names, lowercased and zero-padded so they compare a word at a time.
+struct HeaderTable {
+    static constexpr std::size_t kWidth = 40;
+    char lower[kKnownHeaderCount][kWidth]{};
+    std::uint8_t index[256]{}; ///< slot -> HeaderId (0xFF = empty)
+
+    constexpr HeaderTable() {
+        for (auto& i : index) i = 0xFF;
+        for (std::size_t i = 0; i < kHeaderNames.size(); ++i) {
+            const std::string_view n = kHeaderNames[i];
+            for (std::size_t j = 0; j < n.size(); ++j)
+                lower[i][j] = (n[j] >= 'A' && n[j] <= 'Z') ? static_cast<char>(n[j] - 'A' + 'a') : n[j];
+            index[header_slot(n)] = static_cast<std::uint8_t>(i);
+        }
+    }
+
+    /// Case-insensitive compare of @p s against known name @p i.
+    constexpr bool matches(std::size_t i, std::string_view s) const noexcept {
+        if (s.size() != kHeaderNames[i].size()) return false;
+        for (std::size_t off = 0; off < s.size(); off += 8) {
+            const std::size_t n = s.size() - off < 8 ? s.size() - off : 8;
+            if (header_lower_word(header_word(s.data() + off, n)) != header_word(lower[i] + off, 8))
+                return false;
+        }
+        return true;
+    }
+};
+inline constexpr HeaderTable kHeaderTable{};
+
+/// Case-insensitive ASCII equality, a word at a time.
+constexpr bool header_iequal(std::string_view a, std::string_view b) noexcept {
+    if (a.size() != b.size()) return false;
+    for (std::size_t off = 0; off < a.size(); off += 8) {
+        const std::size_t n = a.size() - off < 8 ? a.size() - off : 8;
+        if (header_lower_word(header_word(a.data() + off, n)) !=
+            header_lower_word(header_word(b.data() + off, n)))
+            return false;
+    }
+    return true;
+}
+
+} // namespace detail
+
+/** @brief HeaderId for @p name (any case), or HeaderId::Unknown. */
+constexpr HeaderId header_id(std::string_view name) noexcept {
+    if (name.size() < 2 || name.size() > 38) return HeaderId::Unknown;
+    const std::uint8_t i = detail::kHeaderTable.index[detail::header_slot(name)];
+    if (i == 0xFF || !detail::kHeaderTable.matches(i, name)) return HeaderId::Unknown;
+    return static_cast<HeaderId>(i);
+}
+
+/** @brief Canonical spelling of @p id ("" for Unknown). */
+constexpr std::string_view header_name(HeaderId id) noexcept {
+    const auto i = static_cast<std::size_t>(id);
+    return i < kKnownHeaderCount ? detail::kHeaderNames[i] : std::string_view();
+}
+
+namespace detail {
+constexpr bool header_table_is_perfect() noexcept {
+    for (std::size_t i = 0; i < kHeaderNames.size(); ++i)
+        if (header_id(kHeaderNames[i]) != static_cast<HeaderId>(i)) return false;
+    return true;
+}
+static_assert(header_table_is_perfect(), "known header names collide; pick another multiplier");
+static_assert(kKnownHeaderCount <= 64, "Headers tracks known slots in a 64-bit mask");
+} // namespace detail
+
+/** @brief One header field as views. */
+struct HeaderField {
+    std::string_view name;
+    std::string_view value;
+};
+
+/**
+ * @brief Request headers: known names in fixed slots, others in a vector.
+ *
+ * Names are case-insensitive and repeated fields are joined with ", "
+ * (RFC 9110 §5.3). add() borrows the name and value, so they must outlive
+ * the container unless own() is called; add_copy() and set() copy. A copy
+ * of a Headers owns all of its data; a move keeps the views as they are
+ * and leaves the source empty.
+ *
+ * Iteration, find() and count() follow the HeaderMap that headers() used
+ * to return: elements are (name, value) pairs of views, known headers
+ * first under their canonical spelling, then the rest in arrival order.
+ *
+ * @code
+ * std::string_view host = req.headers().get(HeaderId::Host);
+ * std::string_view key  = req.headers().get("X-Tenant");   // unknown name
+ * for (const auto& [name, value] : req.headers()) log(name, value);
+ * if (auto it = req.headers().find("x-tenant"); it != req.headers().end()) use(it->second);
+ * @endcode
+ */
+class Headers {
+public:
+    Headers() = default;
+    Headers(const Headers& other);
+    Headers(Headers&& other) noexcept;
+    Headers& operator=(const Headers& other);
+    Headers& operator=(Headers&& other) noexcept;
+    ~Headers() = default;
+
+    /** @brief Value of known header @p id ("" when absent). */
+    std::string_view get(HeaderId id) const noexcept {
+        const auto i = static_cast<std::size_t>(id);
+        return i < kKnownHeaderCount && (present_ >> i & 1u) ? known_[i] : std::string_view();
+    }
+
+    /** @brief Value of header @p name, any case ("" when absent). */
+    std::string_view get(std::string_view name) const noexcept;
+
+    /** @brief True when known header @p id is present. */
+    bool contains(HeaderId id) const noexcept {
+        const auto i = static_cast<std::size_t>(id);
+        return i < kKnownHeaderCount && (present_ >> i & 1u);
+    }
+
+    /** @brief True when header @p name is present. */
+    bool contains(std::string_view name) const noexcept;
+
+    /** @brief Value of header @p name; throws std::out_of_range when absent. */
+    std::string_view at(std::string_view name) const;
+
+    /** @brief Forward iterator over (name, value) pairs; see for_each() for the order. */
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<std::string_view, std::string_view>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        const_iterator() = default;
+
+        reference operator*() const noexcept { return cur_; }
+        pointer operator->() const noexcept { return &cur_; }
+
+        const_iterator& operator++() noexcept {
+            if (known_) known_ &= known_ - 1;
+            else ++other_;
+            load_();
+            return *this;
+        }
+        const_iterator operator++(int) noexcept {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        friend bool operator==(const const_iterator& a, const const_iterator& b) noexcept {
+            return a.known_ == b.known_ && a.other_ == b.other_;
+        }
+
+    private:
+        friend class Headers;
+        const_iterator(const Headers* h, std::uint64_t known, std::size_t other) noexcept
+            : h_(h), known_(known), other_(other) {
+            load_();
+        }
+
+        void load_() noexcept {
+            if (known_) {
+                const auto i = static_cast<std::size_t>(std::countr_zero(known_));
+                cur_ = {detail::kHeaderNames[i], h_->known_[i]};
+            } else if (other_ < h_->other_.size()) {
+                cur_ = {h_->other_[other_].name, h_->other_[other_].value};
+            }
+        }
+
+        const Headers* h_{nullptr};
+        std::uint64_t known_{0}; ///< known slots not yet visited, current one lowest
+        std::size_t other_{0};   ///< index into other_ once known_ is exhausted
+        value_type cur_;
+    };
+    using iterator = const_iterator;
+
+    /** @brief First header. */
+    const_iterator begin() const noexcept { return {this, present_, 0}; }
+    /** @brief Past the last header. */
+    const_iterator end() const noexcept { return {this, 0, other_.size()}; }
+
+    /** @brief Iterator to header @p name (any case), or end(). */
+    const_iterator find(std::string_view name) const noexcept;
+
+    /** @brief Iterator to known header @p id, or end(). */
+    const_iterator find(HeaderId id) const noexcept {
+        const auto i = static_cast<std::size_t>(id);
+        return contains(id) ? const_iterator(this, present_ >> i << i, 0) : end();
+    }
+
+    /** @brief 1 when header @p name is present, else 0 (repeats are joined). */
+    std::size_t count(std::string_view name) const noexcept { return contains(name) ? 1 : 0; }
+
+    /** @brief Number of distinct header names. */
+    std::size_t size() const noexcept {
+        return static_cast<std::size_t>(std::popcount(present_)) + other_.size();
+    }
+
+    /** @brief True when there are no headers. */
+    bool empty() const noexcept { return present_ == 0 && other_.empty(); }
+
+    /** @brief Remove everything (keeps the unknown-field capacity). */
+    void clear() noexcept;
+
+    /** @brief Add a field without copying (@p id must be header_id(name)). */
+    void add(HeaderId id, std::string_view name, std::string_view value);
+    /** @brief Add a field without copying. */
+    void add(std::string_view name, std::string_view value) { add(header_id(name), name, value); }
+    /** @brief Add a copy of a field (@p id must be header_id(name)). */
+    void add_copy(HeaderId id, std::string_view name, std::string_view value);
+    /** @brief Add a copy of a field. */
+    void add_copy(std::string_view name, std::string_view value) {
+        add_copy(header_id(name), name, value);
+    }
+
+    /** @brief Replace known header @p id with a copy of @p value. */
+    void set(HeaderId id, std::string_view value);
+    /** @brief Replace header @p name with a copy of @p value. */
+    void set(std::string_view name, std::string_view value);
+
+    /** @brief Write access by name: `headers["X-Id"] = v` is set("X-Id", v). */
+    class Assign {
+    public:
+        Assign(Headers& h, std::string_view name) noexcept : h_(h), name_(name) {}
+        Assign& operator=(std::string_view value) {
+            h_.set(name_, value);
+            return *this;
+        }
+
+    private:
+        Headers& h_;
+        std::string_view name_;
+    };
+    /** @brief See Assign. */
+    Assign operator[](std::string_view name) noexcept { return {*this, name}; }
+
+    /** @brief Copy every borrowed name and value into owned storage. */
+    void own();
+
+    /**
+     * @brief Call @p fn(name, value) or @p fn(id, name, value) for every
+     *        header: known ones first (canonical spelling), then the rest
+     *        in arrival order.
+     */
+    template <class Fn>
+    void for_each(Fn&& fn) const {
+        for (std::uint64_t m = present_; m; m &= m - 1) {
+            const auto i = static_cast<std::size_t>(std::countr_zero(m));
+            visit_(fn, static_cast<HeaderId>(i), detail::kHeaderNames[i], known_[i]);
+        }
+        for (const HeaderField& f : other_) visit_(fn, HeaderId::Unknown, f.name, f.value);
+    }
+
+private:
+    template <class Fn>
+    static void visit_(Fn& fn, HeaderId id, std::string_view name, std::string_view value) {
+        if constexpr (std::is_invocable_v<Fn&, HeaderId, std::string_view, std::string_view>)
+            fn(id, name, value);
+        else
+            fn(name, value);
+    }
+
+    void add_(HeaderId id, std::string_view name, std::string_view value);
+    HeaderField* find_other_(std::string_view name) noexcept;
+    const HeaderField* find_other_(std::string_view name) const noexcept;
+    std::string_view keep_(std::string_view s);
+    void join_(std::string_view& slot, std::string_view value);
+
+    std::uint64_t present_{0}; ///< bit i set: known_[i] holds HeaderId(i)
+    std::array<std::string_view, kKnownHeaderCount> known_{};
+    std::vector<HeaderField> other_;
+    std::forward_list<std::string> owned_; ///< node-stable, so views survive moves
+    bool borrowed_{false};                 ///< some view points outside owned_
+};
+
+} // namespace socketify
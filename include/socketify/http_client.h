@@ -20,9 +20,20 @@
  *                                  R"({"name":"x"})",
  *                                  {{"Content-Type", "application/json"}});
  * @endcode
+ *
+ * Inside a coroutine handler use the async_ variants: the blocking call
+ * runs on the server's blocking pool and the handler resumes on its loop.
+ *
+ * @code
+ * server.Get("/proxy", [](Request&, Response& res) -> Task<void> {
+ *     auto up = co_await http_client::async_get("http://backend/ping");
+ *     res.status(up.ok() ? 200 : 502).send(up.body);
+ * });
+ * @endcode
  */
 
 #include "socketify/http.h"
+#include "socketify/task.h"
 
 #include <nlohmann/json.hpp>
 
@@ -66,4 +77,13 @@ Response get(const std::string& url, HeaderMap headers = {});
  */
 Response post(const std::string& url, std::string body, HeaderMap headers = {});
 
+/** @brief request() through offload(), for coroutine handlers (see task.h). */
+Task<Response> async_request(Request req);
+
+/** @brief get() through offload(), for coroutine handlers. */
+Task<Response> async_get(std::string url, HeaderMap headers = {});
+
+/** @brief post() through offload(), for coroutine handlers. */
+Task<Response> async_post(std::string url, std::string body, HeaderMap headers = {});
+
 } // namespace socketify::http_client
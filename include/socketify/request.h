@@ -4,19 +4,40 @@
  * @brief HTTP request representation passed to handlers and middleware.
  */
 
+#include "socketify/headers.h"
 #include "socketify/http.h"
 
 #include <nlohmann/json.hpp>
 
+#include <atomic>
+#include <cstddef>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace socketify {
 
+namespace detail {
+class FileHandle;
+
+/** @brief Claim the next Request::local<T>() slot (process-wide). */
+std::size_t next_local_slot() noexcept;
+
+/** @brief The slot Request locals of type @p T live in. */
+template <typename T>
+std::size_t local_slot() noexcept {
+    static const std::size_t slot = next_local_slot();
+    return slot;
+}
+} // namespace detail
+
 /** @brief Key/value map for query parameters, path parameters and cookies. */
 using ParamMap  = std::unordered_map<std::string, std::string>;
 /** @brief Key/value map for request cookies. */
@@ -26,8 +47,23 @@ using CookieMap = std::unordered_map<std::string, std::string>;
  * @brief An incoming HTTP request.
  *
  * A Request is created by the server for every parsed HTTP message and is
- * valid only for the duration of the handler call. All views point into
- * request-owned storage.
+ * valid only for the duration of the handler call. With
+ * ServerOptions::zero_copy_requests its path, target, version, headers and
+ * Content-Length body are views into the connection's receive buffer, which
+ * stays pinned until the response is serialized; a copied or moved Request
+ * (coroutines, deferred handlers) owns all of its data.
+ *
+ * The server builds each Request on its worker's request arena
+ * (ServerOptions::request_arena_size): arena(), the locals and the
+ * router's temporaries live there until the response is serialized.
+ * Copies and moved-to Requests use the global heap, so they may outlive
+ * the handler call.
+ *
+ * The const accessors may be called from several threads at once (for
+ * example a handler and a Blocking() task sharing one Request): query(),
+ * cookies() and body_string() fill their caches once, under a per-request
+ * mutex, and later calls only read an atomic flag. The mutable_* and set_*
+ * members are not synchronized.
  *
  * @code
  * server.AddRoute(Method::GET, "/users/:id", [](Request& req, Response& res) {
@@ -40,6 +76,14 @@ using CookieMap = std::unordered_map<std::string, std::string>;
 class Request {
 public:
     Request() = default;
+    /** @brief Internal: a Request whose scratch memory comes from @p arena. */
+    explicit Request(std::pmr::memory_resource* arena) : locals_(arena), named_locals_(arena) {}
+    Request(const Request& other);
+    /// Moving a borrowing Request copies the borrowed bytes, so may throw.
+    Request(Request&& other);
+    Request& operator=(const Request& other);
+    Request& operator=(Request&& other);
+    ~Request() = default;
 
     // ------------------------------------------------------------------
     // Basic info
@@ -64,24 +108,30 @@ public:
     // Headers
     // ------------------------------------------------------------------
 
-    /** @brief All request headers (keys are case-insensitive). */
-    const HeaderMap& headers() const noexcept { return headers_; }
+    /**
+     * @brief All request headers (names are case-insensitive, repeats
+     *        joined with ", ").
+     */
+    const Headers& headers() const noexcept { return headers_; }
 
     /**
      * @brief Look up a single header value.
      * @return The value, or an empty view when the header is absent.
      */
-    std::string_view header(std::string_view key) const;
+    std::string_view header(std::string_view key) const noexcept { return headers_.get(key); }
+
+    /** @brief Look up a well-known header without hashing its name. */
+    std::string_view header(HeaderId id) const noexcept { return headers_.get(id); }
 
     /** @brief Content-Type header value ("" when absent). */
-    std::string_view content_type() const { return header(H_ContentType); }
+    std::string_view content_type() const noexcept { return header(HeaderId::ContentType); }
 
     // ------------------------------------------------------------------
     // Query / path params / cookies
     // ------------------------------------------------------------------
 
-    /** @brief Decoded query-string parameters ("?a=1&b=2"). */
-    const ParamMap& query() const noexcept { return query_; }
+    /** @brief Decoded query-string parameters ("?a=1&b=2"), parsed on first use. */
+    const ParamMap& query() const;
 
     /** @brief Value of a single query parameter ("" when absent). */
     std::string_view query_value(std::string_view key) const;
@@ -89,8 +139,8 @@ public:
     /** @brief Path parameters bound by the router ("/users/:id"). */
     const ParamMap& params() const noexcept { return params_; }
 
-    /** @brief Parsed cookies from the Cookie header. */
-    const CookieMap& cookies() const noexcept { return cookies_; }
+    /** @brief Cookies from the Cookie header, parsed on first use. */
+    const CookieMap& cookies() const;
 
     /** @brief Value of a single cookie ("" when absent). */
     std::string_view cookie(std::string_view key) const;
@@ -102,11 +152,24 @@ public:
     /** @brief Request body as a view (valid for the handler's lifetime). */
     std::string_view body_view() const noexcept { return body_; }
 
-    /** @brief Request body as an owned string reference. */
-    const std::string& body_string() const noexcept { return body_storage_; }
+    /**
+     * @brief Request body as an owned string reference. A borrowed body
+     *        (ServerOptions::zero_copy_requests) is copied on the first
+     *        call; prefer body_view().
+     */
+    const std::string& body_string() const;
 
     /** @brief True when a non-empty body was received. */
-    bool has_body() const noexcept { return !body_.empty() || !body_storage_.empty(); }
+    bool has_body() const noexcept {
+        return !body_.empty() || !body_storage_.empty() || body_file_ != nullptr;
+    }
+
+    /**
+     * @brief Spooled body (ServerOptions::body_spool_threshold): an unnamed
+     *        file holding size() bytes, read through fd(). body_view() is
+     *        empty then. nullptr when the body is in memory.
+     */
+    const detail::FileHandle* body_file() const noexcept { return body_file_.get(); }
 
     /**
      * @brief Parse the request body as JSON.
@@ -120,27 +183,55 @@ public:
     // ------------------------------------------------------------------
 
     /**
-     * @brief Attach an arbitrary object to this request under @p key.
+     * @brief Attach an object to this request, keyed by its type.
      *
      * Middleware uses this to pass data to downstream handlers, e.g. the
-     * sessions middleware stores the active Session here.
+     * sessions middleware stores the active Session here. Each type has a
+     * process-wide slot index, so lookups are an array access.
      */
-    void set_local(std::string key, std::shared_ptr<void> value) {
-        locals_[std::move(key)] = std::move(value);
+    template <typename T>
+    void set_local(std::shared_ptr<T> value) {
+        const std::size_t slot = detail::local_slot<std::remove_cv_t<T>>();
+        if (slot >= locals_.size()) locals_.resize(slot + 1);
+        locals_[slot] = std::move(value);
     }
 
     /**
-     * @brief Retrieve an object previously stored with set_local().
+     * @brief Retrieve the object of type @p T stored with set_local(value).
+     * @return Shared pointer to the object, or nullptr when absent.
+     */
+    template <typename T>
+    std::shared_ptr<T> local() const {
+        const std::size_t slot = detail::local_slot<std::remove_cv_t<T>>();
+        if (slot >= locals_.size()) return nullptr;
+        return std::static_pointer_cast<T>(locals_[slot]);
+    }
+
+    /**
+     * @brief Attach an object under a string @p key (for several objects
+     *        of one type; prefer the typed overload otherwise).
+     */
+    void set_local(std::string_view key, std::shared_ptr<void> value);
+
+    /**
+     * @brief Retrieve an object previously stored with set_local(key, value).
      * @tparam T The stored type.
      * @return Shared pointer to the object, or nullptr when absent.
      */
     template <typename T>
-    std::shared_ptr<T> local(const std::string& key) const {
-        auto it = locals_.find(key);
-        if (it == locals_.end()) return nullptr;
-        return std::static_pointer_cast<T>(it->second);
+    std::shared_ptr<T> local(std::string_view key) const {
+        for (const auto& [k, v] : named_locals_)
+            if (k == key) return std::static_pointer_cast<T>(v);
+        return nullptr;
     }
 
+    /**
+     * @brief Memory for data that lives no longer than this request, e.g.
+     *        the router's temporaries (the default resource for Requests
+     *        the server did not build).
+     */
+    std::pmr::memory_resource* arena() const noexcept { return locals_.get_allocator().resource(); }
+
     // ------------------------------------------------------------------
     // Internal setters (used by the server / parser; not for handlers)
     // ------------------------------------------------------------------
@@ -148,42 +239,84 @@ public:
     /** @brief Internal: set the parsed method. */
     void set_method(Method m) { method_ = m; }
     /** @brief Internal: set the decoded path. */
-    void set_path(std::string p) { path_ = std::move(p); }
+    void set_path(std::string p) { path_storage_ = std::move(p); path_ = path_storage_; }
     /** @brief Internal: set the raw request-target. */
-    void set_target(std::string t) { target_ = std::move(t); }
+    void set_target(std::string t) { target_storage_ = std::move(t); target_ = target_storage_; }
     /** @brief Internal: set the HTTP version string. */
-    void set_version(std::string v) { version_ = std::move(v); }
+    void set_version(std::string v) { version_storage_ = std::move(v); version_ = version_storage_; }
+    /** @brief Internal: borrow the decoded path (no copy). */
+    void set_path_view(std::string_view p) { path_ = p; }
+    /** @brief Internal: borrow the raw request-target (no copy). */
+    void set_target_view(std::string_view t) { target_ = t; }
+    /** @brief Internal: borrow the HTTP version string (no copy). */
+    void set_version_view(std::string_view v) { version_ = v; }
     /** @brief Internal: set the client address. */
     void set_remote_ip(std::string ip) { remote_ip_ = std::move(ip); }
     /** @brief Internal: mutable access to headers. */
-    HeaderMap& mutable_headers() { return headers_; }
-    /** @brief Internal: mutable access to query parameters. */
-    ParamMap& mutable_query() { return query_; }
+    Headers& mutable_headers() noexcept { return headers_; }
+    /** @brief Internal: install the headers (may borrow, like the views above). */
+    void set_headers(Headers h) noexcept { headers_ = std::move(h); }
+    /** @brief Internal: hand the headers back (cleared) for reuse. */
+    Headers take_headers() noexcept {
+        Headers h = std::move(headers_);
+        h.clear();
+        return h;
+    }
+    /** @brief Internal: mutable access to query parameters (parsed first). */
+    ParamMap& mutable_query() {
+        query();
+        return query_;
+    }
     /** @brief Internal: mutable access to path parameters. */
     ParamMap& mutable_params() { return params_; }
-    /** @brief Internal: mutable access to cookies. */
-    CookieMap& mutable_cookies() { return cookies_; }
-    /** @brief Internal: set the body as a non-owning view. */
-    void set_body_view(std::string_view view) { body_ = view; }
+    /** @brief Internal: mutable access to cookies (parsed first). */
+    CookieMap& mutable_cookies() {
+        cookies();
+        return cookies_;
+    }
+    /** @brief Internal: set the body as a non-owning view (owned once copied). */
+    void set_body_view(std::string_view view) {
+        body_ = view;
+        body_ready_.store(false, std::memory_order_relaxed);
+    }
     /** @brief Internal: set the body, transferring ownership. */
-    void set_body_storage(std::string b) { body_storage_ = std::move(b); body_ = body_storage_; }
+    void set_body_storage(std::string b) {
+        body_storage_ = std::move(b);
+        body_ = body_storage_;
+        body_ready_.store(true, std::memory_order_relaxed);
+    }
+    /** @brief Internal: attach a spooled body (shared by copies). */
+    void set_body_file(detail::FileHandle f);
 
 private:
+    std::ptrdiff_t body_offset_() const noexcept;
+    void rebind_body_(std::string_view from, std::ptrdiff_t off);
+    void own_();
+
     Method method_{Method::UNKNOWN};
-    std::string path_;          ///< decoded path (/api/v2/user)
-    std::string target_;        ///< raw request-target (/api/v2/user?id=42)
-    std::string version_;       ///< HTTP version (HTTP/1.1)
+    std::string_view path_;     ///< decoded path (/api/v2/user)
+    std::string_view target_;   ///< raw request-target (/api/v2/user?id=42)
+    std::string_view version_;  ///< HTTP version (HTTP/1.1)
+    std::string path_storage_;  ///< backs path_ unless borrowed
+    std::string target_storage_;
+    std::string version_storage_;
     std::string remote_ip_;     ///< client address
 
-    HeaderMap headers_;
-    ParamMap query_;
+    Headers headers_;
+    mutable ParamMap query_;    ///< from target_, once query_ready_
     ParamMap params_;
-    CookieMap cookies_;
+    mutable CookieMap cookies_; ///< from the Cookie header, once cookies_ready_
+    mutable std::atomic<bool> query_ready_{false};
+    mutable std::atomic<bool> cookies_ready_{false};
 
-    std::string body_storage_;  ///< owns body data if we copied it
+    mutable std::string body_storage_; ///< owns body data if we copied it
     std::string_view body_;     ///< view into buffer or body_storage
+    mutable std::atomic<bool> body_ready_{false}; ///< body_storage_ holds all of body_
+    mutable std::mutex lazy_mu_; ///< fills query_, cookies_ and body_storage_ once
+    std::shared_ptr<detail::FileHandle> body_file_; ///< spooled body
 
-    std::unordered_map<std::string, std::shared_ptr<void>> locals_;
+    std::pmr::vector<std::shared_ptr<void>> locals_; ///< indexed by detail::local_slot<T>()
+    std::pmr::vector<std::pair<std::string, std::shared_ptr<void>>> named_locals_;
 };
 
 } // namespace socketify
@@ -3,26 +3,45 @@
  * @file response.h
  * @brief HTTP response builder passed to handlers and middleware.
  *
- * Three kinds of responses are supported:
+ * Response kinds:
  *  - **Buffered** (default): body accumulated in memory via send()/json()/write().
  *  - **File**: send_file() streams a file from disk (sendfile(2) on plain sockets).
  *  - **Stream** (SSE): the connection stays open and data is pushed later.
+ *  - **Chunked**: a chunked body produced later through a chunked::Writer
+ *    (see chunked.h); the connection stays keep-alive.
  *  - **Pulse**: bidirectional WebSocket-compatible channel after HTTP 101.
+ *  - **Deferred**: finished later, from any thread, through a Deferred handle
+ *    (see deferred.h).
  */
 
 #include "socketify/cookies.h"
 #include "socketify/http.h"
 #include <nlohmann/json.hpp>
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <memory_resource>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace socketify {
 
+namespace detail {
+class FileHandle;
+}
+
+/**
+ * @brief Response header map: a case-insensitive HeaderMap whose nodes are
+ *        allocated from the Response's memory resource. It is a different
+ *        type from HeaderMap; copy with
+ *        `HeaderMap(m.begin(), m.end())` where one is needed.
+ */
+using ResponseHeaderMap = std::pmr::unordered_map<std::string, std::string, ci_hash, ci_equal>;
+
 /**
  * @brief An outgoing HTTP response.
  *
@@ -32,13 +51,37 @@ namespace socketify {
  * res.send_file("assets/logo.png");
  * res.redirect("/login");
  * @endcode
+ *
+ * The server allocates the header map and Set-Cookie list of the Response
+ * it hands to a handler from the request's arena (Request::arena()).
+ * Copies and moved-to Responses use the global heap.
  */
 class Response {
 public:
     /** @brief Internal response kind (introspected by the server). */
-    enum class Kind : std::uint8_t { Buffered, File, Stream, Pulse };
+    enum class Kind : std::uint8_t { Buffered, File, Stream, Pulse, Deferred, Chunked };
+
+    /**
+     * @brief Headers the serializer treats specially, tracked as bit flags
+     *        by set_header() so the hot path needs no string compares.
+     */
+    enum class KnownHeader : std::uint8_t {
+        ContentLength   = 1u << 0,
+        Connection      = 1u << 1,
+        ContentType     = 1u << 2,
+        ContentEncoding = 1u << 3,
+        Vary            = 1u << 4,
+    };
 
     Response() = default;
+    /** @brief Internal: a Response whose headers live on @p arena. */
+    explicit Response(std::pmr::memory_resource* arena) : headers_(arena), set_cookies_(arena) {}
+    Response(const Response& other);
+    /// Moving out of an arena-backed Response copies its headers, so may throw.
+    Response(Response&& other);
+    Response& operator=(const Response& other);
+    Response& operator=(Response&& other);
+    ~Response() = default;
 
     // ---- Status / headers ----
 
@@ -133,16 +176,31 @@ public:
      */
     bool send_file_range(std::string_view fs_path, std::uint64_t offset, std::uint64_t length);
 
+    /**
+     * @brief Stream a byte range of an already open file; the descriptor is
+     *        shared, not reopened (static_files' cache hands out its own).
+     * @param file    Open file; its size bounds the range.
+     * @param fs_path Path reported by file_path() (logging, Content-Type).
+     * @return false when @p file is not open or the range is invalid.
+     */
+    bool send_file_range(std::shared_ptr<const detail::FileHandle> file, std::string_view fs_path,
+                         std::uint64_t offset, std::uint64_t length);
+
     // ---- Introspection (used by the server; safe for middleware) ----
 
     /** @brief True after the response was finalized. */
     bool ended() const noexcept { return ended_; }
     /** @brief Current status code (0 = unset). */
     std::uint16_t status_code() const noexcept { return status_code_; }
-    /** @brief Response headers. */
-    const HeaderMap& headers() const noexcept { return headers_; }
+    /** @brief Response headers (a ResponseHeaderMap, not a HeaderMap). */
+    const ResponseHeaderMap& headers() const noexcept { return headers_; }
+
+    /** @brief True when @p h was set through set_header(). */
+    bool has_known_header(KnownHeader h) const noexcept {
+        return (known_headers_ & static_cast<std::uint8_t>(h)) != 0;
+    }
     /** @brief Queued Set-Cookie values (one header each). */
-    const std::vector<std::string>& set_cookies() const noexcept { return set_cookies_; }
+    const std::pmr::vector<std::string>& set_cookies() const noexcept { return set_cookies_; }
     /** @brief Body as a view. */
     std::string_view body_view() const noexcept { return body_; }
     /** @brief Body as an owned string reference. */
@@ -158,6 +216,8 @@ public:
     std::uint64_t file_offset() const noexcept { return file_offset_; }
     /** @brief File range length for Kind::File responses (0 = whole file). */
     std::uint64_t file_length() const noexcept { return file_length_; }
+    /** @brief The open file for Kind::File responses; the writer streams from it. */
+    const std::shared_ptr<const detail::FileHandle>& file_handle() const noexcept { return file_; }
 
     // ---- Internal (server / SSE plumbing) ----
 
@@ -167,13 +227,28 @@ public:
         stream_state_ = std::move(state);
         ended_ = true;
     }
+    /** @brief Internal: mark this response as a chunked stream (chunked.h). */
+    void mark_chunked(std::shared_ptr<void> state) {
+        kind_ = Kind::Chunked;
+        stream_state_ = std::move(state);
+        ended_ = true;
+    }
     /** @brief Internal: mark this response as a Pulse (WebSocket) upgrade. */
     void mark_pulse(std::shared_ptr<void> state) {
         kind_ = Kind::Pulse;
         stream_state_ = std::move(state);
         ended_ = true;
     }
-    /** @brief Internal: stream/pulse state attached by mark_stream/mark_pulse. */
+    /**
+     * @brief Internal: the handler handed the response to a Deferred
+     *        handle; the real response lives in @p state.
+     */
+    void mark_deferred(std::shared_ptr<void> state) {
+        kind_ = Kind::Deferred;
+        stream_state_ = std::move(state);
+        ended_ = true;
+    }
+    /** @brief Internal: state attached by the mark_*() calls. */
     const std::shared_ptr<void>& stream_state() const noexcept { return stream_state_; }
 
     /** @brief Internal: take the body, leaving the response empty. */
@@ -187,10 +262,13 @@ public:
 
 private:
     void ensure_body_owned_();
+    std::ptrdiff_t body_offset_() const noexcept;
+    void rebind_body_(std::string_view from, std::ptrdiff_t off) noexcept;
 
     std::uint16_t status_code_{0};
-    HeaderMap     headers_{};
-    std::vector<std::string> set_cookies_{};
+    std::uint8_t  known_headers_{0}; ///< KnownHeader bits.
+    ResponseHeaderMap headers_{};
+    std::pmr::vector<std::string> set_cookies_{};
 
     bool          ended_{false};
     Kind          kind_{Kind::Buffered};
@@ -201,6 +279,7 @@ private:
     std::string   file_path_{};
     std::uint64_t file_offset_{0};
     std::uint64_t file_length_{0};
+    std::shared_ptr<const detail::FileHandle> file_{};
 
     std::shared_ptr<void> stream_state_{};
 };
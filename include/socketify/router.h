@@ -7,16 +7,30 @@
  *  - static:   "/users/list"
  *  - params:   "/users/:id" (bound into Request::params())
  *  - wildcard: "/files/" + "*path" (captures the remaining path)
+ *
+ * Routes are compiled into a radix tree over path segments. When several
+ * routes match a request, the one registered first wins, as with a linear
+ * scan: register "/users/me" before "/users/:id" for it to be reachable.
+ *
+ * Router::route() takes the pattern as a template argument instead,
+ * parsed at compile time, and hands the handler typed parameters (see
+ * typed_route.h); such routes share the tree with the others.
  */
 
+#include "socketify/body_stream.h"
 #include "socketify/http.h"
 #include "socketify/middleware.h"
 #include "socketify/request.h"
 #include "socketify/response.h"
+#include "socketify/task.h"
+#include "socketify/typed_route.h"
 
+#include <cstddef>
+#include <cstdint>
 #include <deque>
 #include <functional>
 #include <memory>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -24,6 +38,8 @@
 
 namespace socketify {
 
+class Router;
+
 /**
  * @brief A single registered route: method + pattern + handler.
  *
@@ -39,7 +55,23 @@ public:
         : method_(m), pattern_(std::move(pattern)), handler_(std::move(h)) {}
 
     /** @brief Attach middleware that runs only for this route. */
-    Route& Use(Middleware mw) { middlewares_.push_back(std::move(mw)); return *this; }
+    Route& Use(Middleware mw);
+
+    /**
+     * @brief Mark the handler as blocking (disk, database, CPU-heavy work).
+     *
+     * Middleware still runs on the worker loop; the handler itself runs on
+     * the ServerOptions::blocking_threads pool and its response is sent
+     * when it returns (see deferred.h). Without a pool it runs inline.
+     */
+    Route& Blocking(bool on = true) noexcept { blocking_ = on; return *this; }
+
+    /**
+     * @brief Stream the request body to @p h as it arrives instead of
+     *        buffering it (see body_stream.h). The handler runs after the
+     *        last piece, with an empty Request::body().
+     */
+    Route& OnBody(BodyHandler h) { body_handler_ = std::move(h); return *this; }
 
     /** @brief Method this route responds to. */
     Method method() const noexcept { return method_; }
@@ -49,12 +81,25 @@ public:
     const Handler& handler() const noexcept { return handler_; }
     /** @brief Per-route middleware, in registration order. */
     const std::vector<Middleware>& middlewares() const noexcept { return middlewares_; }
+    /** @brief True when the handler runs on the blocking pool. */
+    bool blocking() const noexcept { return blocking_; }
+    /** @brief Body handler set with OnBody(), if any. */
+    const BodyHandler& body_handler() const noexcept { return body_handler_; }
+    /** @brief True when the request body is streamed to body_handler(). */
+    bool streams_body() const noexcept { return static_cast<bool>(body_handler_); }
+    /**
+     * @brief True for routes registered with Router::route(): the handler
+     *        parses its own parameters and Request::params() stays empty.
+     */
+    bool typed() const noexcept { return typed_; }
 
 private:
     Method method_;
     std::string pattern_;
     Handler handler_;
     std::vector<Middleware> middlewares_;
+    bool blocking_{false};
+    BodyHandler body_handler_;
 
     friend class Router;
     struct Seg {
@@ -62,6 +107,11 @@ private:
         std::string text; // literal for Static, name for Param/Wildcard
     };
     std::vector<Seg> segs_;
+    std::size_t order_{0}; ///< registration index; the lowest match wins
+    bool typed_{false};
+    Router* router_{nullptr}; ///< owner, told when middleware is added
+    /// Global, group and route middleware in run order (Router::build()).
+    mutable std::vector<const Middleware*> chain_;
 };
 
 /**
@@ -69,10 +119,20 @@ private:
  *
  * Dispatch order: global middleware (registration order) -> group middleware
  * of the matched route -> per-route middleware -> handler.
+ *
+ * Lookups run on a radix tree built by build() (Server::Run() calls it);
+ * each tree node has a table of the routes ending there, indexed by method.
+ * Paths of routes without parameters also go into a perfect hash table
+ * checked first, so they resolve with one hash and one compare.
+ * build() also flattens each route's global, group and route middleware
+ * into one array, so dispatch() walks it by index. Register routes and
+ * middleware before the server runs: a change marks the tree stale and
+ * the next lookup rebuilds it, which is not safe while workers route.
  */
 class Router {
 public:
-    Router() = default;
+    Router();
+    ~Router();
 
     /**
      * @brief Register a route.
@@ -84,11 +144,43 @@ public:
     Route& AddRoute(Method m, std::string_view pattern, Handler h) {
         routes_.emplace_back(m, std::string(pattern), std::move(h));
         routes_.back().segs_ = compile_pattern_(routes_.back().pattern_);
+        routes_.back().router_ = this;
+        routes_.back().order_ = routes_.size() - 1;
+        stale_ = true;
         return routes_.back();
     }
 
+    /** @brief Register a coroutine handler (see task.h). */
+    template <CoroutineHandler F>
+    Route& AddRoute(Method m, std::string_view pattern, F h) {
+        return AddRoute(m, pattern, co_handler(std::move(h)));
+    }
+
+    /**
+     * @brief Register a route whose pattern is parsed at compile time; the
+     *        handler takes its parameters typed (see typed_route.h).
+     * @code
+     * router.route<"/users/:id">(Method::GET,
+     *     [](Request&, Response& res, std::int64_t id) { ... });
+     * @endcode
+     */
+    template <fixed_string P, class F>
+    Route& route(Method m, F h) {
+        Route& r = AddRoute(m, P.view(), detail::typed_handler<P>(std::move(h), 0));
+        r.typed_ = true;
+        return r;
+    }
+
+    /** @brief route() for Method::GET. */
+    template <fixed_string P, class F>
+    Route& route(F h) { return route<P>(Method::GET, std::move(h)); }
+
     /** @brief Register global middleware (runs for every request). */
-    Router& Use(Middleware mw) { global_mw_.push_back(std::move(mw)); return *this; }
+    Router& Use(Middleware mw) {
+        global_mw_.push_back(std::move(mw));
+        stale_ = true;
+        return *this;
+    }
 
     /**
      * @brief Run middleware and route the request.
@@ -103,6 +195,24 @@ public:
      */
     bool dispatch(Request& req, Response& res) const;
 
+    /**
+     * @brief Route that dispatch() would pick for @p m and @p path, without
+     *        running anything; its params are stored in @p params if given.
+     * @return nullptr when no route matches.
+     */
+    const Route* match(Method m, std::string_view path, ParamMap* params = nullptr) const;
+
+    /**
+     * @brief Compile the registered routes into the lookup tree and their
+     *        middleware chains. Lookups call it when routes or middleware
+     *        changed; calling it up front keeps that work (and the race)
+     *        out of request handling.
+     */
+    void build() const;
+
+    /** @brief True when some route streams its request body (OnBody()). */
+    bool streams_bodies() const noexcept;
+
     /**
      * @brief Route group: shares a path prefix and its own middleware.
      *
@@ -138,8 +248,40 @@ public:
         Route& Any(std::string_view p, Handler h)    { return AddRoute(Method::ANY, p, std::move(h)); }
         /** @} */
 
+        /** @name Coroutine handlers (callables returning Task<void>)
+         *  @{ */
+        template <CoroutineHandler F> Route& AddRoute(Method m, std::string_view p, F h) { return AddRoute(m, p, co_handler(std::move(h))); }
+        template <CoroutineHandler F> Route& Get(std::string_view p, F h)    { return Get(p, co_handler(std::move(h))); }
+        template <CoroutineHandler F> Route& Post(std::string_view p, F h)   { return Post(p, co_handler(std::move(h))); }
+        template <CoroutineHandler F> Route& Put(std::string_view p, F h)    { return Put(p, co_handler(std::move(h))); }
+        template <CoroutineHandler F> Route& Patch(std::string_view p, F h)  { return Patch(p, co_handler(std::move(h))); }
+        template <CoroutineHandler F> Route& Delete(std::string_view p, F h) { return Delete(p, co_handler(std::move(h))); }
+        template <CoroutineHandler F> Route& Options(std::string_view p, F h){ return Options(p, co_handler(std::move(h))); }
+        template <CoroutineHandler F> Route& Head(std::string_view p, F h)   { return Head(p, co_handler(std::move(h))); }
+        template <CoroutineHandler F> Route& Any(std::string_view p, F h)    { return Any(p, co_handler(std::move(h))); }
+        /** @} */
+
+        /** @brief Router::route() under this group's prefix. */
+        template <fixed_string P, class F>
+        Route& route(Method m, F h) {
+            PathParts prefix_parts;
+            split_path_(prefix_, prefix_parts);
+            Route& r = AddRoute(m, P.view(),
+                                detail::typed_handler<P>(std::move(h), prefix_parts.size()));
+            r.typed_ = true;
+            return r;
+        }
+
+        /** @brief route() for Method::GET. */
+        template <fixed_string P, class F>
+        Route& route(F h) { return route<P>(Method::GET, std::move(h)); }
+
         /** @brief Middleware that runs for every route in this group. */
-        RouteGroup& Use(Middleware mw) { group_mw_.push_back(std::move(mw)); return *this; }
+        RouteGroup& Use(Middleware mw) {
+            group_mw_.push_back(std::move(mw));
+            router_.stale_ = true;
+            return *this;
+        }
 
         /** @brief The group's path prefix. */
         const std::string& prefix() const { return prefix_; }
@@ -165,15 +307,32 @@ public:
     static bool starts_with_public_(std::string_view s, std::string_view pfx);
 
 private:
+    friend class Route;
+    struct Node;
+    struct StaticIndex;
+    struct Walk;
+    /// Methods allowed on a path (bit per Method) for a 405, when no route
+    /// allows the request's.
+    struct Miss {
+        std::uint32_t allowed{0};
+        bool path_matched{false};
+    };
+
     std::deque<Route> routes_;
     std::vector<Middleware> global_mw_;
     std::deque<RouteGroup> groups_;
+    mutable std::unique_ptr<Node> tree_;
+    mutable std::unique_ptr<StaticIndex> static_index_; ///< null when unused
+    mutable bool stale_{true}; ///< routes changed since build()
+
+    /// Non-empty segments of a path (views into it).
+    using PathParts = std::pmr::vector<std::string_view>;
 
     static std::vector<Route::Seg> compile_pattern_(std::string_view pattern);
-    static bool match_and_bind_(std::string_view path,
-                                const std::vector<Route::Seg>& segs,
-                                ParamMap& params);
-    static std::vector<std::string_view> split_path_(std::string_view s);
+    const Route* find_(Method m, const PathParts& parts, Miss& miss) const;
+    static void bind_(const PathParts& parts, const std::vector<Route::Seg>& segs,
+                      ParamMap& params);
+    static void split_path_(std::string_view s, PathParts& out);
     static bool starts_with_(std::string_view s, std::string_view pfx);
 };
 
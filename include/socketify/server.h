@@ -18,9 +18,13 @@
  * @endcode
  *
  * Architecture: N worker threads (default = hardware cores), each running
- * its own epoll event loop with a SO_REUSEPORT listener, so the kernel
- * load-balances connections with no accept contention. Handlers run
- * synchronously on the loop that owns the connection.
+ * its own event loop (epoll, or io_uring via ServerOptions::io_backend)
+ * with a SO_REUSEPORT listener, so the kernel load-balances connections
+ * with no accept contention. Handlers run on the loop that owns the
+ * connection; slow ones should not hold it: defer() the response and
+ * finish it from another thread (deferred.h), write the handler as a
+ * coroutine (task.h), or mark the route Route::Blocking() to run its
+ * handler on the blocking_threads pool.
  */
 
 #include <atomic>
@@ -41,11 +45,30 @@
 #include "socketify/request.h"
 #include "socketify/response.h"
 #include "socketify/router.h"
+#include "socketify/task.h"
 #include "socketify/tls.h"
 
 namespace socketify {
 
-namespace detail { class Worker; }
+namespace detail {
+class Worker;
+class LazyThreadPool;
+class ThreadPool;
+} // namespace detail
+
+/** @brief Readiness backend used by the worker event loops. */
+enum class IoBackend : std::uint8_t {
+    Epoll,  ///< epoll(7) (default; always available).
+    IoUring ///< io_uring(7) multishot accept/recv and linked sends; falls back to epoll when unavailable.
+};
+
+/** @brief What an SSE/Pulse send does when the client is not keeping up. */
+enum class SlowConsumer : std::uint8_t {
+    Drop,  ///< Discard the event/frame; the send returns false.
+    Close, ///< Close the connection (default); the send returns false.
+    Block  ///< Block the sending thread until the backlog drains to the low mark
+           ///< (Close on a worker event-loop thread, which must not wait).
+};
 
 /** @brief Server configuration. All fields have sensible defaults. */
 struct ServerOptions {
@@ -64,10 +87,144 @@ struct ServerOptions {
     /** @brief Worker threads; 0 means hardware_concurrency(). */
     unsigned workers{0};
 
+    /**
+     * @brief Event-loop backend. IoUring batches interest changes and the
+     *        wait into one io_uring_enter(2) per loop iteration; on Linux
+     *        6.0+ the kernel also accepts connections and receives plain
+     *        (non-TLS) input into a per-worker buffer ring (multishot
+     *        accept/recv) and writes its responses as linked SENDMSG /
+     *        SPLICE submissions. Kernels older than 5.11 (or with io_uring
+     *        disabled) use epoll instead.
+     */
+    IoBackend io_backend{IoBackend::Epoll};
+
+    /**
+     * @brief Bytes read from one connection per readiness event. A
+     *        connection over budget is requeued behind the others and
+     *        resumed on the next loop iteration. 0 = read until EAGAIN.
+     */
+    std::size_t read_budget{256 * 1024};
+    /**
+     * @brief Pipelined requests handled per connection turn before it is
+     *        requeued the same way. 0 = no limit.
+     */
+    unsigned request_budget{64};
+    /**
+     * @brief Register sockets with EPOLLET (epoll backend only). Fewer
+     *        redundant wakeups for busy connections; the budgets above
+     *        decide when a connection yields.
+     */
+    bool edge_triggered{false};
+
+    /**
+     * @brief Unwritten response bytes per connection above which the worker
+     *        stops reading and parsing that connection's requests. For
+     *        SSE/Pulse it is the backlog at which stream_overflow applies;
+     *        chunked::Writer::write() blocks there. 0 = unlimited.
+     */
+    std::size_t output_high_water{1024 * 1024};
+    /** @brief Reading resumes (and blocked producers wake) at or below this. */
+    std::size_t output_low_water{256 * 1024};
+    /**
+     * @brief Policy for SSE/Pulse sends past output_high_water. Block never
+     *        waits on the worker thread that owns the connection.
+     */
+    SlowConsumer stream_overflow{SlowConsumer::Close};
+
+    /**
+     * @brief Threads running Route::Blocking() handlers and offload()
+     *        calls, shared by all workers. With 0, Blocking() handlers run
+     *        inline on the worker loop, and offload() (so also
+     *        http_client::async_*) uses a pool of max(4, cores) threads
+     *        started on its first call.
+     */
+    unsigned blocking_threads{0};
+    /** @brief Blocking jobs allowed to wait for a thread; beyond that 503. */
+    std::size_t blocking_queue{1024};
+
+    /**
+     * @brief Pin each worker thread to one CPU (Linux). CPUs come from
+     *        worker_cpus, or the process affinity mask in order.
+     */
+    bool pin_workers{false};
+    /** @brief Explicit worker CPUs, reused round-robin when shorter. */
+    std::vector<int> worker_cpus{};
+    /**
+     * @brief Allocate worker state on the worker's NUMA node: each worker
+     *        thread switches to MPOL_LOCAL (after pinning) and only then
+     *        builds its event loop, io_uring rings, timers, counters and
+     *        connection pool. Memory shared by all workers (router,
+     *        blocking pool, TLS context) stays where Run() allocated it.
+     *        Most useful together with pin_workers.
+     */
+    bool numa_local{false};
+    /**
+     * @brief Attach an SO_ATTACH_REUSEPORT_CBPF program so a new connection
+     *        goes to the worker pinned to the CPU that received its packets
+     *        (pair with RSS/RPS so a flow stays on one CPU). Implies
+     *        pin_workers; falls back to kernel hashing when unsupported
+     *        (see Server::cpu_steering()).
+     */
+    bool reuseport_cpu_steering{false};
+    /**
+     * @brief Sample SO_INCOMING_CPU on reads and count wakeups where the
+     *        packet was processed on another CPU (ServerStats). Costs one
+     *        getsockopt per readable event.
+     */
+    bool track_cpu_locality{false};
+
     /** @brief Reject header sections larger than this (431). */
     std::size_t max_header_size{16 * 1024};
     /** @brief Reject bodies larger than this (413). */
     std::size_t max_body_size{16 * 1024 * 1024};
+    /** @brief Body cap for routes with Route::OnBody() (0 = unlimited). */
+    std::size_t max_stream_body_size{0};
+    /**
+     * @brief Keep buffered request bodies larger than this in an unnamed
+     *        temp file instead of memory (Request::body_file()); 0 = off.
+     */
+    std::size_t body_spool_threshold{0};
+    /** @brief Directory for spooled bodies (must allow O_TMPFILE or mkstemp). */
+    std::string body_spool_dir{"/tmp"};
+    /**
+     * @brief Build each Request from views into the connection's receive
+     *        buffer (path, target, version, headers, Content-Length body)
+     *        instead of copies; the bytes stay pinned until the response
+     *        is serialized. false copies everything out, as before.
+     */
+    bool zero_copy_requests{true};
+    /**
+     * @brief Bytes of per-worker arena for request-scoped allocations
+     *        (router scratch, response headers, Set-Cookie list, request
+     *        locals), rewound after every response. A request that needs
+     *        more spills to the heap; 0 puts everything on the heap.
+     */
+    std::size_t request_arena_size{16 * 1024};
+
+    /**
+     * @brief Serve HTTP/2 next to HTTP/1.1: over TLS when the client picks
+     *        "h2" through ALPN, in cleartext when a connection opens with
+     *        the HTTP/2 preface (prior knowledge). Streams are multiplexed
+     *        on the connection's worker like pipelined requests.
+     */
+    bool http2{false};
+    /**
+     * @brief Concurrent streams per HTTP/2 connection; more are refused.
+     *        A request the client cancels keeps its slot until its
+     *        (deferred, coroutine or Blocking()) handler answers.
+     */
+    std::uint32_t http2_max_streams{100};
+    /**
+     * @brief RST_STREAM frames a client may send per second before the
+     *        connection is closed with GOAWAY(ENHANCE_YOUR_CALM). 0 = no limit.
+     */
+    std::uint32_t http2_max_resets{200};
+    /**
+     * @brief HTTP/2 receive window per stream. The connection window is
+     *        the larger of this and max_body_size, which also caps the body
+     *        bytes one connection buffers across its streams.
+     */
+    std::uint32_t http2_window{1024 * 1024};
 
     /** @brief Response compression settings. */
     compression::Options compression{};
@@ -76,6 +233,18 @@ struct ServerOptions {
     std::optional<TlsOptions> tls{};
 };
 
+/** @brief Counters summed over all workers (relaxed; approximate while running). */
+struct ServerStats {
+    std::uint64_t accepted{0};          ///< Connections accepted.
+    std::uint64_t requests{0};          ///< Requests dispatched to the router.
+    std::uint64_t wakeups{0};           ///< Readable events sampled (track_cpu_locality).
+    std::uint64_t cross_cpu_wakeups{0}; ///< ...whose packets arrived on another CPU.
+    std::uint64_t read_pauses{0};       ///< Reads paused at output_high_water.
+    std::uint64_t stream_drops{0};      ///< SSE/Pulse sends dropped (SlowConsumer::Drop).
+    std::uint64_t stream_closes{0};     ///< Streams closed (SlowConsumer::Close).
+    std::uint64_t stream_blocks{0};     ///< Sends that blocked (SlowConsumer::Block, chunked).
+};
+
 /**
  * @brief The HTTP/HTTPS server.
  *
@@ -110,6 +279,28 @@ public:
     Route& Any(std::string_view p, Handler h)    { return AddRoute(Method::ANY, p, std::move(h)); }
     /** @} */
 
+    /** @name Coroutine handlers (callables returning Task<void>, see task.h)
+     *  @{ */
+    template <CoroutineHandler F> Route& AddRoute(Method m, std::string_view p, F h) { return AddRoute(m, p, co_handler(std::move(h))); }
+    template <CoroutineHandler F> Route& Get(std::string_view p, F h)    { return Get(p, co_handler(std::move(h))); }
+    template <CoroutineHandler F> Route& Post(std::string_view p, F h)   { return Post(p, co_handler(std::move(h))); }
+    template <CoroutineHandler F> Route& Put(std::string_view p, F h)    { return Put(p, co_handler(std::move(h))); }
+    template <CoroutineHandler F> Route& Patch(std::string_view p, F h)  { return Patch(p, co_handler(std::move(h))); }
+    template <CoroutineHandler F> Route& Delete(std::string_view p, F h) { return Delete(p, co_handler(std::move(h))); }
+    template <CoroutineHandler F> Route& Options(std::string_view p, F h){ return Options(p, co_handler(std::move(h))); }
+    template <CoroutineHandler F> Route& Head(std::string_view p, F h)   { return Head(p, co_handler(std::move(h))); }
+    template <CoroutineHandler F> Route& Any(std::string_view p, F h)    { return Any(p, co_handler(std::move(h))); }
+    /** @} */
+
+    /**
+     * @brief Register a route whose pattern is parsed at compile time and
+     *        whose handler takes typed parameters (see typed_route.h):
+     *        `server.route<"/users/:id">([](Request&, Response&, std::int64_t id) {...})`.
+     */
+    template <fixed_string P, class F> Route& route(Method m, F h) { return router_.route<P>(m, std::move(h)); }
+    /** @brief route() for Method::GET. */
+    template <fixed_string P, class F> Route& route(F h) { return router_.route<P>(std::move(h)); }
+
     /**
      * @brief Create a route group under @p prefix.
      * @return Stable reference (owned by the server's router).
@@ -146,6 +337,18 @@ public:
     /** @brief Actual bound port (useful when Run() was given port 0). */
     uint16_t port() const noexcept { return port_; }
 
+    /** @brief Backend the workers actually use (meaningful after Run()). */
+    IoBackend io_backend() const noexcept { return io_backend_; }
+
+    /** @brief True when reuseport CPU steering is active (after Run()). */
+    bool cpu_steering() const noexcept { return cpu_steering_; }
+
+    /** @brief Snapshot of the per-worker counters. */
+    ServerStats stats() const;
+
+    /** @brief The same counters for each worker, in worker order. */
+    std::vector<ServerStats> worker_stats() const;
+
     /** @brief Diagnostic message from the last failed Run(). */
     const std::string& last_error() const noexcept { return last_error_; }
 
@@ -160,6 +363,8 @@ private:
 
     std::atomic<bool> running_{false};
     uint16_t port_{0};
+    IoBackend io_backend_{IoBackend::Epoll};
+    bool cpu_steering_{false};
     std::string last_error_;
 
     std::vector<std::unique_ptr<detail::Worker>> workers_;
@@ -168,6 +373,12 @@ private:
 
     tls::TlsContext tls_ctx_;
     bool tls_enabled_{false};
+
+    /// Route::Blocking() pool (null when blocking_threads == 0). Declared
+    /// after router_ so it is joined before the handlers it runs go away.
+    std::unique_ptr<detail::ThreadPool> blocking_pool_;
+    /// Coroutine offload() pool when blocking_threads == 0 (started lazily).
+    std::unique_ptr<detail::LazyThreadPool> offload_pool_;
 };
 
 } // namespace socketify
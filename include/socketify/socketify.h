@@ -13,6 +13,7 @@
 #include "socketify/cookies.h"
 #include "socketify/cors.h"
 #include "socketify/http.h"
+#include "socketify/headers.h"
 #include "socketify/version.h"
 #include "socketify/logging.h"
 #include "socketify/middleware.h"
@@ -20,9 +21,14 @@
 #include "socketify/request.h"
 #include "socketify/response.h"
 #include "socketify/router.h"
+#include "socketify/typed_route.h"
 #include "socketify/server.h"
 #include "socketify/sessions.h"
 #include "socketify/sse.h"
+#include "socketify/chunked.h"
+#include "socketify/body_stream.h"
+#include "socketify/deferred.h"
+#include "socketify/task.h"
 #include "socketify/pulse.h"
 #include "socketify/pulse_easy.h"
 #include "socketify/pulse_media.h"
@@ -33,7 +33,9 @@ namespace socketify::sse {
  *
  * Copies share the same underlying connection. All methods are safe to
  * call from any thread; sends after the client disconnected are dropped
- * and return false.
+ * and return false. A client that stops reading is handled by
+ * ServerOptions::stream_overflow once its backlog passes
+ * output_high_water (drop, close, or block the sender).
  */
 class Session {
 public:
@@ -45,7 +47,8 @@ public:
 
     /**
      * @brief Send a data-only event ("data: ...\\n\\n").
-     * @return false when the connection is closed.
+     * @return false when the connection is closed or the event was refused
+     *         by the slow-consumer policy.
      */
     bool send(std::string_view data);
 
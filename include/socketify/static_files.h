@@ -7,6 +7,19 @@
  * and support ETag/Last-Modified conditional requests plus single Range
  * requests.
  *
+ * Each worker thread keeps a bounded cache per serve() instance, keyed by
+ * URL sub-path: the resolved path, the open descriptor (streamed from
+ * directly, never reopened) and the ready ETag/Last-Modified/Content-Type.
+ * An entry is trusted for Options::cache_ttl, then resolved again, so a
+ * replaced or deleted file is noticed within that time. The descriptors
+ * cached by all workers and mounts stay within a quarter of
+ * RLIMIT_NOFILE.
+ *
+ * Kind::File responses bypass the server's on-the-fly compression; set
+ * Options::precompressed to serve "app.js.br"/"app.js.gz" siblings, and
+ * Options::compress to have compressible files gzipped once, in the
+ * background, for later requests.
+ *
  * @code
  * server.Use(static_files::serve("public", {.mount = "/assets",
  *                                           .cache_max_age = 3600}));
@@ -18,6 +31,8 @@
 #include "socketify/request.h"
 #include "socketify/response.h"
 
+#include <chrono>
+#include <cstddef>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -55,6 +70,32 @@ struct Options {
     int  cache_max_age{0};     // seconds; 0 => no Cache-Control emitted
     bool immutable{false};     // add ", immutable" to Cache-Control
 
+    // Per-worker file cache: entries per worker thread (each holds an open
+    // descriptor, plus one per precompressed sibling); 0 disables it and
+    // every request resolves the path. All caches of the process together
+    // hold at most a quarter of RLIMIT_NOFILE; past that files are served
+    // uncached.
+    std::size_t cache_entries{256};
+    // How long a cached entry is served before it is resolved again.
+    std::chrono::milliseconds cache_ttl{1000};
+
+    // Precompressed siblings: answer "app.js" with "app.js.br" or
+    // "app.js.gz" from the same directory when the client accepts that
+    // encoding (br first on equal q), with Content-Encoding, Vary and an
+    // ETag of its own.
+    bool precompressed{false};
+
+    // Gzip files of a compressible type (compression::Options defaults) in
+    // the background, for gzip clients without a precompressed sibling.
+    // Copies live in unnamed files under compress_dir, at most
+    // compress_cache_bytes in all (least recently used dropped first), and
+    // are sent with sendfile like any file; until a copy is ready the file
+    // goes out uncompressed.
+    bool compress{false};
+    std::size_t compress_min_size{1024};
+    std::size_t compress_cache_bytes{64 * 1024 * 1024};
+    std::string compress_dir{"/tmp"};
+
     // Content-Type detection is built-in (by file extension).
 };
 
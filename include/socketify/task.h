@@ -0,0 +1,404 @@
+#pragma once
+/**
+ * @file task.h
+ * @brief C++20 coroutine handlers: Task<T>, offload(), sleep_for(), when_all().
+ *
+ * A handler may be a coroutine returning Task<void>. It starts on the
+ * worker loop that owns the connection, and every co_await below resumes
+ * it on that same loop, so handler code never needs locks:
+ *
+ * @code
+ * server.Get("/dashboard/:id", [&db](Request& req, Response& res) -> Task<void> {
+ *     std::string id = req.params().at("id");
+ *     // Both run concurrently: the query on the blocking pool, the call
+ *     // through the outbound client (see http_client::async_get()).
+ *     auto [user, weather] = co_await when_all(
+ *         offload([&db, id] { return db.find_user(id); }),
+ *         http_client::async_get("http://weather.internal/now"));
+ *     co_await sleep_for(std::chrono::milliseconds(5)); // timer, loop stays free
+ *     res.json({{"user", user}, {"weather", weather.body}});
+ * });
+ * @endcode
+ *
+ * offload() runs its function on the ServerOptions::blocking_threads pool
+ * (or, when that is 0, on a pool the server starts on the first offload),
+ * never on the worker loop; outside a worker it runs on the calling thread.
+ * A handler that never suspends is answered like a plain one;
+ * otherwise its response is sent through a Deferred (see deferred.h).
+ *
+ * The coroutine gets its own copy of the Request, so its references stay
+ * valid across suspensions. Custom awaitables must resume the handler on
+ * its loop, as the ones here do.
+ */
+
+#include "socketify/deferred.h"
+#include "socketify/middleware.h"
+#include "socketify/request.h"
+#include "socketify/response.h"
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace socketify {
+
+template <class T = void>
+class Task;
+
+namespace detail {
+
+/// Result slot type: void results are stored as std::monostate.
+template <class T>
+using task_result_t = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation{};
+    std::exception_ptr error{};
+
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template <class P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) const noexcept {
+            auto next = h.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+template <class T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object() noexcept;
+    template <class U>
+    void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+    T take() {
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+    void take() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief Lazily started coroutine producing a T.
+ *
+ * Starts when awaited and resumes the awaiting coroutine when it finishes
+ * (symmetric transfer, so long chains do not grow the stack). Exceptions
+ * propagate to the awaiter. Move-only; destroying an unstarted Task
+ * discards it.
+ */
+template <class T>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    /** @brief Internal: adopt a coroutine frame. */
+    explicit Task(handle_type h) noexcept : h_(h) {}
+    Task(Task&& other) noexcept : h_(std::exchange(other.h_, {})) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (h_) h_.destroy();
+            h_ = std::exchange(other.h_, {});
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (h_) h_.destroy();
+    }
+
+    /** @brief True when bound to a coroutine. */
+    bool valid() const noexcept { return static_cast<bool>(h_); }
+    /** @brief True once the coroutine ran to completion. */
+    bool done() const noexcept { return h_ && h_.done(); }
+
+    /** @brief Start (or join) the task; yields its result. */
+    auto operator co_await() noexcept {
+        struct Awaiter {
+            handle_type h;
+            bool await_ready() const noexcept { return h.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                h.promise().continuation = awaiting;
+                return h;
+            }
+            T await_resume() { return h.promise().take(); }
+        };
+        return Awaiter{h_};
+    }
+
+private:
+    handle_type h_{};
+};
+
+namespace detail {
+
+template <class T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+/// Fire-and-forget coroutine: runs eagerly and frees itself at the end.
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        [[noreturn]] void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+/// Join counter for when_all(): one count per child plus one for the
+/// waiter, so children finishing before the waiter suspends never resume it.
+struct WhenAllLatch {
+    std::size_t count;
+    std::coroutine_handle<> waiter{};
+
+    void arrive() {
+        if (--count == 0) waiter.resume();
+    }
+
+    struct Awaiter {
+        WhenAllLatch& latch;
+        bool await_ready() const noexcept { return latch.count == 1; }
+        bool await_suspend(std::coroutine_handle<> h) noexcept {
+            latch.waiter = h;
+            return --latch.count != 0;
+        }
+        void await_resume() const noexcept {}
+    };
+};
+
+template <class T>
+Detached join_one(Task<T> task, std::optional<task_result_t<T>>& out,
+                  std::exception_ptr& error, WhenAllLatch& latch) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+            out.emplace();
+        } else {
+            out.emplace(co_await task);
+        }
+    } catch (...) {
+        if (!error) error = std::current_exception();
+    }
+    latch.arrive();
+}
+
+template <class Tasks, class Results, std::size_t... I>
+void join_all(Tasks& tasks, Results& results, std::exception_ptr& error, WhenAllLatch& latch,
+              std::index_sequence<I...>) {
+    (join_one(std::move(std::get<I>(tasks)), std::get<I>(results), error, latch), ...);
+}
+
+class EventLoop;
+class ThreadPool;
+class LazyThreadPool;
+
+/**
+ * @brief Internal: bind the calling thread to a worker loop and pool;
+ *        offload() uses @p fallback when @p pool is null.
+ */
+void set_coroutine_executor(EventLoop* loop, ThreadPool* pool,
+                            LazyThreadPool* fallback = nullptr) noexcept;
+
+/**
+ * @brief Internal: resume @p h on this thread's worker loop after @p delay.
+ * @return false when the thread is not a worker (caller must not suspend).
+ */
+bool resume_after(std::chrono::milliseconds delay, std::coroutine_handle<> h);
+
+/**
+ * @brief Internal: run @p work on the blocking pool, then resume @p h on
+ *        this thread's worker loop.
+ * @return false outside a worker (caller runs @p work inline).
+ * @throws std::runtime_error when the pool queue is full.
+ */
+bool offload_resume(std::function<void()> work, std::coroutine_handle<> h);
+
+/// Per-request state shared by a coroutine handler and the worker.
+struct CoRequest {
+    Request req;
+    Response res;
+    Deferred deferred;        ///< Set when the handler suspended.
+    std::exception_ptr error;
+    bool done{false};
+};
+
+/** @brief Internal: run @p task for @p ctx, answering through @p res. */
+void start_co_request(const std::shared_ptr<CoRequest>& ctx, Task<void> task, Response& res);
+
+/// Awaitable returned by socketify::offload().
+template <class F>
+class OffloadAwaiter {
+    using R = std::invoke_result_t<F&>;
+
+public:
+    explicit OffloadAwaiter(F fn) : fn_(std::move(fn)) {}
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> h) {
+        if (offload_resume([this] { run_(); }, h)) return true;
+        run_();
+        return false;
+    }
+    R await_resume() {
+        if (error_) std::rethrow_exception(error_);
+        if constexpr (!std::is_void_v<R>) return std::move(*value_);
+    }
+
+private:
+    void run_() noexcept {
+        try {
+            if constexpr (std::is_void_v<R>) {
+                fn_();
+                value_.emplace();
+            } else {
+                value_.emplace(fn_());
+            }
+        } catch (...) {
+            error_ = std::current_exception();
+        }
+    }
+
+    F fn_;
+    std::optional<task_result_t<R>> value_;
+    std::exception_ptr error_;
+};
+
+/// Awaitable returned by socketify::sleep_for().
+class SleepAwaiter {
+public:
+    explicit SleepAwaiter(std::chrono::milliseconds d) noexcept : d_(d) {}
+
+    bool await_ready() const noexcept { return d_.count() <= 0; }
+    bool await_suspend(std::coroutine_handle<> h) {
+        if (resume_after(d_, h)) return true;
+        std::this_thread::sleep_for(d_);
+        return false;
+    }
+    void await_resume() const noexcept {}
+
+private:
+    std::chrono::milliseconds d_;
+};
+
+} // namespace detail
+
+/**
+ * @brief Run @p fn (a blocking call: database, disk, CPU work) on the
+ *        blocking pool and resume with its result on the worker loop.
+ *
+ * The pool is ServerOptions::blocking_threads, or with 0 there a default
+ * one the server starts on first use; the worker loop never runs @p fn.
+ * Outside a worker @p fn runs inline. Like any Task, the call starts when
+ * awaited, so offload() calls can be combined with when_all(). Throws
+ * std::runtime_error when the pool queue is full; exceptions from @p fn
+ * are rethrown at the co_await.
+ */
+template <class F>
+Task<std::invoke_result_t<F&>> offload(F fn) {
+    // By value: the task is lazy, so fn must live in its frame.
+    co_return co_await detail::OffloadAwaiter<F>(std::move(fn));
+}
+
+/**
+ * @brief Suspend for @p d on the worker loop's timer wheel (1 ms
+ *        resolution). Outside a worker the thread sleeps instead.
+ */
+template <class Rep, class Period>
+detail::SleepAwaiter sleep_for(std::chrono::duration<Rep, Period> d) {
+    return detail::SleepAwaiter(std::chrono::ceil<std::chrono::milliseconds>(d));
+}
+
+/**
+ * @brief Await several tasks concurrently.
+ * @return Their results in argument order (std::monostate for void).
+ *         The first exception is rethrown after all tasks finished.
+ */
+template <class... Ts>
+Task<std::tuple<detail::task_result_t<Ts>...>> when_all(Task<Ts>... tasks) {
+    std::tuple<Task<Ts>...> held(std::move(tasks)...);
+    std::tuple<std::optional<detail::task_result_t<Ts>>...> results;
+    std::exception_ptr error;
+    detail::WhenAllLatch latch{sizeof...(Ts) + 1};
+    detail::join_all(held, results, error, latch, std::index_sequence_for<Ts...>{});
+    co_await detail::WhenAllLatch::Awaiter{latch};
+    if (error) std::rethrow_exception(error);
+    co_return std::apply(
+        [](auto&... r) { return std::tuple<detail::task_result_t<Ts>...>(std::move(*r)...); },
+        results);
+}
+
+/** @brief when_all() over a runtime-sized list of tasks. */
+template <class T>
+Task<std::vector<detail::task_result_t<T>>> when_all(std::vector<Task<T>> tasks) {
+    std::vector<std::optional<detail::task_result_t<T>>> results(tasks.size());
+    std::exception_ptr error;
+    detail::WhenAllLatch latch{tasks.size() + 1};
+    for (std::size_t i = 0; i < tasks.size(); ++i) {
+        detail::join_one(std::move(tasks[i]), results[i], error, latch);
+    }
+    co_await detail::WhenAllLatch::Awaiter{latch};
+    if (error) std::rethrow_exception(error);
+    std::vector<detail::task_result_t<T>> out;
+    out.reserve(results.size());
+    for (auto& r : results) out.push_back(std::move(*r));
+    co_return out;
+}
+
+/** @brief A callable usable as a coroutine route handler. */
+template <class F>
+concept CoroutineHandler =
+    std::is_same_v<std::invoke_result_t<F&, Request&, Response&>, Task<void>>;
+
+/**
+ * @brief Wrap a coroutine handler as a plain Handler.
+ *
+ * Server::Get() and friends do this automatically for lambdas returning
+ * Task<void>.
+ */
+template <CoroutineHandler F>
+Handler co_handler(F fn) {
+    return [fn = std::move(fn)](Request& req, Response& res) mutable {
+        auto ctx = std::make_shared<detail::CoRequest>();
+        ctx->req = req;
+        ctx->res = std::move(res);
+        res = Response{};
+        detail::start_co_request(ctx, fn(ctx->req, ctx->res), res);
+    };
+}
+
+} // namespace socketify
@@ -20,6 +20,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <vector>
 
 typedef struct ssl_ctx_st SSL_CTX;
 typedef struct ssl_st SSL;
@@ -79,12 +80,22 @@ public:
      */
     SSL* new_session(int fd) const;
 
+    /**
+     * @brief Offer @p protocols through ALPN (RFC 7301), most preferred
+     *        first, e.g. {"h2", "http/1.1"}. The first of ours the client
+     *        also lists wins; with no overlap the handshake proceeds
+     *        without ALPN (see detail::Socket::alpn()). Call after init().
+     * @return false when a name is empty or longer than 255 bytes.
+     */
+    bool set_alpn(const std::vector<std::string>& protocols);
+
     /** @brief Description of the most recent failure. */
     const std::string& last_error() const noexcept { return last_error_; }
 
 private:
     SSL_CTX* ctx_{nullptr};
     std::string last_error_;
+    std::string alpn_; ///< wire format: length-prefixed names
 };
 
 } // namespace tls
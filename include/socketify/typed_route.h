@@ -0,0 +1,245 @@
+#pragma once
+/**
+ * @file typed_route.h
+ * @brief Compile-time route patterns with typed handler parameters.
+ *
+ * A pattern given as a template argument is parsed when the program is
+ * compiled; the handler takes its parameters as extra arguments, in
+ * pattern order, converted from the path without going through
+ * Request::params():
+ *
+ * @code
+ * server.route<"/users/:id/posts/:slug">(
+ *     [](Request&, Response& res, std::int64_t id, std::string_view slug) {
+ *         res.send(std::to_string(id) + " " + std::string(slug));
+ *     });
+ * @endcode
+ *
+ * Parameters may be integers, floating-point numbers, std::string or
+ * std::string_view (a view into Request::path(), valid during the
+ * handler); a wildcard takes a string and receives the rest of the path
+ * as sent. A segment that does not convert (a non-number for an integer,
+ * an out-of-range value) answers 400 without calling the handler.
+ * Mismatched arity or unsupported types are compile errors, as are
+ * malformed patterns.
+ */
+
+#include "socketify/middleware.h"
+#include "socketify/request.h"
+#include "socketify/response.h"
+#include "socketify/task.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace socketify {
+
+/**
+ * @brief A string literal usable as a template argument:
+ *        `route<"/users/:id">(...)`.
+ */
+template <std::size_t N>
+struct fixed_string {
+    char data[N]{};
+
+    constexpr fixed_string(const char (&s)[N]) noexcept { std::copy_n(s, N, data); }
+
+    constexpr std::string_view view() const noexcept { return {data, N - 1}; }
+    constexpr operator std::string_view() const noexcept { return view(); }
+};
+
+namespace detail {
+
+/// One parameter of a compile-time pattern.
+struct PatternParam {
+    std::size_t segment{0}; ///< index among the path's non-empty segments
+    std::string_view name;
+    bool wildcard{false};
+};
+
+/// Parameters of a pattern, at most @p N of them.
+template <std::size_t N>
+struct PatternScan {
+    std::array<PatternParam, N> params{};
+    std::size_t size{0};
+};
+
+/// Parse pattern @p p (of length below @p N). Malformed patterns throw,
+/// which makes the constant evaluation (and so the compile) fail.
+template <std::size_t N>
+consteval PatternScan<N> scan_pattern(std::string_view p) {
+    if (p.empty() || p.front() != '/') throw "route pattern must start with '/'";
+    PatternScan<N> out;
+    std::size_t segment = 0, start = 0;
+    bool after_wildcard = false;
+    while (start < p.size()) {
+        std::size_t pos = p.find('/', start);
+        if (pos == std::string_view::npos) pos = p.size();
+        if (pos > start) {
+            if (after_wildcard) throw "a wildcard must be the last segment";
+            const std::string_view seg = p.substr(start, pos - start);
+            if (seg.front() == ':' || seg.front() == '*') {
+                if (seg.size() == 1) throw "route parameter needs a name";
+                const std::string_view name = seg.substr(1);
+                for (std::size_t k = 0; k < out.size; ++k)
+                    if (out.params[k].name == name) throw "duplicate route parameter name";
+                out.params[out.size++] = {segment, name, seg.front() == '*'};
+                after_wildcard = seg.front() == '*';
+            }
+            ++segment;
+        }
+        start = pos + 1;
+    }
+    return out;
+}
+
+/// The parsed form of pattern @p P.
+template <fixed_string P>
+struct RoutePattern {
+private:
+    static constexpr auto scan = scan_pattern<sizeof(P.data)>(P.view());
+
+public:
+    static constexpr std::size_t size = scan.size;
+    static constexpr std::array<PatternParam, size> params = [] {
+        std::array<PatternParam, size> a{};
+        for (std::size_t k = 0; k < size; ++k) a[k] = scan.params[k];
+        return a;
+    }();
+};
+
+/// Argument list of a handler's call operator.
+template <class T>
+struct callable_traits : callable_traits<decltype(&T::operator())> {};
+template <class R, class... A>
+struct callable_traits<R (*)(A...)> {
+    using result = R;
+    using args = std::tuple<A...>;
+};
+template <class R, class... A>
+struct callable_traits<R (*)(A...) noexcept> : callable_traits<R (*)(A...)> {};
+template <class C, class R, class... A>
+struct callable_traits<R (C::*)(A...)> : callable_traits<R (*)(A...)> {};
+template <class C, class R, class... A>
+struct callable_traits<R (C::*)(A...) const> : callable_traits<R (*)(A...)> {};
+template <class C, class R, class... A>
+struct callable_traits<R (C::*)(A...) noexcept> : callable_traits<R (*)(A...)> {};
+template <class C, class R, class... A>
+struct callable_traits<R (C::*)(A...) const noexcept> : callable_traits<R (*)(A...)> {};
+
+template <class T>
+inline constexpr bool is_path_string_v =
+    std::is_same_v<T, std::string_view> || std::is_same_v<T, std::string>;
+
+template <class T>
+inline constexpr bool is_path_number_v =
+    (std::is_integral_v<T> && !std::is_same_v<T, bool>) || std::is_floating_point_v<T>;
+
+/// Convert one path segment; false when it is not a whole @p T.
+template <class T>
+bool parse_path_param(std::string_view s, T& out) {
+    if constexpr (is_path_string_v<T>) {
+        out = T(s);
+        return true;
+    } else {
+        static_assert(is_path_number_v<T>,
+                      "typed route parameters must be integers, floating-point, "
+                      "std::string or std::string_view");
+        const char* end = s.data() + s.size();
+        const auto [ptr, ec] = std::from_chars(s.data(), end, out);
+        return !s.empty() && ec == std::errc() && ptr == end;
+    }
+}
+
+/// Views of @p path's parameter segments for pattern @p P, once past the
+/// first @p offset segments (a group prefix). A wildcard gets the rest of
+/// the path without its trailing '/'.
+template <fixed_string P>
+std::array<std::string_view, RoutePattern<P>::size> path_params(std::string_view path,
+                                                               std::size_t offset) {
+    constexpr auto& params = RoutePattern<P>::params;
+    std::array<std::string_view, params.size()> views{};
+    std::size_t k = 0, segment = 0, start = 0;
+    while (k < params.size() && start < path.size()) {
+        std::size_t pos = path.find('/', start);
+        if (pos == std::string_view::npos) pos = path.size();
+        if (pos > start) {
+            if (segment == offset + params[k].segment) {
+                if (params[k].wildcard) {
+                    std::string_view rest = path.substr(start);
+                    while (!rest.empty() && rest.back() == '/') rest.remove_suffix(1);
+                    views[k++] = rest;
+                    break;
+                }
+                views[k++] = path.substr(start, pos - start);
+            }
+            ++segment;
+        }
+        start = pos + 1;
+    }
+    return views;
+}
+
+inline void reject_path_param(Response& res) {
+    res.status(Status::BadRequest).send("Bad Request\n");
+}
+
+inline Task<void> finished_task() { co_return; }
+
+/// Calls `f(req, res, converted...)`, or rejects; returns what f returns.
+template <fixed_string P, class F, class Args, std::size_t... I>
+auto invoke_typed(F& f, Request& req, Response& res, std::size_t offset,
+                  std::index_sequence<I...>) {
+    using Result = typename callable_traits<F>::result;
+    const auto views = path_params<P>(req.path(), offset);
+    std::tuple<std::decay_t<std::tuple_element_t<I + 2, Args>>...> values;
+    if (!(parse_path_param(views[I], std::get<I>(values)) && ...)) {
+        reject_path_param(res);
+        if constexpr (std::is_same_v<Result, Task<void>>) return finished_task();
+        else return;
+    }
+    return f(req, res, std::move(std::get<I>(values))...);
+}
+
+/**
+ * @brief The Handler that runs typed handler @p f for pattern @p P under
+ *        @p offset prefix segments; coroutine handlers go through
+ *        co_handler().
+ */
+template <fixed_string P, class F>
+Handler typed_handler(F f, std::size_t offset) {
+    using Traits = callable_traits<F>;
+    using Args = typename Traits::args;
+    using Result = typename Traits::result;
+    constexpr std::size_t n = RoutePattern<P>::size;
+    static_assert(std::tuple_size_v<Args> == n + 2,
+                  "a typed handler takes (Request&, Response&) and one argument per "
+                  "route parameter");
+    static_assert(std::is_same_v<std::tuple_element_t<0, Args>, Request&> &&
+                      std::is_same_v<std::tuple_element_t<1, Args>, Response&>,
+                  "a typed handler starts with (Request&, Response&)");
+    static_assert(std::is_void_v<Result> || std::is_same_v<Result, Task<void>>,
+                  "a typed handler returns void or Task<void>");
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+        static_assert(((!RoutePattern<P>::params[I].wildcard ||
+                        is_path_string_v<std::decay_t<std::tuple_element_t<I + 2, Args>>>) && ...),
+                      "a wildcard parameter is std::string or std::string_view");
+    }(std::make_index_sequence<n>{});
+
+    auto call = [f = std::move(f), offset](Request& req, Response& res) mutable -> Result {
+        return invoke_typed<P, F, Args>(f, req, res, offset, std::make_index_sequence<n>{});
+    };
+    if constexpr (std::is_same_v<Result, Task<void>>) return co_handler(std::move(call));
+    else return call;
+}
+
+} // namespace detail
+
+} // namespace socketify
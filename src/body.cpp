@@ -1,11 +1,24 @@
 /**
  * @file body.cpp
- * @brief JSON / urlencoded / multipart body parsers.
+ * @brief JSON / urlencoded / multipart body parsers, including the push
+ *        multipart parser and its save-to-disk callbacks.
  */
 
 #include "socketify/body.h"
+#include "socketify/detail/file_io.h"
+#include "socketify/detail/http_scan.h"
 #include "socketify/detail/utils.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace socketify::body {
 
 bool is_json(const Request& req) {
@@ -85,73 +98,288 @@ std::string disposition_param_(std::string_view value, std::string_view param) {
     return {};
 }
 
+bool write_all_(int fd, const char* p, std::size_t n) {
+    while (n > 0) {
+        const ssize_t w = ::write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += w;
+        n -= static_cast<std::size_t>(w);
+    }
+    return true;
+}
+
 } // namespace
 
-std::optional<MultipartData> multipart(const Request& req) {
-    if (!is_multipart(req)) return std::nullopt;
+// ---- MultipartParser ----
 
-    std::string boundary = extract_boundary_(req.content_type());
-    if (boundary.empty()) return std::nullopt;
+MultipartParser::MultipartParser(std::string_view boundary, Callbacks cb,
+                                 std::size_t max_header_bytes)
+    : cb_(std::move(cb)), max_header_bytes_(max_header_bytes) {
+    // A boundary without CR/LF means a delimiter can only start at the CR
+    // of its leading CRLF, which is what lets scan_data_() hold back at
+    // most one partial delimiter.
+    if (boundary.empty() || boundary.size() > 70 ||
+        boundary.find_first_of("\r\n") != std::string_view::npos) {
+        fail_("Invalid multipart boundary");
+        return;
+    }
+    delim_.reserve(4 + boundary.size());
+    delim_.append("\r\n--").append(boundary);
+    carry_ = "\r\n"; // the first delimiter may open the body without a CRLF
+}
 
-    std::string_view bodyv = req.body_view();
-    const std::string delim = "--" + boundary;
+void MultipartParser::fail_(std::string msg) {
+    state_ = State::Error;
+    error_ = std::move(msg);
+}
 
-    // The body starts with the first delimiter (possibly after a CRLF).
-    std::size_t pos = bodyv.find(delim);
-    if (pos == std::string_view::npos) return std::nullopt;
-    pos += delim.size();
+bool MultipartParser::emit_(std::string_view data) {
+    if (data.empty() || state_ != State::Data || !cb_.on_part_data) return true;
+    if (cb_.on_part_data(part_, data)) return true;
+    fail_("Stopped by the part callback");
+    return false;
+}
 
-    MultipartData out;
+// Preamble or part data up to the next delimiter; returns the bytes used.
+std::size_t MultipartParser::scan_data_(std::string_view in) {
+    const std::size_t n = delim_.size();
+    auto at_delimiter = [this] {
+        if (state_ == State::Data && cb_.on_part_end) cb_.on_part_end(part_);
+        state_ = State::AfterDelimiter;
+    };
 
-    while (true) {
-        // After a delimiter: "--" means final boundary; else expect CRLF.
-        if (pos + 2 <= bodyv.size() && bodyv.substr(pos, 2) == "--") break;
-        if (pos + 2 > bodyv.size()) break;
-        if (bodyv.substr(pos, 2) == "\r\n") pos += 2;
-
-        // ---- Part headers ----
-        std::string disposition;
-        std::string content_type;
-        while (true) {
-            auto eol = bodyv.find("\r\n", pos);
-            if (eol == std::string_view::npos) return std::nullopt;
-            std::string_view line = bodyv.substr(pos, eol - pos);
-            pos = eol + 2;
-            if (line.empty()) break; // end of part headers
-
-            auto colon = line.find(':');
-            if (colon == std::string_view::npos) continue;
-            auto key = detail::trim_view(line.substr(0, colon));
-            auto val = detail::trim_view(line.substr(colon + 1));
-            if (detail::iequal_ascii(key, "Content-Disposition")) {
-                disposition.assign(val);
-            } else if (detail::iequal_ascii(key, "Content-Type")) {
-                content_type.assign(val);
+    if (!carry_.empty()) {
+        const std::size_t k = carry_.size();
+        const std::size_t m = std::min(n - k, in.size());
+        if (std::memcmp(in.data(), delim_.data() + k, m) == 0) {
+            if (k + m < n) {
+                carry_.append(in.data(), m);
+            } else {
+                carry_.clear();
+                at_delimiter();
             }
+            return m;
         }
+        // No delimiter starts inside the held bytes (only their first byte
+        // is a CR): they are data after all. Rescan `in` from its start.
+        std::string held = std::move(carry_);
+        carry_.clear();
+        emit_(held);
+        return 0;
+    }
 
-        // ---- Part body (up to CRLF + delimiter) ----
-        const std::string closing = "\r\n" + delim;
-        auto end = bodyv.find(closing, pos);
-        if (end == std::string_view::npos) return std::nullopt;
-        std::string_view data = bodyv.substr(pos, end - pos);
-        pos = end + closing.size();
-
-        std::string name = disposition_param_(disposition, "name");
-        std::string filename = disposition_param_(disposition, "filename");
-
-        if (!filename.empty() || !content_type.empty()) {
-            FilePart fp;
-            fp.name = std::move(name);
-            fp.filename = std::move(filename);
-            fp.content_type = std::move(content_type);
-            fp.data.assign(data.data(), data.size());
-            out.files.push_back(std::move(fp));
-        } else if (!name.empty()) {
-            out.fields[std::move(name)] = std::string(data);
+    const char* b = in.data();
+    const char* e = b + in.size();
+    const char* hit = detail::find_delimiter(b, e, delim_.data(), n);
+    if (hit != e) {
+        if (!emit_(std::string_view(b, static_cast<std::size_t>(hit - b)))) return 0;
+        at_delimiter();
+        return static_cast<std::size_t>(hit - b) + n;
+    }
+
+    // Hold back a tail that may be the start of a delimiter split across
+    // feeds.
+    std::size_t keep = 0;
+    for (std::size_t i = in.size() - std::min(n - 1, in.size()); i < in.size(); ++i) {
+        if (in[i] == '\r' && std::memcmp(b + i, delim_.data(), in.size() - i) == 0) {
+            keep = in.size() - i;
+            break;
         }
     }
+    if (!emit_(in.substr(0, in.size() - keep))) return 0;
+    carry_.assign(e - keep, keep);
+    return in.size();
+}
 
+void MultipartParser::header_line_(std::string_view line) {
+    const auto colon = line.find(':');
+    if (colon == std::string_view::npos) return;
+    const auto key = detail::trim_view(line.substr(0, colon));
+    const auto val = detail::trim_view(line.substr(colon + 1));
+    if (detail::iequal_ascii(key, "Content-Disposition")) {
+        part_.name = disposition_param_(val, "name");
+        part_.filename = disposition_param_(val, "filename");
+    } else if (detail::iequal_ascii(key, "Content-Type")) {
+        part_.content_type.assign(val);
+    }
+}
+
+bool MultipartParser::feed(std::string_view in) {
+    while (!in.empty()) {
+        switch (state_) {
+        case State::Preamble:
+        case State::Data:
+            in.remove_prefix(scan_data_(in));
+            break;
+        case State::AfterDelimiter: {
+            // "--" closes the body; otherwise optional blanks, then CRLF.
+            const char c = in.front();
+            in.remove_prefix(1);
+            if (c == '-') {
+                state_ = State::CloseDash;
+            } else if (c == '\r') {
+                state_ = State::DelimiterLf;
+            } else if (c != ' ' && c != '\t') {
+                fail_("Malformed multipart delimiter");
+            }
+            break;
+        }
+        case State::CloseDash:
+            if (in.front() != '-') {
+                fail_("Malformed multipart delimiter");
+                break;
+            }
+            in.remove_prefix(1);
+            state_ = State::Epilogue;
+            break;
+        case State::DelimiterLf:
+            if (in.front() != '\n') {
+                fail_("Malformed multipart delimiter");
+                break;
+            }
+            in.remove_prefix(1);
+            part_ = PartInfo{};
+            header_bytes_ = 0;
+            state_ = State::Headers;
+            break;
+        case State::Headers: {
+            const char* e = in.data() + in.size();
+            const char* nl = detail::find_newline(in.data(), e);
+            const auto len = static_cast<std::size_t>(nl - in.data());
+            header_bytes_ += len + (nl != e ? 1 : 0);
+            if (header_bytes_ > max_header_bytes_) {
+                fail_("Part headers too large");
+                break;
+            }
+            if (nl == e) {
+                line_.append(in);
+                in = {};
+                break;
+            }
+            std::string_view line = in.substr(0, len);
+            if (!line_.empty()) {
+                line_.append(line);
+                line = line_;
+            }
+            in.remove_prefix(len + 1);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (line.empty()) {
+                ++parts_;
+                state_ = State::Data;
+                if (cb_.on_part_begin) cb_.on_part_begin(part_);
+            } else {
+                header_line_(line);
+            }
+            line_.clear();
+            break;
+        }
+        case State::Epilogue:
+            return true;
+        case State::Error:
+            return false;
+        }
+    }
+    return state_ != State::Error;
+}
+
+bool MultipartParser::finish() {
+    if (done()) return true;
+    if (!failed()) fail_("Truncated multipart body");
+    return false;
+}
+
+// ---- save_multipart ----
+
+MultipartParser::Callbacks save_multipart(std::string dir, MultipartUpload& out,
+                                          std::size_t max_field_bytes) {
+    struct State {
+        std::string dir;
+        MultipartUpload* out;
+        std::size_t max_field;
+        int fd{-1};
+        std::string field;
+        ~State() {
+            if (fd >= 0) ::close(fd);
+        }
+    };
+    auto st = std::make_shared<State>();
+    st->dir = std::move(dir);
+    st->out = &out;
+    st->max_field = max_field_bytes;
+
+    MultipartParser::Callbacks cb;
+    cb.on_part_begin = [st](const PartInfo& part) {
+        st->field.clear();
+        if (!part.is_file()) return;
+        std::string path = st->dir + "/upload-XXXXXX";
+        st->fd = ::mkostemp(path.data(), O_CLOEXEC);
+        if (st->fd < 0) path.clear();
+        st->out->files.push_back({part.name, part.filename, part.content_type, std::move(path), 0});
+    };
+    cb.on_part_data = [st](const PartInfo& part, std::string_view data) {
+        if (!part.is_file()) {
+            if (st->field.size() + data.size() > st->max_field) return false;
+            st->field.append(data);
+            return true;
+        }
+        if (st->fd < 0 || !write_all_(st->fd, data.data(), data.size())) return false;
+        st->out->files.back().size += data.size();
+        return true;
+    };
+    cb.on_part_end = [st](const PartInfo& part) {
+        if (part.is_file()) {
+            ::close(st->fd);
+            st->fd = -1;
+        } else if (!part.name.empty()) {
+            st->out->fields[part.name] = std::move(st->field);
+        }
+    };
+    return cb;
+}
+
+// ---- buffered multipart ----
+
+std::string multipart_boundary(const Request& req) {
+    return is_multipart(req) ? extract_boundary_(req.content_type()) : std::string();
+}
+
+std::optional<MultipartData> multipart(const Request& req) {
+    const std::string boundary = multipart_boundary(req);
+    if (boundary.empty()) return std::nullopt;
+
+    MultipartData out;
+    std::string data; // current part
+    MultipartParser::Callbacks cb;
+    cb.on_part_begin = [&data](const PartInfo&) { data.clear(); };
+    cb.on_part_data = [&data](const PartInfo&, std::string_view d) {
+        data.append(d);
+        return true;
+    };
+    cb.on_part_end = [&](const PartInfo& part) {
+        if (part.is_file()) {
+            out.files.push_back({part.name, part.filename, part.content_type, std::move(data)});
+        } else if (!part.name.empty()) {
+            out.fields[part.name] = std::move(data);
+        }
+    };
+    MultipartParser parser(boundary, std::move(cb));
+
+    if (const detail::FileHandle* f = req.body_file()) {
+        // Spooled body: read it back in blocks.
+        std::string block(64 * 1024, '\0');
+        for (std::uint64_t off = 0; off < f->size();) {
+            const ssize_t n = ::pread(f->fd(), block.data(), block.size(), static_cast<off_t>(off));
+            if (n <= 0) return std::nullopt;
+            off += static_cast<std::uint64_t>(n);
+            if (!parser.feed(std::string_view(block.data(), static_cast<std::size_t>(n)))) break;
+        }
+    } else {
+        parser.feed(req.body_view());
+    }
+    if (!parser.finish()) return std::nullopt;
     return out;
 }
 
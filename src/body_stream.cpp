@@ -0,0 +1,41 @@
+/**
+ * @file body_stream.cpp
+ * @brief Flow control for streamed request bodies.
+ */
+
+#include "socketify/body_stream.h"
+#include "socketify/detail/body_stream_impl.h"
+
+namespace socketify {
+
+void BodyStream::pause() {
+    if (!impl_) return;
+    std::lock_guard<std::mutex> lk(impl_->mu);
+    if (!impl_->closed) impl_->paused = true;
+}
+
+void BodyStream::resume() {
+    if (!impl_) return;
+    std::function<void()> notify;
+    {
+        std::lock_guard<std::mutex> lk(impl_->mu);
+        if (impl_->closed || !impl_->paused) return;
+        impl_->paused = false;
+        notify = impl_->notify;
+    }
+    if (notify) notify();
+}
+
+bool BodyStream::paused() const {
+    if (!impl_) return false;
+    std::lock_guard<std::mutex> lk(impl_->mu);
+    return impl_->paused;
+}
+
+std::uint64_t BodyStream::received() const {
+    if (!impl_) return 0;
+    std::lock_guard<std::mutex> lk(impl_->mu);
+    return impl_->received;
+}
+
+} // namespace socketify
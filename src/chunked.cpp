@@ -0,0 +1,133 @@
+/**
+ * @file chunked.cpp
+ * @brief Chunked response writer: framing, trailers and stream start.
+ */
+
+#include "socketify/chunked.h"
+#include "socketify/detail/chunked_impl.h"
+#include "socketify/detail/http_scan.h"
+
+namespace socketify::chunked {
+
+namespace {
+
+using Impl = Writer::Impl;
+
+// Append head + data + tail to pending under the limit and wake the loop.
+bool enqueue_(Impl& impl, std::string_view head, std::string_view data, std::string_view tail,
+              bool last) {
+    std::function<void()> n;
+    {
+        std::unique_lock<std::mutex> lk(impl.mu);
+        if (impl.closed || impl.ended) return false;
+        const std::size_t add = head.size() + data.size() + tail.size();
+        // The last chunk (and trailers) is small and ends the stream: never
+        // refuse it, or a producer at the high mark could not finish.
+        if (!last && !impl.limit.admit(lk, impl.pending, add, impl.closed, impl.close_requested))
+            return false;
+        if (impl.ended) return false; // end() from another thread while we waited
+        impl.pending.reserve(impl.pending.size() + add);
+        impl.pending.append(head).append(data).append(tail);
+        impl.ended = last;
+        n = impl.notify;
+    }
+    if (n) n();
+    return true;
+}
+
+} // namespace
+
+bool Writer::write(std::string_view data) {
+    if (!impl_) return false;
+    if (data.empty()) return alive();
+    if (!impl_->framed) return enqueue_(*impl_, {}, data, {}, false);
+    char head[24];
+    std::size_t len = 0;
+    for (std::size_t v = data.size(); v; v >>= 4) ++len;
+    for (std::size_t i = len, v = data.size(); i-- > 0; v >>= 4)
+        head[i] = "0123456789abcdef"[v & 0xf];
+    head[len++] = '\r';
+    head[len++] = '\n';
+    return enqueue_(*impl_, std::string_view(head, len), data, "\r\n", false);
+}
+
+bool Writer::trailer(std::string_view name, std::string_view value) {
+    if (!impl_ || name.empty()) return false;
+    const char* const ne = name.data() + name.size();
+    const char* const ve = value.data() + value.size();
+    if (detail::find_non_token(name.data(), ne) != ne ||
+        detail::find_invalid_value(value.data(), ve) != ve)
+        return false;
+    std::lock_guard<std::mutex> lk(impl_->mu);
+    if (impl_->ended || impl_->closed) return false;
+    if (impl_->framed) impl_->trailers.append(name).append(": ").append(value).append("\r\n");
+    return true;
+}
+
+bool Writer::end() {
+    if (!impl_) return false;
+    if (!impl_->framed) return enqueue_(*impl_, {}, {}, {}, true);
+    std::string last;
+    {
+        std::lock_guard<std::mutex> lk(impl_->mu);
+        last.reserve(impl_->trailers.size() + 5);
+        last.append("0\r\n").append(impl_->trailers).append("\r\n");
+    }
+    return enqueue_(*impl_, {}, last, {}, true);
+}
+
+void Writer::abort() {
+    if (!impl_) return;
+    std::function<void()> n;
+    {
+        std::lock_guard<std::mutex> lk(impl_->mu);
+        if (impl_->closed || impl_->ended) return;
+        impl_->close_requested = true;
+        n = impl_->notify;
+    }
+    if (n) n();
+}
+
+bool Writer::alive() const {
+    if (!impl_) return false;
+    std::lock_guard<std::mutex> lk(impl_->mu);
+    return !impl_->closed && !impl_->ended && !impl_->close_requested;
+}
+
+bool Writer::ready() const {
+    if (!impl_) return false;
+    std::lock_guard<std::mutex> lk(impl_->mu);
+    const auto& l = impl_->limit;
+    return l.high == 0 || impl_->pending.size() + l.in_flight <= l.high;
+}
+
+void Writer::on_drain(std::function<void()> fn) {
+    if (!impl_ || !fn) return;
+    {
+        std::lock_guard<std::mutex> lk(impl_->mu);
+        if (impl_->closed) return;
+        const auto& l = impl_->limit;
+        if (l.high != 0 && impl_->pending.size() + l.in_flight > l.low) {
+            impl_->drain = std::move(fn);
+            return;
+        }
+    }
+    fn();
+}
+
+Writer start(Request& req, Response& res) {
+    auto impl = std::make_shared<Impl>();
+    impl->framed = req.http_version() != "HTTP/1.0";
+    // Limited from the first write: a producer looping on ready() on the
+    // worker's own loop must not buffer the whole body before adoption.
+    if (const detail::StreamPolicy* policy = detail::t_stream_policy) limit_stream(*impl, *policy);
+    if (!res.status_code()) res.status(Status::OK);
+    res.mark_chunked(impl);
+
+    // The worker holds `impl`; user handles share a second count whose
+    // last release aborts a stream that was never ended.
+    std::shared_ptr<Impl> handle(impl.get(), [impl](Impl*) { Writer(impl).abort(); });
+    return Writer(std::move(handle));
+}
+
+} // namespace socketify::chunked
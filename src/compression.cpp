@@ -1,6 +1,7 @@
 #include "socketify/compression.h"
 
 #include <algorithm>
+#include <charconv>
 #include <zlib.h>
 
 namespace socketify::compression {
@@ -48,6 +49,43 @@ Encoding negotiate_accept_encoding(std::string_view accept_enc, const Options& o
     return Encoding::None;
 }
 
+double accept_encoding_q(std::string_view accept_enc, std::string_view coding) {
+    auto trim = [](std::string_view v) {
+        while (!v.empty() && (v.front() == ' ' || v.front() == '\t')) v.remove_prefix(1);
+        while (!v.empty() && (v.back() == ' ' || v.back() == '\t')) v.remove_suffix(1);
+        return v;
+    };
+    auto iequal = [](std::string_view a, std::string_view b) {
+        return a.size() == b.size() &&
+               std::equal(a.begin(), a.end(), b.begin(),
+                          [](char x, char y) { return ascii_lower(x) == ascii_lower(y); });
+    };
+
+    double exact = -1, any = -1;
+    while (!accept_enc.empty()) {
+        const std::size_t comma = accept_enc.find(',');
+        std::string_view item = accept_enc.substr(0, comma);
+        accept_enc.remove_prefix(comma == std::string_view::npos ? accept_enc.size() : comma + 1);
+
+        const std::size_t semi = item.find(';');
+        const std::string_view token = trim(item.substr(0, semi));
+        double q = 1;
+        if (semi != std::string_view::npos) {
+            std::string_view param = trim(item.substr(semi + 1));
+            if (param.size() >= 2 && ascii_lower(param[0]) == 'q' && param[1] == '=') {
+                param.remove_prefix(2);
+                if (std::from_chars(param.data(), param.data() + param.size(), q).ec != std::errc())
+                    q = 0;
+                q = std::clamp(q, 0.0, 1.0);
+            }
+        }
+        if (iequal(token, coding) || (iequal(coding, "gzip") && iequal(token, "x-gzip"))) exact = q;
+        else if (token == "*") any = q;
+    }
+    if (exact >= 0) return exact;
+    return any >= 0 ? any : 0;
+}
+
 // ---- zlib helpers ----
 // gzip: use deflate with gzip wrapper (windowBits = 15 + 16)
 bool gzip_compress(std::string_view src, std::string& out, int level) {
@@ -14,16 +14,10 @@ static inline std::string to_lower(std::string s) {
     return s;
 }
 
-static inline std::string_view get_header(const HeaderMap& h, std::string_view key) {
-    auto it = h.find(std::string(key));
-    if (it == h.end()) return {};
-    return it->second;
-}
-
-static inline void append_vary(HeaderMap& h, std::string_view token) {
-    auto it = h.find("Vary");
-    if (it == h.end()) {
-        h.emplace("Vary", std::string(token));
+static inline void append_vary(Response& res, std::string_view token) {
+    auto it = res.headers().find("Vary");
+    if (it == res.headers().end()) {
+        res.set_header("Vary", token);
         return;
     }
     // append if not already present (case-insensitive contains)
@@ -32,7 +26,7 @@ static inline void append_vary(HeaderMap& h, std::string_view token) {
     std::string needle = to_lower(std::string(token));
     if (low.find(needle) == std::string::npos) {
         cur.append(", ").append(std::string(token));
-        it->second = std::move(cur);
+        res.set_header("Vary", cur);
     }
 }
 
@@ -43,7 +37,7 @@ static inline void set_header(Response& res, std::string_view k, std::string_vie
 static inline bool is_preflight(const Request& req) {
     if (req.method() != Method::OPTIONS) return false;
     // CORS preflight must include Access-Control-Request-Method
-    return !get_header(req.headers(), "Access-Control-Request-Method").empty();
+    return !req.header(HeaderId::AccessControlRequestMethod).empty();
 }
 
 static inline bool origin_allowed(const std::string& request_origin,
@@ -83,7 +77,7 @@ static inline bool origin_allowed(const std::string& request_origin,
 
 Middleware middleware(CorsOptions opts) {
     return [opts](Request& req, Response& res, Next next) {
-        const auto origin = std::string(get_header(req.headers(), "Origin"));
+        const auto origin = std::string(req.header(HeaderId::Origin));
         if (origin.empty()) {
             // Not a CORS request; proceed
             next();
@@ -101,15 +95,14 @@ Middleware middleware(CorsOptions opts) {
             }
             if (vary_origin) {
                 // Reflecting origin → add Vary: Origin
-                auto& h = const_cast<HeaderMap&>(res.headers());
-                append_vary(h, "Origin");
+                append_vary(res, "Origin");
             }
         }
 
         if (is_preflight(req)) {
             // Preflight response headers
             // Methods
-            auto req_method = get_header(req.headers(), "Access-Control-Request-Method");
+            auto req_method = req.header(HeaderId::AccessControlRequestMethod);
             if (!opts.allow_methods.empty()) {
                 set_header(res, "Access-Control-Allow-Methods", opts.allow_methods);
             } else if (!req_method.empty()) {
@@ -117,20 +110,19 @@ Middleware middleware(CorsOptions opts) {
             }
 
             // Requested headers
-            auto req_headers = get_header(req.headers(), "Access-Control-Request-Headers");
+            auto req_headers = req.header(HeaderId::AccessControlRequestHeaders);
             if (!opts.allow_headers.empty()) {
                 set_header(res, "Access-Control-Allow-Headers", opts.allow_headers);
             } else if (!req_headers.empty()) {
                 // echo requested headers
                 set_header(res, "Access-Control-Allow-Headers", req_headers);
                 // since we reflect request-specified headers, this varies on that header
-                auto& h = const_cast<HeaderMap&>(res.headers());
-                append_vary(h, "Access-Control-Request-Headers");
+                append_vary(res, "Access-Control-Request-Headers");
             }
 
             // Private Network Access (Chrome)
             if (opts.allow_private_network) {
-                auto pna = get_header(req.headers(), "Access-Control-Request-Private-Network");
+                auto pna = req.header(HeaderId::AccessControlRequestPrivateNetwork);
                 if (!pna.empty()) {
                     // If header present, add allow header (many browsers treat any value as signal)
                     set_header(res, "Access-Control-Allow-Private-Network", "true");
@@ -0,0 +1,85 @@
+/**
+ * @file deferred.cpp
+ * @brief Deferred response handles and blocking-route offload.
+ */
+
+#include "socketify/deferred.h"
+#include "socketify/detail/deferred_impl.h"
+
+namespace socketify {
+
+Deferred::Impl::~Impl() {
+    // Every handle was dropped without an answer; the client still waits.
+    if (!done && deliver) {
+        Response err;
+        err.status(Status::InternalServerError).send("Internal Server Error\n");
+        deliver(std::move(err));
+    }
+}
+
+bool Deferred::finish(const std::function<void(Response&)>& fill) {
+    if (!impl_) return false;
+    std::lock_guard<std::mutex> lk(impl_->mu);
+    if (impl_->done || impl_->closed) return false;
+    if (fill) fill(impl_->res);
+    if (!impl_->res.ended()) impl_->res.end();
+    impl_->done = true;
+    // Without deliver the handler has not returned yet; the worker takes
+    // the stored response when it adopts the handle.
+    if (impl_->deliver) {
+        impl_->deliver(std::move(impl_->res));
+        impl_->deliver = nullptr;
+    }
+    return true;
+}
+
+bool Deferred::send(std::string_view body, std::string_view content_type) {
+    return finish([&](Response& res) { res.send(body, content_type); });
+}
+
+bool Deferred::json(const nlohmann::json& j) {
+    return finish([&](Response& res) { res.json(j); });
+}
+
+bool Deferred::send_status(Status s) {
+    return finish([&](Response& res) { res.send_status(s); });
+}
+
+bool Deferred::alive() const {
+    if (!impl_) return false;
+    std::lock_guard<std::mutex> lk(impl_->mu);
+    return !impl_->done && !impl_->closed;
+}
+
+Deferred defer(Response& res) {
+    if (res.ended()) return {};
+    auto impl = std::make_shared<Deferred::Impl>();
+    impl->res = std::move(res);
+    res = Response{};
+    res.mark_deferred(impl);
+    return Deferred(std::move(impl));
+}
+
+namespace detail {
+
+void run_offloaded(const std::shared_ptr<Deferred::Impl>& impl, Request& req) {
+    Response res;
+    {
+        std::lock_guard<std::mutex> lk(impl->mu);
+        res = std::move(impl->res);
+    }
+    try {
+        (*impl->offload)(req, res);
+    } catch (const std::exception& e) {
+        res = Response{};
+        res.status(Status::InternalServerError).send(std::string("Internal Server Error: ") + e.what() + "\n");
+    } catch (...) {
+        res = Response{};
+        res.status(Status::InternalServerError).send("Internal Server Error\n");
+    }
+    Deferred(impl).finish([&res](Response& out) { out = std::move(res); });
+}
+
+} // namespace detail
+
+} // namespace socketify
@@ -0,0 +1,135 @@
+/**
+ * @file cpu_affinity_linux.cpp
+ * @brief sched_setaffinity / set_mempolicy / SO_ATTACH_REUSEPORT_CBPF.
+ */
+
+#include "socketify/detail/cpu_affinity.h"
+
+#include <linux/filter.h>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace socketify::detail {
+
+std::vector<int> allowed_cpus() {
+    std::vector<int> out;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof(set), &set) != 0) return out;
+    for (int c = 0; c < CPU_SETSIZE; ++c) {
+        if (CPU_ISSET(c, &set)) out.push_back(c);
+    }
+    return out;
+}
+
+std::vector<int> plan_worker_cpus(const std::vector<int>& requested, unsigned workers) {
+    const std::vector<int> pool = requested.empty() ? allowed_cpus() : requested;
+    std::vector<int> out;
+    if (pool.empty()) return out;
+    out.reserve(workers);
+    for (unsigned i = 0; i < workers; ++i) out.push_back(pool[i % pool.size()]);
+    return out;
+}
+
+bool pin_current_thread(int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return ::sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+bool prefer_local_memory() {
+    return ::syscall(SYS_set_mempolicy, MPOL_LOCAL, nullptr, 0) == 0;
+}
+
+int current_cpu() noexcept { return ::sched_getcpu(); }
+
+int incoming_cpu(int fd) noexcept {
+#ifdef SO_INCOMING_CPU
+    int cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if (::getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) == 0) return cpu;
+#else
+    (void)fd;
+#endif
+    return -1;
+}
+
+bool attach_reuseport_cpu_steering(int fd, const std::vector<int>& cpus, std::string& err) {
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+    if (cpus.empty()) {
+        err = "no worker CPUs to steer to";
+        return false;
+    }
+    // Workers sharing a CPU, in worker order.
+    std::vector<std::pair<int, std::vector<std::uint32_t>>> groups;
+    for (std::size_t i = 0; i < cpus.size(); ++i) {
+        auto it = std::find_if(groups.begin(), groups.end(),
+                               [&](const auto& g) { return g.first == cpus[i]; });
+        if (it == groups.end()) it = groups.insert(groups.end(), {cpus[i], {}});
+        it->second.push_back(static_cast<std::uint32_t>(i));
+    }
+
+    // A = raw_smp_processor_id(); then one "jeq cpu" block per distinct CPU.
+    // A CPU with one worker returns its index; several workers split their
+    // CPU's flows by rxhash % count. CPUs no worker is pinned to fall back
+    // to A % n.
+    std::vector<sock_filter> prog;
+    prog.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+                            static_cast<std::uint32_t>(SKF_AD_OFF + SKF_AD_CPU)));
+    for (const auto& [cpu, idx] : groups) {
+        // ld rxhash; mod k; (jeq j; ret idx[j]) * (k-1); ret idx[k-1]
+        const std::size_t block = idx.size() == 1 ? 1 : 2 * idx.size() + 1;
+        if (block > 255) {
+            err = "too many workers share CPU " + std::to_string(cpu) + " to steer";
+            return false;
+        }
+        prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, static_cast<std::uint32_t>(cpu), 0,
+                                static_cast<std::uint8_t>(block)));
+        if (idx.size() == 1) {
+            prog.push_back(BPF_STMT(BPF_RET | BPF_K, idx.front()));
+            continue;
+        }
+        prog.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+                                static_cast<std::uint32_t>(SKF_AD_OFF + SKF_AD_RXHASH)));
+        prog.push_back(BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, static_cast<std::uint32_t>(idx.size())));
+        for (std::size_t j = 0; j + 1 < idx.size(); ++j) {
+            prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, static_cast<std::uint32_t>(j), 0, 1));
+            prog.push_back(BPF_STMT(BPF_RET | BPF_K, idx[j]));
+        }
+        prog.push_back(BPF_STMT(BPF_RET | BPF_K, idx.back()));
+    }
+    prog.push_back(BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, static_cast<std::uint32_t>(cpus.size())));
+    prog.push_back(BPF_STMT(BPF_RET | BPF_A, 0));
+    if (prog.size() > BPF_MAXINSNS) {
+        err = "too many worker CPUs to steer";
+        return false;
+    }
+
+    sock_fprog fprog{};
+    fprog.len = static_cast<unsigned short>(prog.size());
+    fprog.filter = prog.data();
+    if (::setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &fprog, sizeof(fprog)) != 0) {
+        err = std::string("SO_ATTACH_REUSEPORT_CBPF: ") + std::strerror(errno);
+        return false;
+    }
+    return true;
+#else
+    (void)fd;
+    (void)cpus;
+    err = "SO_ATTACH_REUSEPORT_CBPF is not supported on this platform";
+    return false;
+#endif
+}
+
+} // namespace socketify::detail
@@ -1,10 +1,13 @@
 /**
  * @file file_io_posix.cpp
- * @brief POSIX implementation of detail::FileHandle.
+ * @brief POSIX implementation of detail::FileHandle (including temp files).
  */
 
 #include "socketify/detail/file_io.h"
 
+#include <cerrno>
+#include <cstdlib>
+
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -28,6 +31,40 @@ bool FileHandle::open(std::string_view path) {
     return true;
 }
 
+bool FileHandle::open_temp(std::string_view dir) {
+    close();
+    std::string d(dir.empty() ? std::string_view("/tmp") : dir);
+    int fd = -1;
+#ifdef O_TMPFILE
+    fd = ::open(d.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+#endif
+    if (fd < 0) {
+        // No O_TMPFILE (old kernel, or a filesystem without it).
+        std::string tmpl = d + "/socketify-body-XXXXXX";
+        fd = ::mkostemp(tmpl.data(), O_CLOEXEC);
+        if (fd < 0) return false;
+        ::unlink(tmpl.c_str());
+    }
+    fd_ = fd;
+    size_ = 0;
+    mtime_ = 0;
+    return true;
+}
+
+bool FileHandle::append(const char* p, std::size_t n) {
+    while (n > 0) {
+        ssize_t rc = ::pwrite(fd_, p, n, static_cast<off_t>(size_));
+        if (rc < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += rc;
+        n -= static_cast<std::size_t>(rc);
+        size_ += static_cast<std::uint64_t>(rc);
+    }
+    return true;
+}
+
 void FileHandle::close() noexcept {
     if (fd_ >= 0) {
         ::close(fd_);
@@ -40,12 +77,20 @@ void FileHandle::close() noexcept {
 bool read_file_range(std::string_view path, std::uint64_t offset, std::uint64_t len, std::string& out) {
     FileHandle fh;
     if (!fh.open(path)) return false;
+    return read_file_range(fh, offset, len, out);
+}
+
+bool read_file_range(const FileHandle& file, std::uint64_t offset, std::uint64_t len, std::string& out) {
+    if (!file.valid()) return false;
     out.resize(static_cast<std::size_t>(len));
     std::size_t got = 0;
     while (got < len) {
-        ssize_t rc = ::pread(fh.fd(), &out[got], static_cast<std::size_t>(len - got),
+        ssize_t rc = ::pread(file.fd(), &out[got], static_cast<std::size_t>(len - got),
                              static_cast<off_t>(offset + got));
-        if (rc < 0) return false;
+        if (rc < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
         if (rc == 0) break;
         got += static_cast<std::size_t>(rc);
     }
@@ -0,0 +1,455 @@
+/**
+ * @file hpack.cpp
+ * @brief HPACK integers, Huffman coding, static table and the
+ *        dynamic-table encoder/decoder pair.
+ */
+
+#include "socketify/detail/hpack.h"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace socketify::detail::hpack {
+
+namespace {
+
+struct StaticEntry {
+    std::string_view name;
+    std::string_view value;
+};
+
+// RFC 7541 Appendix A; index i + 1.
+constexpr std::array<StaticEntry, kStaticTableSize> kStatic{{
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+}};
+
+struct HuffCode {
+    std::uint32_t code;
+    std::uint8_t bits;
+};
+
+// RFC 7541 Appendix B; symbol 256 is EOS.
+constexpr HuffCode kHuffman[257] = {
+    {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28},
+    {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},
+    {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+    {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+    {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},
+    {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+    {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28},
+    {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},
+    {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+    {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11},
+    {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11},
+    {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+    {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6},
+    {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6},
+    {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+    {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10},
+    {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7},
+    {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+    {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7},
+    {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7},
+    {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+    {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7},
+    {0xfc, 8}, {0x73, 7}, {0xfd, 8}, {0x1ffb, 13},
+    {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+    {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5},
+    {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6},
+    {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+    {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5},
+    {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5},
+    {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+    {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15},
+    {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},
+    {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+    {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23},
+    {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23},
+    {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+    {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23},
+    {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23},
+    {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+    {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24},
+    {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22},
+    {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+    {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24},
+    {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23},
+    {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+    {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23},
+    {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22},
+    {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+    {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19},
+    {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25},
+    {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+    {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25},
+    {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27},
+    {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+    {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26},
+    {0xffffffd, 28}, {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27},
+    {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+    {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23},
+    {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25},
+    {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+    {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26},
+    {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27},
+    {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+    {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},
+    {0x3fffffff, 30},
+};
+
+// Binary decoding tree over kHuffman, built once.
+struct HuffTree {
+    struct Node {
+        std::int16_t child[2]{-1, -1};
+        std::int16_t sym{-1};
+    };
+    std::vector<Node> nodes;
+
+    HuffTree() {
+        nodes.reserve(512);
+        nodes.emplace_back();
+        for (int s = 0; s < 257; ++s) {
+            std::size_t n = 0;
+            for (int b = kHuffman[s].bits - 1; b >= 0; --b) {
+                const int bit = (kHuffman[s].code >> b) & 1;
+                if (nodes[n].child[bit] < 0) {
+                    nodes[n].child[bit] = static_cast<std::int16_t>(nodes.size());
+                    nodes.emplace_back();
+                }
+                n = static_cast<std::size_t>(nodes[n].child[bit]);
+            }
+            nodes[n].sym = static_cast<std::int16_t>(s);
+        }
+    }
+};
+
+const HuffTree& huff_tree() {
+    static const HuffTree tree;
+    return tree;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Primitives
+// ---------------------------------------------------------------------------
+
+void encode_integer(std::string& out, std::uint64_t v, int prefix, std::uint8_t first) {
+    const std::uint64_t max = (1u << prefix) - 1;
+    if (v < max) {
+        out.push_back(static_cast<char>(first | v));
+        return;
+    }
+    out.push_back(static_cast<char>(first | max));
+    v -= max;
+    while (v >= 128) {
+        out.push_back(static_cast<char>((v & 127) | 128));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+bool decode_integer(const std::uint8_t*& p, const std::uint8_t* end, int prefix, std::uint64_t& v) {
+    if (p == end) return false;
+    const std::uint64_t max = (1u << prefix) - 1;
+    v = *p++ & max;
+    if (v < max) return true;
+    for (int shift = 0; p != end; shift += 7) {
+        const std::uint8_t b = *p++;
+        v += static_cast<std::uint64_t>(b & 127) << shift;
+        if (v > 0xffffffffu) return false;
+        if (!(b & 128)) return true;
+        if (shift > 28) return false;
+    }
+    return false;
+}
+
+std::size_t huffman_length(std::string_view s) noexcept {
+    std::size_t bits = 0;
+    for (unsigned char c : s) bits += kHuffman[c].bits;
+    return (bits + 7) / 8;
+}
+
+void huffman_encode(std::string& out, std::string_view s) {
+    std::uint64_t acc = 0;
+    int n = 0;
+    for (unsigned char c : s) {
+        acc = (acc << kHuffman[c].bits) | kHuffman[c].code;
+        n += kHuffman[c].bits;
+        while (n >= 8) {
+            n -= 8;
+            out.push_back(static_cast<char>(acc >> n));
+        }
+    }
+    if (n > 0) out.push_back(static_cast<char>((acc << (8 - n)) | (0xffu >> n)));
+}
+
+bool huffman_decode(std::string_view in, std::string& out) {
+    const auto& nodes = huff_tree().nodes;
+    std::size_t n = 0;
+    int depth = 0;      // bits since the last symbol
+    bool ones = true;   // ... and all of them were 1
+    for (unsigned char c : in) {
+        for (int b = 7; b >= 0; --b) {
+            const int bit = (c >> b) & 1;
+            const std::int16_t next = nodes[n].child[bit];
+            if (next < 0) return false;
+            n = static_cast<std::size_t>(next);
+            ++depth;
+            ones = ones && bit;
+            const std::int16_t sym = nodes[n].sym;
+            if (sym >= 0) {
+                if (sym == 256) return false; // EOS in the string
+                out.push_back(static_cast<char>(sym));
+                n = 0;
+                depth = 0;
+                ones = true;
+            }
+        }
+    }
+    return depth <= 7 && ones;
+}
+
+// ---------------------------------------------------------------------------
+// Decoder
+// ---------------------------------------------------------------------------
+
+bool Decoder::lookup_(std::uint64_t index, std::string_view& name, std::string_view& value) const {
+    if (index == 0) return false;
+    if (index <= kStaticTableSize) {
+        name = kStatic[index - 1].name;
+        value = kStatic[index - 1].value;
+        return true;
+    }
+    index -= kStaticTableSize + 1;
+    if (index >= table_.size()) return false;
+    name = table_[index].name;
+    value = table_[index].value;
+    return true;
+}
+
+bool Decoder::read_string_(const std::uint8_t*& p, const std::uint8_t* end, std::string& out) {
+    if (p == end) return false;
+    const bool huff = (*p & 0x80) != 0;
+    std::uint64_t len = 0;
+    if (!decode_integer(p, end, 7, len) || len > static_cast<std::uint64_t>(end - p)) return false;
+    const std::string_view raw(reinterpret_cast<const char*>(p), static_cast<std::size_t>(len));
+    p += len;
+    out.clear();
+    if (!huff) {
+        out.assign(raw);
+        return true;
+    }
+    return huffman_decode(raw, out);
+}
+
+void Decoder::evict_to_(std::size_t max) {
+    while (size_ > max && !table_.empty()) {
+        size_ -= table_.back().size();
+        table_.pop_back();
+    }
+}
+
+void Decoder::insert_(std::string name, std::string value) {
+    Field f{std::move(name), std::move(value)};
+    const std::size_t sz = f.size();
+    evict_to_(sz > max_ ? 0 : max_ - sz);
+    if (sz > max_) return; // too big: the table is just emptied
+    size_ += sz;
+    table_.push_front(std::move(f));
+}
+
+bool Decoder::decode(std::string_view block, const Emit& emit) {
+    auto* p = reinterpret_cast<const std::uint8_t*>(block.data());
+    const auto* end = p + block.size();
+    bool fields_seen = false;
+    while (p != end) {
+        const std::uint8_t b = *p;
+        std::uint64_t index = 0;
+        std::string_view name, value;
+        if (b & 0x80) { // indexed field
+            if (!decode_integer(p, end, 7, index) || !lookup_(index, name, value)) return false;
+            fields_seen = true;
+            if (!emit(name, value)) return false;
+            continue;
+        }
+        if ((b & 0xe0) == 0x20) { // dynamic table size update
+            std::uint64_t sz = 0;
+            if (fields_seen || !decode_integer(p, end, 5, sz) || sz > limit_) return false;
+            max_ = static_cast<std::size_t>(sz);
+            evict_to_(max_);
+            continue;
+        }
+        const bool indexing = (b & 0xc0) == 0x40;
+        if (!decode_integer(p, end, indexing ? 6 : 4, index)) return false;
+        if (index == 0) {
+            if (!read_string_(p, end, name_buf_)) return false;
+        } else {
+            std::string_view unused;
+            if (!lookup_(index, name, unused)) return false;
+            name_buf_.assign(name);
+        }
+        if (!read_string_(p, end, value_buf_)) return false;
+        fields_seen = true;
+        if (!emit(name_buf_, value_buf_)) return false;
+        if (indexing) insert_(name_buf_, value_buf_);
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Encoder
+// ---------------------------------------------------------------------------
+
+void Encoder::set_max_table_size(std::size_t n) {
+    n = std::min<std::size_t>(n, 4096);
+    if (n == max_ && !update_pending_) return;
+    max_ = n;
+    min_update_ = std::min(min_update_, n);
+    update_pending_ = true;
+    while (size_ > max_) {
+        size_ -= table_.back().size();
+        table_.pop_back();
+    }
+}
+
+void Encoder::flush_size_update_(std::string& out) {
+    if (!update_pending_) return;
+    if (min_update_ < max_) encode_integer(out, min_update_, 5, 0x20);
+    encode_integer(out, max_, 5, 0x20);
+    update_pending_ = false;
+    min_update_ = SIZE_MAX;
+}
+
+void Encoder::literal_(std::string& out, std::string_view s) {
+    const std::size_t h = huffman_length(s);
+    if (h < s.size()) {
+        encode_integer(out, h, 7, 0x80);
+        huffman_encode(out, s);
+    } else {
+        encode_integer(out, s.size(), 7, 0);
+        out.append(s);
+    }
+}
+
+void Encoder::insert_(std::string_view name, std::string_view value) {
+    Field f{std::string(name), std::string(value)};
+    const std::size_t sz = f.size();
+    while (size_ + sz > max_ && !table_.empty()) {
+        size_ -= table_.back().size();
+        table_.pop_back();
+    }
+    if (sz > max_) return;
+    size_ += sz;
+    table_.push_front(std::move(f));
+}
+
+void Encoder::status(std::string& out, unsigned code) {
+    flush_size_update_(out);
+    for (std::size_t i = 7; i < 14; ++i) {
+        const auto v = kStatic[i].value;
+        if (static_cast<unsigned>((v[0] - '0') * 100 + (v[1] - '0') * 10 + (v[2] - '0')) == code) {
+            encode_integer(out, i + 1, 7, 0x80);
+            return;
+        }
+    }
+    char buf[3] = {static_cast<char>('0' + code / 100 % 10), static_cast<char>('0' + code / 10 % 10),
+                   static_cast<char>('0' + code % 10)};
+    field(out, ":status", std::string_view(buf, 3));
+}
+
+void Encoder::field(std::string& out, std::string_view name, std::string_view value, bool sensitive) {
+    flush_size_update_(out);
+    std::size_t name_index = 0;
+    for (std::size_t i = 0; i < kStatic.size(); ++i) {
+        if (kStatic[i].name != name) continue;
+        if (!sensitive && kStatic[i].value == value && !value.empty()) {
+            encode_integer(out, i + 1, 7, 0x80);
+            return;
+        }
+        if (!name_index) name_index = i + 1;
+    }
+    for (std::size_t i = 0; i < table_.size(); ++i) {
+        if (table_[i].name != name) continue;
+        if (!sensitive && table_[i].value == value) {
+            encode_integer(out, kStaticTableSize + 1 + i, 7, 0x80);
+            return;
+        }
+        if (!name_index) name_index = kStaticTableSize + 1 + i;
+    }
+
+    // Lengths and similar per-response values would only churn the table.
+    const bool index = !sensitive && name != "content-length" &&
+                       name.size() + value.size() + kEntryOverhead <= max_ / 2;
+    if (index) {
+        encode_integer(out, name_index, 6, 0x40);
+    } else {
+        encode_integer(out, name_index, 4, sensitive ? 0x10 : 0x00);
+    }
+    if (!name_index) literal_(out, name);
+    literal_(out, value);
+    if (index) insert_(name, value);
+}
+
+} // namespace socketify::detail::hpack
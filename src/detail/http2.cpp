@@ -0,0 +1,749 @@
+/**
+ * @file http2.cpp
+ * @brief HTTP/2 frame parsing, stream bookkeeping and flow control.
+ */
+
+#include "socketify/detail/http2.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+
+namespace socketify::detail::h2 {
+
+namespace {
+
+constexpr std::uint8_t kEndStream = 0x1;
+constexpr std::uint8_t kAck = 0x1;
+constexpr std::uint8_t kEndHeaders = 0x4;
+constexpr std::uint8_t kPadded = 0x8;
+constexpr std::uint8_t kPriority = 0x20;
+
+constexpr std::uint32_t kMaxFrame = 16384; // we never raise SETTINGS_MAX_FRAME_SIZE
+constexpr std::int64_t kMaxWindow = 0x7fffffff;
+
+enum : std::uint16_t {
+    kSettingsHeaderTableSize = 0x1,
+    kSettingsEnablePush = 0x2,
+    kSettingsMaxConcurrentStreams = 0x3,
+    kSettingsInitialWindowSize = 0x4,
+    kSettingsMaxFrameSize = 0x5,
+    kSettingsMaxHeaderListSize = 0x6,
+};
+
+std::uint32_t be32(const char* p) noexcept {
+    const auto* u = reinterpret_cast<const unsigned char*>(p);
+    return (std::uint32_t{u[0]} << 24) | (std::uint32_t{u[1]} << 16) | (std::uint32_t{u[2]} << 8) | u[3];
+}
+
+void put32(std::string& out, std::uint32_t v) {
+    out.push_back(static_cast<char>(v >> 24));
+    out.push_back(static_cast<char>(v >> 16));
+    out.push_back(static_cast<char>(v >> 8));
+    out.push_back(static_cast<char>(v));
+}
+
+void put_setting(std::string& out, std::uint16_t id, std::uint32_t v) {
+    out.push_back(static_cast<char>(id >> 8));
+    out.push_back(static_cast<char>(id));
+    put32(out, v);
+}
+
+// Fields that only mean something to HTTP/1.1 (RFC 9113 8.2.2).
+bool connection_specific(std::string_view n) noexcept {
+    return n == "connection" || n == "keep-alive" || n == "proxy-connection" ||
+           n == "transfer-encoding" || n == "upgrade";
+}
+
+bool valid_name(std::string_view n) noexcept {
+    for (char c : n)
+        if ((c >= 'A' && c <= 'Z') || c == ' ' || c == ':' || c == '\r' || c == '\n' || c == '\0')
+            return false;
+    return !n.empty();
+}
+
+bool valid_value(std::string_view v) noexcept {
+    return v.find_first_of(std::string_view("\r\n\0", 3)) == std::string_view::npos;
+}
+
+void write_head(char* p, std::size_t len, std::uint8_t type, std::uint8_t flags, std::uint32_t stream) {
+    p[0] = static_cast<char>(len >> 16);
+    p[1] = static_cast<char>(len >> 8);
+    p[2] = static_cast<char>(len);
+    p[3] = static_cast<char>(type);
+    p[4] = static_cast<char>(flags);
+    p[5] = static_cast<char>(stream >> 24);
+    p[6] = static_cast<char>(stream >> 16);
+    p[7] = static_cast<char>(stream >> 8);
+    p[8] = static_cast<char>(stream);
+}
+
+bool read_fully(int fd, char* dst, std::size_t n, std::uint64_t offset) {
+    while (n > 0) {
+        const ssize_t r = ::pread(fd, dst, n, static_cast<off_t>(offset));
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        dst += r;
+        n -= static_cast<std::size_t>(r);
+        offset += static_cast<std::uint64_t>(r);
+    }
+    return true;
+}
+
+} // namespace
+
+Session::Session(SessionLimits limits) : limits_(limits) {
+    // Until our SETTINGS are acknowledged the peer may assume 65535, so a
+    // smaller window could not be enforced anyway.
+    limits_.initial_window = std::max<std::uint32_t>(limits_.initial_window, 65535);
+    std::string payload;
+    put_setting(payload, kSettingsMaxConcurrentStreams, limits_.max_concurrent_streams);
+    put_setting(payload, kSettingsInitialWindowSize, limits_.initial_window);
+    put_setting(payload, kSettingsMaxHeaderListSize, static_cast<std::uint32_t>(limits_.max_header_list));
+    frame_(FrameType::Settings, 0, 0, payload);
+    conn_window_ = limits_.initial_window;
+    if (limits_.max_buffered != 0)
+        conn_window_ = static_cast<std::uint32_t>(std::clamp<std::size_t>(
+            limits_.max_buffered, conn_window_, static_cast<std::size_t>(kMaxWindow)));
+    // The connection window starts at 65535 whatever SETTINGS say.
+    if (conn_window_ > 65535) window_update_(0, conn_window_ - 65535);
+}
+
+std::size_t Session::feed(std::string_view in) {
+    if (failed_) return in.size();
+    std::size_t used = 0;
+    if (!preface_done_) {
+        const std::size_t n = std::min(in.size(), kPreface.size());
+        if (in.substr(0, n) != kPreface.substr(0, n)) {
+            fail_(ErrorCode::ProtocolError);
+            return in.size();
+        }
+        if (n < kPreface.size()) return 0;
+        preface_done_ = true;
+        used = kPreface.size();
+    }
+    while (in.size() - used >= 9) {
+        const char* p = in.data() + used;
+        const auto* u = reinterpret_cast<const unsigned char*>(p);
+        const std::size_t len = (std::size_t{u[0]} << 16) | (std::size_t{u[1]} << 8) | u[2];
+        if (len > kMaxFrame) {
+            fail_(ErrorCode::FrameSizeError);
+            return in.size();
+        }
+        if (in.size() - used - 9 < len) break;
+        const auto type = static_cast<FrameType>(u[3]);
+        const std::uint8_t flags = u[4];
+        const std::uint32_t stream = be32(p + 5) & 0x7fffffff;
+        used += 9 + len;
+        if (!on_frame_(type, flags, stream, std::string_view(p + 9, len))) return in.size();
+    }
+    return used;
+}
+
+bool Session::next_request(IncomingRequest& out) {
+    if (ready_.empty()) return false;
+    out = std::move(ready_.front());
+    ready_.pop_front();
+    if (limits_.max_buffered != 0) {
+        buffered_ -= out.body.size();
+        release_(out.body.size());
+    }
+    return true;
+}
+
+bool Session::respond(std::uint32_t stream, unsigned status, const std::vector<Field>& fields,
+                      ResponseBody body) {
+    auto it = streams_.find(stream);
+    if (it == streams_.end() || it->second.responded) {
+        cancelled_.erase(stream);
+        return false;
+    }
+    Stream& s = it->second;
+    s.responded = true;
+
+    std::string block;
+    encoder_.status(block, status);
+    for (const auto& [name, value] : fields) {
+        scratch_.assign(name);
+        for (char& c : scratch_)
+            if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        if (connection_specific(scratch_)) continue;
+        encoder_.field(block, scratch_, value, scratch_ == "set-cookie");
+    }
+    const bool end_stream = body.empty();
+    send_headers_(stream, block, end_stream);
+    if (end_stream) {
+        finish_stream_(stream);
+        return true;
+    }
+    s.body = std::move(body);
+    s.data_off = 0;
+    sending_.push_back(stream);
+    return true;
+}
+
+void Session::reset(std::uint32_t stream, ErrorCode code) {
+    if (streams_.count(stream) != 0) stream_error_(stream, code);
+    else cancelled_.erase(stream);
+}
+
+void Session::pump(std::size_t budget) {
+    std::size_t blocked = 0;
+    while (sending_.size() > blocked && out_.size() < budget && conn_send_window_ > 0) {
+        const std::uint32_t id = sending_.front();
+        sending_.pop_front();
+        auto it = streams_.find(id);
+        if (it == streams_.end()) continue; // reset meanwhile
+        Stream& s = it->second;
+        if (s.send_window <= 0) {
+            sending_.push_back(id);
+            ++blocked;
+            continue;
+        }
+        const std::uint64_t remaining = (s.body.data.size() - s.data_off) + s.body.length;
+        const std::size_t chunk = static_cast<std::size_t>(
+            std::min<std::uint64_t>({remaining, static_cast<std::uint64_t>(s.send_window),
+                                     static_cast<std::uint64_t>(conn_send_window_), peer_max_frame_,
+                                     kMaxFrame}));
+        const bool last = chunk == remaining;
+
+        const std::size_t head = out_.size();
+        out_.resize(head + 9);
+        const std::size_t from_data = std::min(chunk, s.body.data.size() - s.data_off);
+        out_.append(s.body.data, s.data_off, from_data);
+        s.data_off += from_data;
+        if (const std::size_t from_file = chunk - from_data; from_file > 0) {
+            const std::size_t at = out_.size();
+            out_.resize(at + from_file);
+            if (!read_fully(s.body.file->fd(), out_.data() + at, from_file, s.body.offset)) {
+                out_.resize(head);
+                stream_error_(id, ErrorCode::InternalError);
+                continue;
+            }
+            s.body.offset += from_file;
+            s.body.length -= from_file;
+        }
+        write_head(out_.data() + head, chunk, static_cast<std::uint8_t>(FrameType::Data),
+                   last ? kEndStream : 0, id);
+
+        s.send_window -= static_cast<std::int64_t>(chunk);
+        conn_send_window_ -= static_cast<std::int64_t>(chunk);
+        if (last) {
+            finish_stream_(id);
+        } else {
+            sending_.push_back(id);
+        }
+    }
+}
+
+bool Session::can_pump() const noexcept {
+    if (conn_send_window_ <= 0) return false;
+    for (std::uint32_t id : sending_) {
+        auto it = streams_.find(id);
+        if (it != streams_.end() && it->second.send_window > 0) return true;
+    }
+    return false;
+}
+
+void Session::frame_head_(std::size_t len, FrameType type, std::uint8_t flags, std::uint32_t stream) {
+    const std::size_t at = out_.size();
+    out_.resize(at + 9);
+    write_head(out_.data() + at, len, static_cast<std::uint8_t>(type), flags, stream);
+}
+
+void Session::frame_(FrameType type, std::uint8_t flags, std::uint32_t stream, std::string_view payload) {
+    frame_head_(payload.size(), type, flags, stream);
+    out_.append(payload);
+}
+
+void Session::fail_(ErrorCode code) {
+    if (failed_) return;
+    std::string payload;
+    put32(payload, last_stream_);
+    put32(payload, static_cast<std::uint32_t>(code));
+    frame_(FrameType::GoAway, 0, 0, payload);
+    failed_ = true;
+}
+
+void Session::stream_error_(std::uint32_t stream, ErrorCode code) {
+    std::string payload;
+    put32(payload, static_cast<std::uint32_t>(code));
+    frame_(FrameType::RstStream, 0, stream, payload);
+    if (auto it = streams_.find(stream); it != streams_.end()) {
+        drop_body_(it->second);
+        streams_.erase(it);
+    }
+}
+
+void Session::reject_(std::uint32_t stream, unsigned status) {
+    std::string block;
+    encoder_.status(block, status);
+    encoder_.field(block, "content-length", "0");
+    send_headers_(stream, block, true);
+    finish_stream_(stream);
+}
+
+void Session::window_update_(std::uint32_t stream, std::uint32_t increment) {
+    std::string payload;
+    put32(payload, increment);
+    frame_(FrameType::WindowUpdate, 0, stream, payload);
+}
+
+// Received bytes that left the session reopen the connection window: in
+// batches of half the window, or at once while the peer has less than
+// half left, so it never stalls on bytes we already gave up.
+void Session::release_(std::size_t n) {
+    conn_released_ += static_cast<std::uint32_t>(n);
+    if (conn_released_ == 0) return;
+    if (conn_released_ >= conn_window_ / 2 || conn_recv_unacked_ >= conn_window_ / 2) {
+        window_update_(0, conn_released_);
+        conn_recv_unacked_ -= conn_released_;
+        conn_released_ = 0;
+    }
+}
+
+void Session::drop_body_(Stream& s) {
+    if (limits_.max_buffered == 0 || s.held == 0) return;
+    buffered_ -= s.held;
+    release_(s.held);
+    s.held = 0;
+}
+
+void Session::send_headers_(std::uint32_t stream, const std::string& block, bool end_stream) {
+    std::string_view rest = block;
+    std::size_t n = std::min<std::size_t>(rest.size(), peer_max_frame_);
+    frame_(FrameType::Headers,
+           static_cast<std::uint8_t>((end_stream ? kEndStream : 0) | (n == rest.size() ? kEndHeaders : 0)),
+           stream, rest.substr(0, n));
+    rest.remove_prefix(n);
+    while (!rest.empty()) {
+        n = std::min<std::size_t>(rest.size(), peer_max_frame_);
+        frame_(FrameType::Continuation, n == rest.size() ? kEndHeaders : 0, stream, rest.substr(0, n));
+        rest.remove_prefix(n);
+    }
+}
+
+// Token count per wall-clock second: enough for browsers cancelling
+// navigations, far below what a reset flood needs to matter.
+bool Session::on_peer_reset_() {
+    if (limits_.max_resets_per_second == 0) return true;
+    const auto now = std::chrono::steady_clock::now();
+    if (now - resets_since_ >= std::chrono::seconds(1)) {
+        resets_since_ = now;
+        resets_ = 0;
+    }
+    if (++resets_ <= limits_.max_resets_per_second) return true;
+    fail_(ErrorCode::EnhanceYourCalm);
+    return false;
+}
+
+void Session::finish_stream_(std::uint32_t stream) {
+    auto it = streams_.find(stream);
+    if (it == streams_.end()) return;
+    // Answered before the request ended (413, 431): tell the peer to stop
+    // sending without treating it as an error (RFC 9113 8.1).
+    if (!it->second.remote_closed) {
+        std::string payload;
+        put32(payload, static_cast<std::uint32_t>(ErrorCode::NoError));
+        frame_(FrameType::RstStream, 0, stream, payload);
+    }
+    drop_body_(it->second);
+    streams_.erase(it);
+}
+
+bool Session::on_frame_(FrameType type, std::uint8_t flags, std::uint32_t stream, std::string_view payload) {
+    if (!settings_seen_ && (type != FrameType::Settings || (flags & kAck) != 0)) {
+        fail_(ErrorCode::ProtocolError);
+        return false;
+    }
+    if (continuation_stream_ != 0 && (type != FrameType::Continuation || stream != continuation_stream_)) {
+        fail_(ErrorCode::ProtocolError);
+        return false;
+    }
+    switch (type) {
+    case FrameType::Data:
+        return on_data_(flags, stream, payload);
+    case FrameType::Headers:
+        return on_headers_(flags, stream, payload);
+    case FrameType::Continuation:
+        if (continuation_stream_ == 0) {
+            fail_(ErrorCode::ProtocolError);
+            return false;
+        }
+        block_.append(payload);
+        if (block_.size() > limits_.max_header_list + kMaxFrame) {
+            fail_(ErrorCode::EnhanceYourCalm);
+            return false;
+        }
+        if ((flags & kEndHeaders) == 0) return true;
+        continuation_stream_ = 0;
+        return on_header_block_(stream, (continuation_flags_ & kEndStream) != 0);
+    case FrameType::Priority:
+        if (stream == 0) {
+            fail_(ErrorCode::ProtocolError);
+            return false;
+        }
+        if (payload.size() != 5) stream_error_(stream, ErrorCode::FrameSizeError);
+        return true;
+    case FrameType::RstStream:
+        if (stream == 0 || stream > last_stream_) {
+            fail_(ErrorCode::ProtocolError);
+            return false;
+        }
+        if (payload.size() != 4) {
+            fail_(ErrorCode::FrameSizeError);
+            return false;
+        }
+        if (!on_peer_reset_()) return false;
+        if (auto it = streams_.find(stream); it != streams_.end()) {
+            // Cancelled by the peer; a late respond() is a no-op. A complete
+            // request is (or will be) running in a handler, so it keeps its
+            // concurrency slot until that handler answers.
+            if (it->second.remote_closed && !it->second.responded) cancelled_.insert(stream);
+            drop_body_(it->second);
+            streams_.erase(it);
+        }
+        return true;
+    case FrameType::Settings:
+        return on_settings_(flags, stream, payload);
+    case FrameType::PushPromise:
+        fail_(ErrorCode::ProtocolError);
+        return false;
+    case FrameType::Ping:
+        if (stream != 0) {
+            fail_(ErrorCode::ProtocolError);
+            return false;
+        }
+        if (payload.size() != 8) {
+            fail_(ErrorCode::FrameSizeError);
+            return false;
+        }
+        if ((flags & kAck) == 0) frame_(FrameType::Ping, kAck, 0, payload);
+        return true;
+    case FrameType::GoAway:
+        if (stream != 0) {
+            fail_(ErrorCode::ProtocolError);
+            return false;
+        }
+        peer_goaway_ = true;
+        return true;
+    case FrameType::WindowUpdate:
+        return on_window_update_(stream, payload);
+    }
+    return true; // unknown frame types are ignored
+}
+
+bool Session::on_headers_(std::uint8_t flags, std::uint32_t stream, std::string_view payload) {
+    if (stream == 0 || stream % 2 == 0) {
+        fail_(ErrorCode::ProtocolError);
+        return false;
+    }
+    std::size_t pad = 0;
+    if ((flags & kPadded) != 0) {
+        if (payload.empty()) {
+            fail_(ErrorCode::ProtocolError);
+            return false;
+        }
+        pad = static_cast<unsigned char>(payload[0]);
+        payload.remove_prefix(1);
+    }
+    if ((flags & kPriority) != 0) {
+        if (payload.size() < 5) {
+            fail_(ErrorCode::ProtocolError);
+            return false;
+        }
+        payload.remove_prefix(5);
+    }
+    if (pad > payload.size()) {
+        fail_(ErrorCode::ProtocolError);
+        return false;
+    }
+    payload.remove_suffix(pad);
+    block_.assign(payload);
+    if ((flags & kEndHeaders) == 0) {
+        continuation_stream_ = stream;
+        continuation_flags_ = flags;
+        return true;
+    }
+    return on_header_block_(stream, (flags & kEndStream) != 0);
+}
+
+bool Session::on_header_block_(std::uint32_t stream, bool end_stream) {
+    auto it = streams_.find(stream);
+    if (it != streams_.end() || stream <= last_stream_) {
+        // Trailers, or a block for a stream we already closed: decode to
+        // keep the HPACK state in step and drop the fields.
+        bool pseudo = false;
+        if (!decoder_.decode(block_, [&](std::string_view n, std::string_view) {
+                pseudo = pseudo || (!n.empty() && n[0] == ':');
+                return true;
+            })) {
+            fail_(ErrorCode::CompressionError);
+            return false;
+        }
+        if (it == streams_.end()) return true;
+        if (it->second.remote_closed) {
+            stream_error_(stream, ErrorCode::StreamClosed);
+        } else if (!end_stream || pseudo) {
+            stream_error_(stream, ErrorCode::ProtocolError);
+        } else {
+            on_request_complete_(stream, it->second);
+        }
+        return true;
+    }
+
+    last_stream_ = stream;
+    const bool refused = streams_.size() + cancelled_.size() >= limits_.max_concurrent_streams;
+    Stream s;
+    s.req.stream = stream;
+    s.send_window = peer_initial_window_;
+    s.remote_closed = end_stream;
+    std::string cookie;
+    bool regular_seen = false;
+    bool too_big = false;
+    const bool decoded = decoder_.decode(block_, [&](std::string_view n, std::string_view v) {
+        s.header_bytes += n.size() + v.size() + hpack::kEntryOverhead;
+        if (s.header_bytes > limits_.max_header_list) too_big = true;
+        if (refused || too_big || s.malformed) return true;
+        if (!valid_value(v)) {
+            s.malformed = true;
+        } else if (!n.empty() && n[0] == ':') {
+            std::string* slot = nullptr;
+            if (n == ":method") slot = &s.req.method;
+            else if (n == ":scheme") slot = &s.req.scheme;
+            else if (n == ":authority") slot = &s.req.authority;
+            else if (n == ":path") slot = &s.req.path;
+            if (slot == nullptr || regular_seen || !slot->empty() || v.empty()) s.malformed = true;
+            else slot->assign(v);
+        } else {
+            regular_seen = true;
+            if (!valid_name(n) || connection_specific(n) || (n == "te" && v != "trailers")) {
+                s.malformed = true;
+            } else if (n == "cookie") {
+                // Cookie crumbs are split across fields in HTTP/2 (RFC 9113 8.2.3).
+                if (!cookie.empty()) cookie += "; ";
+                cookie.append(v);
+            } else {
+                if (n == "content-length") {
+                    std::int64_t cl = 0;
+                    for (char c : v) {
+                        if (c < '0' || c > '9' || cl > (INT64_MAX - 9) / 10) {
+                            s.malformed = true;
+                            break;
+                        }
+                        cl = cl * 10 + (c - '0');
+                    }
+                    if (v.empty() || (s.content_length >= 0 && s.content_length != cl)) s.malformed = true;
+                    s.content_length = cl;
+                }
+                s.req.fields.emplace_back(n, v);
+            }
+        }
+        return true;
+    });
+    if (!decoded) {
+        fail_(ErrorCode::CompressionError);
+        return false;
+    }
+    if (refused) {
+        std::string payload;
+        put32(payload, static_cast<std::uint32_t>(ErrorCode::RefusedStream));
+        frame_(FrameType::RstStream, 0, stream, payload);
+        return true;
+    }
+    const bool is_connect = s.req.method == "CONNECT";
+    if (s.req.method.empty() || (!is_connect && (s.req.scheme.empty() || s.req.path.empty())) ||
+        (is_connect && s.req.authority.empty()))
+        s.malformed = true;
+    if (!cookie.empty()) s.req.fields.emplace_back("cookie", std::move(cookie));
+
+    Stream& ref = streams_.emplace(stream, std::move(s)).first->second;
+    if (too_big) {
+        reject_(stream, 431);
+    } else if (ref.malformed) {
+        stream_error_(stream, ErrorCode::ProtocolError);
+    } else if (end_stream) {
+        on_request_complete_(stream, ref);
+    }
+    return true;
+}
+
+bool Session::on_data_(std::uint8_t flags, std::uint32_t stream, std::string_view payload) {
+    if (stream == 0) {
+        fail_(ErrorCode::ProtocolError);
+        return false;
+    }
+    // The whole frame, padding included, counts against both windows.
+    const auto flow = static_cast<std::uint32_t>(payload.size());
+    if (conn_recv_unacked_ + flow > conn_window_) {
+        fail_(ErrorCode::FlowControlError);
+        return false;
+    }
+    conn_recv_unacked_ += flow;
+    // Without max_buffered the bytes leave the session on arrival. With
+    // it, only what is not kept as body (padding, frames for streams that
+    // are gone or refused); kept bytes are released when handed off.
+    const bool hold = limits_.max_buffered != 0;
+    if (!hold) release_(flow);
+    if ((flags & kPadded) != 0) {
+        if (payload.empty() || static_cast<unsigned char>(payload[0]) >= payload.size()) {
+            fail_(ErrorCode::ProtocolError);
+            return false;
+        }
+        const std::size_t pad = static_cast<unsigned char>(payload[0]);
+        payload.remove_prefix(1);
+        payload.remove_suffix(pad);
+    }
+    if (hold) release_(flow - payload.size());
+
+    auto it = streams_.find(stream);
+    if (it == streams_.end()) {
+        if (stream > last_stream_) {
+            fail_(ErrorCode::ProtocolError);
+            return false;
+        }
+        if (hold) release_(payload.size());
+        return true; // a stream we reset or rejected; the peer may not know yet
+    }
+    Stream& s = it->second;
+    if (s.remote_closed) {
+        if (hold) release_(payload.size());
+        stream_error_(stream, ErrorCode::StreamClosed);
+        return true;
+    }
+    if (s.recv_unacked + flow > limits_.initial_window) {
+        fail_(ErrorCode::FlowControlError);
+        return false;
+    }
+    s.recv_unacked += flow;
+    if (limits_.max_body != 0 && s.req.body.size() + payload.size() > limits_.max_body) {
+        if (hold) release_(payload.size());
+        reject_(stream, 413);
+        return true;
+    }
+    s.req.body.append(payload);
+    if (hold) {
+        s.held += payload.size();
+        buffered_ += payload.size();
+        // Unfinished bodies hold the whole connection window and nothing
+        // is waiting to be handed off: nothing would reopen it, so give up
+        // this stream (the peer may retry it).
+        if (buffered_ >= conn_window_ && ready_.empty()) {
+            stream_error_(stream, ErrorCode::RefusedStream);
+            return true;
+        }
+    }
+    if ((flags & kEndStream) != 0) {
+        s.remote_closed = true;
+        on_request_complete_(stream, s);
+    } else if (s.recv_unacked >= limits_.initial_window / 2) {
+        window_update_(stream, s.recv_unacked);
+        s.recv_unacked = 0;
+    }
+    return true;
+}
+
+bool Session::on_settings_(std::uint8_t flags, std::uint32_t stream, std::string_view payload) {
+    if (stream != 0) {
+        fail_(ErrorCode::ProtocolError);
+        return false;
+    }
+    if ((flags & kAck) != 0) {
+        if (!payload.empty()) {
+            fail_(ErrorCode::FrameSizeError);
+            return false;
+        }
+        return true;
+    }
+    if (payload.size() % 6 != 0) {
+        fail_(ErrorCode::FrameSizeError);
+        return false;
+    }
+    settings_seen_ = true;
+    for (std::size_t i = 0; i < payload.size(); i += 6) {
+        const auto id = static_cast<std::uint16_t>((static_cast<unsigned char>(payload[i]) << 8) |
+                                                   static_cast<unsigned char>(payload[i + 1]));
+        const std::uint32_t v = be32(payload.data() + i + 2);
+        switch (id) {
+        case kSettingsHeaderTableSize:
+            encoder_.set_max_table_size(v);
+            break;
+        case kSettingsEnablePush:
+            if (v > 1) {
+                fail_(ErrorCode::ProtocolError);
+                return false;
+            }
+            break;
+        case kSettingsInitialWindowSize: {
+            if (v > kMaxWindow) {
+                fail_(ErrorCode::FlowControlError);
+                return false;
+            }
+            const std::int64_t delta = static_cast<std::int64_t>(v) - peer_initial_window_;
+            for (auto& [id_, s] : streams_) {
+                s.send_window += delta;
+                if (s.send_window > kMaxWindow) {
+                    fail_(ErrorCode::FlowControlError);
+                    return false;
+                }
+            }
+            peer_initial_window_ = v;
+            break;
+        }
+        case kSettingsMaxFrameSize:
+            if (v < 16384 || v > 16777215) {
+                fail_(ErrorCode::ProtocolError);
+                return false;
+            }
+            peer_max_frame_ = v;
+            break;
+        default:
+            break; // MAX_CONCURRENT_STREAMS (we never push), MAX_HEADER_LIST_SIZE, unknown
+        }
+    }
+    frame_(FrameType::Settings, kAck, 0, {});
+    return true;
+}
+
+bool Session::on_window_update_(std::uint32_t stream, std::string_view payload) {
+    if (payload.size() != 4) {
+        fail_(ErrorCode::FrameSizeError);
+        return false;
+    }
+    const std::uint32_t inc = be32(payload.data()) & 0x7fffffff;
+    if (stream == 0) {
+        conn_send_window_ += inc;
+        if (inc == 0 || conn_send_window_ > kMaxWindow) {
+            fail_(inc == 0 ? ErrorCode::ProtocolError : ErrorCode::FlowControlError);
+            return false;
+        }
+        return true;
+    }
+    auto it = streams_.find(stream);
+    if (it == streams_.end()) {
+        if (stream > last_stream_) {
+            fail_(ErrorCode::ProtocolError);
+            return false;
+        }
+        return true;
+    }
+    if (inc == 0) {
+        stream_error_(stream, ErrorCode::ProtocolError);
+        return true;
+    }
+    it->second.send_window += inc;
+    if (it->second.send_window > kMaxWindow) stream_error_(stream, ErrorCode::FlowControlError);
+    return true;
+}
+
+void Session::on_request_complete_(std::uint32_t stream, Stream& s) {
+    s.remote_closed = true;
+    if (s.content_length >= 0 && static_cast<std::uint64_t>(s.content_length) != s.req.body.size()) {
+        stream_error_(stream, ErrorCode::ProtocolError);
+        return;
+    }
+    s.held = 0; // counted until next_request() hands it off
+    ready_.push_back(std::move(s.req));
+}
+
+} // namespace socketify::detail::h2
@@ -4,8 +4,10 @@
  */
 
 #include "socketify/detail/http_parser.h"
+#include "socketify/detail/http_scan.h"
 
 #include <algorithm>
+#include <cerrno>
 #include <cstdlib>
 #include <cstring>
 
@@ -33,7 +35,15 @@ HttpParser::HttpParser() = default;
 
 void HttpParser::reset() {
   state_ = ParseState::StartLine;
+  zero_copy_ = want_zero_copy_;
   line_buf_.clear();
+  base_ = nullptr;
+  msg_bytes_ = 0;
+  line_open_ = false;
+  line_start_ = 0;
+  target_span_ = path_span_ = query_span_ = version_span_ = Span{};
+  fields_.clear();
+  body_off_ = 0;
   method_ = Method::UNKNOWN;
   target_.clear();
   path_.clear();
@@ -49,6 +59,10 @@ void HttpParser::reset() {
   err_msg_.clear();
   err_status_ = Status::BadRequest;
   header_bytes_ = 0;
+  body_limit_ = max_body_bytes_;
+  sink_ = nullptr;
+  hold_ = false;
+  spool_.close();
 }
 
 // --------- public consume ----------
@@ -57,9 +71,13 @@ std::size_t HttpParser::consume(const char *data, std::size_t len) {
       state_ == ParseState::Complete)
     return 0;
 
+  if (zero_copy_)
+    base_ = data - msg_bytes_;
+  hold_ = false;
   std::size_t consumed = 0;
   while (consumed < len && state_ != ParseState::Error &&
          state_ != ParseState::Complete) {
+    const ParseState before = state_;
     std::size_t n = 0;
     switch (state_) {
     case ParseState::StartLine:
@@ -88,191 +106,372 @@ std::size_t HttpParser::consume(const char *data, std::size_t len) {
       break;
     }
     consumed += n;
-    if (n == 0)
-      break; // need more data
+    if (keeps_(before))
+      msg_bytes_ += n;
+    if (n == 0 || hold_)
+      break; // need more data, or the sink asked for a pause
+    if (stop_after_headers_ && before == ParseState::Headers && headers_done())
+      break;
   }
   return consumed;
 }
 
+// --------- body routing ----------
+void HttpParser::set_body_limit(std::size_t max_body_bytes) {
+  body_limit_ = max_body_bytes;
+  if (!body_limit_ || !headers_done() || state_ == ParseState::Complete)
+    return;
+  if (content_length_ > body_limit_ || body_received_ > body_limit_)
+    fail_("Body too large", Status::PayloadTooLarge);
+}
+
+void HttpParser::set_body_sink(BodySink sink) {
+  sink_ = std::move(sink);
+  spool_.close();
+  if (zero_copy_ && sink_) {
+    // Nothing of this message is borrowed any more.
+    msg_bytes_ = 0;
+    target_span_ = path_span_ = query_span_ = version_span_ = Span{};
+    fields_.clear();
+  }
+}
+
+bool HttpParser::spool_open_() {
+  if (!spool_.open_temp(spool_dir_)) {
+    fail_("Cannot create body spool file", Status::InternalServerError);
+    return false;
+  }
+  if (!body_storage_.empty()) {
+    if (!spool_.append(body_storage_.data(), body_storage_.size())) {
+      fail_("Cannot write body spool file", Status::InternalServerError);
+      return false;
+    }
+    std::string().swap(body_storage_);
+  }
+  return true;
+}
+
+// Body bytes that are not borrowed: to the sink, the spool file or memory.
+bool HttpParser::take_body_bytes_(const char *p, std::size_t n) {
+  if (sink_) {
+    if (!sink_(std::string_view(p, n)))
+      hold_ = true;
+    return true;
+  }
+  if (!spool_.valid() && spool_threshold_ && chunked_ &&
+      body_storage_.size() + n > spool_threshold_ && !spool_open_())
+    return false;
+  if (spool_.valid()) {
+    if (!spool_.append(p, n)) {
+      fail_("Cannot write body spool file", Status::InternalServerError);
+      return false;
+    }
+    return true;
+  }
+  body_storage_.append(p, n);
+  return true;
+}
+
+// --------- header lookups ----------
+std::string_view HttpParser::header(std::string_view name) const {
+  const HeaderId id = header_id(name);
+  if (id != HeaderId::Unknown)
+    return header(id);
+  if (!zero_copy_)
+    return headers_.get(name);
+  for (const FieldSpan &f : fields_)
+    if (f.id == HeaderId::Unknown && iequal_ascii_(at_(f.name), name))
+      return at_(f.value);
+  return {};
+}
+
+std::string_view HttpParser::header(HeaderId id) const noexcept {
+  if (!zero_copy_)
+    return headers_.get(id);
+  for (const FieldSpan &f : fields_)
+    if (f.id == id)
+      return at_(f.value);
+  return {};
+}
+
+// Repeated fields joined with ", ", as the copying mode stores them.
+bool HttpParser::joined_header_(HeaderId id, std::string &out) const {
+  out.clear();
+  if (!zero_copy_) {
+    if (!headers_.contains(id))
+      return false;
+    out = headers_.get(id);
+    return true;
+  }
+  bool found = false;
+  for (const FieldSpan &f : fields_) {
+    if (f.id != id)
+      continue;
+    if (found)
+      out.append(", ");
+    out.append(at_(f.value));
+    found = true;
+  }
+  return found;
+}
+
+// --------- header-section lines ----------
+// Every line of the start-line + header section is located with the
+// vectorized newline scan and charged to the header limit in one step. A
+// complete line is parsed in place from the caller's bytes; a line split
+// across reads is gathered in line_buf_, or, in zero-copy mode, found again
+// at line_start_ in the input the caller keeps.
+std::size_t HttpParser::take_header_line_(const char *data, std::size_t len,
+                                          std::string_view &line, bool &got) {
+  got = false;
+  const char *end = data + len;
+  const char *nl = find_newline(data, end);
+  const std::size_t n =
+      static_cast<std::size_t>(nl - data) + (nl != end ? 1 : 0);
+  if (!grow_header_bytes_(n))
+    return n;
+  if (zero_copy_) {
+    if (!line_open_)
+      line_start_ = static_cast<std::size_t>(data - base_);
+    line_open_ = nl == end;
+    if (line_open_)
+      return n;
+    line = std::string_view(base_ + line_start_,
+                            static_cast<std::size_t>(nl - (base_ + line_start_)));
+    if (!line.empty() && line.back() == '\r')
+      line.remove_suffix(1);
+    got = true;
+    return n;
+  }
+  if (nl == end) {
+    line_buf_.append(data, n);
+    return n;
+  }
+  line = std::string_view(data, n - 1);
+  if (!line_buf_.empty()) {
+    line_buf_.append(line);
+    line = line_buf_;
+  }
+  if (!line.empty() && line.back() == '\r')
+    line.remove_suffix(1);
+  got = true;
+  return n;
+}
+
 // --------- parse start line: METHOD SP TARGET SP VERSION CRLF ----------
 std::size_t HttpParser::parse_start_line_(const char *data, std::size_t len) {
   std::size_t i = 0;
-  for (; i < len; ++i) {
-    char c = data[i];
-    if (!grow_header_bytes_(1))
-      return i + 1;
-    if (c == '\n') {
-      std::string line = std::move(line_buf_);
+  while (i < len) {
+    std::string_view line;
+    bool got = false;
+    i += take_header_line_(data + i, len - i, line, got);
+    if (!got)
+      return i;
+
+    // Tolerate leading empty line(s) between pipelined requests.
+    if (line.empty()) {
       line_buf_.clear();
-      if (!line.empty() && line.back() == '\r')
-        line.pop_back();
-
-      // Tolerate leading empty line(s) between pipelined requests.
-      if (line.empty())
-        continue;
-
-      size_t p1 = line.find(' ');
-      size_t p2 = (p1 == std::string::npos) ? std::string::npos
-                                            : line.find(' ', p1 + 1);
-      if (p1 == std::string::npos || p2 == std::string::npos) {
-        fail_("Malformed start-line", Status::BadRequest);
-        return i + 1;
-      }
+      continue;
+    }
+    start_line_(line);
+    line_buf_.clear();
+    return i;
+  }
+  return i;
+}
 
-      std::string_view m = std::string_view(line).substr(0, p1);
-      std::string_view rt = std::string_view(line).substr(p1 + 1, p2 - (p1 + 1));
-      std::string_view ver = std::string_view(line).substr(p2 + 1);
+void HttpParser::start_line_(std::string_view line) {
+  size_t p1 = line.find(' ');
+  size_t p2 = (p1 == std::string_view::npos) ? std::string_view::npos
+                                             : line.find(' ', p1 + 1);
+  if (p1 == std::string_view::npos || p2 == std::string_view::npos) {
+    fail_("Malformed start-line", Status::BadRequest);
+    return;
+  }
 
-      method_ = method_from_string(m);
-      if (method_ == Method::UNKNOWN) {
-        fail_("Unknown HTTP method", Status::NotImplemented);
-        return i + 1;
-      }
-      if (rt.empty()) {
-        fail_("Empty request-target", Status::BadRequest);
-        return i + 1;
-      }
-      if (!(ver == "HTTP/1.1" || ver == "HTTP/1.0")) {
-        fail_("Unsupported HTTP version", static_cast<Status>(505));
-        return i + 1;
-      }
+  std::string_view m = line.substr(0, p1);
+  std::string_view rt = line.substr(p1 + 1, p2 - (p1 + 1));
+  std::string_view ver = line.substr(p2 + 1);
 
-      version_.assign(ver.begin(), ver.end());
-      target_.assign(rt.begin(), rt.end());
+  method_ = method_from_string(m);
+  if (method_ == Method::UNKNOWN) {
+    fail_("Unknown HTTP method", Status::NotImplemented);
+    return;
+  }
+  if (rt.empty()) {
+    fail_("Empty request-target", Status::BadRequest);
+    return;
+  }
+  if (!(ver == "HTTP/1.1" || ver == "HTTP/1.0")) {
+    fail_("Unsupported HTTP version", static_cast<Status>(505));
+    return;
+  }
 
-      size_t qpos = target_.find('?');
-      if (qpos == std::string::npos) {
-        path_ = target_;
-        query_.clear();
-      } else {
-        path_.assign(target_.data(), qpos);
-        query_.assign(target_.data() + qpos + 1, target_.size() - qpos - 1);
-      }
+  if (zero_copy_) {
+    version_span_ = span_(ver.data(), ver.size());
+    target_span_ = span_(rt.data(), rt.size());
+    const size_t q = rt.find('?');
+    path_span_ = span_(rt.data(), q == std::string_view::npos ? rt.size() : q);
+    if (q != std::string_view::npos)
+      query_span_ = span_(rt.data() + q + 1, rt.size() - q - 1);
+    state_ = ParseState::Headers;
+    return;
+  }
 
-      state_ = ParseState::Headers;
-      return i + 1;
-    }
-    line_buf_.push_back(c);
+  version_.assign(ver.begin(), ver.end());
+  target_.assign(rt.begin(), rt.end());
+
+  size_t qpos = target_.find('?');
+  if (qpos == std::string::npos) {
+    path_ = target_;
+    query_.clear();
+  } else {
+    path_.assign(target_.data(), qpos);
+    query_.assign(target_.data() + qpos + 1, target_.size() - qpos - 1);
   }
-  return i;
+
+  state_ = ParseState::Headers;
 }
 
 // --------- parse headers until blank line ----------
 std::size_t HttpParser::parse_headers_(const char *data, std::size_t len) {
   std::size_t i = 0;
   while (i < len) {
-    char c = data[i++];
-    if (!grow_header_bytes_(1))
+    std::string_view line;
+    bool got = false;
+    i += take_header_line_(data + i, len - i, line, got);
+    if (!got)
       return i;
-    if (c != '\n') {
-      line_buf_.push_back(c);
-      continue;
-    }
 
-    std::string line = std::move(line_buf_);
+    if (line.empty()) {
+      line_buf_.clear();
+      end_headers_();
+      return i;
+    }
+    const bool ok = header_line_(line);
     line_buf_.clear();
-    if (!line.empty() && line.back() == '\r')
-      line.pop_back();
+    if (!ok)
+      return i;
+  }
+  return i;
+}
 
-    if (!line.empty()) {
-      size_t colon = line.find(':');
-      if (colon == std::string::npos) {
-        fail_("Header missing ':'", Status::BadRequest);
-        return i;
-      }
-      size_t key_end = colon;
-      while (key_end > 0 && (line[key_end - 1] == ' ' || line[key_end - 1] == '\t'))
-        --key_end;
-      std::string key = line.substr(0, key_end);
-
-      size_t value_start = colon + 1;
-      while (value_start < line.size() &&
-             (line[value_start] == ' ' || line[value_start] == '\t'))
-        ++value_start;
-      size_t value_end = line.size();
-      while (value_end > value_start &&
-             (line[value_end - 1] == ' ' || line[value_end - 1] == '\t'))
-        --value_end;
-      std::string value = line.substr(value_start, value_end - value_start);
-
-      if (key.empty()) {
-        fail_("Empty header name", Status::BadRequest);
-        return i;
-      }
+bool HttpParser::header_line_(std::string_view line) {
+  const char *b = line.data();
+  const char *e = b + line.size();
+
+  // field-name is a token followed directly by ':'. Whitespace in between
+  // must be rejected (RFC 9112 §5.1): proxies disagree on what it means.
+  const char *name_end = find_non_token(b, e);
+  const char *p = name_end;
+  if (p == e || *p != ':') {
+    while (p < e && (*p == ' ' || *p == '\t'))
+      ++p;
+    if (line.find(':') == std::string_view::npos)
+      fail_("Header missing ':'", Status::BadRequest);
+    else if (p != name_end && p < e && *p == ':')
+      fail_("Whitespace before ':'", Status::BadRequest);
+    else
+      fail_("Invalid header name", Status::BadRequest);
+    return false;
+  }
+  if (name_end == b) {
+    fail_("Empty header name", Status::BadRequest);
+    return false;
+  }
 
-      // Repeated headers are joined with ", " (RFC 7230 §3.2.2).
-      auto it = headers_.find(key);
-      if (it != headers_.end()) {
-        it->second.append(", ").append(value);
-      } else {
-        headers_.emplace(std::move(key), std::move(value));
-      }
-      continue;
-    }
+  const char *vb = p + 1;
+  while (vb < e && (*vb == ' ' || *vb == '\t'))
+    ++vb;
+  const char *ve = e;
+  while (ve > vb && (ve[-1] == ' ' || ve[-1] == '\t'))
+    --ve;
+  if (find_invalid_value(vb, ve) != ve) {
+    fail_("Invalid header value", Status::BadRequest);
+    return false;
+  }
+  std::string_view value(vb, static_cast<std::size_t>(ve - vb));
+  std::string_view name(b, static_cast<std::size_t>(name_end - b));
+  const HeaderId id = header_id(name);
 
-    // ---- End of headers ----
-    auto te = headers_.find("Transfer-Encoding");
-    if (te != headers_.end()) {
-      std::string low = te->second;
-      for (auto &ch : low)
-        ch = ascii_lower_(ch);
-      if (low.find("chunked") != std::string::npos) {
-        chunked_ = true;
-      } else {
-        fail_("Unsupported Transfer-Encoding", Status::NotImplemented);
-        return i;
-      }
-    }
+  if (zero_copy_) {
+    fields_.push_back({span_(b, name.size()), span_(vb, value.size()), id});
+    return true;
+  }
 
-    auto cl = headers_.find("Content-Length");
-    if (cl != headers_.end()) {
-      if (chunked_) {
-        // Reject smuggling-prone combination (RFC 7230 §3.3.3).
-        fail_("Both Content-Length and chunked", Status::BadRequest);
-        return i;
-      }
-      const std::string &s = cl->second;
-      char *endp = nullptr;
-      errno = 0;
-      long long v = std::strtoll(s.c_str(), &endp, 10);
-      if (endp == s.c_str() || *endp != '\0' || v < 0 || errno == ERANGE) {
-        fail_("Invalid Content-Length", Status::BadRequest);
-        return i;
-      }
-      content_length_ = static_cast<std::size_t>(v);
-      if (max_body_bytes_ && content_length_ > max_body_bytes_) {
-        fail_("Body too large", Status::PayloadTooLarge);
-        return i;
-      }
+  // Repeated headers are joined with ", " (RFC 9110 §5.3).
+  headers_.add_copy(id, name, value);
+  return true;
+}
+
+void HttpParser::end_headers_() {
+  std::string low;
+  if (joined_header_(HeaderId::TransferEncoding, low)) {
+    for (auto &ch : low)
+      ch = ascii_lower_(ch);
+    if (low.find("chunked") != std::string::npos) {
+      chunked_ = true;
+    } else {
+      fail_("Unsupported Transfer-Encoding", Status::NotImplemented);
+      return;
     }
+  }
 
+  std::string s;
+  if (joined_header_(HeaderId::ContentLength, s)) {
     if (chunked_) {
-      state_ = ParseState::ChunkSize;
-      return i;
+      // Reject smuggling-prone combination (RFC 7230 §3.3.3).
+      fail_("Both Content-Length and chunked", Status::BadRequest);
+      return;
+    }
+    char *endp = nullptr;
+    errno = 0;
+    long long v = std::strtoll(s.c_str(), &endp, 10);
+    if (endp == s.c_str() || *endp != '\0' || v < 0 || errno == ERANGE) {
+      fail_("Invalid Content-Length", Status::BadRequest);
+      return;
+    }
+    content_length_ = static_cast<std::size_t>(v);
+    if (body_limit_ && content_length_ > body_limit_) {
+      fail_("Body too large", Status::PayloadTooLarge);
+      return;
     }
-    if (content_length_ > 0) {
+  }
+
+  if (chunked_) {
+    state_ = ParseState::ChunkSize;
+    return;
+  }
+  if (content_length_ > 0) {
+    if (spool_threshold_ && content_length_ > spool_threshold_) {
+      if (!spool_open_())
+        return;
+    } else if (!zero_copy_) {
       body_storage_.reserve(content_length_);
-      state_ = ParseState::Body;
-      return i;
     }
-    body_ = std::string_view(body_storage_.data(), body_storage_.size());
-    state_ = ParseState::Complete;
-    return i;
+    state_ = ParseState::Body;
+    return;
   }
-  return i;
+  body_ = std::string_view(body_storage_.data(), body_storage_.size());
+  state_ = ParseState::Complete;
 }
 
 // --------- fixed Content-Length body ----------
 std::size_t HttpParser::parse_body_(const char *data, std::size_t len) {
   const std::size_t need = content_length_ - body_received_;
   const std::size_t take = (len < need) ? len : need;
+  const bool borrow = body_borrowed();
 
-  if (take > 0) {
-    body_storage_.append(data, take);
-    body_received_ += take;
+  if (borrow) {
+    if (body_received_ == 0)
+      body_off_ = static_cast<std::size_t>(data - base_);
+  } else if (take > 0 && !take_body_bytes_(data, take)) {
+    return take;
   }
+  body_received_ += take;
   if (body_received_ == content_length_) {
-    body_ = std::string_view(body_storage_.data(), body_storage_.size());
+    body_ = borrow ? std::string_view(base_ + body_off_, content_length_)
+                   : std::string_view(body_storage_.data(), body_storage_.size());
     state_ = ParseState::Complete;
   }
   return take;
@@ -326,8 +525,10 @@ std::size_t HttpParser::parse_chunk_size_(const char *data, std::size_t len) {
 std::size_t HttpParser::parse_chunk_data_(const char *data, std::size_t len) {
   const std::size_t take = (len < chunk_remaining_) ? len : chunk_remaining_;
   if (take > 0) {
-    body_storage_.append(data, take);
+    if (!take_body_bytes_(data, take))
+      return take;
     chunk_remaining_ -= take;
+    body_received_ += take;
   }
   if (chunk_remaining_ == 0)
     state_ = ParseState::ChunkDataEnd;
@@ -370,7 +571,7 @@ std::size_t HttpParser::parse_chunk_trailer_(const char *data, std::size_t len)
       line.pop_back();
     if (line.empty()) {
       // End of trailers -> message complete.
-      content_length_ = body_storage_.size();
+      content_length_ = body_received_;
       body_ = std::string_view(body_storage_.data(), body_storage_.size());
       state_ = ParseState::Complete;
       return i;
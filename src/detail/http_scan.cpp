@@ -0,0 +1,293 @@
+/**
+ * @file http_scan.cpp
+ * @brief Scalar, SSE4.2 and AVX2 scanners and their runtime dispatch.
+ */
+
+#include "socketify/detail/http_scan.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SOCKETIFY_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace socketify::detail {
+
+namespace {
+
+using ScanFn = const char* (*)(const char*, const char*) noexcept;
+using SearchFn = const char* (*)(const char*, const char*, const char*, std::size_t) noexcept;
+
+constexpr bool is_tchar(unsigned char c) noexcept {
+    if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) return true;
+    switch (c) {
+    case '!': case '#': case '$': case '%': case '&': case '\'': case '*': case '+':
+    case '-': case '.': case '^': case '_': case '`': case '|': case '~':
+        return true;
+    default:
+        return false;
+    }
+}
+
+struct TokenTable {
+    bool ok[256]{};
+    constexpr TokenTable() {
+        for (int c = 0; c < 256; ++c) ok[c] = is_tchar(static_cast<unsigned char>(c));
+    }
+};
+constexpr TokenTable kToken{};
+
+inline bool token_byte(char c) noexcept { return kToken.ok[static_cast<unsigned char>(c)]; }
+
+inline bool invalid_value_byte(char c) noexcept {
+    const auto u = static_cast<unsigned char>(c);
+    return (u < 0x20 && u != '\t') || u == 0x7f;
+}
+
+// ---- scalar ----
+
+const char* newline_scalar(const char* p, const char* end) noexcept {
+    const void* q = std::memchr(p, '\n', static_cast<std::size_t>(end - p));
+    return q ? static_cast<const char*>(q) : end;
+}
+
+const char* non_token_scalar(const char* p, const char* end) noexcept {
+    while (p < end && token_byte(*p)) ++p;
+    return p;
+}
+
+const char* invalid_value_scalar(const char* p, const char* end) noexcept {
+    while (p < end && !invalid_value_byte(*p)) ++p;
+    return p;
+}
+
+const char* delimiter_scalar(const char* p, const char* end, const char* needle,
+                             std::size_t n) noexcept {
+    const char* last = end - n; // last possible start
+    while (p <= last) {
+        const void* q = std::memchr(p, needle[0], static_cast<std::size_t>(last - p) + 1);
+        if (!q) return end;
+        p = static_cast<const char*>(q);
+        if (std::memcmp(p + 1, needle + 1, n - 1) == 0) return p;
+        ++p;
+    }
+    return end;
+}
+
+#ifdef SOCKETIFY_SCAN_X86
+
+// ---- SSE4.2 ----
+
+// Byte ranges that can not appear in a token. PCMPESTRI takes at most eight
+// ranges, so the last one ("{".."\xff") also covers '|' and '~'; hits there
+// are confirmed against the table.
+alignas(16) constexpr char kNonTokenRanges[16] = {
+    '\x00', ' ', '"', '"', '(', ')', ',', ',', '/', '/', ':', '@', '[', ']', '{', '\xff'};
+
+// CTLs except HTAB, and DEL.
+alignas(16) constexpr char kInvalidValueRanges[16] = {
+    '\x00', '\x08', '\x0a', '\x1f', '\x7f', '\x7f'};
+
+constexpr int kRangeMode = _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT;
+
+inline const __m128i* as_m128(const char* p) noexcept { return reinterpret_cast<const __m128i*>(p); }
+
+__attribute__((target("sse4.2")))
+const char* newline_sse42(const char* p, const char* end) noexcept {
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16) {
+        const auto m = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(as_m128(p)), nl)));
+        if (m) return p + __builtin_ctz(m);
+    }
+    while (p < end && *p != '\n') ++p;
+    return p;
+}
+
+__attribute__((target("sse4.2")))
+const char* non_token_sse42(const char* p, const char* end) noexcept {
+    const __m128i ranges = _mm_load_si128(as_m128(kNonTokenRanges));
+    while (end - p >= 16) {
+        const int idx = _mm_cmpestri(ranges, 16, _mm_loadu_si128(as_m128(p)), 16, kRangeMode);
+        if (idx == 16) {
+            p += 16;
+            continue;
+        }
+        p += idx;
+        if (!token_byte(*p)) return p;
+        ++p;
+    }
+    return non_token_scalar(p, end);
+}
+
+__attribute__((target("sse4.2")))
+const char* invalid_value_sse42(const char* p, const char* end) noexcept {
+    const __m128i ranges = _mm_load_si128(as_m128(kInvalidValueRanges));
+    for (; end - p >= 16; p += 16) {
+        const int idx = _mm_cmpestri(ranges, 6, _mm_loadu_si128(as_m128(p)), 16, kRangeMode);
+        if (idx != 16) return p + idx;
+    }
+    return invalid_value_scalar(p, end);
+}
+
+__attribute__((target("sse4.2")))
+const char* delimiter_sse42(const char* p, const char* end, const char* needle,
+                            std::size_t n) noexcept {
+    if (static_cast<std::size_t>(end - p) < n) return end;
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[n - 1]);
+    // Block starts at p; it reads up to p + 15 + n - 1.
+    for (; static_cast<std::size_t>(end - p) >= 16 + n - 1; p += 16) {
+        const __m128i a = _mm_cmpeq_epi8(first, _mm_loadu_si128(as_m128(p)));
+        const __m128i b = _mm_cmpeq_epi8(last, _mm_loadu_si128(as_m128(p + n - 1)));
+        auto m = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(a, b)));
+        while (m) {
+            const unsigned i = static_cast<unsigned>(__builtin_ctz(m));
+            if (std::memcmp(p + i + 1, needle + 1, n - 2) == 0) return p + i;
+            m &= m - 1;
+        }
+    }
+    return delimiter_scalar(p, end, needle, n);
+}
+
+// ---- AVX2 ----
+
+inline const __m256i* as_m256(const char* p) noexcept { return reinterpret_cast<const __m256i*>(p); }
+
+__attribute__((target("avx2")))
+const char* newline_avx2(const char* p, const char* end) noexcept {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    for (; end - p >= 32; p += 32) {
+        const auto m = static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(as_m256(p)), nl)));
+        if (m) return p + __builtin_ctz(m);
+    }
+    return newline_sse42(p, end);
+}
+
+__attribute__((target("avx2")))
+const char* invalid_value_avx2(const char* p, const char* end) noexcept {
+    const __m256i ctl_max = _mm256_set1_epi8(0x1f);
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    for (; end - p >= 32; p += 32) {
+        const __m256i v = _mm256_loadu_si256(as_m256(p));
+        // Unsigned v <= 0x1f without a sign flip: max(v, 0x1f) == 0x1f.
+        const __m256i ctl = _mm256_cmpeq_epi8(_mm256_max_epu8(v, ctl_max), ctl_max);
+        const __m256i bad = _mm256_or_si256(_mm256_andnot_si256(_mm256_cmpeq_epi8(v, tab), ctl),
+                                            _mm256_cmpeq_epi8(v, del));
+        const auto m = static_cast<unsigned>(_mm256_movemask_epi8(bad));
+        if (m) return p + __builtin_ctz(m);
+    }
+    return invalid_value_sse42(p, end);
+}
+
+__attribute__((target("avx2")))
+const char* delimiter_avx2(const char* p, const char* end, const char* needle,
+                           std::size_t n) noexcept {
+    if (static_cast<std::size_t>(end - p) < n) return end;
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[n - 1]);
+    for (; static_cast<std::size_t>(end - p) >= 32 + n - 1; p += 32) {
+        const __m256i a = _mm256_cmpeq_epi8(first, _mm256_loadu_si256(as_m256(p)));
+        const __m256i b = _mm256_cmpeq_epi8(last, _mm256_loadu_si256(as_m256(p + n - 1)));
+        auto m = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(a, b)));
+        while (m) {
+            const unsigned i = static_cast<unsigned>(__builtin_ctz(m));
+            if (std::memcmp(p + i + 1, needle + 1, n - 2) == 0) return p + i;
+            m &= m - 1;
+        }
+    }
+    return delimiter_sse42(p, end, needle, n);
+}
+
+#endif // SOCKETIFY_SCAN_X86
+
+struct ScanOps {
+    ScanIsa isa;
+    ScanFn newline;
+    ScanFn non_token;
+    ScanFn invalid_value;
+    SearchFn delimiter;
+};
+
+constexpr ScanOps kScalarOps{ScanIsa::Scalar, newline_scalar, non_token_scalar, invalid_value_scalar,
+                             delimiter_scalar};
+#ifdef SOCKETIFY_SCAN_X86
+constexpr ScanOps kSse42Ops{ScanIsa::Sse42, newline_sse42, non_token_sse42, invalid_value_sse42,
+                            delimiter_sse42};
+// Header names are short; AVX2 gains nothing over PCMPESTRI for them.
+constexpr ScanOps kAvx2Ops{ScanIsa::Avx2, newline_avx2, non_token_sse42, invalid_value_avx2,
+                           delimiter_avx2};
+#endif
+
+const ScanOps* ops_for(ScanIsa isa) noexcept {
+#ifdef SOCKETIFY_SCAN_X86
+    if (isa == ScanIsa::Avx2) return &kAvx2Ops;
+    if (isa == ScanIsa::Sse42) return &kSse42Ops;
+#else
+    (void)isa;
+#endif
+    return &kScalarOps;
+}
+
+ScanIsa detect_isa() noexcept {
+#ifdef SOCKETIFY_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return ScanIsa::Avx2;
+    if (__builtin_cpu_supports("sse4.2")) return ScanIsa::Sse42;
+#endif
+    return ScanIsa::Scalar;
+}
+
+std::atomic<const ScanOps*> g_ops{nullptr};
+
+inline const ScanOps& ops() noexcept {
+    const ScanOps* o = g_ops.load(std::memory_order_relaxed);
+    if (!o) {
+        o = ops_for(best_scan_isa());
+        g_ops.store(o, std::memory_order_relaxed);
+    }
+    return *o;
+}
+
+} // namespace
+
+ScanIsa best_scan_isa() noexcept {
+    static const ScanIsa best = detect_isa();
+    return best;
+}
+
+ScanIsa scan_isa() noexcept { return ops().isa; }
+
+void set_scan_isa(ScanIsa isa) noexcept {
+    if (static_cast<int>(isa) > static_cast<int>(best_scan_isa())) isa = best_scan_isa();
+    g_ops.store(ops_for(isa), std::memory_order_relaxed);
+}
+
+const char* scan_isa_name(ScanIsa isa) noexcept {
+    switch (isa) {
+    case ScanIsa::Scalar: return "scalar";
+    case ScanIsa::Sse42: return "sse4.2";
+    case ScanIsa::Avx2: return "avx2";
+    }
+    return "?";
+}
+
+const char* find_newline(const char* p, const char* end) noexcept { return ops().newline(p, end); }
+
+const char* find_non_token(const char* p, const char* end) noexcept { return ops().non_token(p, end); }
+
+const char* find_invalid_value(const char* p, const char* end) noexcept {
+    return ops().invalid_value(p, end);
+}
+
+const char* find_delimiter(const char* p, const char* end, const char* needle,
+                           std::size_t n) noexcept {
+    return ops().delimiter(p, end, needle, n);
+}
+
+} // namespace socketify::detail
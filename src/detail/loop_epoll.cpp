@@ -1,6 +1,8 @@
 /**
  * @file loop_epoll.cpp
- * @brief epoll(7) implementation of detail::EventLoop.
+ * @brief epoll(7) implementation of detail::EventLoop (and the shared
+ *        eventfd / post() plumbing). The io_uring backend lives in
+ *        loop_uring.cpp; every entry point below forwards to it when active.
  */
 
 #include "socketify/detail/loop.h"
@@ -13,48 +15,79 @@
 
 namespace socketify::detail {
 
-EventLoop::EventLoop() {
-    epfd_ = ::epoll_create1(EPOLL_CLOEXEC);
+EventLoop::EventLoop(LoopBackend backend) {
     wake_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
-    if (epfd_ >= 0 && wake_fd_ >= 0) {
+    if (wake_fd_ < 0) return;
+    if (backend == LoopBackend::IoUring && uring_open_()) return;
+
+    epfd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epfd_ >= 0) {
         epoll_event ev{};
         ev.events = EPOLLIN;
-        ev.data.ptr = nullptr; // nullptr marks the wakeup channel
+        ev.data.u64 = 0; // token 0 marks the wakeup channel
         ::epoll_ctl(epfd_, EPOLL_CTL_ADD, wake_fd_, &ev);
     }
 }
 
 EventLoop::~EventLoop() {
+    uring_close_();
     if (wake_fd_ >= 0) ::close(wake_fd_);
     if (epfd_ >= 0) ::close(epfd_);
 }
 
-static std::uint32_t make_events_(bool read, bool write) {
+static std::uint32_t make_events_(bool read, bool write, bool edge) {
     std::uint32_t ev = EPOLLRDHUP;
+    if (edge) ev |= EPOLLET;
     if (read) ev |= EPOLLIN;
     if (write) ev |= EPOLLOUT;
     return ev;
 }
 
-bool EventLoop::add(int fd, bool read, bool write, void* data) {
+bool EventLoop::add(int fd, bool read, bool write, std::uint64_t data) {
+    if (uring_) return uring_arm_(fd, read, write, data);
     epoll_event ev{};
-    ev.events = make_events_(read, write);
-    ev.data.ptr = data;
+    ev.events = make_events_(read, write, edge_);
+    ev.data.u64 = data;
     return ::epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) == 0;
 }
 
-bool EventLoop::mod(int fd, bool read, bool write, void* data) {
+bool EventLoop::mod(int fd, bool read, bool write, std::uint64_t data) {
+    if (uring_) return uring_arm_(fd, read, write, data);
     epoll_event ev{};
-    ev.events = make_events_(read, write);
-    ev.data.ptr = data;
+    ev.events = make_events_(read, write, edge_);
+    ev.data.u64 = data;
     return ::epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev) == 0;
 }
 
+bool EventLoop::add_listener(int fd, std::uint64_t data) {
+    if (multishot_) return uring_listen_(fd, data);
+    return add(fd, true, false, data);
+}
+
+bool EventLoop::add_stream(int fd, std::uint64_t data) {
+    if (multishot_) return uring_stream_(fd, data);
+    return add(fd, true, false, data);
+}
+
+bool EventLoop::send(int fd, const iovec* iov, std::size_t cnt, int file_fd,
+                     std::uint64_t file_off, std::size_t file_len) {
+    if (!multishot_) return false;
+    return uring_send_(fd, iov, cnt, file_fd, file_off, file_len);
+}
+
+std::size_t EventLoop::unsent(int fd) const noexcept {
+    return multishot_ ? uring_unsent_(fd) : 0;
+}
+
 bool EventLoop::del(int fd) {
+    if (uring_) return uring_disarm_(fd);
     return ::epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr) == 0;
 }
 
 int EventLoop::wait(std::vector<LoopEvent>& out, int timeout_ms) {
+    int next = timers_.next_timeout_ms(TimerWheel::Clock::now());
+    if (next >= 0 && (timeout_ms < 0 || next < timeout_ms)) timeout_ms = next;
+    if (uring_) return uring_wait_(out, timeout_ms);
     out.clear();
     epoll_event evs[256];
     int n = ::epoll_wait(epfd_, evs, 256, timeout_ms);
@@ -64,14 +97,14 @@ int EventLoop::wait(std::vector<LoopEvent>& out, int timeout_ms) {
     }
     out.reserve(static_cast<std::size_t>(n));
     for (int i = 0; i < n; ++i) {
-        if (evs[i].data.ptr == nullptr) {
+        if (evs[i].data.u64 == 0) {
             // Drain the wakeup eventfd.
             std::uint64_t v;
             while (::read(wake_fd_, &v, sizeof(v)) > 0) {}
             continue;
         }
         LoopEvent le;
-        le.data = evs[i].data.ptr;
+        le.data = evs[i].data.u64;
         le.readable = (evs[i].events & EPOLLIN) != 0;
         le.writable = (evs[i].events & EPOLLOUT) != 0;
         le.error = (evs[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) != 0;
@@ -0,0 +1,871 @@
+/**
+ * @file loop_uring.cpp
+ * @brief io_uring(7) backend of detail::EventLoop.
+ *
+ * On Linux 6.0+ the listener gets one multishot IORING_OP_ACCEPT and each
+ * add_stream() socket one multishot IORING_OP_RECV that picks its buffers
+ * from a ring registered with IORING_REGISTER_PBUF_RING: the kernel
+ * accepts and reads on its own, and wait() hands over the new fds and the
+ * received bytes, so the worker issues no accept4/readv calls and keeps no
+ * per-connection read space. Buffers delivered by one wait() go back to
+ * the ring at the start of the next. When the ring runs dry a recv ends
+ * with ENOBUFS and is re-armed after that recycling; its bytes wait in the
+ * socket meanwhile.
+ *
+ * Those sockets are written the same way: send() queues one IOSQE_IO_LINK
+ * chain per call, an IORING_OP_SENDMSG of the caller's iovecs (with
+ * MSG_WAITALL, so the kernel retries partial sends itself) followed by a
+ * piece of the file as IORING_OP_SPLICE file -> pipe, a POLLOUT poll and
+ * IORING_OP_SPLICE pipe -> socket. File bytes the socket did not take stay
+ * in the connection's pipe and are spliced out at the head of the next
+ * chain; a short step breaks the chain, so nothing is sent out of order.
+ * wait() reports the chain once its last CQE is in.
+ *
+ * Everything else (write interest, TLS sockets whose bytes must go through
+ * OpenSSL, and every socket on older kernels) is tracked with one-shot
+ * IORING_OP_POLL_ADD requests that are re-armed as soon as they complete,
+ * which gives the same level-triggered semantics as the epoll backend.
+ * add()/mod()/del() only queue SQEs; they reach the kernel together with
+ * the next wait() in a single io_uring_enter(2), so a loop iteration that
+ * changes the interest set of many sockets still costs one syscall instead
+ * of one epoll_ctl per change.
+ *
+ * The ring is driven through raw syscalls (no liburing dependency), is
+ * built against Linux 6.0+ UAPI headers and needs IORING_FEAT_EXT_ARG
+ * (Linux 5.11) for timed waits; on older kernels, or when io_uring is
+ * disabled, uring_open_() fails and the loop uses epoll.
+ */
+
+#include "socketify/detail/loop.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+
+#if defined(IORING_RECV_MULTISHOT)
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace socketify::detail {
+
+namespace {
+
+constexpr unsigned kSqEntries = 1024;
+constexpr unsigned kCqEntries = 8192;
+
+// Provided-buffer ring for multishot recv: 256 x 8 KiB per loop.
+constexpr unsigned kRecvBuffers = 256;
+constexpr unsigned kRecvBufferSize = 8 * 1024;
+constexpr std::uint16_t kBufferGroup = 0;
+
+// send() pipes: capacity asked for (the kernel may cap it) and how many
+// empty ones a loop keeps for the next file.
+constexpr std::size_t kPipeSize = 256 * 1024;
+constexpr std::size_t kIdlePipes = 16;
+
+// user_data tags. Socket polls carry (generation << 32 | fd), multishot
+// recvs the same with kRecvBit set; generations wrap at 30 bits. Send
+// chains carry kSendBit | (step << 32) | op index.
+constexpr std::uint64_t kWakeTag = ~std::uint64_t{0};
+constexpr std::uint64_t kIgnoreTag = ~std::uint64_t{0} - 1;
+constexpr std::uint64_t kAcceptTag = ~std::uint64_t{0} - 2;
+constexpr std::uint64_t kRecvBit = std::uint64_t{1} << 63;
+constexpr std::uint64_t kSendBit = std::uint64_t{1} << 62;
+
+/// Steps of a send() chain, in submission order.
+enum SendStep : unsigned { kDrainPoll, kDrain, kHead, kFileIn, kFilePoll, kFileOut, kSendSteps };
+
+int sys_setup_(unsigned entries, io_uring_params* p) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+int sys_enter_(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+               const void* arg, std::size_t argsz) {
+    return static_cast<int>(
+        ::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz));
+}
+
+int sys_register_(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+std::uint64_t tag_(int fd, std::uint32_t gen) {
+    return (std::uint64_t{gen & 0x3fffffffu} << 32) | static_cast<std::uint32_t>(fd);
+}
+
+std::uint64_t recv_tag_(int fd, std::uint32_t epoch) { return kRecvBit | tag_(fd, epoch); }
+
+std::uint64_t send_tag_(std::uint32_t op, unsigned step) {
+    return kSendBit | (std::uint64_t{step} << 32) | op;
+}
+
+/// IORING_RECV_MULTISHOT has no probe bit of its own; it shipped in the
+/// same release (Linux 6.0) as IORING_OP_SEND_ZC, which does.
+bool probe_multishot_(int ring_fd) {
+    constexpr unsigned kOps = 256;
+    std::vector<unsigned char> mem(sizeof(io_uring_probe) + kOps * sizeof(io_uring_probe_op));
+    auto* probe = reinterpret_cast<io_uring_probe*>(mem.data());
+    if (sys_register_(ring_fd, IORING_REGISTER_PROBE, probe, kOps) < 0) return false;
+    const unsigned op = IORING_OP_SEND_ZC;
+    return op <= probe->last_op && op < probe->ops_len &&
+           (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+}
+
+std::uint32_t poll_mask_(bool read, bool write) {
+    std::uint32_t m = POLLRDHUP;
+    if (read) m |= POLLIN;
+    if (write) m |= POLLOUT;
+    return m;
+}
+
+template <typename T>
+T* at_(void* base, std::uint32_t off) {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + off);
+}
+
+} // namespace
+
+struct EventLoop::Uring {
+    /// Pipe that carries a stream's file bytes from one splice to the next.
+    struct Pipe {
+        int rd{-1};
+        int wr{-1};
+        std::size_t cap{0};
+    };
+
+    /// One send() chain. Pooled so the msghdr and iovecs it points the
+    /// kernel at stay put until its last CQE.
+    struct SendOp {
+        int fd{-1};
+        std::uint64_t data{0};
+        msghdr msg{};
+        iovec iov[kSendIov];
+        bool used[kSendSteps]{};
+        std::int64_t res[kSendSteps]{};
+        unsigned pending{0}; ///< CQEs still to come
+        bool orphan{false};  ///< del() ran; `pipe` is ours to close
+        Pipe pipe;
+    };
+
+    /// Per-fd registration. A poll completion is only delivered when its
+    /// generation still matches, so completions that raced a mod()/del()
+    /// (or a recycled fd number) are dropped. A stream's recv outlives
+    /// mod(); its completions are matched against the epoch, which only
+    /// del() moves on.
+    struct Slot {
+        std::uint64_t data{0};
+        std::uint32_t gen{0};
+        std::uint32_t mask{0};
+        bool active{false};
+        bool armed{false};
+
+        bool stream{false};         ///< add_stream(): input via multishot recv
+        bool reading{false};        ///< the owner wants input
+        bool receiving{false};      ///< a recv is in flight (maybe cancelled)
+        bool recv_cancelled{false}; ///< ...and its cancel is queued
+        std::uint32_t epoch{0};
+
+        std::uint32_t send_op{0}; ///< send() in flight: op index + 1
+        Pipe pipe;                ///< holds `piped` file bytes not yet sent
+        std::size_t piped{0};
+    };
+
+    int ring_fd{-1};
+    bool single_mmap{false};
+
+    void* sq_map{nullptr};
+    std::size_t sq_map_len{0};
+    void* cq_map{nullptr};
+    std::size_t cq_map_len{0};
+    io_uring_sqe* sqes{nullptr};
+    std::size_t sqes_len{0};
+
+    unsigned* sq_head{nullptr};
+    unsigned* sq_tail{nullptr};
+    unsigned* sq_array{nullptr};
+    unsigned sq_mask{0};
+    unsigned sq_entries{0};
+    unsigned sq_local_tail{0};
+
+    unsigned* cq_head{nullptr};
+    unsigned* cq_tail{nullptr};
+    io_uring_cqe* cqes{nullptr};
+    unsigned cq_mask{0};
+
+    std::vector<Slot> slots;
+    bool wake_armed{false};
+
+    // Multishot accept.
+    int listen_fd{-1};
+    std::uint64_t listen_data{0};
+    bool accepting{false};
+
+    // Provided-buffer ring; the tail lives in the first entry's resv field.
+    io_uring_buf* bufs{nullptr};
+    std::size_t bufs_len{0};
+    char* buf_area{nullptr};
+    std::size_t buf_area_len{0};
+    std::uint16_t buf_tail{0};
+    std::vector<std::uint16_t> spent; ///< handed out by the last wait()
+
+    std::vector<std::unique_ptr<SendOp>> send_ops;
+    std::vector<std::uint32_t> free_send_ops;
+    std::vector<Pipe> idle_pipes;
+
+    ~Uring() {
+        for (Slot& s : slots) close_pipe(s.pipe);
+        for (auto& op : send_ops) close_pipe(op->pipe);
+        for (Pipe& p : idle_pipes) close_pipe(p);
+        if (buf_area) ::munmap(buf_area, buf_area_len);
+        if (bufs) ::munmap(bufs, bufs_len);
+        if (sqes) ::munmap(sqes, sqes_len);
+        if (cq_map && !single_mmap) ::munmap(cq_map, cq_map_len);
+        if (sq_map) ::munmap(sq_map, sq_map_len);
+        if (ring_fd >= 0) ::close(ring_fd);
+    }
+
+    bool map(const io_uring_params& p) {
+        sq_map_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_map_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_map_len = cq_map_len = (sq_map_len > cq_map_len) ? sq_map_len : cq_map_len;
+        }
+
+        void* m = ::mmap(nullptr, sq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring_fd, static_cast<off_t>(IORING_OFF_SQ_RING));
+        if (m == MAP_FAILED) return false;
+        sq_map = m;
+
+        if (single_mmap) {
+            cq_map = sq_map;
+        } else {
+            m = ::mmap(nullptr, cq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring_fd, static_cast<off_t>(IORING_OFF_CQ_RING));
+            if (m == MAP_FAILED) return false;
+            cq_map = m;
+        }
+
+        sqes_len = p.sq_entries * sizeof(io_uring_sqe);
+        m = ::mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ring_fd, static_cast<off_t>(IORING_OFF_SQES));
+        if (m == MAP_FAILED) return false;
+        sqes = static_cast<io_uring_sqe*>(m);
+
+        sq_head = at_<unsigned>(sq_map, p.sq_off.head);
+        sq_tail = at_<unsigned>(sq_map, p.sq_off.tail);
+        sq_array = at_<unsigned>(sq_map, p.sq_off.array);
+        sq_mask = *at_<unsigned>(sq_map, p.sq_off.ring_mask);
+        sq_entries = *at_<unsigned>(sq_map, p.sq_off.ring_entries);
+        sq_local_tail = *sq_tail;
+
+        cq_head = at_<unsigned>(cq_map, p.cq_off.head);
+        cq_tail = at_<unsigned>(cq_map, p.cq_off.tail);
+        cqes = at_<io_uring_cqe>(cq_map, p.cq_off.cqes);
+        cq_mask = *at_<unsigned>(cq_map, p.cq_off.ring_mask);
+        return true;
+    }
+
+    /// Register the buffer ring used by multishot recv; false when the
+    /// kernel predates multishot recv (the loop then polls every socket).
+    bool setup_buffers() {
+        if (!probe_multishot_(ring_fd)) return false;
+        bufs_len = kRecvBuffers * sizeof(io_uring_buf);
+        void* m = ::mmap(nullptr, bufs_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                         -1, 0);
+        if (m == MAP_FAILED) return false;
+        bufs = static_cast<io_uring_buf*>(m);
+        buf_area_len = std::size_t{kRecvBuffers} * kRecvBufferSize;
+        m = ::mmap(nullptr, buf_area_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                   -1, 0);
+        if (m == MAP_FAILED) return false;
+        buf_area = static_cast<char*>(m);
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<std::uint64_t>(bufs);
+        reg.ring_entries = kRecvBuffers;
+        reg.bgid = kBufferGroup;
+        if (sys_register_(ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) return false;
+        for (unsigned bid = 0; bid < kRecvBuffers; ++bid) provide(static_cast<std::uint16_t>(bid));
+        publish();
+        return true;
+    }
+
+    /// Put buffer @p bid back at the ring's tail (visible after publish()).
+    /// Field by field: the first entry's resv is the shared tail.
+    void provide(std::uint16_t bid) {
+        io_uring_buf& b = bufs[buf_tail & (kRecvBuffers - 1)];
+        b.addr = reinterpret_cast<std::uint64_t>(buf_area + std::size_t{bid} * kRecvBufferSize);
+        b.len = kRecvBufferSize;
+        b.bid = bid;
+        ++buf_tail;
+    }
+
+    void publish() { __atomic_store_n(&bufs[0].resv, buf_tail, __ATOMIC_RELEASE); }
+
+    /// SQEs queued but not yet consumed by the kernel.
+    unsigned unsubmitted() const {
+        return sq_local_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    }
+
+    bool submit() {
+        while (unsubmitted() > 0) {
+            if (sys_enter_(ring_fd, unsubmitted(), 0, 0, nullptr, 0) < 0 && errno != EINTR) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    io_uring_sqe* next_sqe() {
+        if (unsubmitted() >= sq_entries && !submit()) return nullptr;
+        const unsigned idx = sq_local_tail & sq_mask;
+        io_uring_sqe* sqe = &sqes[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array[idx] = idx;
+        ++sq_local_tail;
+        __atomic_store_n(sq_tail, sq_local_tail, __ATOMIC_RELEASE);
+        return sqe;
+    }
+
+    bool queue_poll(int fd, std::uint32_t mask, std::uint64_t user_data) {
+        io_uring_sqe* sqe = next_sqe();
+        if (!sqe) return false;
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        mask = (mask << 16) | (mask >> 16); // poll32_events is word-reversed on BE
+#endif
+        sqe->poll32_events = mask;
+        sqe->user_data = user_data;
+        return true;
+    }
+
+    bool arm(int fd, Slot& s) {
+        if (!queue_poll(fd, s.mask, tag_(fd, s.gen))) return false;
+        s.armed = true;
+        return true;
+    }
+
+    /// Cancel the in-flight poll of @p s; its late completion (if any) is
+    /// dropped because the generation moves on.
+    void cancel(int fd, Slot& s) {
+        if (s.armed) {
+            if (io_uring_sqe* sqe = next_sqe()) {
+                sqe->opcode = IORING_OP_POLL_REMOVE;
+                sqe->fd = -1;
+                sqe->addr = tag_(fd, s.gen);
+                sqe->user_data = kIgnoreTag;
+            }
+            s.armed = false;
+        }
+        ++s.gen;
+    }
+
+    bool queue_cancel(std::uint64_t target) {
+        io_uring_sqe* sqe = next_sqe();
+        if (!sqe) return false;
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = target;
+        sqe->user_data = kIgnoreTag;
+        return true;
+    }
+
+    bool arm_accept() {
+        io_uring_sqe* sqe = next_sqe();
+        if (!sqe) return false;
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = listen_fd;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        sqe->user_data = kAcceptTag;
+        accepting = true;
+        return true;
+    }
+
+    bool arm_recv(int fd, Slot& s) {
+        io_uring_sqe* sqe = next_sqe();
+        if (!sqe) return false;
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = kBufferGroup;
+        sqe->user_data = recv_tag_(fd, s.epoch);
+        s.receiving = true;
+        s.recv_cancelled = false;
+        return true;
+    }
+
+    /// Stop the stream's recv; what it already received is still delivered.
+    void cancel_recv(int fd, Slot& s) {
+        if (!s.receiving || s.recv_cancelled) return;
+        s.recv_cancelled = queue_cancel(recv_tag_(fd, s.epoch));
+    }
+
+    /// mod() of a stream: reading starts or stops the recv, writing is
+    /// watched with a POLLOUT poll.
+    bool set_stream(int fd, Slot& s, bool read, bool write) {
+        s.reading = read;
+        bool ok = true;
+        if (!read) {
+            cancel_recv(fd, s);
+        } else if (!s.receiving) {
+            ok = arm_recv(fd, s);
+        } // else re-armed when the cancelled recv completes
+
+        const std::uint32_t mask = write ? std::uint32_t{POLLOUT} : 0u;
+        if (s.armed && s.mask == mask) return ok;
+        cancel(fd, s);
+        s.mask = mask;
+        if (mask != 0) ok = arm(fd, s) && ok;
+        return ok;
+    }
+
+    static void close_pipe(Pipe& p) noexcept {
+        if (p.rd >= 0) ::close(p.rd);
+        if (p.wr >= 0) ::close(p.wr);
+        p = Pipe{};
+    }
+
+    bool take_pipe(Pipe& p) {
+        if (!idle_pipes.empty()) {
+            p = idle_pipes.back();
+            idle_pipes.pop_back();
+            return true;
+        }
+        // Non-blocking, so a splice that finds the socket full returns
+        // instead of parking an io-wq worker.
+        int fds[2];
+        if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0) return false;
+        ::fcntl(fds[1], F_SETPIPE_SZ, static_cast<int>(kPipeSize));
+        const int cap = ::fcntl(fds[1], F_GETPIPE_SZ);
+        p = Pipe{fds[0], fds[1], cap > 0 ? static_cast<std::size_t>(cap) : 64 * 1024};
+        return true;
+    }
+
+    void give_pipe(Pipe& p) {
+        if (idle_pipes.size() < kIdlePipes) {
+            idle_pipes.push_back(p);
+            p = Pipe{};
+        } else {
+            close_pipe(p);
+        }
+    }
+
+    static void prep_splice(io_uring_sqe* sqe, int out, int in, std::uint64_t in_off,
+                            std::size_t len) {
+        sqe->opcode = IORING_OP_SPLICE;
+        sqe->fd = out;
+        sqe->off = ~std::uint64_t{0}; // pipes and sockets have no offset
+        sqe->splice_fd_in = in;
+        sqe->splice_off_in = in_off;
+        sqe->len = static_cast<std::uint32_t>(len);
+    }
+
+    bool queue_send(int fd, Slot& s, const iovec* iov, std::size_t cnt, int file_fd,
+                    std::uint64_t file_off, std::size_t file_len) {
+        if (s.send_op != 0 || cnt > kSendIov) return false;
+        const bool file = file_fd >= 0 && file_len > 0;
+        if (file && s.pipe.rd < 0 && !take_pipe(s.pipe)) return false;
+
+        unsigned steps[kSendSteps];
+        unsigned n = 0;
+        if (s.piped > 0) {
+            steps[n++] = kDrainPoll;
+            steps[n++] = kDrain;
+        }
+        if (cnt > 0) steps[n++] = kHead;
+        if (file) {
+            steps[n++] = kFileIn;
+            steps[n++] = kFilePoll;
+            steps[n++] = kFileOut;
+        }
+        if (n == 0) return false;
+        // The chain must reach the kernel in one io_uring_enter(2): a link
+        // split across two submissions would not order its halves.
+        if (sq_entries - unsubmitted() < n && !submit()) return false;
+
+        std::uint32_t idx;
+        if (!free_send_ops.empty()) {
+            idx = free_send_ops.back();
+            free_send_ops.pop_back();
+        } else {
+            idx = static_cast<std::uint32_t>(send_ops.size());
+            send_ops.push_back(std::make_unique<SendOp>());
+        }
+        SendOp& op = *send_ops[idx];
+        op.fd = fd;
+        op.data = s.data;
+        op.pending = n;
+        op.orphan = false;
+        std::fill(std::begin(op.used), std::end(op.used), false);
+        std::fill(std::begin(op.res), std::end(op.res), 0);
+        std::copy(iov, iov + cnt, op.iov);
+        op.msg = msghdr{};
+        op.msg.msg_iov = op.iov;
+        op.msg.msg_iovlen = cnt;
+        const std::size_t chunk = file ? std::min(file_len, s.pipe.cap) : 0;
+
+        for (unsigned i = 0; i < n; ++i) {
+            io_uring_sqe* sqe = next_sqe(); // room was made above
+            switch (steps[i]) {
+            case kDrainPoll:
+            case kFilePoll: {
+                sqe->opcode = IORING_OP_POLL_ADD;
+                sqe->fd = fd;
+                std::uint32_t mask = POLLOUT;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                mask = (mask << 16) | (mask >> 16);
+#endif
+                sqe->poll32_events = mask;
+                break;
+            }
+            case kDrain: prep_splice(sqe, fd, s.pipe.rd, ~std::uint64_t{0}, s.piped); break;
+            case kHead:
+                sqe->opcode = IORING_OP_SENDMSG;
+                sqe->fd = fd;
+                sqe->addr = reinterpret_cast<std::uint64_t>(&op.msg);
+                sqe->len = 1;
+                sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+                break;
+            case kFileIn: prep_splice(sqe, s.pipe.wr, file_fd, file_off, chunk); break;
+            case kFileOut: prep_splice(sqe, fd, s.pipe.rd, ~std::uint64_t{0}, chunk); break;
+            }
+            if (i + 1 < n) sqe->flags |= IOSQE_IO_LINK;
+            sqe->user_data = send_tag_(idx, steps[i]);
+            op.used[steps[i]] = true;
+        }
+        s.send_op = idx + 1;
+        return true;
+    }
+
+    /// Record one CQE of a send() chain; the last one reports the chain.
+    void on_send_cqe(std::uint64_t ud, int res, std::vector<LoopEvent>& out) {
+        const auto idx = static_cast<std::uint32_t>(ud & 0xffffffffu);
+        const auto step = static_cast<unsigned>((ud >> 32) & 0xffu);
+        if (idx >= send_ops.size() || step >= kSendSteps) return;
+        SendOp& op = *send_ops[idx];
+        op.res[step] = res;
+        if (--op.pending > 0) return;
+
+        // -ECANCELED: an earlier step came up short and broke the chain;
+        // -EAGAIN: the socket filled up. Neither is a socket failure.
+        int err = 0;
+        for (unsigned st = 0; st < kSendSteps && err == 0; ++st) {
+            if (op.used[st] && op.res[st] < 0 && op.res[st] != -ECANCELED && op.res[st] != -EAGAIN)
+                err = static_cast<int>(-op.res[st]);
+        }
+        auto moved = [&op](unsigned st) -> std::int64_t {
+            return op.used[st] && op.res[st] > 0 ? op.res[st] : 0;
+        };
+        const std::int64_t into_pipe = moved(kFileIn);
+        const std::int64_t out_of_pipe = moved(kDrain) + moved(kFileOut);
+
+        LoopEvent le;
+        le.data = op.data;
+        le.send_done = true;
+        le.sent = err != 0 ? -err : moved(kHead);
+        le.file_sent = op.used[kFileIn] && op.res[kFileIn] == 0 ? -1 : into_pipe;
+
+        if (op.orphan) {
+            close_pipe(op.pipe);
+        } else if (static_cast<std::size_t>(op.fd) < slots.size()) {
+            Slot& s = slots[static_cast<std::size_t>(op.fd)];
+            s.send_op = 0;
+            s.piped = static_cast<std::size_t>(static_cast<std::int64_t>(s.piped) + into_pipe -
+                                               out_of_pipe);
+            if (s.piped == 0 && s.pipe.rd >= 0) give_pipe(s.pipe);
+        }
+        op.orphan = false;
+        free_send_ops.push_back(idx);
+        out.push_back(le);
+    }
+};
+
+bool EventLoop::uring_open_() {
+    io_uring_params p{};
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = kCqEntries;
+    int fd = sys_setup_(kSqEntries, &p);
+    if (fd < 0) return false;
+
+    auto u = std::make_unique<Uring>();
+    u->ring_fd = fd;
+    const bool features_ok =
+        (p.features & IORING_FEAT_EXT_ARG) && (p.features & IORING_FEAT_NODROP);
+    if (!features_ok || !u->map(p)) return false;
+    if (!u->queue_poll(wake_fd_, POLLIN, kWakeTag)) return false;
+    u->wake_armed = true;
+    multishot_ = u->setup_buffers();
+
+    uring_ = u.release();
+    return true;
+}
+
+void EventLoop::uring_close_() noexcept {
+    if (uring_) {
+        // Connections accepted since the last wait() are still ours.
+        Uring& u = *uring_;
+        const unsigned tail = __atomic_load_n(u.cq_tail, __ATOMIC_ACQUIRE);
+        for (unsigned head = *u.cq_head; head != tail; ++head) {
+            const io_uring_cqe& cqe = u.cqes[head & u.cq_mask];
+            if (cqe.user_data == kAcceptTag && cqe.res >= 0) ::close(cqe.res);
+        }
+    }
+    delete uring_;
+    uring_ = nullptr;
+    multishot_ = false;
+}
+
+bool EventLoop::uring_arm_(int fd, bool read, bool write, std::uint64_t data) {
+    if (fd < 0) return false;
+    auto& slots = uring_->slots;
+    if (static_cast<std::size_t>(fd) >= slots.size()) slots.resize(static_cast<std::size_t>(fd) + 1);
+
+    Uring::Slot& s = slots[static_cast<std::size_t>(fd)];
+    s.data = data;
+    if (s.active && s.stream) return uring_->set_stream(fd, s, read, write);
+    const std::uint32_t mask = poll_mask_(read, write);
+    if (s.active && s.armed && s.mask == mask) return true;
+
+    uring_->cancel(fd, s);
+    s.active = true;
+    s.mask = mask;
+    return uring_->arm(fd, s);
+}
+
+bool EventLoop::uring_listen_(int fd, std::uint64_t data) {
+    if (fd < 0 || uring_->listen_fd >= 0) return false;
+    uring_->listen_fd = fd;
+    uring_->listen_data = data;
+    return uring_->arm_accept();
+}
+
+bool EventLoop::uring_stream_(int fd, std::uint64_t data) {
+    if (fd < 0) return false;
+    auto& slots = uring_->slots;
+    if (static_cast<std::size_t>(fd) >= slots.size()) slots.resize(static_cast<std::size_t>(fd) + 1);
+
+    Uring::Slot& s = slots[static_cast<std::size_t>(fd)];
+    if (s.active) return false;
+    s.active = true;
+    s.stream = true;
+    s.data = data;
+    s.mask = 0;
+    s.reading = true;
+    return uring_->arm_recv(fd, s);
+}
+
+bool EventLoop::uring_send_(int fd, const iovec* iov, std::size_t cnt, int file_fd,
+                            std::uint64_t file_off, std::size_t file_len) {
+    auto& slots = uring_->slots;
+    if (fd < 0 || static_cast<std::size_t>(fd) >= slots.size()) return false;
+    Uring::Slot& s = slots[static_cast<std::size_t>(fd)];
+    if (!s.active || !s.stream) return false;
+    return uring_->queue_send(fd, s, iov, cnt, file_fd, file_off, file_len);
+}
+
+std::size_t EventLoop::uring_unsent_(int fd) const noexcept {
+    const auto& slots = uring_->slots;
+    if (fd < 0 || static_cast<std::size_t>(fd) >= slots.size()) return 0;
+    return slots[static_cast<std::size_t>(fd)].piped;
+}
+
+bool EventLoop::uring_disarm_(int fd) {
+    Uring& u = *uring_;
+    if (fd >= 0 && fd == u.listen_fd) {
+        if (u.accepting) u.queue_cancel(kAcceptTag);
+        u.listen_fd = -1;
+        return true;
+    }
+    auto& slots = u.slots;
+    if (fd < 0 || static_cast<std::size_t>(fd) >= slots.size()) return false;
+    Uring::Slot& s = slots[static_cast<std::size_t>(fd)];
+    if (!s.active) return false;
+    u.cancel(fd, s);
+    if (s.send_op != 0) {
+        // Shut the socket so the chain fails fast instead of waiting for a
+        // peer that will never read; its pipe goes with it.
+        Uring::SendOp& op = *u.send_ops[s.send_op - 1];
+        op.orphan = true;
+        op.pipe = s.pipe;
+        s.pipe = Uring::Pipe{};
+        s.send_op = 0;
+        ::shutdown(fd, SHUT_RDWR);
+    } else {
+        Uring::close_pipe(s.pipe); // bytes for a stream that is gone
+    }
+    s.piped = 0;
+    if (s.stream) {
+        // The recv pins the socket open until it ends; its remaining
+        // completions no longer match the epoch and only return buffers.
+        u.cancel_recv(fd, s);
+        ++s.epoch;
+        s.stream = s.reading = s.receiving = s.recv_cancelled = false;
+    }
+    s.active = false;
+    s.data = 0;
+    return true;
+}
+
+int EventLoop::uring_wait_(std::vector<LoopEvent>& out, int timeout_ms) {
+    out.clear();
+    Uring& u = *uring_;
+
+    // Bytes handed out by the previous wait() have been consumed.
+    if (!u.spent.empty()) {
+        for (const std::uint16_t bid : u.spent) u.provide(bid);
+        u.publish();
+        u.spent.clear();
+    }
+    // A wakeup poll that could not be re-armed (submission queue full and
+    // the kernel busy) is retried here; until then never sleep, so a
+    // wakeup() can not be lost.
+    if (!u.wake_armed) u.wake_armed = u.queue_poll(wake_fd_, POLLIN, kWakeTag);
+    if (!u.wake_armed) timeout_ms = 0;
+
+    const bool have_cqes =
+        *u.cq_head != __atomic_load_n(u.cq_tail, __ATOMIC_ACQUIRE);
+
+    __kernel_timespec ts{};
+    io_uring_getevents_arg arg{};
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+        arg.ts = reinterpret_cast<std::uint64_t>(&ts);
+    }
+    const unsigned min_complete = (have_cqes || timeout_ms == 0) ? 0 : 1;
+
+    // One syscall: submit every queued (re-)arm / cancel and wait.
+    if (sys_enter_(u.ring_fd, u.unsubmitted(), min_complete,
+                   IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg)) < 0) {
+        if (errno != EINTR && errno != ETIME && errno != EAGAIN && errno != EBUSY) return -1;
+    }
+
+    unsigned head = *u.cq_head;
+    const unsigned tail = __atomic_load_n(u.cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        const io_uring_cqe& cqe = u.cqes[head & u.cq_mask];
+        const std::uint64_t ud = cqe.user_data;
+        const int res = cqe.res;
+
+        if (ud == kIgnoreTag) continue;
+        if (ud == kWakeTag) {
+            std::uint64_t v;
+            while (::read(wake_fd_, &v, sizeof(v)) > 0) {}
+            u.wake_armed = u.queue_poll(wake_fd_, POLLIN, kWakeTag);
+            continue;
+        }
+        if (ud == kAcceptTag) {
+            if (!(cqe.flags & IORING_CQE_F_MORE)) u.accepting = false;
+            if (res >= 0) {
+                if (u.listen_fd < 0) {
+                    ::close(res); // raced del() of the listener
+                    continue;
+                }
+                LoopEvent le;
+                le.data = u.listen_data;
+                le.accepted = res;
+                out.push_back(le);
+            }
+            // Like a level-triggered listener, an accept that failed
+            // (EMFILE, ...) is simply tried again.
+            if (!u.accepting && u.listen_fd >= 0) u.arm_accept();
+            continue;
+        }
+        if ((ud & (kRecvBit | kSendBit)) == kSendBit) {
+            u.on_send_cqe(ud, res, out);
+            continue;
+        }
+        if (ud & kRecvBit) {
+            const bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+            const bool has_buf = (cqe.flags & IORING_CQE_F_BUFFER) != 0;
+            const auto bid = static_cast<std::uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            if (has_buf) u.spent.push_back(bid);
+
+            const int fd = static_cast<int>(ud & 0xffffffffu);
+            if (static_cast<std::size_t>(fd) >= u.slots.size()) continue;
+            Uring::Slot& s = u.slots[static_cast<std::size_t>(fd)];
+            if (!s.active || !s.stream || recv_tag_(fd, s.epoch) != ud) continue; // stale
+            if (!more) s.receiving = false;
+
+            LoopEvent le;
+            le.data = s.data;
+            le.readable = true;
+            if (res > 0 && has_buf) {
+                le.received = std::string_view(
+                    u.buf_area + std::size_t{bid} * kRecvBufferSize, static_cast<std::size_t>(res));
+                out.push_back(le);
+            } else if (res == 0 || (res != -ENOBUFS && res != -ECANCELED)) {
+                le.error = true; // end of stream, or a socket error
+                out.push_back(le);
+                continue;
+            }
+            // Ended by our cancel, an empty buffer ring or a full CQ:
+            // resume if the owner still wants input.
+            if (!s.receiving && s.reading) u.arm_recv(fd, s);
+            continue;
+        }
+
+        const int fd = static_cast<int>(ud & 0xffffffffu);
+        if (static_cast<std::size_t>(fd) >= u.slots.size()) continue;
+        Uring::Slot& s = u.slots[static_cast<std::size_t>(fd)];
+        if (!s.active || !s.armed || tag_(fd, s.gen) != ud) continue; // stale completion
+
+        s.armed = false;
+        LoopEvent le;
+        le.data = s.data;
+        if (res < 0) {
+            le.readable = true;
+            le.error = true;
+        } else {
+            const auto ev = static_cast<std::uint32_t>(res);
+            le.readable = (ev & POLLIN) != 0;
+            le.writable = (ev & POLLOUT) != 0;
+            le.error = (ev & (POLLERR | POLLHUP | POLLRDHUP)) != 0;
+            // Level-triggered: keep watching until the owner changes interest.
+            u.arm(fd, s);
+        }
+        out.push_back(le);
+    }
+    __atomic_store_n(u.cq_head, head, __ATOMIC_RELEASE);
+    return static_cast<int>(out.size());
+}
+
+} // namespace socketify::detail
+
+#else // no (recent enough) io_uring headers: the backend is never selected.
+
+namespace socketify::detail {
+
+struct EventLoop::Uring {};
+
+bool EventLoop::uring_open_() { return false; }
+void EventLoop::uring_close_() noexcept {}
+bool EventLoop::uring_arm_(int, bool, bool, std::uint64_t) { return false; }
+bool EventLoop::uring_listen_(int, std::uint64_t) { return false; }
+bool EventLoop::uring_stream_(int, std::uint64_t) { return false; }
+bool EventLoop::uring_disarm_(int) { return false; }
+bool EventLoop::uring_send_(int, const iovec*, std::size_t, int, std::uint64_t, std::size_t) {
+    return false;
+}
+std::size_t EventLoop::uring_unsent_(int) const noexcept { return 0; }
+int EventLoop::uring_wait_(std::vector<LoopEvent>& out, int) {
+    out.clear();
+    return -1;
+}
+
+} // namespace socketify::detail
+
+#endif
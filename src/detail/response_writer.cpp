@@ -0,0 +1,388 @@
+/**
+ * @file response_writer.cpp
+ * @brief HTTP/1.1 and HTTP/2 response serialization (see response_writer.h).
+ */
+
+#include "socketify/detail/response_writer.h"
+
+#include "socketify/compression.h"
+#include "socketify/detail/http2.h"
+#include "socketify/detail/output_queue.h"
+#include "socketify/detail/utils.h"
+#include "socketify/request.h"
+#include "socketify/response.h"
+#include "socketify/server.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace socketify::detail {
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Status lines
+// ---------------------------------------------------------------------------
+
+constexpr std::array<std::string_view, 600> make_status_lines_() {
+    std::array<std::string_view, 600> t{};
+    t[100] = "HTTP/1.1 100 Continue\r\n";
+    t[101] = "HTTP/1.1 101 Switching Protocols\r\n";
+    t[102] = "HTTP/1.1 102 Processing\r\n";
+    t[200] = "HTTP/1.1 200 OK\r\n";
+    t[201] = "HTTP/1.1 201 Created\r\n";
+    t[202] = "HTTP/1.1 202 Accepted\r\n";
+    t[204] = "HTTP/1.1 204 No Content\r\n";
+    t[206] = "HTTP/1.1 206 Partial Content\r\n";
+    t[301] = "HTTP/1.1 301 Moved Permanently\r\n";
+    t[302] = "HTTP/1.1 302 Found\r\n";
+    t[303] = "HTTP/1.1 303 See Other\r\n";
+    t[304] = "HTTP/1.1 304 Not Modified\r\n";
+    t[307] = "HTTP/1.1 307 Temporary Redirect\r\n";
+    t[308] = "HTTP/1.1 308 Permanent Redirect\r\n";
+    t[400] = "HTTP/1.1 400 Bad Request\r\n";
+    t[401] = "HTTP/1.1 401 Unauthorized\r\n";
+    t[403] = "HTTP/1.1 403 Forbidden\r\n";
+    t[404] = "HTTP/1.1 404 Not Found\r\n";
+    t[405] = "HTTP/1.1 405 Method Not Allowed\r\n";
+    t[406] = "HTTP/1.1 406 Not Acceptable\r\n";
+    t[408] = "HTTP/1.1 408 Request Timeout\r\n";
+    t[409] = "HTTP/1.1 409 Conflict\r\n";
+    t[410] = "HTTP/1.1 410 Gone\r\n";
+    t[411] = "HTTP/1.1 411 Length Required\r\n";
+    t[413] = "HTTP/1.1 413 Payload Too Large\r\n";
+    t[414] = "HTTP/1.1 414 URI Too Long\r\n";
+    t[415] = "HTTP/1.1 415 Unsupported Media Type\r\n";
+    t[416] = "HTTP/1.1 416 Range Not Satisfiable\r\n";
+    t[422] = "HTTP/1.1 422 Unprocessable Entity\r\n";
+    t[429] = "HTTP/1.1 429 Too Many Requests\r\n";
+    t[431] = "HTTP/1.1 431 Request Header Fields Too Large\r\n";
+    t[500] = "HTTP/1.1 500 Internal Server Error\r\n";
+    t[501] = "HTTP/1.1 501 Not Implemented\r\n";
+    t[502] = "HTTP/1.1 502 Bad Gateway\r\n";
+    t[503] = "HTTP/1.1 503 Service Unavailable\r\n";
+    t[504] = "HTTP/1.1 504 Gateway Timeout\r\n";
+    t[505] = "HTTP/1.1 505 HTTP Version Not Supported\r\n";
+    return t;
+}
+
+constexpr auto kStatusLines = make_status_lines_();
+
+// ---------------------------------------------------------------------------
+// Helpers
+// ---------------------------------------------------------------------------
+
+std::string_view find_header_(const ResponseHeaderMap& h, std::string_view key) {
+    auto it = h.find(std::string(key));
+    if (it == h.end()) return {};
+    return it->second;
+}
+
+bool is_header_(std::string_view name, std::string_view known) noexcept {
+    return name.size() == known.size() && iequal_ascii(name, known);
+}
+
+void append_number_(std::string& out, std::uint64_t v) {
+    char buf[24];
+    auto r = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, static_cast<std::size_t>(r.ptr - buf));
+}
+
+void put2_(char* p, unsigned v) noexcept {
+    p[0] = static_cast<char>('0' + v / 10);
+    p[1] = static_cast<char>('0' + v % 10);
+}
+
+// Body-dependent parts shared by the HTTP/1.1 and HTTP/2 writers: the
+// buffered body (compressed when negotiated), its Content-Encoding and the
+// default Content-Type.
+struct PreparedBody {
+    std::string body;
+    std::string_view content_encoding;
+    std::string_view forced_content_type;
+};
+
+PreparedBody prepare_body_(const Request& req, Response& res, const ServerOptions& opts) {
+    using K = Response::KnownHeader;
+    PreparedBody pb;
+    std::string& body = pb.body;
+    if (res.kind() == Response::Kind::Buffered) {
+        body = res.take_body();
+    }
+
+    // ---- Compression (buffered responses only) ----
+    if (res.kind() == Response::Kind::Buffered && opts.compression.enable &&
+        !body.empty() && !res.has_known_header(K::ContentEncoding) &&
+        body.size() >= opts.compression.min_size) {
+        const auto ae = req.header(HeaderId::AcceptEncoding);
+        auto enc = compression::negotiate_accept_encoding(ae, opts.compression);
+        if (enc != compression::Encoding::None) {
+            const auto ct = res.has_known_header(K::ContentType)
+                                ? find_header_(res.headers(), H_ContentType)
+                                : std::string_view{};
+            if (compression::is_compressible_type(ct, opts.compression)) {
+                std::string compressed;
+                bool ok = false;
+                if (enc == compression::Encoding::Gzip) {
+                    ok = compression::gzip_compress(body, compressed);
+                    pb.content_encoding = "gzip";
+                } else if (enc == compression::Encoding::Deflate) {
+                    ok = compression::deflate_compress(body, compressed);
+                    pb.content_encoding = "deflate";
+                }
+                if (ok && compressed.size() < body.size()) {
+                    body.swap(compressed);
+                } else {
+                    pb.content_encoding = {};
+                }
+            }
+        }
+    }
+
+    // ---- Default Content-Type for non-empty buffered bodies ----
+    if (!body.empty() && !res.has_known_header(K::ContentType)) {
+        auto begins_with = [&](std::string_view s, std::string_view pfx) {
+            return s.size() >= pfx.size() &&
+                   std::equal(pfx.begin(), pfx.end(), s.begin(),
+                              [](char a, char b) { return (a | 32) == (b | 32); });
+        };
+        pb.forced_content_type = (begins_with(body, "<!doctype") || begins_with(body, "<html"))
+                                     ? "text/html; charset=utf-8"
+                                     : "text/plain; charset=utf-8";
+    }
+    return pb;
+}
+
+} // namespace
+
+
+// ---------------------------------------------------------------------------
+// DateCache
+// ---------------------------------------------------------------------------
+
+std::string_view DateCache::now() noexcept {
+    using namespace std::chrono;
+    return at(duration_cast<seconds>(system_clock::now().time_since_epoch()).count());
+}
+
+std::string_view DateCache::at(std::int64_t unix_seconds) noexcept {
+    static constexpr std::size_t kLen = 29; // "Sun, 06 Nov 1994 08:49:37 GMT"
+    if (unix_seconds == sec_) return {buf_, kLen};
+    sec_ = unix_seconds;
+
+    static constexpr char kDays[7][4] = {"Thu", "Fri", "Sat", "Sun", "Mon", "Tue", "Wed"};
+    static constexpr char kMonths[12][4] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                            "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+    std::int64_t days = unix_seconds / 86400;
+    std::int64_t rem = unix_seconds % 86400;
+    if (rem < 0) {
+        rem += 86400;
+        --days;
+    }
+    const auto wday = static_cast<unsigned>(((days % 7) + 7) % 7); // 1970-01-01 was a Thursday
+
+    // Civil date from days since the epoch (H. Hinnant's algorithm).
+    std::int64_t z = days + 719468;
+    const std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const auto doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    const auto y = static_cast<unsigned>(static_cast<std::int64_t>(yoe) + era * 400 + (m <= 2));
+
+    char* p = buf_;
+    std::copy_n(kDays[wday], 3, p);
+    p[3] = ',';
+    p[4] = ' ';
+    put2_(p + 5, d);
+    p[7] = ' ';
+    std::copy_n(kMonths[m - 1], 3, p + 8);
+    p[11] = ' ';
+    put2_(p + 12, (y / 100) % 100);
+    put2_(p + 14, y % 100);
+    p[16] = ' ';
+    const auto secs = static_cast<unsigned>(rem);
+    put2_(p + 17, secs / 3600);
+    p[19] = ':';
+    put2_(p + 20, (secs / 60) % 60);
+    p[22] = ':';
+    put2_(p + 23, secs % 60);
+    std::copy_n(" GMT", 4, p + 25);
+    return {buf_, kLen};
+}
+
+// ---------------------------------------------------------------------------
+// Status line
+// ---------------------------------------------------------------------------
+
+std::string_view status_line(unsigned code) noexcept {
+    return code < kStatusLines.size() ? kStatusLines[code] : std::string_view{};
+}
+
+// ---------------------------------------------------------------------------
+// Serialization
+// ---------------------------------------------------------------------------
+
+void serialize_response(OutputQueue& q, const Request& req, Response& res,
+                        const ServerOptions& opts, std::string_view date,
+                        bool head_request, bool close_connection) {
+    using K = Response::KnownHeader;
+
+    PreparedBody pb = prepare_body_(req, res, opts);
+    std::string& body = pb.body;
+    const std::string_view content_encoding_value = pb.content_encoding;
+    const std::string_view forced_content_type = pb.forced_content_type;
+
+    // ---- Head ----
+    unsigned code = res.status_code() ? res.status_code() : 200u;
+    std::string& out = q.open_segment();
+    const std::size_t head_start = out.size();
+    out.reserve(head_start + 256);
+
+    if (auto line = status_line(code); !line.empty()) {
+        out += line;
+    } else {
+        out += "HTTP/1.1 ";
+        append_number_(out, code);
+        out.push_back(' ');
+        out += reason(static_cast<Status>(code));
+        out += "\r\n";
+    }
+
+    out += "Date: ";
+    out += date;
+    out += "\r\nServer: socketify\r\n";
+
+    const bool filter = res.has_known_header(K::ContentLength) ||
+                        res.has_known_header(K::Connection);
+    for (const auto& kv : res.headers()) {
+        if (filter && (is_header_(kv.first, H_ContentLength) || is_header_(kv.first, H_Connection)))
+            continue;
+        out += kv.first;
+        out += ": ";
+        out += kv.second;
+        out += "\r\n";
+    }
+    for (const auto& sc : res.set_cookies()) {
+        out += "Set-Cookie: ";
+        out += sc;
+        out += "\r\n";
+    }
+    if (!forced_content_type.empty()) {
+        out += "Content-Type: ";
+        out += forced_content_type;
+        out += "\r\n";
+    }
+    if (!content_encoding_value.empty()) {
+        out += "Content-Encoding: ";
+        out += content_encoding_value;
+        out += "\r\n";
+        if (!res.has_known_header(K::Vary)) out += "Vary: Accept-Encoding\r\n";
+    }
+
+    switch (res.kind()) {
+        case Response::Kind::Buffered:
+            out += "Content-Length: ";
+            append_number_(out, body.size());
+            out += "\r\n";
+            break;
+        case Response::Kind::File:
+            out += "Content-Length: ";
+            append_number_(out, res.file_length());
+            out += "\r\n";
+            break;
+        case Response::Kind::Stream:
+            // Stream length is unknown; the connection closes at the end.
+            break;
+        case Response::Kind::Chunked:
+            // HTTP/1.0 has no chunked coding: the body ends at close.
+            if (req.http_version() != "HTTP/1.0") out += "Transfer-Encoding: chunked\r\n";
+            break;
+        case Response::Kind::Pulse:
+            // Pulse (WebSocket) has no body after the 101 handshake.
+            break;
+        case Response::Kind::Deferred:
+            // Placeholder only; the worker serializes the finished response.
+            break;
+    }
+
+    if (res.kind() == Response::Kind::Pulse) {
+        out += "Connection: Upgrade\r\n";
+    } else {
+        out += close_connection ? "Connection: close\r\n" : "Connection: keep-alive\r\n";
+    }
+    out += "\r\n";
+    q.commit(out.size() - head_start);
+
+    if (!head_request && !body.empty()) {
+        q.push(std::move(body));
+    }
+}
+
+bool wants_close(const Request& req, const Response& res) {
+    auto rconn = req.header(HeaderId::Connection);
+    if (!rconn.empty()) {
+        if (iequal_ascii(rconn, "close")) return true;
+        if (iequal_ascii(rconn, "keep-alive")) return false;
+    }
+    if (res.has_known_header(Response::KnownHeader::Connection)) {
+        auto sconn = find_header_(res.headers(), H_Connection);
+        if (!sconn.empty() && iequal_ascii(sconn, "close")) return true;
+    }
+    // HTTP/1.0 defaults to close; HTTP/1.1 defaults to keep-alive.
+    return req.http_version() == "HTTP/1.0";
+}
+
+bool serialize_response_h2(h2::Session& session, std::uint32_t stream, const Request& req,
+                           Response& res, const ServerOptions& opts, std::string_view date,
+                           bool head_request) {
+    using K = Response::KnownHeader;
+
+    PreparedBody pb = prepare_body_(req, res, opts);
+    h2::ResponseBody body;
+    std::string length;
+    if (res.kind() == Response::Kind::File) {
+        append_number_(length, res.file_length());
+        if (!head_request && res.file_length() > 0) {
+            if (!res.file_handle()) return false;
+            body.file = res.file_handle();
+            body.offset = res.file_offset();
+            body.length = res.file_length();
+        }
+    } else {
+        append_number_(length, pb.body.size());
+        if (!head_request) body.data = std::move(pb.body);
+    }
+
+    // Names go out as given; the session lower-cases them and drops the
+    // HTTP/1.1 connection fields.
+    std::vector<h2::Field> fields;
+    fields.reserve(res.headers().size() + res.set_cookies().size() + 6);
+    fields.emplace_back("date", date);
+    fields.emplace_back("server", "socketify");
+    const bool filter = res.has_known_header(K::ContentLength);
+    for (const auto& kv : res.headers()) {
+        if (filter && is_header_(kv.first, H_ContentLength)) continue;
+        fields.emplace_back(kv.first, kv.second);
+    }
+    for (const auto& sc : res.set_cookies()) fields.emplace_back("set-cookie", sc);
+    if (!pb.forced_content_type.empty()) fields.emplace_back("content-type", pb.forced_content_type);
+    if (!pb.content_encoding.empty()) {
+        fields.emplace_back("content-encoding", pb.content_encoding);
+        if (!res.has_known_header(K::Vary)) fields.emplace_back("vary", "Accept-Encoding");
+    }
+    fields.emplace_back("content-length", length);
+
+    const unsigned code = res.status_code() ? res.status_code() : 200u;
+    session.respond(stream, code, fields, std::move(body));
+    return true;
+}
+
+} // namespace socketify::detail
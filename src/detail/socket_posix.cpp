@@ -5,7 +5,9 @@
 
 #include "socketify/detail/socket.h"
 
+#include <algorithm>
 #include <cerrno>
+#include <cstring>
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
@@ -124,6 +126,18 @@ IoResult Socket::handshake() {
 #endif
 }
 
+std::string_view Socket::alpn() const noexcept {
+#if defined(SOCKETIFY_HAS_TLS) && SOCKETIFY_HAS_TLS
+    if (ssl_ && handshaken_) {
+        const unsigned char* data = nullptr;
+        unsigned int len = 0;
+        SSL_get0_alpn_selected(ssl_, &data, &len);
+        if (data) return {reinterpret_cast<const char*>(data), len};
+    }
+#endif
+    return {};
+}
+
 IoResult Socket::read(char* buf, std::size_t len, std::size_t& out) {
     out = 0;
     if (fd_ < 0) return IoResult::Error;
@@ -147,6 +161,29 @@ IoResult Socket::read(char* buf, std::size_t len, std::size_t& out) {
     return IoResult::Error;
 }
 
+IoResult Socket::readv(const iovec* iov, std::size_t count, std::size_t& out) {
+    out = 0;
+    if (fd_ < 0) return IoResult::Error;
+    if (ssl_) {
+        // SSL_read decrypts into one destination; a record never spans the
+        // scatter list anyway.
+        for (std::size_t i = 0; i < count; ++i) {
+            if (iov[i].iov_len > 0) {
+                return read(static_cast<char*>(iov[i].iov_base), iov[i].iov_len, out);
+            }
+        }
+        return IoResult::Ok;
+    }
+    ssize_t rc = ::readv(fd_, iov, static_cast<int>(count));
+    if (rc > 0) {
+        out = static_cast<std::size_t>(rc);
+        return IoResult::Ok;
+    }
+    if (rc == 0) return IoResult::Closed;
+    if (would_block_(errno) || errno == EINTR) return IoResult::WantRead;
+    return IoResult::Error;
+}
+
 IoResult Socket::write(const char* buf, std::size_t len, std::size_t& out) {
     out = 0;
     if (fd_ < 0) return IoResult::Error;
@@ -171,6 +208,44 @@ IoResult Socket::write(const char* buf, std::size_t len, std::size_t& out) {
     return IoResult::Error;
 }
 
+IoResult Socket::writev(const iovec* iov, std::size_t count, std::size_t& out) {
+    out = 0;
+    if (fd_ < 0) return IoResult::Error;
+    if (count == 0) return IoResult::Ok;
+#if defined(SOCKETIFY_HAS_TLS) && SOCKETIFY_HAS_TLS
+    if (ssl_) {
+        // One TLS record carries at most 16 KiB of plaintext. Coalesce small
+        // leading buffers into one record instead of one SSL_write each.
+        // Retries after WantWrite see the same (or a longer) prefix, which
+        // SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER permits.
+        constexpr std::size_t kRecord = 16 * 1024;
+        if (iov[0].iov_len >= kRecord || count == 1) {
+            return write(static_cast<const char*>(iov[0].iov_base), iov[0].iov_len, out);
+        }
+        thread_local char staging[kRecord];
+        std::size_t used = 0;
+        for (std::size_t i = 0; i < count && used < kRecord; ++i) {
+            std::size_t take = std::min(iov[i].iov_len, kRecord - used);
+            std::memcpy(staging + used, iov[i].iov_base, take);
+            used += take;
+        }
+        return write(staging, used, out);
+    }
+#endif
+    msghdr msg{};
+    msg.msg_iov = const_cast<iovec*>(iov);
+    msg.msg_iovlen = count;
+    ssize_t rc = ::sendmsg(fd_, &msg, MSG_NOSIGNAL);
+    if (rc > 0) {
+        out = static_cast<std::size_t>(rc);
+        return IoResult::Ok;
+    }
+    if (rc == 0) return IoResult::WantWrite;
+    if (would_block_(errno) || errno == EINTR) return IoResult::WantWrite;
+    if (errno == EPIPE || errno == ECONNRESET) return IoResult::Closed;
+    return IoResult::Error;
+}
+
 IoResult Socket::send_file(int file_fd, std::uint64_t& offset, std::size_t len, std::size_t& out) {
     out = 0;
     if (fd_ < 0) return IoResult::Error;
@@ -0,0 +1,82 @@
+/**
+ * @file thread_pool.cpp
+ * @brief Bounded thread pool implementation.
+ */
+
+#include "socketify/detail/thread_pool.h"
+
+#include <algorithm>
+
+namespace socketify::detail {
+
+ThreadPool::ThreadPool(unsigned threads, std::size_t capacity) : capacity_(capacity) {
+    const unsigned n = std::max(1u, threads);
+    threads_.reserve(n);
+    for (unsigned i = 0; i < n; ++i) {
+        threads_.emplace_back([this] { run_(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    std::deque<std::function<void()>> dropped;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stop_ = true;
+        dropped.swap(queue_);
+    }
+    cv_.notify_all();
+    for (auto& t : threads_) {
+        if (t.joinable()) t.join();
+    }
+    // Queued jobs are destroyed here, outside the lock.
+}
+
+bool ThreadPool::try_submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (stop_ || (capacity_ != 0 && queue_.size() >= capacity_)) return false;
+        queue_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+    return true;
+}
+
+std::size_t ThreadPool::pending() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return queue_.size();
+}
+
+void ThreadPool::run_() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lk(mu_);
+            cv_.wait(lk, [this] { return stop_ || !queue_.empty(); });
+            if (stop_) return;
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        job();
+    }
+}
+
+ThreadPool& LazyThreadPool::get() {
+    if (ThreadPool* p = ready_.load(std::memory_order_acquire)) return *p;
+    std::lock_guard<std::mutex> lk(mu_);
+    if (!pool_) {
+        pool_ = std::make_unique<ThreadPool>(threads_, capacity_);
+        ready_.store(pool_.get(), std::memory_order_release);
+    }
+    return *pool_;
+}
+
+void LazyThreadPool::reset() {
+    std::unique_ptr<ThreadPool> pool;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        ready_.store(nullptr, std::memory_order_release);
+        pool = std::move(pool_);
+    }
+}
+
+} // namespace socketify::detail
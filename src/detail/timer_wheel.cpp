@@ -0,0 +1,202 @@
+/**
+ * @file timer_wheel.cpp
+ * @brief Hierarchical timing wheel (see timer_wheel.h).
+ *
+ * A timer at level L with d = expires - now in [64^L, 64^(L+1)) sits in
+ * slot (expires >> 6L) & 63 and is re-linked one level down when the wheel
+ * reaches the start of that slot. Level 0 slots are fired directly.
+ */
+
+#include "socketify/detail/timer_wheel.h"
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+
+namespace socketify::detail {
+
+Timer::~Timer() {
+    if (wheel_) wheel_->cancel(*this);
+}
+
+namespace {
+
+void init_head(Timer*& prev, Timer*& next, Timer* self) noexcept {
+    prev = self;
+    next = self;
+}
+
+} // namespace
+
+TimerWheel::TimerWheel(Clock::time_point origin) : origin_(origin) {
+    for (auto& lvl : levels_) {
+        for (auto& h : lvl.heads) init_head(h.prev_, h.next_, &h);
+    }
+}
+
+TimerWheel::~TimerWheel() {
+    // Detach anything still armed so its destructor does not touch us.
+    for (auto& lvl : levels_) {
+        for (auto& h : lvl.heads) {
+            for (Timer* t = h.next_; t != &h;) {
+                Timer* next = t->next_;
+                t->prev_ = t->next_ = nullptr;
+                t->wheel_ = nullptr;
+                t = next;
+            }
+            init_head(h.prev_, h.next_, &h);
+        }
+        lvl.occupied = 0;
+    }
+    count_ = 0;
+}
+
+std::uint64_t TimerWheel::tick_of_(Clock::time_point t) const noexcept {
+    if (t <= origin_) return 0;
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t - origin_).count();
+    return static_cast<std::uint64_t>(ms);
+}
+
+void TimerWheel::arm(Timer& t, Clock::time_point when) {
+    if (t.wheel_) unlink_(t);
+    // Round up so a timer never fires before @p when, and never into a
+    // slot that has already been processed.
+    std::uint64_t tick = tick_of_(when);
+    if (origin_ + std::chrono::milliseconds(tick) < when) ++tick;
+    t.expires_ = std::max(tick, now_ + 1);
+    t.wheel_ = this;
+    ++count_;
+    link_(t);
+}
+
+void TimerWheel::cancel(Timer& t) noexcept {
+    if (t.wheel_ == this) unlink_(t);
+}
+
+void TimerWheel::link_(Timer& t) {
+    std::uint64_t place = t.expires_ > now_ ? t.expires_ : now_;
+    if (place - now_ >= kSpan) place = now_ + kSpan - 1; // re-cascaded until due
+    std::uint64_t delta = place - now_;
+
+    unsigned level = 0;
+    while (level + 1 < kLevels && delta >= (std::uint64_t{1} << (kBits * (level + 1)))) ++level;
+    unsigned idx = static_cast<unsigned>(place >> (kBits * level)) & kMask;
+
+    Level& lvl = levels_[level];
+    Timer& head = lvl.heads[idx];
+    t.prev_ = head.prev_;
+    t.next_ = &head;
+    head.prev_->next_ = &t;
+    head.prev_ = &t;
+    t.slot_ = static_cast<std::uint16_t>(level * kSlots + idx);
+    lvl.occupied |= std::uint64_t{1} << idx;
+}
+
+void TimerWheel::unlink_(Timer& t) noexcept {
+    t.prev_->next_ = t.next_;
+    t.next_->prev_ = t.prev_;
+    if (t.slot_ != kDetached) {
+        Level& lvl = levels_[t.slot_ / kSlots];
+        unsigned idx = t.slot_ % kSlots;
+        if (lvl.heads[idx].next_ == &lvl.heads[idx]) lvl.occupied &= ~(std::uint64_t{1} << idx);
+    }
+    t.prev_ = t.next_ = nullptr;
+    t.wheel_ = nullptr;
+    --count_;
+}
+
+void TimerWheel::cascade_(unsigned level) {
+    Level& lvl = levels_[level];
+    unsigned idx = static_cast<unsigned>(now_ >> (kBits * level)) & kMask;
+    Timer& head = lvl.heads[idx];
+    Timer* t = head.next_;
+    init_head(head.prev_, head.next_, &head);
+    lvl.occupied &= ~(std::uint64_t{1} << idx);
+    while (t != &head) {
+        Timer* next = t->next_;
+        link_(*t);
+        t = next;
+    }
+}
+
+std::size_t TimerWheel::advance(Clock::time_point now) {
+    const std::uint64_t target = tick_of_(now);
+    std::size_t fired = 0;
+
+    while (now_ < target && count_ > 0) {
+        const std::uint64_t base = now_ & ~std::uint64_t{kMask};
+        const std::uint64_t block_end = base + kSlots;
+        const std::uint64_t limit = std::min(block_end, target);
+
+        // Next occupied level-0 slot in (now_, limit] within this block.
+        unsigned lo = static_cast<unsigned>(now_ - base) + 1;
+        unsigned hi = static_cast<unsigned>(std::min<std::uint64_t>(limit - base, kMask));
+        std::uint64_t bits = 0;
+        if (lo <= hi) {
+            std::uint64_t range = (hi == kMask ? ~std::uint64_t{0} : ((std::uint64_t{1} << (hi + 1)) - 1)) &
+                                  ~((std::uint64_t{1} << lo) - 1);
+            bits = levels_[0].occupied & range;
+        }
+        if (bits) {
+            now_ = base + static_cast<unsigned>(std::countr_zero(bits));
+        } else {
+            now_ = limit;
+            if (now_ != block_end) continue;
+            for (unsigned l = 1; l < kLevels; ++l) {
+                unsigned idx = static_cast<unsigned>(now_ >> (kBits * l)) & kMask;
+                cascade_(l);
+                if (idx != 0) break;
+            }
+        }
+
+        // Fire level-0 slot now_. Detach the list first so callbacks may
+        // freely arm/cancel (including destroying the timer being fired).
+        Level& l0 = levels_[0];
+        unsigned idx = static_cast<unsigned>(now_) & kMask;
+        Timer& head = l0.heads[idx];
+        if (head.next_ == &head) continue;
+        Timer pending;
+        pending.prev_ = head.prev_;
+        pending.next_ = head.next_;
+        pending.prev_->next_ = &pending;
+        pending.next_->prev_ = &pending;
+        init_head(head.prev_, head.next_, &head);
+        l0.occupied &= ~(std::uint64_t{1} << idx);
+        for (Timer* t = pending.next_; t != &pending; t = t->next_) t->slot_ = kDetached;
+
+        while (pending.next_ != &pending) {
+            Timer* t = pending.next_;
+            unlink_(*t);
+            Timer::Callback fn = t->fn_;
+            void* ctx = t->ctx_;
+            if (fn) fn(ctx);
+            ++fired;
+        }
+    }
+    if (now_ < target) now_ = target;
+    return fired;
+}
+
+int TimerWheel::next_timeout_ms(Clock::time_point now) const {
+    if (count_ == 0) return -1;
+
+    std::uint64_t due = UINT64_MAX;
+    for (unsigned l = 0; l < kLevels; ++l) {
+        std::uint64_t occ = levels_[l].occupied;
+        if (!occ) continue;
+        std::uint64_t cur = now_ >> (kBits * l);
+        unsigned shift = static_cast<unsigned>((cur + 1) & kMask);
+        // Bit k of r is slot (cur + 1 + k) & 63.
+        std::uint64_t r = std::rotr(occ, static_cast<int>(shift));
+        std::uint64_t k = static_cast<std::uint64_t>(std::countr_zero(r)) + 1;
+        std::uint64_t at = (cur + k) << (kBits * l);
+        due = std::min(due, at);
+    }
+
+    std::uint64_t cur_tick = tick_of_(now);
+    if (due <= cur_tick) return 0;
+    std::uint64_t wait = due - cur_tick;
+    return wait > static_cast<std::uint64_t>(INT_MAX) ? INT_MAX : static_cast<int>(wait);
+}
+
+} // namespace socketify::detail
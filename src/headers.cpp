@@ -0,0 +1,165 @@
+/**
+ * @file headers.cpp
+ * @brief Headers container: adding, joining, lookups by name and ownership.
+ */
+
+#include "socketify/headers.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace socketify {
+
+Headers::Headers(const Headers& other)
+    : present_(other.present_), known_(other.known_), other_(other.other_), borrowed_(true) {
+    own();
+}
+
+Headers::Headers(Headers&& other) noexcept
+    : present_(std::exchange(other.present_, 0)), known_(other.known_),
+      other_(std::move(other.other_)), owned_(std::move(other.owned_)),
+      borrowed_(std::exchange(other.borrowed_, false)) {
+    other.other_.clear();
+}
+
+Headers& Headers::operator=(Headers&& other) noexcept {
+    if (this == &other) return *this;
+    present_ = std::exchange(other.present_, 0);
+    known_ = other.known_;
+    other_ = std::move(other.other_);
+    other.other_.clear();
+    owned_ = std::move(other.owned_);
+    other.owned_.clear();
+    borrowed_ = std::exchange(other.borrowed_, false);
+    return *this;
+}
+
+Headers& Headers::operator=(const Headers& other) {
+    if (this != &other) *this = Headers(other);
+    return *this;
+}
+
+const HeaderField* Headers::find_other_(std::string_view name) const noexcept {
+    for (const HeaderField& f : other_)
+        if (detail::header_iequal(f.name, name)) return &f;
+    return nullptr;
+}
+
+HeaderField* Headers::find_other_(std::string_view name) noexcept {
+    return const_cast<HeaderField*>(std::as_const(*this).find_other_(name));
+}
+
+std::string_view Headers::get(std::string_view name) const noexcept {
+    const HeaderId id = header_id(name);
+    if (id != HeaderId::Unknown) return get(id);
+    const HeaderField* f = find_other_(name);
+    return f ? f->value : std::string_view();
+}
+
+bool Headers::contains(std::string_view name) const noexcept {
+    const HeaderId id = header_id(name);
+    return id != HeaderId::Unknown ? contains(id) : find_other_(name) != nullptr;
+}
+
+Headers::const_iterator Headers::find(std::string_view name) const noexcept {
+    const HeaderId id = header_id(name);
+    if (id != HeaderId::Unknown) return find(id);
+    const HeaderField* f = find_other_(name);
+    return f ? const_iterator(this, 0, static_cast<std::size_t>(f - other_.data())) : end();
+}
+
+std::string_view Headers::at(std::string_view name) const {
+    if (!contains(name)) throw std::out_of_range("no header '" + std::string(name) + "'");
+    return get(name);
+}
+
+void Headers::clear() noexcept {
+    present_ = 0;
+    other_.clear();
+    owned_.clear();
+    borrowed_ = false;
+}
+
+std::string_view Headers::keep_(std::string_view s) {
+    owned_.emplace_front(s);
+    return owned_.front();
+}
+
+// Repeated fields are joined with ", " into owned storage.
+void Headers::join_(std::string_view& slot, std::string_view value) {
+    std::string& s = owned_.emplace_front();
+    s.reserve(slot.size() + 2 + value.size());
+    s.append(slot).append(", ").append(value);
+    slot = s;
+}
+
+void Headers::add_(HeaderId id, std::string_view name, std::string_view value) {
+    const auto i = static_cast<std::size_t>(id);
+    if (i < kKnownHeaderCount) {
+        const std::uint64_t bit = std::uint64_t{1} << i;
+        if (present_ & bit) {
+            join_(known_[i], value);
+        } else {
+            present_ |= bit;
+            known_[i] = value;
+        }
+        return;
+    }
+    if (HeaderField* f = find_other_(name)) {
+        join_(f->value, value);
+        return;
+    }
+    other_.push_back({name, value});
+}
+
+void Headers::add(HeaderId id, std::string_view name, std::string_view value) {
+    add_(id, name, value);
+    borrowed_ = true;
+}
+
+void Headers::add_copy(HeaderId id, std::string_view name, std::string_view value) {
+    const bool known = id != HeaderId::Unknown;
+    if (known ? contains(id) : find_other_(name) != nullptr) {
+        add_(id, name, value); // the joined value is owned
+    } else if (known) {
+        add_(id, name, keep_(value));
+    } else {
+        other_.push_back({keep_(name), keep_(value)});
+    }
+}
+
+void Headers::set(HeaderId id, std::string_view value) {
+    const auto i = static_cast<std::size_t>(id);
+    if (i >= kKnownHeaderCount) return;
+    present_ |= std::uint64_t{1} << i;
+    known_[i] = keep_(value);
+}
+
+void Headers::set(std::string_view name, std::string_view value) {
+    const HeaderId id = header_id(name);
+    if (id != HeaderId::Unknown) {
+        set(id, value);
+    } else if (HeaderField* f = find_other_(name)) {
+        f->value = keep_(value);
+    } else {
+        other_.push_back({keep_(name), keep_(value)});
+    }
+}
+
+void Headers::own() {
+    if (!borrowed_) return;
+    std::forward_list<std::string> fresh;
+    auto copy = [&fresh](std::string_view& v) {
+        fresh.emplace_front(v);
+        v = fresh.front();
+    };
+    for (std::uint64_t m = present_; m; m &= m - 1) copy(known_[static_cast<std::size_t>(std::countr_zero(m))]);
+    for (HeaderField& f : other_) {
+        copy(f.name);
+        copy(f.value);
+    }
+    owned_ = std::move(fresh);
+    borrowed_ = false;
+}
+
+} // namespace socketify
@@ -371,4 +371,30 @@ Response post(const std::string& url, std::string body, HeaderMap headers) {
     return request(req);
 }
 
+// The blocking call reads the request from the coroutine frame, so the
+// awaiter only carries a reference.
+Task<Response> async_request(Request req) {
+    co_return co_await offload([&req] { return request(req); });
+}
+
+Task<Response> async_get(std::string url, HeaderMap headers) {
+    Request req;
+    req.method = Method::GET;
+    req.url = std::move(url);
+    req.headers = std::move(headers);
+    return async_request(std::move(req));
+}
+
+Task<Response> async_post(std::string url, std::string body, HeaderMap headers) {
+    Request req;
+    req.method = Method::POST;
+    req.url = std::move(url);
+    req.body = std::move(body);
+    req.headers = std::move(headers);
+    if (req.headers.find("Content-Type") == req.headers.end()) {
+        req.headers["Content-Type"] = "application/json";
+    }
+    return async_request(std::move(req));
+}
+
 } // namespace socketify::http_client
@@ -56,7 +56,7 @@ void default_sink_(Level lvl, std::string_view msg) {
 
 std::string client_ip_(const Request& req, bool trust_proxy) {
     if (trust_proxy) {
-        auto xff = req.header("X-Forwarded-For");
+        auto xff = req.header(HeaderId::XForwardedFor);
         if (!xff.empty()) {
             auto comma = xff.find(',');
             auto hop = (comma == std::string_view::npos)
@@ -80,11 +80,11 @@ Level status_level_(unsigned status) {
 
 void append_debug_extras_(std::string& line, const Request& req) {
     if (level() > Level::Debug) return;
-    auto rid = req.header(H_XRequestId);
+    auto rid = req.header(HeaderId::XRequestId);
     if (!rid.empty()) {
         line.append(" rid=").append(rid);
     }
-    auto ua = req.header("User-Agent");
+    auto ua = req.header(HeaderId::UserAgent);
     if (!ua.empty()) {
         constexpr std::size_t kMax = 40;
         line.append(" ua=");
@@ -10,10 +10,10 @@ namespace socketify::middleware {
 
 Middleware request_id() {
     return [](Request& req, Response& res, Next next) {
-        std::string id{req.header(H_XRequestId)};
+        std::string id{req.header(HeaderId::XRequestId)};
         if (id.empty()) {
             id = detail::random_token(8);
-            req.mutable_headers()[std::string(H_XRequestId)] = id;
+            req.mutable_headers().set(HeaderId::XRequestId, id);
         }
         res.set_header(H_XRequestId, id);
         next();
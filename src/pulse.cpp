@@ -138,7 +138,12 @@ bool feed_bytes(const std::shared_ptr<Channel::Impl>& impl, std::string_view dat
     {
         std::lock_guard<std::mutex> lk(impl->mu);
         if (impl->closed) return false;
-        impl->inbuf.append(data.data(), data.size());
+        // A frame split across reads continues in inbuf; otherwise frames
+        // are decoded straight from the caller's bytes.
+        if (!impl->inbuf.empty()) {
+            impl->inbuf.append(data.data(), data.size());
+            data = {};
+        }
         on_text = impl->on_text;
         on_binary = impl->on_binary;
         on_close = impl->on_close;
@@ -152,13 +157,23 @@ bool feed_bytes(const std::shared_ptr<Channel::Impl>& impl, std::string_view dat
         DecodedFrame fr;
         {
             std::lock_guard<std::mutex> lk(impl->mu);
-            fr = decode_frame(impl->inbuf, opts.max_message_bytes);
+            const bool direct = impl->inbuf.empty();
+            fr = decode_frame(direct ? data : std::string_view(impl->inbuf),
+                              opts.max_message_bytes);
             if (fr.protocol_error) {
                 impl->closed = true;
                 return false;
             }
-            if (!fr.ok) return true;
-            impl->inbuf.erase(0, fr.bytes_consumed);
+            if (!fr.ok) {
+                // Keep the partial trailing frame for the next read.
+                if (direct) impl->inbuf.assign(data.data(), data.size());
+                return true;
+            }
+            if (direct) {
+                data.remove_prefix(fr.bytes_consumed);
+            } else {
+                impl->inbuf.erase(0, fr.bytes_consumed);
+            }
         }
 
         switch (fr.opcode) {
@@ -248,14 +263,14 @@ std::uint64_t Channel::id() const {
 std::size_t Channel::pending_bytes() const {
     if (!impl_) return 0;
     std::lock_guard<std::mutex> lk(impl_->mu);
-    return impl_->pending.size();
+    return impl_->pending.size() + impl_->limit.in_flight;
 }
 
 bool Channel::writable() const {
     if (!impl_) return false;
     std::lock_guard<std::mutex> lk(impl_->mu);
     if (impl_->closed) return false;
-    return impl_->pending.size() < impl_->opts.max_pending_bytes;
+    return impl_->pending.size() + impl_->limit.in_flight < impl_->opts.max_pending_bytes;
 }
 
 bool Channel::begin_fragment_(std::uint8_t opcode) {
@@ -397,10 +412,10 @@ const std::string& Channel::protocol() const {
 }
 
 Channel upgrade(Request& req, Response& res, Options opts) {
-    auto upgrade_h = req.header("Upgrade");
-    auto conn_h = req.header("Connection");
-    auto key = req.header("Sec-WebSocket-Key");
-    auto ver = req.header("Sec-WebSocket-Version");
+    auto upgrade_h = req.header(HeaderId::Upgrade);
+    auto conn_h = req.header(HeaderId::Connection);
+    auto key = req.header(HeaderId::SecWebSocketKey);
+    auto ver = req.header(HeaderId::SecWebSocketVersion);
 
     if (!detail::iequal_ascii(upgrade_h, "websocket") ||
         !header_has_token_(conn_h, "Upgrade") || key.empty() ||
@@ -412,7 +427,7 @@ Channel upgrade(Request& req, Response& res, Options opts) {
     auto impl = std::make_shared<Channel::Impl>();
     impl->opts = opts;
     impl->self = impl;
-    auto proto = pick_subprotocol_(req.header("Sec-WebSocket-Protocol"), opts.subprotocols);
+    auto proto = pick_subprotocol_(req.header(HeaderId::SecWebSocketProtocol), opts.subprotocols);
     impl->protocol = proto;
 
     res.status(Status::SwitchingProtocols)
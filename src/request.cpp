@@ -1,31 +1,203 @@
 /**
  * @file request.cpp
- * @brief Request lookups (headers, cookies, query parameters).
+ * @brief Request lookups (lazily parsed cookies and query parameters,
+ *        locals) and ownership on copy/move.
  */
 
 #include "socketify/request.h"
+#include "socketify/cookies.h"
+#include "socketify/detail/file_io.h"
 #include "socketify/detail/utils.h"
 
+#include <atomic>
+
 namespace socketify {
 
-std::string_view Request::header(std::string_view key) const {
-    auto it = headers_.find(std::string(key));
-    if (it == headers_.end()) return {};
-    return it->second;
+namespace detail {
+
+std::size_t next_local_slot() noexcept {
+    static std::atomic<std::size_t> next{0};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace detail
+
+namespace {
+
+// Point @p v at @p storage, copying the bytes there unless it already does.
+void own_view(std::string_view& v, std::string& storage) {
+    if (v.data() != storage.data() || v.size() != storage.size()) storage.assign(v);
+    v = storage;
+}
+
+} // namespace
+
+// body_ usually views body_storage_, whose (SSO) bytes travel with the
+// object; copies and moves re-point such a view at the new storage. Views
+// into the receive buffer are copied, so the result owns everything. The
+// pmr members of a copy or a move-constructed Request use the default
+// resource (the arena is rewound after the response), which also makes
+// the move ctor copy arena-backed locals. The lazy caches are copied under
+// other's lock, since another thread may be filling them.
+Request::Request(const Request& other)
+    : method_(other.method_), path_storage_(other.path_), target_storage_(other.target_),
+      version_storage_(other.version_), remote_ip_(other.remote_ip_),
+      headers_(other.headers_), params_(other.params_), body_file_(other.body_file_),
+      locals_(other.locals_), named_locals_(other.named_locals_) {
+    path_ = path_storage_;
+    target_ = target_storage_;
+    version_ = version_storage_;
+    std::ptrdiff_t off;
+    {
+        std::lock_guard<std::mutex> lock(other.lazy_mu_);
+        if (other.query_ready_.load(std::memory_order_relaxed)) {
+            query_ = other.query_;
+            query_ready_.store(true, std::memory_order_relaxed);
+        }
+        if (other.cookies_ready_.load(std::memory_order_relaxed)) {
+            cookies_ = other.cookies_;
+            cookies_ready_.store(true, std::memory_order_relaxed);
+        }
+        body_storage_ = other.body_storage_;
+        off = other.body_offset_();
+    }
+    rebind_body_(other.body_, off);
+}
+
+Request::Request(Request&& other) { *this = std::move(other); }
+
+Request& Request::operator=(const Request& other) {
+    if (this != &other) *this = Request(other);
+    return *this;
+}
+
+Request& Request::operator=(Request&& other) {
+    if (this == &other) return *this;
+    other.own_();
+    const std::ptrdiff_t off = other.body_offset_();
+    method_ = other.method_;
+    path_storage_ = std::move(other.path_storage_);
+    target_storage_ = std::move(other.target_storage_);
+    version_storage_ = std::move(other.version_storage_);
+    path_ = path_storage_;
+    target_ = target_storage_;
+    version_ = version_storage_;
+    other.path_ = other.target_ = other.version_ = {};
+    remote_ip_ = std::move(other.remote_ip_);
+    headers_ = std::move(other.headers_);
+    query_ = std::move(other.query_);
+    params_ = std::move(other.params_);
+    cookies_ = std::move(other.cookies_);
+    query_ready_.store(other.query_ready_.exchange(false), std::memory_order_relaxed);
+    cookies_ready_.store(other.cookies_ready_.exchange(false), std::memory_order_relaxed);
+    body_ready_.store(false, std::memory_order_relaxed);
+    other.body_ready_.store(false, std::memory_order_relaxed);
+    body_storage_ = std::move(other.body_storage_);
+    body_file_ = std::move(other.body_file_);
+    locals_ = std::move(other.locals_);
+    named_locals_ = std::move(other.named_locals_);
+    rebind_body_(other.body_, off);
+    other.body_ = {};
+    return *this;
+}
+
+void Request::set_body_file(detail::FileHandle f) {
+    body_file_ = std::make_shared<detail::FileHandle>(std::move(f));
+}
+
+void Request::own_() {
+    own_view(path_, path_storage_);
+    own_view(target_, target_storage_);
+    own_view(version_, version_storage_);
+    headers_.own();
+    rebind_body_(body_, body_offset_());
+}
+
+// body_ keeps viewing the receive buffer: body_view() callers see the
+// same bytes either way.
+const std::string& Request::body_string() const {
+    if (!body_ready_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(lazy_mu_);
+        if (!body_ready_.load(std::memory_order_relaxed)) {
+            if (!body_.empty() && body_offset_() < 0) body_storage_.assign(body_);
+            body_ready_.store(true, std::memory_order_release);
+        }
+    }
+    return body_storage_;
+}
+
+std::ptrdiff_t Request::body_offset_() const noexcept {
+    if (body_.empty() || body_storage_.empty()) return -1;
+    if (body_.data() < body_storage_.data() ||
+        body_.data() >= body_storage_.data() + body_storage_.size()) {
+        return -1;
+    }
+    return body_.data() - body_storage_.data();
+}
+
+void Request::rebind_body_(std::string_view from, std::ptrdiff_t off) {
+    if (off >= 0) {
+        body_ = std::string_view(body_storage_).substr(static_cast<std::size_t>(off), from.size());
+    } else if (!from.empty()) {
+        body_storage_.assign(from);
+        body_ = body_storage_;
+    } else {
+        body_ = {};
+    }
+}
+
+// The query string and Cookie header stay unparsed until a handler asks:
+// most requests never look at them.
+// The flag is set only after the map is complete, so a reader that sees
+// it needs no lock.
+const ParamMap& Request::query() const {
+    if (!query_ready_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(lazy_mu_);
+        if (!query_ready_.load(std::memory_order_relaxed)) {
+            if (const auto q = target_.find('?'); q != std::string_view::npos)
+                detail::parse_query_string(target_.substr(q + 1), query_);
+            query_ready_.store(true, std::memory_order_release);
+        }
+    }
+    return query_;
+}
+
+const CookieMap& Request::cookies() const {
+    if (!cookies_ready_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(lazy_mu_);
+        if (!cookies_ready_.load(std::memory_order_relaxed)) {
+            if (const auto header = headers_.get(HeaderId::Cookie); !header.empty())
+                cookies::parse_cookie_header(header, cookies_);
+            cookies_ready_.store(true, std::memory_order_release);
+        }
+    }
+    return cookies_;
 }
 
 std::string_view Request::cookie(std::string_view key) const {
-    auto it = cookies_.find(std::string(key));
-    if (it == cookies_.end()) return {};
+    const CookieMap& all = cookies();
+    auto it = all.find(std::string(key));
+    if (it == all.end()) return {};
     return it->second;
 }
 
 std::string_view Request::query_value(std::string_view key) const {
-    auto it = query_.find(std::string(key));
-    if (it == query_.end()) return {};
+    const ParamMap& all = query();
+    auto it = all.find(std::string(key));
+    if (it == all.end()) return {};
     return it->second;
 }
 
+void Request::set_local(std::string_view key, std::shared_ptr<void> value) {
+    for (auto& [k, v] : named_locals_) {
+        if (k == key) {
+            v = std::move(value);
+            return;
+        }
+    }
+    named_locals_.emplace_back(std::string(key), std::move(value));
+}
+
 std::optional<nlohmann::json> Request::json() const {
     if (body_.empty()) return std::nullopt;
     auto j = nlohmann::json::parse(body_, /*cb=*/nullptr, /*allow_exceptions=*/false);
@@ -5,13 +5,86 @@
 
 #include "socketify/response.h"
 #include "socketify/detail/file_io.h"
+#include "socketify/detail/utils.h"
 
 #include <filesystem>
 
 namespace socketify {
 
+namespace {
+
+std::uint8_t classify_header_(std::string_view key) noexcept {
+    using K = Response::KnownHeader;
+    auto bit = [](K k) { return static_cast<std::uint8_t>(k); };
+    switch (key.size()) {
+        case 4:  return detail::iequal_ascii(key, "Vary") ? bit(K::Vary) : 0;
+        case 10: return detail::iequal_ascii(key, H_Connection) ? bit(K::Connection) : 0;
+        case 12: return detail::iequal_ascii(key, H_ContentType) ? bit(K::ContentType) : 0;
+        case 14: return detail::iequal_ascii(key, H_ContentLength) ? bit(K::ContentLength) : 0;
+        case 16: return detail::iequal_ascii(key, H_ContentEncoding) ? bit(K::ContentEncoding) : 0;
+        default: return 0;
+    }
+}
+
+} // namespace
+
+// body_ usually views body_storage_, whose (SSO) bytes travel with the
+// object; copies and moves re-point such a view at the new storage. The
+// headers of a copy or a move-constructed Response go to the default
+// resource, never to the source's arena.
+Response::Response(const Response& other)
+    : status_code_(other.status_code_), known_headers_(other.known_headers_),
+      headers_(other.headers_), set_cookies_(other.set_cookies_), ended_(other.ended_),
+      kind_(other.kind_), body_storage_(other.body_storage_), file_path_(other.file_path_),
+      file_offset_(other.file_offset_), file_length_(other.file_length_), file_(other.file_),
+      stream_state_(other.stream_state_) {
+    rebind_body_(other.body_, other.body_offset_());
+}
+
+Response::Response(Response&& other) { *this = std::move(other); }
+
+Response& Response::operator=(const Response& other) {
+    if (this != &other) *this = Response(other);
+    return *this;
+}
+
+Response& Response::operator=(Response&& other) {
+    if (this == &other) return *this;
+    const std::ptrdiff_t off = other.body_offset_();
+    status_code_ = other.status_code_;
+    known_headers_ = other.known_headers_;
+    headers_ = std::move(other.headers_);
+    set_cookies_ = std::move(other.set_cookies_);
+    ended_ = other.ended_;
+    kind_ = other.kind_;
+    body_storage_ = std::move(other.body_storage_);
+    file_path_ = std::move(other.file_path_);
+    file_offset_ = other.file_offset_;
+    file_length_ = other.file_length_;
+    file_ = std::move(other.file_);
+    stream_state_ = std::move(other.stream_state_);
+    rebind_body_(other.body_, off);
+    other.body_ = {};
+    return *this;
+}
+
+std::ptrdiff_t Response::body_offset_() const noexcept {
+    if (body_.empty() || body_storage_.empty()) return -1;
+    if (body_.data() < body_storage_.data() ||
+        body_.data() >= body_storage_.data() + body_storage_.size()) {
+        return -1;
+    }
+    return body_.data() - body_storage_.data();
+}
+
+void Response::rebind_body_(std::string_view from, std::ptrdiff_t off) noexcept {
+    body_ = off < 0 ? from
+                    : std::string_view(body_storage_).substr(static_cast<std::size_t>(off), from.size());
+}
+
 Response& Response::set_header(std::string_view key, std::string_view value) {
     headers_[std::string(key)] = std::string(value);
+    known_headers_ |= classify_header_(key);
     return *this;
 }
 
@@ -27,7 +100,7 @@ Response& Response::clear_cookie(std::string_view name, std::string_view path) {
 bool Response::send(std::string_view body, std::string_view content_type) {
     if (ended_) return false;
     // Do not clobber a Content-Type set explicitly by the handler.
-    if (headers_.find(std::string(H_ContentType)) == headers_.end()) {
+    if (!has_known_header(KnownHeader::ContentType)) {
         set_content_type(content_type);
     }
     body_storage_.assign(body.data(), body.size());
@@ -96,15 +169,16 @@ void Response::redirect(std::string_view url, std::uint16_t code) {
 bool Response::send_file(std::string_view fs_path, bool download, std::string_view download_name) {
     if (ended_) return false;
 
-    detail::FileHandle fh;
-    if (!fh.open(fs_path)) return false;
+    auto fh = std::make_shared<detail::FileHandle>();
+    if (!fh->open(fs_path)) return false;
 
     kind_ = Kind::File;
     file_path_.assign(fs_path);
     file_offset_ = 0;
-    file_length_ = fh.size();
+    file_length_ = fh->size();
+    file_ = std::move(fh);
 
-    if (headers_.find(std::string(H_ContentType)) == headers_.end()) {
+    if (!has_known_header(KnownHeader::ContentType)) {
         set_content_type(content_type_for_path(fs_path));
     }
     if (download) {
@@ -121,16 +195,23 @@ bool Response::send_file(std::string_view fs_path, bool download, std::string_vi
 bool Response::send_file_range(std::string_view fs_path, std::uint64_t offset, std::uint64_t length) {
     if (ended_) return false;
 
-    detail::FileHandle fh;
-    if (!fh.open(fs_path)) return false;
-    if (offset > fh.size() || offset + length > fh.size()) return false;
+    auto fh = std::make_shared<detail::FileHandle>();
+    if (!fh->open(fs_path)) return false;
+    return send_file_range(std::move(fh), fs_path, offset, length);
+}
+
+bool Response::send_file_range(std::shared_ptr<const detail::FileHandle> file, std::string_view fs_path,
+                               std::uint64_t offset, std::uint64_t length) {
+    if (ended_ || !file || !file->valid()) return false;
+    if (offset > file->size() || length > file->size() - offset) return false;
 
     kind_ = Kind::File;
     file_path_.assign(fs_path);
     file_offset_ = offset;
     file_length_ = length;
+    file_ = std::move(file);
 
-    if (headers_.find(std::string(H_ContentType)) == headers_.end()) {
+    if (!has_known_header(KnownHeader::ContentType)) {
         set_content_type(content_type_for_path(fs_path));
     }
     ended_ = true;
@@ -4,10 +4,17 @@
  */
 
 #include "socketify/router.h"
+#include "socketify/detail/deferred_impl.h"
 #include "socketify/detail/utils.h"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <utility>
 
 namespace socketify {
 
@@ -17,7 +24,8 @@ std::vector<Route::Seg> Router::compile_pattern_(std::string_view pattern) {
         return segs; // empty segs means root
     }
 
-    auto parts = split_path_(pattern);
+    PathParts parts;
+    split_path_(pattern, parts);
     segs.reserve(parts.size());
 
     for (auto part : parts) {
@@ -34,8 +42,8 @@ std::vector<Route::Seg> Router::compile_pattern_(std::string_view pattern) {
     return segs;
 }
 
-std::vector<std::string_view> Router::split_path_(std::string_view s) {
-    std::vector<std::string_view> out;
+void Router::split_path_(std::string_view s, PathParts& out) {
+    out.clear();
     size_t start = 0;
     while (start < s.size()) {
         size_t pos = s.find('/', start);
@@ -47,7 +55,7 @@ std::vector<std::string_view> Router::split_path_(std::string_view s) {
             start = pos + 1;
         }
     }
-    return out; // "/" -> empty vector (root)
+    // "/" -> empty (root)
 }
 
 bool Router::starts_with_(std::string_view s, std::string_view pfx) {
@@ -67,29 +75,333 @@ bool Router::starts_with_public_(std::string_view s, std::string_view pfx) {
     return starts_with_(s, pfx);
 }
 
-// Match `path` against compiled `segs`. If matched, fill params.
-bool Router::match_and_bind_(std::string_view path,
-                             const std::vector<Route::Seg>& segs,
-                             ParamMap& params) {
-    // Root pattern (empty segs) matches only "/" or "".
-    if (segs.empty()) {
-        return path == "/" || path.empty();
+// ---------- Radix tree ----------
+
+namespace {
+
+constexpr std::size_t kMethodSlots = static_cast<std::size_t>(Method::ANY) + 1;
+
+constexpr std::size_t slot_(Method m) noexcept { return static_cast<std::size_t>(m); }
+constexpr std::uint32_t bit_(Method m) noexcept { return 1u << slot_(m); }
+
+constexpr std::uint64_t kFnvOffset = 14695981039346656037ull;
+constexpr std::uint64_t kFnvPrime = 1099511628211ull;
+
+// FNV-1a over the segments, each preceded by '/': the same value for a
+// path however its slashes are doubled.
+template <class Parts>
+std::uint64_t hash_parts_(const Parts& parts) noexcept {
+    std::uint64_t h = kFnvOffset;
+    for (const auto& part : parts) {
+        h = (h ^ '/') * kFnvPrime;
+        for (const char c : part) h = (h ^ static_cast<unsigned char>(c)) * kFnvPrime;
     }
+    return h;
+}
 
-    auto parts = split_path_(path);
-    params.clear();
+// splitmix64 finaliser, to place a key given its bucket's seed.
+std::uint64_t mix_(std::uint64_t h) noexcept {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    return h ^ (h >> 31);
+}
+
+std::size_t pow2_at_least_(std::size_t n) noexcept {
+    std::size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+} // namespace
+
+// `label` holds the static segments on the edge into the node: one each
+// while building, then chains of single-child nodes without routes are
+// merged. Children are the static ones (sorted by their first segment),
+// the parameter and the wildcard, which ends a branch.
+struct Router::Node {
+    std::vector<std::string> label;
+    std::vector<std::unique_ptr<Node>> statics;
+    std::unique_ptr<Node> param;
+    std::unique_ptr<Node> wildcard;
+    std::array<const Route*, kMethodSlots> methods{}; ///< first route per method
+    bool terminal{false};                             ///< some route ends here
+    /// Lowest registration index in this subtree: a lookup skips the
+    /// branch once it holds an earlier match.
+    std::size_t first{SIZE_MAX};
+
+    Node* static_child(std::string_view seg) const {
+        auto it = std::lower_bound(statics.begin(), statics.end(), seg,
+                                   [](const std::unique_ptr<Node>& c, std::string_view s) {
+                                       return std::string_view(c->label.front()) < s;
+                                   });
+        return it != statics.end() && (*it)->label.front() == seg ? it->get() : nullptr;
+    }
+
+    Node& add_static(const std::string& seg) {
+        auto it = std::lower_bound(statics.begin(), statics.end(), seg,
+                                   [](const std::unique_ptr<Node>& c, const std::string& s) {
+                                       return c->label.front() < s;
+                                   });
+        if (it == statics.end() || (*it)->label.front() != seg) {
+            it = statics.insert(it, std::make_unique<Node>());
+            (*it)->label.push_back(seg);
+        }
+        return **it;
+    }
+
+    void compress() {
+        for (auto& c : statics) {
+            while (!c->terminal && !c->param && !c->wildcard && c->statics.size() == 1) {
+                std::unique_ptr<Node> only = std::move(c->statics.front());
+                c->label.insert(c->label.end(), std::make_move_iterator(only->label.begin()),
+                                std::make_move_iterator(only->label.end()));
+                c->statics = std::move(only->statics);
+                c->param = std::move(only->param);
+                c->wildcard = std::move(only->wildcard);
+                c->methods = only->methods;
+                c->terminal = only->terminal;
+            }
+            c->compress();
+        }
+        if (param) param->compress();
+    }
+
+    // The earliest route here that takes @p m: its own, ANY, and for HEAD
+    // also GET (the body is stripped later).
+    const Route* pick(Method m) const noexcept {
+        const Route* best = methods[slot_(m)];
+        auto consider = [&best](const Route* r) {
+            if (r && (!best || r->order_ < best->order_)) best = r;
+        };
+        if (m == Method::HEAD) consider(methods[slot_(Method::GET)]);
+        consider(methods[slot_(Method::ANY)]);
+        return best;
+    }
+
+    void note(Miss& miss) const noexcept {
+        miss.path_matched = true;
+        for (std::size_t k = 0; k < slot_(Method::ANY); ++k)
+            if (methods[k] && k != slot_(Method::UNKNOWN)) miss.allowed |= 1u << k;
+    }
+
+    // Depth first from parts[i], keeping the earliest matching route in
+    // @p best; a branch whose routes were all registered after it is
+    // skipped. Nodes that match the path but not the method note a miss.
+    void find(Method m, const PathParts& parts, std::size_t i, Miss& miss, const Route*& best) const {
+        if (best && first >= best->order_) return;
+        if (i == parts.size() && terminal) consider(m, miss, best);
+        if (i < parts.size()) {
+            if (const Node* c = static_child(parts[i])) {
+                const std::size_t n = c->label.size();
+                if (parts.size() - i >= n &&
+                    std::equal(c->label.begin() + 1, c->label.end(), parts.begin() + static_cast<std::ptrdiff_t>(i) + 1)) {
+                    c->find(m, parts, i + n, miss, best);
+                }
+            }
+            if (param) param->find(m, parts, i + 1, miss, best);
+        }
+        if (wildcard) wildcard->consider(m, miss, best);
+    }
+
+    void consider(Method m, Miss& miss, const Route*& best) const {
+        const Route* r = pick(m);
+        if (!r) {
+            note(miss);
+        } else if (!best || r->order_ < best->order_) {
+            best = r;
+        }
+    }
+
+    // The node reached from here through static edges only.
+    const Node* exact(const PathParts& parts, std::size_t i) const {
+        if (i == parts.size()) return this;
+        const Node* c = static_child(parts[i]);
+        const std::size_t n = c ? c->label.size() : 0;
+        if (!c || parts.size() - i < n ||
+            !std::equal(c->label.begin() + 1, c->label.end(), parts.begin() + static_cast<std::ptrdiff_t>(i) + 1))
+            return nullptr;
+        return c->exact(parts, i + n);
+    }
+};
+
+// Hash-and-displace perfect hash over the parameterless route paths: a
+// path's hash picks a bucket, the bucket's seed picks its slot, and
+// build() searches seeds until no two paths share a slot. A hit holds the
+// tree's answer for the path per method, computed by build(); a method
+// without one (a 405 or 404) goes to the tree.
+struct Router::StaticIndex {
+    struct Slot {
+        std::vector<std::string> parts; ///< empty for an unused slot
+        const Node* node{nullptr};
+        std::array<const Route*, kMethodSlots> routes{};
+    };
+    std::vector<std::uint64_t> seeds; ///< per bucket
+    std::vector<Slot> slots;
+
+    std::size_t place(std::uint64_t h, std::uint64_t seed) const noexcept {
+        return static_cast<std::size_t>(mix_(h ^ seed)) & (slots.size() - 1);
+    }
+
+    const Slot* find(const PathParts& parts) const noexcept {
+        const std::uint64_t h = hash_parts_(parts);
+        const Slot& s = slots[place(h, seeds[static_cast<std::size_t>(h) & (seeds.size() - 1)])];
+        if (!s.node || s.parts.size() != parts.size() ||
+            !std::equal(s.parts.begin(), s.parts.end(), parts.begin()))
+            return nullptr;
+        return &s;
+    }
+
+    // False when no seed separates some bucket (the tree then serves
+    // every path).
+    bool build(std::vector<Slot> keys) {
+        seeds.assign(pow2_at_least_(keys.size() / 4 + 1), 0);
+        slots.assign(pow2_at_least_(keys.size() * 2 + 1), Slot{});
+
+        std::vector<std::uint64_t> hashes;
+        std::vector<std::vector<std::size_t>> buckets(seeds.size());
+        for (const auto& k : keys) {
+            hashes.push_back(hash_parts_(k.parts));
+            buckets[static_cast<std::size_t>(hashes.back()) & (seeds.size() - 1)].push_back(hashes.size() - 1);
+        }
+        std::vector<std::size_t> order(buckets.size());
+        for (std::size_t b = 0; b < order.size(); ++b) order[b] = b;
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            return buckets[a].size() > buckets[b].size();
+        });
+
+        std::vector<std::size_t> placed;
+        for (const std::size_t b : order) {
+            if (buckets[b].empty()) break;
+            bool ok = false;
+            for (std::uint64_t seed = 1; !ok && seed <= 4096; ++seed) {
+                placed.clear();
+                ok = true;
+                for (const std::size_t k : buckets[b]) {
+                    const std::size_t at = place(hashes[k], seed);
+                    if (slots[at].node || std::find(placed.begin(), placed.end(), at) != placed.end()) {
+                        ok = false;
+                        break;
+                    }
+                    placed.push_back(at);
+                }
+                if (ok) seeds[b] = seed;
+            }
+            if (!ok) return false;
+            for (std::size_t j = 0; j < placed.size(); ++j)
+                slots[placed[j]] = std::move(keys[buckets[b][j]]);
+        }
+        return true;
+    }
+};
+
+Router::Router() = default;
+Router::~Router() = default;
+
+Route& Route::Use(Middleware mw) {
+    middlewares_.push_back(std::move(mw));
+    if (router_) router_->stale_ = true;
+    return *this;
+}
+
+void Router::build() const {
+    auto root = std::make_unique<Node>();
+    for (const auto& r : routes_) {
+        r.chain_.clear();
+        for (const auto& mw : global_mw_) r.chain_.push_back(&mw);
+        for (const auto& g : groups_) {
+            if (!prefix_matches_(r.pattern(), g.prefix())) continue;
+            for (const auto& mw : g.middlewares()) r.chain_.push_back(&mw);
+        }
+        for (const auto& mw : r.middlewares()) r.chain_.push_back(&mw);
+
+        Node* n = root.get();
+        n->first = std::min(n->first, r.order_);
+        for (const auto& seg : r.segs_) {
+            switch (seg.kind) {
+                case Route::Seg::Static:
+                    n = &n->add_static(seg.text);
+                    break;
+                case Route::Seg::Param:
+                    if (!n->param) n->param = std::make_unique<Node>();
+                    n = n->param.get();
+                    break;
+                case Route::Seg::Wildcard:
+                    if (!n->wildcard) n->wildcard = std::make_unique<Node>();
+                    n = n->wildcard.get();
+                    break;
+            }
+            n->first = std::min(n->first, r.order_);
+        }
+        const Route*& slot = n->methods[slot_(r.method())];
+        if (!slot) slot = &r; // the first registration wins
+        n->terminal = true;
+    }
+    root->compress();
+
+    // Index the parameterless paths once compress() has settled the nodes.
+    // An earlier :param or *wildcard route may take such a path, so each
+    // key stores the tree's own answer per method.
+    std::vector<StaticIndex::Slot> keys;
+    for (const auto& r : routes_) {
+        if (!std::all_of(r.segs_.begin(), r.segs_.end(),
+                         [](const Route::Seg& seg) { return seg.kind == Route::Seg::Static; }))
+            continue;
+        StaticIndex::Slot key;
+        for (const auto& seg : r.segs_) key.parts.push_back(seg.text);
+        std::byte scratch[512];
+        std::pmr::monotonic_buffer_resource mem(scratch, sizeof(scratch));
+        const PathParts parts(key.parts.begin(), key.parts.end(), &mem);
+        key.node = root->exact(parts, 0);
+        assert(key.node);
+        for (std::size_t k = 0; k < kMethodSlots; ++k) {
+            Miss miss;
+            root->find(static_cast<Method>(k), parts, 0, miss, key.routes[k]);
+        }
+        keys.push_back(std::move(key));
+    }
+    // One key per path, whatever its methods.
+    std::sort(keys.begin(), keys.end(),
+              [](const StaticIndex::Slot& a, const StaticIndex::Slot& b) { return a.parts < b.parts; });
+    keys.erase(std::unique(keys.begin(), keys.end(),
+                           [](const StaticIndex::Slot& a, const StaticIndex::Slot& b) { return a.parts == b.parts; }),
+               keys.end());
+    static_index_.reset();
+    if (!keys.empty()) {
+        auto index = std::make_unique<StaticIndex>();
+        if (index->build(std::move(keys))) static_index_ = std::move(index);
+    }
+
+    tree_ = std::move(root);
+    stale_ = false;
+}
+
+const Route* Router::find_(Method m, const PathParts& parts, Miss& miss) const {
+    if (stale_) build();
+    if (static_index_) {
+        if (const StaticIndex::Slot* s = static_index_->find(parts)) {
+            if (const Route* r = s->routes[slot_(m)]) return r;
+        }
+    }
+    const Route* best = nullptr;
+    tree_->find(m, parts, 0, miss, best);
+    return best;
+}
 
-    size_t i = 0, j = 0;
-    while (i < parts.size() && j < segs.size()) {
-        const auto& seg = segs[j];
+// Fill `params` for the route that matched `parts`: only the winner pays
+// for the strings.
+void Router::bind_(const PathParts& parts, const std::vector<Route::Seg>& segs,
+                   ParamMap& params) {
+    params.clear();
+    size_t i = 0;
+    for (const auto& seg : segs) {
         switch (seg.kind) {
             case Route::Seg::Static:
-                if (parts[i] != seg.text) return false;
-                ++i; ++j;
+                ++i;
                 break;
             case Route::Seg::Param:
-                params[seg.text] = std::string(parts[i]);
-                ++i; ++j;
+                params[seg.text] = std::string(parts[i++]);
                 break;
             case Route::Seg::Wildcard: {
                 std::string rest;
@@ -98,131 +410,120 @@ bool Router::match_and_bind_(std::string_view path,
                     rest.append(parts[i].data(), parts[i].size());
                 }
                 params[seg.text] = std::move(rest);
-                ++j;
-                i = parts.size();
                 break;
             }
         }
     }
-
-    if (j < segs.size()) {
-        if (!(segs[j].kind == Route::Seg::Wildcard && j + 1 == segs.size())) {
-            return false;
-        }
-        params[segs[j].text] = "";
-        ++j;
-    }
-    return i == parts.size() && j == segs.size();
 }
 
 // ---------- Router public API ----------
-bool Router::dispatch(Request& req, Response& res) const {
-    // Build a chain of GLOBAL middleware only, and let a terminal lambda
-    // perform route lookup + per-route middleware + handler.
-    size_t idx = 0;
-    bool handled = false;
-
-    std::function<void()> next;
-    next = [&]() {
-        if (res.ended()) return;
-
-        if (idx < global_mw_.size()) {
-            auto& mw = global_mw_[idx++];
-            mw(req, res, next);
-            return;
-        }
-
-        // ---- Terminal stage: do routing now ----
-        const Method method = req.method();
-        const std::string_view path = req.path();
-
-        const Route* matched = nullptr;
-
-        bool path_matched_any = false;
-        std::vector<Method> allowed;
-        ParamMap bound;
-
-        for (const auto& r : routes_) {
-            ParamMap candidate;
-            if (!match_and_bind_(path, r.segs_, candidate)) continue;
-
-            path_matched_any = true;
+const Route* Router::match(Method m, std::string_view path, ParamMap* params) const {
+    // No Request (and arena) yet: split into stack memory.
+    std::byte scratch[512];
+    std::pmr::monotonic_buffer_resource mem(scratch, sizeof(scratch));
+    PathParts parts(&mem);
+    split_path_(path, parts);
+    Miss miss;
+    const Route* r = find_(m, parts, miss);
+    if (r && params) bind_(parts, r->segs_, *params);
+    return r;
+}
 
-            const bool method_ok =
-                r.method() == Method::ANY || r.method() == method ||
-                // HEAD falls back to GET handlers (body is stripped later).
-                (method == Method::HEAD && r.method() == Method::GET);
+bool Router::streams_bodies() const noexcept {
+    for (const auto& r : routes_)
+        if (r.streams_body()) return true;
+    return false;
+}
 
-            if (method_ok) {
-                bound = std::move(candidate);
-                matched = &r;
-                break;
-            }
-            if (r.method() != Method::UNKNOWN && r.method() != Method::ANY) {
-                allowed.push_back(r.method());
+// One request's trip: global middleware, routing, the rest of the matched
+// route's chain, its handler. `next` captures only `this`, so it fits in
+// std::function's inline storage and passing it to a middleware by value
+// allocates nothing.
+struct Router::Walk {
+    const Router& router;
+    Request& req;
+    Response& res;
+    const Route* route{nullptr};
+    std::size_t idx{0};
+    bool routed{false};
+    bool handled{false};
+    Next next{[this] { step(); }};
+
+    void step() {
+        if (res.ended()) return;
+        if (!routed) {
+            // The global prefix of every chain, run before the lookup.
+            if (idx < router.global_mw_.size()) {
+                router.global_mw_[idx++](req, res, next);
+                return;
             }
+            if (!resolve()) return;
         }
+        if (!route) return;
+        const auto& chain = route->chain_;
+        if (idx < chain.size()) {
+            (*chain[idx++])(req, res, next);
+        } else if (idx++ == chain.size()) {
+            run_handler();
+        }
+    }
 
-        if (!matched) {
-            if (path_matched_any) {
-                std::sort(allowed.begin(), allowed.end(),
-                          [](Method a, Method b){ return static_cast<int>(a) < static_cast<int>(b); });
-                allowed.erase(std::unique(allowed.begin(), allowed.end()), allowed.end());
+    // Look the route up once the global middleware is through; sends the
+    // 405 when only the method is wrong.
+    bool resolve() {
+        routed = true;
+        // Scratch space lives on the request's arena.
+        PathParts parts(req.arena());
+        split_path_(req.path(), parts);
+        Miss miss;
+        route = router.find_(req.method(), parts, miss);
 
-                if (std::find(allowed.begin(), allowed.end(), Method::GET) != allowed.end() &&
-                    std::find(allowed.begin(), allowed.end(), Method::HEAD) == allowed.end()) {
-                    allowed.push_back(Method::HEAD);
-                }
+        if (!route) {
+            if (miss.path_matched) {
+                if (miss.allowed & bit_(Method::GET)) miss.allowed |= bit_(Method::HEAD);
 
                 std::string allow_header;
-                for (size_t i = 0; i < allowed.size(); ++i) {
-                    if (i) allow_header.append(", ");
-                    allow_header.append(std::string(to_string(allowed[i])));
+                for (std::size_t k = 0; k < slot_(Method::ANY); ++k) {
+                    if (!(miss.allowed & (1u << k))) continue;
+                    if (!allow_header.empty()) allow_header.append(", ");
+                    allow_header.append(to_string(static_cast<Method>(k)));
                 }
 
                 handled = true;
                 res.status(Status::MethodNotAllowed)
                    .set_header("Allow", allow_header)
                    .send("Method Not Allowed\n");
-                return;
             }
             // no route at all -> let caller send 404
-            return;
+            return false;
         }
 
-        req.mutable_params() = std::move(bound);
+        if (!route->typed()) bind_(parts, route->segs_, req.mutable_params());
         handled = true;
+        return true;
+    }
 
-        // Build chain: group MWs + route MWs + final handler
-        std::vector<const Middleware*> chain;
-        for (const auto& g : groups_) {
-            if (prefix_matches_(matched->pattern(), g.prefix())) {
-                for (const auto& mw : g.middlewares()) chain.push_back(&mw);
+    void run_handler() {
+        if (route->blocking()) {
+            // The worker hands the handler to the blocking pool once the
+            // request is off its stack.
+            if (defer(res).valid()) {
+                std::static_pointer_cast<Deferred::Impl>(res.stream_state())->offload =
+                    &route->handler();
             }
+            return;
         }
-        for (const auto& mw : matched->middlewares()) chain.push_back(&mw);
-
-        const Middleware handler_stage = [matched](Request& rq, Response& rs, Next){
-            matched->handler()(rq, rs);
-        };
-        chain.push_back(&handler_stage);
-
-        // Execute per-route chain
-        size_t j = 0;
-        std::function<void()> step;
-        step = [&]() {
-            if (j >= chain.size() || res.ended()) return;
-            const auto& mw = *chain[j++];
-            mw(req, res, step);
-        };
-        step();
-    };
+        route->handler()(req, res);
+    }
+};
 
-    // Kick off global chain
-    next();
+bool Router::dispatch(Request& req, Response& res) const {
+    if (stale_) build();
+    Walk walk{*this, req, res};
+    walk.step();
 
     // Handled when a route/405 ran, or some middleware ended the response.
-    return handled || res.ended();
+    return walk.handled || res.ended();
 }
 
 } // namespace socketify
@@ -1,22 +1,35 @@
 /**
  * @file server.cpp
- * @brief Event-driven server core: SO_REUSEPORT listeners, one epoll loop
- *        per worker, incremental parsing, keep-alive/pipelining, TLS,
- *        sendfile streaming and SSE connection adoption.
+ * @brief Event-driven server core: SO_REUSEPORT listeners, one event loop
+ *        (epoll or io_uring) per worker, incremental parsing, keep-alive/pipelining, TLS,
+ *        sendfile streaming, deferred responses, SSE connection adoption and
+ *        HTTP/2 sessions.
  */
 
 #include "socketify/server.h"
 
+#include "socketify/detail/arena.h"
+#include "socketify/detail/body_stream_impl.h"
 #include "socketify/detail/buffer.h"
+#include "socketify/detail/cpu_affinity.h"
+#include "socketify/detail/deferred_impl.h"
 #include "socketify/detail/file_io.h"
+#include "socketify/detail/http2.h"
 #include "socketify/detail/http_parser.h"
 #include "socketify/detail/loop.h"
+#include "socketify/detail/output_queue.h"
+#include "socketify/detail/response_writer.h"
+#include "socketify/detail/slab.h"
 #include "socketify/detail/socket.h"
+#include "socketify/detail/thread_pool.h"
+#include "socketify/task.h"
 #include "socketify/detail/sse_impl.h"
+#include "socketify/detail/chunked_impl.h"
 #include "socketify/detail/pulse_impl.h"
 #include "socketify/detail/utils.h"
 
 #include <arpa/inet.h>
+#include <cerrno>
 #include <csignal>
 #include <cstring>
 #include <netdb.h>
@@ -26,8 +39,12 @@
 
 #include <algorithm>
 #include <chrono>
+#include <future>
+#include <iterator>
 #include <memory>
+#include <optional>
 #include <unordered_map>
+#include <utility>
 
 using namespace std::chrono;
 
@@ -35,155 +52,6 @@ namespace socketify {
 
 namespace {
 
-// ---------------------------------------------------------------------------
-// Response serialization
-// ---------------------------------------------------------------------------
-
-std::string_view find_header_(const HeaderMap& h, std::string_view key) {
-    auto it = h.find(std::string(key));
-    if (it == h.end()) return {};
-    return it->second;
-}
-
-/// Serialize status line + headers (+ buffered body) into `out`.
-/// For File/Stream responses only the head is emitted; the caller streams
-/// the rest.
-void serialize_response_(std::string& out,
-                         const Request& req,
-                         Response& res,
-                         const ServerOptions& opts,
-                         bool head_request,
-                         bool close_connection) {
-    std::string body;
-    if (res.kind() == Response::Kind::Buffered) {
-        body = res.take_body();
-    }
-
-    // ---- Compression (buffered responses only) ----
-    std::string content_encoding_value;
-    if (res.kind() == Response::Kind::Buffered && opts.compression.enable &&
-        !body.empty() &&
-        find_header_(res.headers(), H_ContentEncoding).empty()) {
-        const auto ae = find_header_(req.headers(), H_AcceptEncoding);
-        auto enc = compression::negotiate_accept_encoding(ae, opts.compression);
-        if (enc != compression::Encoding::None) {
-            const auto ct = find_header_(res.headers(), H_ContentType);
-            if (compression::is_compressible_type(ct, opts.compression) &&
-                body.size() >= opts.compression.min_size) {
-                std::string compressed;
-                bool ok = false;
-                if (enc == compression::Encoding::Gzip) {
-                    ok = compression::gzip_compress(body, compressed);
-                    content_encoding_value = "gzip";
-                } else if (enc == compression::Encoding::Deflate) {
-                    ok = compression::deflate_compress(body, compressed);
-                    content_encoding_value = "deflate";
-                }
-                if (ok && compressed.size() < body.size()) {
-                    body.swap(compressed);
-                } else {
-                    content_encoding_value.clear();
-                }
-            }
-        }
-    }
-
-    // ---- Default Content-Type for non-empty buffered bodies ----
-    std::string forced_content_type;
-    if (!body.empty() && find_header_(res.headers(), H_ContentType).empty()) {
-        auto begins_with = [&](std::string_view s, std::string_view pfx) {
-            return s.size() >= pfx.size() &&
-                   std::equal(pfx.begin(), pfx.end(), s.begin(),
-                              [](char a, char b) { return (a | 32) == (b | 32); });
-        };
-        forced_content_type = (begins_with(body, "<!doctype") || begins_with(body, "<html"))
-                                  ? "text/html; charset=utf-8"
-                                  : "text/plain; charset=utf-8";
-    }
-
-    // ---- Head ----
-    unsigned code = res.status_code() ? res.status_code() : 200u;
-    out.reserve(out.size() + 256 + body.size());
-    out += "HTTP/1.1 ";
-    out += std::to_string(code);
-    out.push_back(' ');
-    out += std::string(reason(static_cast<Status>(code)));
-    out += "\r\n";
-
-    out += "Date: ";
-    out += detail::http_date_now();
-    out += "\r\nServer: socketify\r\n";
-
-    bool have_vary = false;
-    for (const auto& kv : res.headers()) {
-        std::string low = detail::to_lower_copy(kv.first);
-        if (low == "content-length" || low == "connection") continue;
-        if (low == "vary") have_vary = true;
-        out += kv.first;
-        out += ": ";
-        out += kv.second;
-        out += "\r\n";
-    }
-    for (const auto& sc : res.set_cookies()) {
-        out += "Set-Cookie: ";
-        out += sc;
-        out += "\r\n";
-    }
-    if (!forced_content_type.empty()) {
-        out += "Content-Type: ";
-        out += forced_content_type;
-        out += "\r\n";
-    }
-    if (!content_encoding_value.empty()) {
-        out += "Content-Encoding: ";
-        out += content_encoding_value;
-        out += "\r\n";
-        if (!have_vary) out += "Vary: Accept-Encoding\r\n";
-    }
-
-    switch (res.kind()) {
-        case Response::Kind::Buffered:
-            out += "Content-Length: ";
-            out += std::to_string(body.size());
-            out += "\r\n";
-            break;
-        case Response::Kind::File:
-            out += "Content-Length: ";
-            out += std::to_string(res.file_length());
-            out += "\r\n";
-            break;
-        case Response::Kind::Stream:
-            // Stream length is unknown; the connection closes at the end.
-            break;
-        case Response::Kind::Pulse:
-            // Pulse (WebSocket) has no body after the 101 handshake.
-            break;
-    }
-
-    if (res.kind() == Response::Kind::Pulse) {
-        out += "Connection: Upgrade\r\n";
-    } else {
-        out += close_connection ? "Connection: close\r\n" : "Connection: keep-alive\r\n";
-    }
-    out += "\r\n";
-
-    if (!head_request && !body.empty()) {
-        out += body;
-    }
-}
-
-bool wants_close_(const Request& req, const Response& res) {
-    auto rconn = find_header_(req.headers(), H_Connection);
-    if (!rconn.empty()) {
-        if (detail::iequal_ascii(rconn, "close")) return true;
-        if (detail::iequal_ascii(rconn, "keep-alive")) return false;
-    }
-    auto sconn = find_header_(res.headers(), H_Connection);
-    if (!sconn.empty() && detail::iequal_ascii(sconn, "close")) return true;
-    // HTTP/1.0 defaults to close; HTTP/1.1 defaults to keep-alive.
-    return req.http_version() == "HTTP/1.0";
-}
-
 std::string peer_ip_(const sockaddr_storage& ss) {
     char buf[INET6_ADDRSTRLEN] = {0};
     if (ss.ss_family == AF_INET) {
@@ -196,6 +64,23 @@ std::string peer_ip_(const sockaddr_storage& ss) {
     return buf;
 }
 
+// Percent-decode a request path. Without escapes it is @p raw itself and
+// @p storage stays empty; otherwise it is @p storage. nullopt when the
+// escapes are malformed or decode to a NUL.
+std::optional<std::string_view> decode_path_(std::string_view raw, std::string& storage) {
+    if (raw.find_first_of(std::string_view("%\0", 2)) == std::string_view::npos) return raw;
+    if (!detail::url_decode(raw, storage) || storage.find('\0') != std::string::npos) return std::nullopt;
+    return std::string_view(storage);
+}
+
+// A stream or upgrade HTTP/2 can not carry: its handle refuses writes.
+template <class Impl>
+void refuse_stream_(const std::shared_ptr<void>& state) {
+    auto impl = std::static_pointer_cast<Impl>(state);
+    std::lock_guard<std::mutex> lk(impl->mu);
+    impl->closed = true;
+}
+
 } // namespace
 
 // ---------------------------------------------------------------------------
@@ -206,41 +91,128 @@ namespace detail {
 
 class Worker;
 
-/// Token shared with SSE handles; expires with the connection.
-struct ConnToken {
-    Worker* worker;
-    struct Connection* conn;
-};
+/// Loop token for the listener. Connection handles never have a zero
+/// generation, so this can not collide with one.
+constexpr std::uint64_t kListenerToken = 1;
 
+/// Pooled per-worker connection state. Objects are recycled through the
+/// worker's Slab; reset() returns one to the freshly-constructed state
+/// while keeping modest buffer capacity for the next connection.
 struct Connection {
+    Worker* owner{nullptr};
+    std::uint64_t handle{0}; ///< Slab handle (also the loop token); 0 when free.
     Socket sock;
     Buffer in;
-    std::string out;
-    std::size_t out_off{0};
+    OutputQueue out;
     HttpParser parser;
 
     bool close_after{false};
-    bool sent_100{false};
+    bool head_routed{false}; ///< route_head_() ran for the current message
     bool head_request{false};
     bool in_request{false}; ///< bytes of the current request already arrived
-
-    // File streaming (after `out` drains).
-    FileHandle file;
+    bool fresh{true};       ///< no request yet: an HTTP/2 preface may come
+    bool ring_input{false}; ///< the loop receives for us (multishot recv)
+    bool ring_output{false}; ///< ...and sends for us (EventLoop::send())
+    bool sending{false};     ///< a loop send() of `out`/`file` is in flight
+
+    // Zero-copy parsing: the first msg_off bytes of `in` are the current
+    // message, already parsed and still referenced by the parser (and the
+    // Request built from it) until the response is serialized.
+    std::size_t msg_off{0};
+    Headers headers; ///< recycled Request headers
+
+    // Fairness: set when a turn ended on a budget rather than on EAGAIN or
+    // an empty buffer; the worker's ready list brings the connection back.
+    bool ready_queued{false};
+    bool read_pending{false};  ///< socket may still hold unread bytes
+    bool parse_pending{false}; ///< `in` still holds complete pipelined requests
+
+    /// Unwritten output passed the high-water mark: EPOLLIN is dropped and
+    /// parsing stops until it drains to the low mark.
+    bool read_paused{false};
+
+    // Streamed request body (Route::OnBody): the head is built when it
+    // arrives and waits in body_req while the pieces go to the route's
+    // body handler. body_paused is read_paused for BodyStream::pause().
+    const Route* body_route{nullptr};
+    std::unique_ptr<Request> body_req;
+    std::shared_ptr<BodyStream::Impl> body_stream;
+    bool body_paused{false};
+    bool body_failed{false}; ///< the body handler threw; answer 500
+
+    // File streaming (after `out` drains); the descriptor is the
+    // Response's, possibly shared with static_files' cache.
+    std::shared_ptr<const FileHandle> file;
     std::uint64_t file_off{0};
     std::uint64_t file_end{0};
 
     // SSE / Pulse adoption.
     std::shared_ptr<sse::Session::Impl> sse;
+    std::shared_ptr<chunked::Writer::Impl> chunked; ///< until the stream ends
     std::shared_ptr<pulse::Channel::Impl> pulse;
-    std::shared_ptr<ConnToken> token;
 
+    // Deferred response: the request waits here until the handle finishes.
+    // Weak, so dropping every user handle reaches Deferred::Impl's 500.
+    std::weak_ptr<Deferred::Impl> deferred;
+    std::shared_ptr<Request> deferred_req;
+
+    // HTTP/2: the session, and the streams whose Deferred answer is pending
+    // (each keeps its Request like deferred_req).
+    std::unique_ptr<h2::Session> h2;
+    struct H2Deferred {
+        std::weak_ptr<Deferred::Impl> impl;
+        std::shared_ptr<Request> req;
+    };
+    std::unordered_map<std::uint32_t, H2Deferred> h2_deferred;
+
+    bool registered_read{true};
     bool registered_write{false};
-    steady_clock::time_point deadline{};
+    Timer deadline; ///< Header/body/idle timeout; disarmed for SSE/Pulse.
+
+    enum class Phase : std::uint8_t { Handshake, Http, Http2, Sse, Pulse, Chunked } phase{Phase::Http};
 
-    enum class Phase : std::uint8_t { Handshake, Http, Sse, Pulse } phase{Phase::Http};
+    /// `in` holds bytes the parser has not seen yet.
+    bool has_unparsed_input() const noexcept { return in.size() > msg_off; }
 
     bool has_pending_output() const {
-        return out_off < out.size() || (file.valid() && file_off < file_end);
+        return !out.empty() || (file && file_off < file_end) || sending;
+    }
+
+    /// A deferred response is outstanding; later pipelined requests wait.
+    bool awaiting() const noexcept { return deferred_req != nullptr; }
+
+    /// Input capacity kept across requests and pooled connections (about
+    /// one request head); a larger buffer is released once it drains.
+    static constexpr std::size_t kRetainInput = 8 * 1024;
+
+    void reset() {
+        sock = Socket();
+        in.clear();
+        if (in.capacity() > kRetainInput) in = Buffer();
+        out.clear();
+        parser.reset();
+        msg_off = 0;
+        close_after = head_routed = head_request = in_request = false;
+        fresh = true;
+        ring_input = ring_output = sending = false;
+        ready_queued = read_pending = parse_pending = read_paused = false;
+        body_route = nullptr;
+        body_req.reset();
+        body_stream.reset();
+        body_paused = body_failed = false;
+        file.reset();
+        file_off = file_end = 0;
+        sse.reset();
+        chunked.reset();
+        pulse.reset();
+        deferred.reset();
+        deferred_req.reset();
+        h2.reset();
+        h2_deferred.clear();
+        registered_read = true;
+        registered_write = false;
+        phase = Phase::Http;
+        handle = 0;
     }
 };
 
@@ -250,9 +222,33 @@ struct Connection {
 
 class Worker {
 public:
-    Worker(Server& srv) : srv_(srv) {}
+    /// @param cpu CPU the worker thread is pinned to, or -1 if it floats.
+    /// Construct on that thread, after place_thread(), so the loop, rings,
+    /// arena and counters are allocated on its node.
+    Worker(Server& srv, int cpu)
+        : srv_(srv),
+          loop_(srv.opts_.io_backend == IoBackend::IoUring ? LoopBackend::IoUring
+                                                           : LoopBackend::Epoll),
+          cpu_(cpu), streams_bodies_(srv.router_.streams_bodies()),
+          arena_(srv.opts_.request_arena_size) {
+        loop_.set_edge_triggered(srv.opts_.edge_triggered);
+        stream_policy_.high = srv.opts_.output_high_water;
+        stream_policy_.low = srv.opts_.output_low_water;
+        stream_policy_.counters = &stats_.streams;
+        switch (srv.opts_.stream_overflow) {
+        case SlowConsumer::Drop: stream_policy_.action = OverflowAction::Drop; break;
+        case SlowConsumer::Close: stream_policy_.action = OverflowAction::Close; break;
+        case SlowConsumer::Block: stream_policy_.action = OverflowAction::Block; break;
+        }
+        // Prefault the first slab chunk here instead of on the first accept.
+        if (srv.opts_.numa_local) conns_.reserve(1);
+    }
     ~Worker() { close_listener_(); }
 
+    /// Pins the calling thread and, with numa_local, makes its allocations
+    /// node-local. Runs before the Worker is built on that thread.
+    static void place_thread(int cpu, bool numa_local);
+
     bool setup_listener(const std::string& ip, uint16_t port, uint16_t& bound_port,
                         std::string& err);
     void run();
@@ -262,26 +258,92 @@ public:
     }
 
     EventLoop& loop() { return loop_; }
+    int listen_fd() const noexcept { return listen_fd_; }
+
+    /// Add this worker's counters to @p out (callable from any thread).
+    void add_stats(ServerStats& out) const noexcept {
+        out.accepted += stats_.accepted.load(std::memory_order_relaxed);
+        out.requests += stats_.requests.load(std::memory_order_relaxed);
+        out.wakeups += stats_.wakeups.load(std::memory_order_relaxed);
+        out.cross_cpu_wakeups += stats_.cross_cpu_wakeups.load(std::memory_order_relaxed);
+        out.read_pauses += stats_.read_pauses.load(std::memory_order_relaxed);
+        out.stream_drops += stats_.streams.drops.load(std::memory_order_relaxed);
+        out.stream_closes += stats_.streams.closes.load(std::memory_order_relaxed);
+        out.stream_blocks += stats_.streams.blocks.load(std::memory_order_relaxed);
+    }
 
 private:
+    /// Written only by the owning worker (except streams, which SSE, Pulse
+    /// and chunked producers bump with fetch_add); own cache line so stats()
+    /// readers and neighbouring workers do not bounce it.
+    struct alignas(64) Counters {
+        std::atomic<std::uint64_t> accepted{0};
+        std::atomic<std::uint64_t> requests{0};
+        std::atomic<std::uint64_t> wakeups{0};
+        std::atomic<std::uint64_t> cross_cpu_wakeups{0};
+        std::atomic<std::uint64_t> read_pauses{0};
+        StreamCounters streams;
+    };
+    static void bump_(std::atomic<std::uint64_t>& n) noexcept {
+        n.store(n.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void sample_cpu_(Connection* c);
+    std::size_t parser_body_limit_() const;
+
     void accept_new_();
+    void on_accepted_(int cfd);
+    void open_conn_(int cfd, const sockaddr_storage& ss);
     void on_readable_(Connection* c);
+    void on_received_(Connection* c, std::string_view bytes);
+    bool read_input_(Connection* c, bool& got_data);
+    void queue_ready_(Connection* c);
+    void resume_ready_(std::uint64_t h);
+    bool pause_if_backlogged_(Connection* c);
+    void resume_reading_(Connection* c);
+    void publish_stream_backlog_(Connection* c);
     void process_input_(Connection* c);
+    void route_head_(Connection* c);
+    bool on_body_chunk_(Connection* c, std::string_view chunk);
+    void resume_body_(Connection* c);
+    void release_body_stream_(Connection* c);
+    bool build_head_(Connection* c, Request& req);
     void handle_request_(Connection* c);
+    void dispatch_(Request& req, Response& res);
+    void route_request_(Connection* c, Request& req);
+    void finish_response_(Connection* c, const Request& req, Response& res, bool force_close = false);
+    void start_h2_(Connection* c);
+    void process_h2_(Connection* c);
+    void handle_h2_request_(Connection* c, h2::IncomingRequest&& in);
+    void respond_h2_(Connection* c, std::uint32_t stream, const Request& req, Response& res);
+    void pump_h2_(Connection* c);
+    void flush_h2_(Connection* c);
+    void adopt_deferred_(Connection* c, std::shared_ptr<Request> req,
+                         std::shared_ptr<Deferred::Impl> impl, std::uint32_t stream = 0);
+    void settle_deferred_(Connection* c, std::uint32_t stream, Response&& res);
+    void complete_deferred_(Connection* c, std::uint32_t stream, Response&& res);
+    void release_deferred_(Connection* c);
     void queue_error_response_(Connection* c, Status st, std::string_view msg);
+    IoResult write_out_(Connection* c);
+    IoResult send_out_(Connection* c);
+    void on_sent_(Connection* c, const LoopEvent& ev);
     void flush_output_(Connection* c);
     void flush_sse_(Connection* c);
     void adopt_sse_(Connection* c, std::shared_ptr<sse::Session::Impl> impl);
     void release_sse_(Connection* c);
+    void flush_chunked_(Connection* c);
+    void adopt_chunked_(Connection* c, std::shared_ptr<chunked::Writer::Impl> impl);
+    void release_chunked_(Connection* c);
     void flush_pulse_(Connection* c);
     void adopt_pulse_(Connection* c, std::shared_ptr<pulse::Channel::Impl> impl);
     void release_pulse_(Connection* c);
     void update_interest_(Connection* c);
     void set_deadline_(Connection* c);
-    void sweep_deadlines_();
+    void on_deadline_(Connection* c);
     void close_conn_(Connection* c);
     void close_listener_() {
         if (listen_fd_ >= 0) {
+            loop_.del(listen_fd_);
             ::close(listen_fd_);
             listen_fd_ = -1;
         }
@@ -291,8 +353,26 @@ private:
     EventLoop loop_;
     int listen_fd_{-1};
     std::atomic<bool> stop_{false};
-    std::unordered_map<Connection*, std::unique_ptr<Connection>> conns_;
-    char listener_tag_{0};
+    int cpu_{-1};
+    bool streams_bodies_{false}; ///< some route has Route::OnBody()
+    Slab<Connection> conns_;
+    /// Handles whose turn ended on a budget; resumed next iteration.
+    std::vector<std::uint64_t> ready_;
+    bool listener_queued_{false};
+    DateCache date_;
+    /// Backs the Request/Response being handled; rewound once it is sent.
+    RequestArena arena_;
+    /// What connections closed mid-send leave the loop writing from (and
+    /// their fd, so its number is not reused meanwhile), by handle; dropped
+    /// when the send reports back.
+    struct Retired {
+        OutputQueue out;
+        std::shared_ptr<const FileHandle> file;
+        Socket sock;
+    };
+    std::unordered_map<std::uint64_t, Retired> retired_;
+    Counters stats_;
+    StreamPolicy stream_policy_; ///< SSE/Pulse limits; chunked streams always Block.
 };
 
 bool Worker::setup_listener(const std::string& ip, uint16_t port, uint16_t& bound_port,
@@ -357,27 +437,70 @@ bool Worker::setup_listener(const std::string& ip, uint16_t port, uint16_t& boun
     return true;
 }
 
+void Worker::place_thread(int cpu, bool numa_local) {
+    if (cpu >= 0) pin_current_thread(cpu);
+    // Everything this thread allocates from here on (the Worker itself, its
+    // loop and rings, connection slab, buffers) is placed on its node.
+    if (numa_local) prefer_local_memory();
+}
+
+void Worker::sample_cpu_(Connection* c) {
+    int in = incoming_cpu(c->sock.fd());
+    if (in < 0) return;
+    bump_(stats_.wakeups);
+    if (in != current_cpu()) bump_(stats_.cross_cpu_wakeups);
+}
+
 void Worker::run() {
-    loop_.add(listen_fd_, /*read=*/true, /*write=*/false, &listener_tag_);
+    t_event_loop_thread = true;
+    t_stream_policy = &stream_policy_;
+    loop_.add_listener(listen_fd_, kListenerToken);
+    // Coroutine handlers started here resume on this loop.
+    set_coroutine_executor(&loop_, srv_.blocking_pool_.get(), srv_.offload_pool_.get());
 
     std::vector<LoopEvent> events;
-    auto last_sweep = steady_clock::now();
+    std::vector<std::uint64_t> resume;
 
     while (!stop_.load(std::memory_order_acquire)) {
-        int n = loop_.wait(events, 500);
+        // Timeout comes from the timer wheel; request_stop() wakes us.
+        // Requeued connections still have work, so only poll then.
+        int n = loop_.wait(events, ready_.empty() ? -1 : 0);
         if (n < 0) break;
 
         loop_.run_posted();
 
+        // Connections requeued last iteration run after this batch, so a
+        // busy one never gets two turns in a row while others wait.
+        resume.swap(ready_);
+
         for (const auto& ev : events) {
-            if (ev.data == &listener_tag_) {
-                accept_new_();
+            if (ev.data == kListenerToken) {
+                if (ev.accepted >= 0) {
+                    on_accepted_(ev.accepted);
+                } else {
+                    accept_new_();
+                }
+                continue;
+            }
+            Connection* c = conns_.get(ev.data);
+            if (!c) { // closed earlier (maybe with a send still going)
+                if (ev.send_done) retired_.erase(ev.data);
+                continue;
+            }
+            if (ev.send_done) {
+                on_sent_(c, ev);
                 continue;
             }
-            auto* c = static_cast<Connection*>(ev.data);
-            if (conns_.find(c) == conns_.end()) continue; // closed earlier this batch
 
             if (ev.error) {
+                // Like read_input_: a peer that half-closes after its last
+                // request still gets the response the loop is sending.
+                if (c->sending && c->phase != Connection::Phase::Sse &&
+                    c->phase != Connection::Phase::Pulse &&
+                    c->phase != Connection::Phase::Chunked) {
+                    c->close_after = true;
+                    continue;
+                }
                 close_conn_(c);
                 continue;
             }
@@ -386,12 +509,23 @@ void Worker::run() {
                 auto hr = c->sock.handshake();
                 if (hr == IoResult::Ok) {
                     c->phase = Connection::Phase::Http;
+                    if (srv_.opts_.http2 && c->sock.alpn() == "h2") start_h2_(c);
                     set_deadline_(c);
                     update_interest_(c);
+                    // The handshake consumed the edge; the request may
+                    // already be sitting in the socket.
+                    if (loop_.edge_triggered()) {
+                        c->read_pending = true;
+                        queue_ready_(c);
+                    }
                 } else if (hr == IoResult::WantRead) {
-                    loop_.mod(c->sock.fd(), true, false, c);
+                    loop_.mod(c->sock.fd(), true, false, c->handle);
+                    c->registered_read = true;
+                    c->registered_write = false;
                 } else if (hr == IoResult::WantWrite) {
-                    loop_.mod(c->sock.fd(), false, true, c);
+                    loop_.mod(c->sock.fd(), false, true, c->handle);
+                    c->registered_read = false;
+                    c->registered_write = true;
                 } else {
                     close_conn_(c);
                 }
@@ -400,26 +534,37 @@ void Worker::run() {
 
             if (ev.writable && c->has_pending_output()) {
                 flush_output_(c);
-                if (conns_.find(c) == conns_.end()) continue;
+                if (c->handle != ev.data) continue;
             }
-            if (ev.readable) {
-                on_readable_(c);
+            if (!ev.received.empty()) {
+                on_received_(c, ev.received);
+            } else if (ev.readable) {
+                if (c->ready_queued) {
+                    c->read_pending = true; // its turn comes below
+                } else {
+                    on_readable_(c);
+                }
             }
         }
 
-        auto now = steady_clock::now();
-        if (now - last_sweep >= milliseconds(250)) {
-            sweep_deadlines_();
-            last_sweep = now;
-        }
+        for (auto h : resume) resume_ready_(h);
+        resume.clear();
+
+        loop_.run_timers();
     }
 
     // Shutdown: close everything owned by this worker.
     close_listener_();
-    std::vector<Connection*> all;
-    all.reserve(conns_.size());
-    for (auto& kv : conns_) all.push_back(kv.first);
-    for (auto* c : all) close_conn_(c);
+    for (auto h : conns_.live_handles()) close_conn_(conns_.get(h));
+    // Those closes cut their sends short; let them report back (briefly)
+    // so the kernel is done with the buffers before they are freed.
+    for (int i = 0; !retired_.empty() && i < 100 && loop_.wait(events, 10) >= 0; ++i) {
+        for (const auto& ev : events) {
+            if (ev.accepted >= 0) ::close(ev.accepted);
+            if (ev.send_done) retired_.erase(ev.data);
+        }
+    }
+    set_coroutine_executor(nullptr, nullptr);
 }
 
 void Worker::accept_new_() {
@@ -429,36 +574,122 @@ void Worker::accept_new_() {
         int cfd = ::accept4(listen_fd_, reinterpret_cast<sockaddr*>(&ss), &slen,
                             SOCK_NONBLOCK | SOCK_CLOEXEC);
         if (cfd < 0) {
-            return; // EAGAIN/EINTR or transient error; retry on next readiness
+            // EAGAIN, or a transient error (EMFILE, ...) retried on the next
+            // readiness. An edge-triggered listener only fires again for a
+            // new connection, so retry those next iteration instead.
+            if (errno != EAGAIN && loop_.edge_triggered() && !listener_queued_) {
+                listener_queued_ = true;
+                ready_.push_back(kListenerToken);
+            }
+            return;
         }
+        open_conn_(cfd, ss);
+    }
+}
 
-        auto conn = std::make_unique<Connection>();
-        conn->sock = Socket(cfd);
-        conn->sock.set_remote_ip(peer_ip_(ss));
-        conn->parser.set_limits(srv_.opts_.max_header_size, srv_.opts_.max_body_size);
+// Multishot accept: the kernel took the connection off the listener
+// without its address.
+void Worker::on_accepted_(int cfd) {
+    sockaddr_storage ss{};
+    socklen_t slen = sizeof(ss);
+    ::getpeername(cfd, reinterpret_cast<sockaddr*>(&ss), &slen);
+    open_conn_(cfd, ss);
+}
 
-        if (srv_.tls_enabled_) {
-            SSL* ssl = srv_.tls_ctx_.new_session(cfd);
-            if (!ssl) continue; // drop the connection
-            conn->sock.adopt_tls(ssl);
-            conn->phase = Connection::Phase::Handshake;
+void Worker::open_conn_(int cfd, const sockaddr_storage& ss) {
+    SSL* ssl = nullptr;
+    if (srv_.tls_enabled_) {
+        ssl = srv_.tls_ctx_.new_session(cfd);
+        if (!ssl) { // drop the connection
+            ::close(cfd);
+            return;
         }
+    }
+
+    bump_(stats_.accepted);
+    std::uint64_t h = 0;
+    Connection* c = conns_.acquire(h);
+    c->owner = this;
+    c->handle = h;
+    c->sock = Socket(cfd);
+    c->sock.set_remote_ip(peer_ip_(ss));
+    c->parser.set_limits(srv_.opts_.max_header_size, parser_body_limit_());
+    c->parser.set_zero_copy(srv_.opts_.zero_copy_requests);
+    // With streaming routes the parser stops after each head so
+    // route_head_() can pick the body's limit and destination.
+    c->parser.set_stop_after_headers(streams_bodies_);
+    c->parser.set_spool(srv_.opts_.body_spool_threshold, srv_.opts_.body_spool_dir);
+    if (ssl) {
+        c->sock.adopt_tls(ssl);
+        c->phase = Connection::Phase::Handshake;
+    }
 
-        Connection* raw = conn.get();
-        raw->deadline = steady_clock::now() + srv_.opts_.idle_timeout;
-        conns_[raw] = std::move(conn);
-        loop_.add(raw->sock.fd(), true, false, raw);
+    c->deadline.set_callback(
+        [](void* ctx) {
+            auto* conn = static_cast<Connection*>(ctx);
+            conn->owner->on_deadline_(conn);
+        },
+        c);
+    loop_.timers().arm_after(c->deadline, srv_.opts_.idle_timeout);
+    // Plain sockets are read by the loop when it can; TLS records go
+    // through OpenSSL, which reads the socket itself.
+    if (!ssl && loop_.receives_input()) {
+        c->ring_input = true;
+        c->ring_output = loop_.sends_output();
+        loop_.add_stream(c->sock.fd(), h);
+    } else {
+        loop_.add(c->sock.fd(), true, false, h);
     }
 }
 
 void Worker::on_readable_(Connection* c) {
-    char buf[16 * 1024];
+    if (srv_.opts_.track_cpu_locality) sample_cpu_(c);
     bool got_data = false;
+    if (!read_input_(c, got_data)) return;
+    if (got_data) process_input_(c);
+}
+
+// Until a head is routed the parser allows the larger of the two body
+// limits; route_head_() narrows it per message.
+std::size_t Worker::parser_body_limit_() const {
+    const std::size_t plain = srv_.opts_.max_body_size;
+    const std::size_t stream = srv_.opts_.max_stream_body_size;
+    if (!streams_bodies_) return plain;
+    if (plain == 0 || stream == 0) return 0;
+    return std::max(plain, stream);
+}
+
+bool Worker::read_input_(Connection* c, bool& got_data) {
+    // resume_reading_() / resume_body_() come back for it; the loop
+    // delivers ring input through on_received_().
+    if (c->read_paused || c->body_paused || c->ring_input) return true;
+    // Bytes land directly in whatever spare room the input buffer already
+    // has; the stack spill area catches the rest, so one readv drains the
+    // socket without reserving read space per connection. `in` then grows
+    // to what is buffered and process_input_() releases it again once the
+    // messages in it are done (only a partial message keeps it grown).
+    char spill[64 * 1024];
+    const std::size_t budget = srv_.opts_.read_budget;
+    std::size_t total = 0;
     while (true) {
+        if (budget != 0 && total >= budget) {
+            // More may be waiting; let the other connections have a turn.
+            c->read_pending = true;
+            queue_ready_(c);
+            break;
+        }
+        iovec iov[2];
+        iov[0].iov_base = c->in.prepare(0);
+        iov[0].iov_len = c->in.writable();
+        iov[1].iov_base = spill;
+        iov[1].iov_len = sizeof(spill);
         std::size_t got = 0;
-        auto r = c->sock.read(buf, sizeof(buf), got);
+        auto r = c->sock.readv(iov, 2, got);
         if (r == IoResult::Ok) {
-            c->in.append(buf, got);
+            const std::size_t direct = std::min(got, iov[0].iov_len);
+            c->in.commit(direct);
+            if (got > direct) c->in.append(spill, got - direct);
+            total += got;
             got_data = true;
             continue;
         }
@@ -466,17 +697,72 @@ void Worker::on_readable_(Connection* c) {
         // Closed or Error: if the peer half-closed while we still have
         // output pending, keep flushing; otherwise drop.
         if (c->phase == Connection::Phase::Sse || c->phase == Connection::Phase::Pulse ||
-            !c->has_pending_output()) {
+            c->phase == Connection::Phase::Chunked || !c->has_pending_output()) {
             close_conn_(c);
-            return;
+            return false;
         }
         c->close_after = true;
         break;
     }
-    if (got_data) process_input_(c);
+    return true;
+}
+
+// The loop already took these bytes off the socket and reuses their buffer
+// after this batch, so they join `in` even while parsing is paused (a pause
+// also stops the recv, so that overshoot is bounded by what was in flight).
+void Worker::on_received_(Connection* c, std::string_view bytes) {
+    if (srv_.opts_.track_cpu_locality) sample_cpu_(c);
+    c->in.append(bytes.data(), bytes.size());
+    if (c->ready_queued) {
+        c->parse_pending = true; // its turn comes below
+    } else {
+        process_input_(c);
+    }
+}
+
+void Worker::queue_ready_(Connection* c) {
+    if (c->ready_queued) return;
+    c->ready_queued = true;
+    ready_.push_back(c->handle);
+}
+
+void Worker::resume_ready_(std::uint64_t h) {
+    if (h == kListenerToken) {
+        listener_queued_ = false;
+        accept_new_();
+        return;
+    }
+    Connection* c = conns_.get(h);
+    if (!c) return; // closed while queued
+    c->ready_queued = false;
+    const bool parse = std::exchange(c->parse_pending, false);
+    bool got_data = false;
+    if (std::exchange(c->read_pending, false) && !read_input_(c, got_data)) return;
+    if (got_data || parse) process_input_(c);
+}
+
+bool Worker::pause_if_backlogged_(Connection* c) {
+    const std::size_t high = srv_.opts_.output_high_water;
+    if (high == 0 || c->out.size() <= high) return false;
+    c->read_paused = true;
+    bump_(stats_.read_pauses);
+    return true;
+}
+
+void Worker::resume_reading_(Connection* c) {
+    c->read_paused = false;
+    // Buffered requests and (edge-triggered) unread socket bytes are picked
+    // up on the connection's next turn; flush_output_ restores EPOLLIN.
+    c->read_pending = true;
+    c->parse_pending = c->has_unparsed_input();
+    queue_ready_(c);
 }
 
 void Worker::process_input_(Connection* c) {
+    if (c->phase == Connection::Phase::Http2) {
+        process_h2_(c);
+        return;
+    }
     if (c->phase == Connection::Phase::Sse) {
         // Clients may send data on an SSE socket; we discard it.
         c->in.clear();
@@ -484,9 +770,11 @@ void Worker::process_input_(Connection* c) {
     }
     if (c->phase == Connection::Phase::Pulse) {
         if (!c->in.empty() && c->pulse) {
-            std::string chunk(c->in.data(), c->in.size());
+            // Frames are decoded straight out of the input buffer; handlers
+            // only queue output, so `in` is untouched until we clear it.
+            const bool ok = pulse::feed_bytes(c->pulse, c->in.view());
             c->in.clear();
-            if (!pulse::feed_bytes(c->pulse, chunk)) {
+            if (!ok) {
                 close_conn_(c);
                 return;
             }
@@ -495,82 +783,265 @@ void Worker::process_input_(Connection* c) {
         }
         return;
     }
+    // Pipelined bytes stay buffered until the deferred or chunked response
+    // is sent, or until the client has read enough of what it asked for.
+    if (c->phase == Connection::Phase::Chunked) return;
+    if (c->awaiting() || c->read_paused || c->body_paused || c->body_failed) return;
+    if (pause_if_backlogged_(c)) {
+        update_interest_(c);
+        return;
+    }
 
+    // HTTP/2 with prior knowledge: the connection opens with the preface
+    // instead of a request line (a shorter prefix waits for more bytes).
+    if (c->fresh && !c->in_request && srv_.opts_.http2 && !c->sock.is_tls()) {
+        const std::string_view start = c->in.view().substr(0, h2::kPreface.size());
+        if (!start.empty() && h2::kPreface.substr(0, start.size()) == start) {
+            if (start.size() < h2::kPreface.size()) {
+                set_deadline_(c);
+                return;
+            }
+            start_h2_(c);
+            process_h2_(c);
+            return;
+        }
+    }
+
+    const unsigned budget = srv_.opts_.request_budget;
+    unsigned handled = 0;
     while (true) {
-        if (!c->in.empty()) {
-            std::size_t used = c->parser.consume(c->in.data(), c->in.size());
-            c->in.consume(used);
+        std::size_t used = 0;
+        if (c->has_unparsed_input()) {
+            const std::size_t kept = c->parser.retained_bytes();
+            used = c->parser.consume(c->in.data() + c->msg_off, c->in.size() - c->msg_off);
+            if (c->parser.zero_copy()) {
+                // The head and a borrowed body stay pinned until the
+                // response is serialized; chunked, spooled and streamed
+                // body bytes are copied out, so drop them now.
+                const std::size_t pinned = c->parser.retained_bytes() - kept;
+                if (pinned < used) c->in.erase(c->msg_off + pinned, used - pinned);
+                c->msg_off += pinned;
+            } else {
+                c->in.consume(used);
+            }
             if (used > 0) c->in_request = true;
         }
 
+        if (!c->head_routed && c->parser.headers_done()) {
+            const std::uint64_t h = c->handle;
+            route_head_(c);
+            if (c->handle != h) return;
+        }
+
+        if (c->body_failed) {
+            queue_error_response_(c, Status::InternalServerError, "");
+            break;
+        }
         if (c->parser.error()) {
             queue_error_response_(c, c->parser.error_status(), c->parser.error_message());
             break;
         }
 
-        // Expect: 100-continue — tell the client to send the body.
-        if (!c->sent_100 && !c->parser.complete() &&
-            (c->parser.state() == ParseState::Body ||
-             c->parser.state() == ParseState::ChunkSize)) {
-            auto expect = find_header_(c->parser.headers(), "Expect");
-            if (detail::iequal_ascii(expect, "100-continue")) {
-                c->out += "HTTP/1.1 100 Continue\r\n\r\n";
-            }
-            c->sent_100 = true;
+        if (!c->parser.complete()) {
+            // Stopped after the head with body bytes left: go on with them.
+            if (used > 0 && !c->body_paused && c->has_unparsed_input()) continue;
+            break; // need more bytes, or the body handler paused
         }
 
-        if (!c->parser.complete()) break; // need more bytes
-
+        const std::uint64_t h = c->handle;
         handle_request_(c);
-        if (conns_.find(c) == conns_.end()) return; // closed during handling
+        if (c->handle != h) return; // closed during handling
 
+        // The response is serialized and the Request is gone (or owns a
+        // copy): release the message's bytes.
+        c->in.consume(c->msg_off);
+        c->msg_off = 0;
+        if (c->in.empty() && c->in.capacity() > Connection::kRetainInput) c->in = Buffer();
         c->parser.reset();
-        c->sent_100 = false;
+        c->head_routed = false;
         c->in_request = false;
 
-        if (c->close_after || c->phase == Connection::Phase::Sse ||
-            c->phase == Connection::Phase::Pulse)
-            break;
+        if (c->close_after || c->awaiting() || c->phase != Connection::Phase::Http) break;
         // Wait for the current response (esp. file streaming) to finish
         // before parsing the next pipelined request.
-        if (c->file.valid() && c->file_off < c->file_end) break;
-        if (c->in.empty()) break;
+        if (c->file && c->file_off < c->file_end) break;
+        if (!c->has_unparsed_input()) break;
+        if (pause_if_backlogged_(c)) break;
+        if (budget != 0 && ++handled >= budget) {
+            c->parse_pending = true;
+            queue_ready_(c);
+            break;
+        }
     }
 
     set_deadline_(c);
     flush_output_(c);
 }
 
-void Worker::handle_request_(Connection* c) {
-    Request req;
-    Response res;
+// Runs once per message, as soon as its header section is parsed: picks the
+// body limit and, for an OnBody() route, hands the body to its handler.
+void Worker::route_head_(Connection* c) {
+    HttpParser& p = c->parser;
+    c->head_routed = true;
+    const Route* route = nullptr;
+    ParamMap params;
+    if (streams_bodies_ && !p.complete()) {
+        std::string decoded;
+        if (const auto path = decode_path_(p.path(), decoded))
+            route = srv_.router_.match(p.method(), *path, &params);
+        const bool stream = route && route->streams_body();
+        p.set_body_limit(stream ? srv_.opts_.max_stream_body_size : srv_.opts_.max_body_size);
+        if (p.error()) return; // 413 instead of 100 Continue
+        if (!stream) route = nullptr;
+    }
+
+    // Expect: 100-continue — tell the client to send the body.
+    if (!p.complete() &&
+        (p.state() == ParseState::Body || p.state() == ParseState::ChunkSize)) {
+        auto expect = p.header(HeaderId::Expect);
+        if (detail::iequal_ascii(expect, "100-continue")) {
+            c->out.append("HTTP/1.1 100 Continue\r\n\r\n");
+        }
+    }
+    if (!route) return;
+
+    Request head;
+    if (!build_head_(c, head)) return;
+    head.mutable_params() = std::move(params);
+    c->head_request = (head.method() == Method::HEAD);
+    c->body_req = std::make_unique<Request>(std::move(head)); // owns its bytes
+    c->body_route = route;
+
+    auto impl = std::make_shared<BodyStream::Impl>();
+    Worker* self = this;
+    const std::uint64_t h = c->handle;
+    impl->notify = [self, h]() {
+        self->loop_.post([self, h]() {
+            if (Connection* conn = self->conns_.get(h)) self->resume_body_(conn);
+        });
+    };
+    c->body_stream = std::move(impl);
+    p.set_body_sink([this, c](std::string_view chunk) { return on_body_chunk_(c, chunk); });
+    // Nothing in the buffer belongs to the message any more.
+    c->in.consume(c->msg_off);
+    c->msg_off = 0;
+}
+
+bool Worker::on_body_chunk_(Connection* c, std::string_view chunk) {
+    BodyStream::Impl& impl = *c->body_stream;
+    {
+        std::lock_guard<std::mutex> lk(impl.mu);
+        impl.received += chunk.size();
+    }
+    BodyStream stream(c->body_stream);
+    try {
+        c->body_route->body_handler()(*c->body_req, chunk, stream);
+    } catch (...) {
+        c->body_failed = true;
+        release_body_stream_(c);
+        return false;
+    }
+    std::lock_guard<std::mutex> lk(impl.mu);
+    c->body_paused = impl.paused;
+    return !c->body_paused;
+}
+
+void Worker::resume_body_(Connection* c) {
+    if (!c->body_paused || !c->body_stream) return;
+    {
+        std::lock_guard<std::mutex> lk(c->body_stream->mu);
+        if (c->body_stream->paused) return; // paused again meanwhile
+    }
+    c->body_paused = false;
+    // Like resume_reading_(), plus EPOLLIN: nothing else may run before
+    // the connection's next turn to restore it.
+    c->read_pending = true;
+    c->parse_pending = c->has_unparsed_input();
+    queue_ready_(c);
+    set_deadline_(c);
+    update_interest_(c);
+}
+
+void Worker::release_body_stream_(Connection* c) {
+    if (c->body_stream) {
+        std::lock_guard<std::mutex> lk(c->body_stream->mu);
+        c->body_stream->closed = true;
+        c->body_stream->paused = false;
+        c->body_stream->notify = nullptr;
+    }
+    c->body_stream.reset();
+    c->body_paused = false;
+}
+
+// Method, path, target, version and headers of the parsed head (the query
+// string and cookies are parsed by Request on first use). False (with a 400
+// queued) when the path does not decode.
+bool Worker::build_head_(Connection* c, Request& req) {
+    HttpParser& p = c->parser;
+    const bool borrow = p.zero_copy();
 
-    req.set_method(c->parser.method());
-    req.set_target(std::string(c->parser.target()));
-    req.set_version(std::string(c->parser.version()));
+    req.set_method(p.method());
     req.set_remote_ip(c->sock.remote_ip());
 
-    // Percent-decode the path.
-    std::string decoded_path;
-    if (!detail::url_decode(c->parser.path(), decoded_path) ||
-        decoded_path.find('\0') != std::string::npos) {
+    std::string decoded;
+    const auto path = decode_path_(p.path(), decoded);
+    if (!path) {
         queue_error_response_(c, Status::BadRequest, "Malformed percent-encoding in path");
-        return;
+        return false;
+    }
+    if (!decoded.empty()) req.set_path(std::move(decoded));
+    else if (borrow) req.set_path_view(*path);
+    else req.set_path(std::string(*path));
+
+    if (borrow) {
+        req.set_target_view(p.target());
+        req.set_version_view(p.version());
+        p.for_each_field([c](HeaderId id, std::string_view k, std::string_view v) {
+            c->headers.add(id, k, v);
+        });
+        req.set_headers(std::move(c->headers));
+    } else {
+        req.set_target(std::string(p.target()));
+        req.set_version(std::string(p.version()));
+        req.set_headers(p.take_headers());
     }
-    req.set_path(std::move(decoded_path));
+    return true;
+}
 
-    detail::parse_query_string(c->parser.query_string(), req.mutable_query());
+void Worker::handle_request_(Connection* c) {
+    bump_(stats_.requests);
+    c->fresh = false;
+    HttpParser& p = c->parser;
+    const RequestArena::Scope scope(arena_); // outlives req and res
+    if (c->body_req) {
+        // Streamed body: the head was built when it arrived.
+        std::unique_ptr<Request> req = std::move(c->body_req);
+        release_body_stream_(c);
+        c->body_route = nullptr;
+        route_request_(c, *req);
+        c->headers = req->take_headers();
+        return;
+    }
 
-    req.mutable_headers() = c->parser.headers();
-    auto cookie_header = find_header_(req.headers(), H_Cookie);
-    if (!cookie_header.empty()) {
-        cookies::parse_cookie_header(cookie_header, req.mutable_cookies());
+    Request req(arena_.resource());
+    if (!build_head_(c, req)) return;
+    if (p.body_borrowed()) {
+        req.set_body_view(p.body_view());
+    } else if (p.body_spooled()) {
+        req.set_body_file(p.take_body_file());
+    } else {
+        req.set_body_storage(p.take_body());
     }
-    req.set_body_storage(c->parser.take_body());
 
     c->head_request = (req.method() == Method::HEAD);
 
-    // ---- Route it ----
+    route_request_(c, req);
+    c->headers = req.take_headers();
+}
+
+// Run the router (and its middleware) for @p req; a failed or unfinished
+// handler still leaves @p res ended.
+void Worker::dispatch_(Request& req, Response& res) {
     bool handled = false;
     try {
         handled = srv_.router_.dispatch(req, res);
@@ -591,40 +1062,313 @@ void Worker::handle_request_(Connection* c) {
         if (res.status_code() == 0) res.status(Status::OK);
         res.end();
     }
+}
+
+void Worker::route_request_(Connection* c, Request& req) {
+    Response res(req.arena());
+    dispatch_(req, res);
 
     // ---- SSE adoption ----
     if (res.kind() == Response::Kind::Stream) {
-        serialize_response_(c->out, req, res, srv_.opts_, c->head_request,
+        serialize_response(c->out, req, res, srv_.opts_, date_.now(), c->head_request,
                             /*close_connection=*/true);
         adopt_sse_(c, std::static_pointer_cast<sse::Session::Impl>(res.stream_state()));
         return;
     }
 
+    // ---- Chunked stream: the body comes from a chunked::Writer ----
+    if (res.kind() == Response::Kind::Chunked) {
+        auto impl = std::static_pointer_cast<chunked::Writer::Impl>(res.stream_state());
+        // HTTP/1.0: the close ends the body, whatever the client asked for.
+        finish_response_(c, req, res, /*force_close=*/!impl->framed);
+        if (c->head_request) {
+            std::lock_guard<std::mutex> lk(impl->mu);
+            impl->closed = true; // no body; writes are refused
+            impl->pending.clear();
+            return;
+        }
+        adopt_chunked_(c, std::move(impl));
+        return;
+    }
+
     // ---- Pulse (WebSocket) adoption ----
     if (res.kind() == Response::Kind::Pulse) {
-        serialize_response_(c->out, req, res, srv_.opts_, c->head_request,
+        serialize_response(c->out, req, res, srv_.opts_, date_.now(), c->head_request,
                             /*close_connection=*/true);
         adopt_pulse_(c, std::static_pointer_cast<pulse::Channel::Impl>(res.stream_state()));
         return;
     }
 
-    const bool close_it = wants_close_(req, res);
+    // ---- Deferred: the response is finished later through its handle ----
+    if (res.kind() == Response::Kind::Deferred) {
+        adopt_deferred_(c, std::make_shared<Request>(std::move(req)),
+                        std::static_pointer_cast<Deferred::Impl>(res.stream_state()));
+        return;
+    }
+
+    finish_response_(c, req, res);
+}
+
+void Worker::finish_response_(Connection* c, const Request& req, Response& res, bool force_close) {
+    const bool close_it = force_close || wants_close(req, res);
     if (close_it) c->close_after = true;
 
-    serialize_response_(c->out, req, res, srv_.opts_, c->head_request, close_it);
+    serialize_response(c->out, req, res, srv_.opts_, date_.now(), c->head_request, close_it);
 
     // ---- File streaming setup ----
     if (res.kind() == Response::Kind::File && !c->head_request && res.file_length() > 0) {
-        if (c->file.open(res.file_path())) {
+        if (res.file_handle()) {
+            c->file = res.file_handle();
             c->file_off = res.file_offset();
             c->file_end = res.file_offset() + res.file_length();
         } else {
-            // File vanished between send_file() and now; abort cleanly.
+            // No file behind the response (moved out); abort cleanly.
             c->close_after = true;
         }
     }
 }
 
+// ---------------------------------------------------------------------------
+// HTTP/2: the session frames and multiplexes; each complete stream is routed
+// like an HTTP/1 request and answered on its stream.
+// ---------------------------------------------------------------------------
+
+void Worker::start_h2_(Connection* c) {
+    h2::SessionLimits limits;
+    limits.max_concurrent_streams = srv_.opts_.http2_max_streams;
+    limits.max_resets_per_second = srv_.opts_.http2_max_resets;
+    limits.initial_window = srv_.opts_.http2_window;
+    limits.max_header_list = srv_.opts_.max_header_size;
+    limits.max_body = srv_.opts_.max_body_size;
+    // All streams together hold no more body bytes than one HTTP/1.1 request may.
+    limits.max_buffered = srv_.opts_.max_body_size;
+    c->h2 = std::make_unique<h2::Session>(limits);
+    c->phase = Connection::Phase::Http2;
+    c->fresh = false;
+    pump_h2_(c); // our SETTINGS
+}
+
+void Worker::process_h2_(Connection* c) {
+    if (c->read_paused) return; // resume_reading_() comes back
+    h2::Session& session = *c->h2;
+    c->in.consume(session.feed(c->in.view()));
+
+    h2::IncomingRequest in;
+    while (session.next_request(in)) {
+        const std::uint64_t h = c->handle;
+        handle_h2_request_(c, std::move(in));
+        if (c->handle != h) return;
+    }
+    pump_h2_(c);
+    pause_if_backlogged_(c);
+    set_deadline_(c);
+    flush_output_(c);
+}
+
+void Worker::handle_h2_request_(Connection* c, h2::IncomingRequest&& in) {
+    bump_(stats_.requests);
+    const std::uint32_t stream = in.stream;
+    const RequestArena::Scope scope(arena_);
+    Request req(arena_.resource());
+    req.set_method(method_from_string(in.method));
+    req.set_remote_ip(c->sock.remote_ip());
+
+    const std::string_view target = in.path;
+    std::string decoded;
+    const auto path = decode_path_(target.substr(0, target.find('?')), decoded);
+    if (!path) {
+        Response bad;
+        bad.status(Status::BadRequest).send("Bad Request: Malformed percent-encoding in path\n");
+        respond_h2_(c, stream, req, bad);
+        return;
+    }
+    req.set_path(decoded.empty() ? std::string(*path) : std::move(decoded));
+    req.set_target(std::move(in.path));
+    req.set_version("HTTP/2");
+
+    // :authority stands in for Host (RFC 9113 8.3.1).
+    Headers& headers = req.mutable_headers();
+    if (!in.authority.empty()) headers.add_copy(HeaderId::Host, "host", in.authority);
+    for (const auto& [name, value] : in.fields) {
+        if (!in.authority.empty() && name == "host") continue;
+        headers.add_copy(name, value);
+    }
+    req.set_body_storage(std::move(in.body));
+
+    // Bodies arrive whole here, so OnBody() routes stay on HTTP/1.1.
+    if (streams_bodies_) {
+        const Route* route = srv_.router_.match(req.method(), req.path());
+        if (route && route->streams_body()) {
+            c->h2->reset(stream, h2::ErrorCode::Http11Required);
+            return;
+        }
+    }
+
+    Response res(req.arena());
+    dispatch_(req, res);
+    switch (res.kind()) {
+    case Response::Kind::Stream:
+        refuse_stream_<sse::Session::Impl>(res.stream_state());
+        c->h2->reset(stream, h2::ErrorCode::Http11Required);
+        break;
+    case Response::Kind::Chunked:
+        refuse_stream_<chunked::Writer::Impl>(res.stream_state());
+        c->h2->reset(stream, h2::ErrorCode::Http11Required);
+        break;
+    case Response::Kind::Pulse:
+        refuse_stream_<pulse::Channel::Impl>(res.stream_state());
+        c->h2->reset(stream, h2::ErrorCode::Http11Required);
+        break;
+    case Response::Kind::Deferred:
+        adopt_deferred_(c, std::make_shared<Request>(std::move(req)),
+                        std::static_pointer_cast<Deferred::Impl>(res.stream_state()), stream);
+        break;
+    default:
+        respond_h2_(c, stream, req, res);
+        break;
+    }
+}
+
+void Worker::respond_h2_(Connection* c, std::uint32_t stream, const Request& req, Response& res) {
+    if (!serialize_response_h2(*c->h2, stream, req, res, srv_.opts_, date_.now(),
+                               req.method() == Method::HEAD)) {
+        // File vanished between send_file() and now.
+        c->h2->reset(stream, h2::ErrorCode::InternalError);
+    }
+}
+
+// Move what the session produced into `out`, topping DATA up to the
+// high-water mark.
+void Worker::pump_h2_(Connection* c) {
+    const std::size_t high = srv_.opts_.output_high_water;
+    const std::size_t budget = high == 0 ? 1024 * 1024 : high;
+    if (c->out.size() < budget) c->h2->pump(budget - c->out.size());
+    std::string& produced = c->h2->output();
+    if (produced.empty()) return;
+    c->out.push(std::move(produced));
+    produced.clear();
+}
+
+void Worker::flush_h2_(Connection* c) {
+    h2::Session& session = *c->h2;
+    // Everything queued is written: keep DATA flowing while windows allow.
+    while (session.can_pump() && !c->close_after) {
+        pump_h2_(c);
+        auto r = write_out_(c);
+        if (r == IoResult::WantWrite || r == IoResult::WantRead) {
+            update_interest_(c);
+            return;
+        }
+        if (r != IoResult::Ok) {
+            close_conn_(c);
+            return;
+        }
+    }
+    if (session.failed() || session.finished() || c->close_after) {
+        close_conn_(c);
+        return;
+    }
+    set_deadline_(c);
+    update_interest_(c);
+}
+
+// @p stream is 0 for HTTP/1, or the HTTP/2 stream the answer goes to.
+void Worker::adopt_deferred_(Connection* c, std::shared_ptr<Request> req,
+                             std::shared_ptr<Deferred::Impl> impl, std::uint32_t stream) {
+    if (stream == 0) {
+        c->deferred = impl;
+        c->deferred_req = req;
+    } else {
+        c->h2_deferred[stream] = {impl, req};
+    }
+    loop_.timers().cancel(c->deadline); // the handle decides how long this takes
+
+    ThreadPool* pool = srv_.blocking_pool_.get();
+    if (impl->offload && !pool) run_offloaded(impl, *req);
+
+    // The handle may already be finished (inline offload, or a thread the
+    // handler started); otherwise route the answer back through our loop.
+    // The handle goes stale once the connection closes.
+    std::optional<Response> ready;
+    {
+        std::lock_guard<std::mutex> lk(impl->mu);
+        if (impl->done) {
+            ready.emplace(std::move(impl->res));
+        } else {
+            Worker* self = this;
+            const std::uint64_t h = c->handle;
+            impl->deliver = [self, h, stream](Response&& r) {
+                auto res = std::make_shared<Response>(std::move(r));
+                self->loop_.post([self, h, stream, res]() {
+                    if (Connection* conn = self->conns_.get(h)) {
+                        self->complete_deferred_(conn, stream, std::move(*res));
+                    }
+                });
+            };
+        }
+    }
+    if (ready) {
+        settle_deferred_(c, stream, std::move(*ready));
+        return;
+    }
+
+    if (impl->offload) {
+        auto job = [impl, req]() { run_offloaded(impl, *req); };
+        if (!pool->try_submit(std::move(job))) {
+            {
+                std::lock_guard<std::mutex> lk(impl->mu);
+                impl->done = true;
+                impl->deliver = nullptr;
+            }
+            Response busy;
+            busy.status(Status::ServiceUnavailable).send("Service Unavailable\n");
+            settle_deferred_(c, stream, std::move(busy));
+        }
+    }
+}
+
+void Worker::settle_deferred_(Connection* c, std::uint32_t stream, Response&& res) {
+    std::shared_ptr<Request> req;
+    if (stream == 0) {
+        req = std::move(c->deferred_req);
+        c->deferred.reset();
+    } else {
+        auto it = c->h2_deferred.find(stream);
+        if (it == c->h2_deferred.end()) return;
+        req = std::move(it->second.req);
+        c->h2_deferred.erase(it);
+    }
+    if (res.kind() != Response::Kind::Buffered && res.kind() != Response::Kind::File) {
+        // Streams and upgrades need the handler's own connection context.
+        res = Response{};
+        res.status(Status::InternalServerError).send("Internal Server Error\n");
+    }
+    if (stream == 0) {
+        finish_response_(c, *req, res);
+    } else {
+        respond_h2_(c, stream, *req, res);
+    }
+}
+
+void Worker::complete_deferred_(Connection* c, std::uint32_t stream, Response&& res) {
+    settle_deferred_(c, stream, std::move(res));
+    if (stream != 0) pump_h2_(c);
+    set_deadline_(c);
+    flush_output_(c); // then carries on with buffered pipelined requests
+}
+
+void Worker::release_deferred_(Connection* c) {
+    auto close_handle = [](const std::weak_ptr<Deferred::Impl>& weak) {
+        auto impl = weak.lock();
+        if (!impl) return;
+        std::lock_guard<std::mutex> lk(impl->mu);
+        impl->closed = true;
+        impl->deliver = nullptr;
+    };
+    close_handle(c->deferred);
+    for (const auto& entry : c->h2_deferred) close_handle(entry.second.impl);
+}
+
 void Worker::queue_error_response_(Connection* c, Status st, std::string_view msg) {
     Request dummy;
     Response res;
@@ -635,34 +1379,81 @@ void Worker::queue_error_response_(Connection* c, Status st, std::string_view ms
     body.push_back('\n');
     res.status(st).send(body);
     c->close_after = true;
-    serialize_response_(c->out, dummy, res, srv_.opts_, false, true);
+    serialize_response(c->out, dummy, res, srv_.opts_, date_.now(), false, true);
 }
 
-void Worker::flush_output_(Connection* c) {
-    // 1) Drain the head/body byte buffer.
-    while (c->out_off < c->out.size()) {
+IoResult Worker::write_out_(Connection* c) {
+    if (c->ring_output) return send_out_(c);
+    iovec iov[64];
+    while (!c->out.empty()) {
+        std::size_t cnt = c->out.gather(iov, std::size(iov));
         std::size_t n = 0;
-        auto r = c->sock.write(c->out.data() + c->out_off, c->out.size() - c->out_off, n);
-        if (r == IoResult::Ok) {
-            c->out_off += n;
-            continue;
-        }
-        if (r == IoResult::WantWrite || r == IoResult::WantRead) {
+        auto r = c->sock.writev(iov, cnt, n);
+        if (r != IoResult::Ok) return r;
+        c->out.consume(n);
+    }
+    return IoResult::Ok;
+}
+
+// The loop writes for ring connections: hand it the queued segments, and
+// the next piece of the file once nothing is queued ahead of it, as one
+// submission. WantWrite until on_sent_() reports back and flushes again.
+IoResult Worker::send_out_(Connection* c) {
+    if (c->sending) return IoResult::WantWrite;
+    const int fd = c->sock.fd();
+    const bool file = c->file && c->file_off < c->file_end;
+    if (c->out.empty() && !file && loop_.unsent(fd) == 0) return IoResult::Ok;
+
+    c->out.pin();
+    iovec iov[EventLoop::kSendIov];
+    const std::size_t cnt = c->out.gather(iov, std::size(iov));
+    std::size_t gathered = 0;
+    for (std::size_t i = 0; i < cnt; ++i) gathered += iov[i].iov_len;
+    const bool ok = file && gathered == c->out.size()
+                        ? loop_.send(fd, iov, cnt, c->file->fd(), c->file_off,
+                                     static_cast<std::size_t>(c->file_end - c->file_off))
+                        : loop_.send(fd, iov, cnt);
+    if (!ok) return IoResult::Error;
+    c->sending = true;
+    return IoResult::WantWrite;
+}
+
+void Worker::on_sent_(Connection* c, const LoopEvent& ev) {
+    c->sending = false;
+    if (ev.sent < 0) {
+        close_conn_(c);
+        return;
+    }
+    c->out.consume(static_cast<std::size_t>(ev.sent));
+    if (ev.file_sent < 0) {
+        // EOF before expected end: give up sending more of the file.
+        c->file.reset();
+        c->file_off = c->file_end = 0;
+    } else {
+        c->file_off += static_cast<std::uint64_t>(ev.file_sent);
+    }
+    flush_output_(c);
+}
+
+void Worker::flush_output_(Connection* c) {
+    // 1) Drain the queued head/body segments.
+    auto wr = write_out_(c);
+    if (c->read_paused && c->out.size() <= srv_.opts_.output_low_water) resume_reading_(c);
+    if (wr != IoResult::Ok) {
+        if (wr == IoResult::WantWrite || wr == IoResult::WantRead) {
+            publish_stream_backlog_(c); // SSE/Pulse: wake blocked producers as it drains
             update_interest_(c);
             return;
         }
         close_conn_(c);
         return;
     }
-    if (c->out_off > 0) {
-        c->out.clear();
-        c->out_off = 0;
-    }
 
-    // 2) Stream the file, if any.
-    while (c->file.valid() && c->file_off < c->file_end) {
+    // 2) Stream the file, if any (send_out_() already did for ring
+    //    connections).
+    while (c->file && c->file_off < c->file_end) {
         std::size_t sent = 0;
-        auto r = c->sock.send_file(c->file.fd(), c->file_off,
+        auto r = c->sock.send_file(c->file->fd(), c->file_off,
                                    static_cast<std::size_t>(c->file_end - c->file_off), sent);
         if (r == IoResult::Ok) {
             if (sent == 0) break; // EOF before expected end: give up sending more
@@ -675,20 +1466,32 @@ void Worker::flush_output_(Connection* c) {
         close_conn_(c);
         return;
     }
-    if (c->file.valid() && c->file_off >= c->file_end) {
-        c->file.close();
+    if (c->file && c->file_off >= c->file_end) {
+        c->file.reset();
         c->file_off = c->file_end = 0;
     }
 
     // 3) Response fully sent.
+    if (c->phase == Connection::Phase::Http2) {
+        flush_h2_(c);
+        return;
+    }
     if (c->phase == Connection::Phase::Sse) {
         flush_sse_(c);
         return;
     }
+    if (c->phase == Connection::Phase::Chunked) {
+        flush_chunked_(c);
+        return;
+    }
     if (c->phase == Connection::Phase::Pulse) {
         flush_pulse_(c);
         return;
     }
+    if (c->awaiting()) {
+        update_interest_(c);
+        return;
+    }
     if (c->close_after) {
         close_conn_(c);
         return;
@@ -697,26 +1500,27 @@ void Worker::flush_output_(Connection* c) {
     set_deadline_(c);
     update_interest_(c);
 
-    // Pipelined request bytes may already be buffered.
-    if (!c->in.empty()) process_input_(c);
+    // Pipelined request bytes may already be buffered (unless they are
+    // waiting for their turn on the ready list).
+    if (c->has_unparsed_input() && !c->parse_pending) process_input_(c);
 }
 
 void Worker::adopt_sse_(Connection* c, std::shared_ptr<sse::Session::Impl> impl) {
     c->phase = Connection::Phase::Sse;
     c->sse = std::move(impl);
     c->close_after = true; // stream ends -> connection closes
-    c->token = std::make_shared<ConnToken>(ConnToken{this, c});
-    c->deadline = steady_clock::time_point::max();
+    loop_.timers().cancel(c->deadline);
 
-    std::weak_ptr<ConnToken> wt = c->token;
-    EventLoop* loop = &loop_;
+    // The handle goes stale once the connection closes, so a late
+    // notification finds nothing to flush.
+    Worker* self = this;
+    const std::uint64_t h = c->handle;
     {
         std::lock_guard<std::mutex> lk(c->sse->mu);
-        c->sse->notify = [loop, wt]() {
-            loop->post([wt]() {
-                if (auto t = wt.lock()) {
-                    t->worker->flush_sse_(t->conn);
-                }
+        c->sse->limit.apply(stream_policy_);
+        c->sse->notify = [self, h]() {
+            self->loop_.post([self, h]() {
+                if (Connection* conn = self->conns_.get(h)) self->flush_sse_(conn);
             });
         };
     }
@@ -729,27 +1533,22 @@ void Worker::flush_sse_(Connection* c) {
     bool close_requested = false;
     {
         std::lock_guard<std::mutex> lk(c->sse->mu);
-        if (!c->sse->pending.empty()) {
-            if (c->out_off == c->out.size()) {
-                c->out.swap(c->sse->pending);
-                c->out_off = 0;
-                c->sse->pending.clear();
-            } else {
-                c->out.append(c->sse->pending);
-                c->sse->pending.clear();
-            }
+        auto& pending = c->sse->pending;
+        if (pending.size() < OutputQueue::kInlineMax) {
+            c->out.append(pending); // keep pending's capacity for the next batch
+            pending.clear();
+        } else {
+            std::string batch;
+            batch.swap(pending);
+            c->out.push(std::move(batch));
         }
         close_requested = c->sse->close_requested;
     }
 
     // Drain what we can right now.
-    while (c->out_off < c->out.size()) {
-        std::size_t n = 0;
-        auto r = c->sock.write(c->out.data() + c->out_off, c->out.size() - c->out_off, n);
-        if (r == IoResult::Ok) {
-            c->out_off += n;
-            continue;
-        }
+    auto r = write_out_(c);
+    publish_stream_backlog_(c);
+    if (r != IoResult::Ok) {
         if (r == IoResult::WantWrite || r == IoResult::WantRead) {
             update_interest_(c);
             return;
@@ -757,8 +1556,6 @@ void Worker::flush_sse_(Connection* c) {
         close_conn_(c);
         return;
     }
-    c->out.clear();
-    c->out_off = 0;
 
     if (close_requested) {
         close_conn_(c);
@@ -773,33 +1570,132 @@ void Worker::release_sse_(Connection* c) {
     c->sse->closed = true;
     c->sse->notify = nullptr;
     c->sse->pending.clear();
+    c->sse->limit.drained.notify_all();
+}
+
+void Worker::adopt_chunked_(Connection* c, std::shared_ptr<chunked::Writer::Impl> impl) {
+    c->phase = Connection::Phase::Chunked;
+    c->chunked = std::move(impl);
+    loop_.timers().cancel(c->deadline); // the producer decides how long this takes
+
+    Worker* self = this;
+    const std::uint64_t h = c->handle;
+    {
+        std::lock_guard<std::mutex> lk(c->chunked->mu);
+        c->chunked->notify = [self, h]() {
+            self->loop_.post([self, h]() {
+                if (Connection* conn = self->conns_.get(h)) self->flush_chunked_(conn);
+            });
+        };
+    }
+    flush_chunked_(c);
+}
+
+void Worker::flush_chunked_(Connection* c) {
+    if (!c->chunked) return;
+
+    bool ended = false;
+    bool close_requested = false;
+    {
+        std::lock_guard<std::mutex> lk(c->chunked->mu);
+        auto& pending = c->chunked->pending;
+        if (pending.size() < OutputQueue::kInlineMax) {
+            c->out.append(pending);
+            pending.clear();
+        } else {
+            std::string batch;
+            batch.swap(pending);
+            c->out.push(std::move(batch));
+        }
+        ended = c->chunked->ended;
+        close_requested = c->chunked->close_requested;
+    }
+
+    auto r = write_out_(c);
+    publish_stream_backlog_(c);
+    if (r != IoResult::Ok) {
+        if (r == IoResult::WantWrite || r == IoResult::WantRead) {
+            update_interest_(c);
+            return;
+        }
+        close_conn_(c);
+        return;
+    }
+
+    if (close_requested) {
+        close_conn_(c);
+        return;
+    }
+    if (!ended) {
+        update_interest_(c);
+        return;
+    }
+
+    // The last chunk is out: back to HTTP, then keep-alive (or close) and
+    // any pipelined requests, as after a buffered response.
+    release_chunked_(c);
+    c->chunked.reset();
+    c->phase = Connection::Phase::Http;
+    flush_output_(c);
+}
+
+void Worker::release_chunked_(Connection* c) {
+    if (!c->chunked) return;
+    std::lock_guard<std::mutex> lk(c->chunked->mu);
+    c->chunked->closed = true;
+    c->chunked->notify = nullptr;
+    c->chunked->drain = nullptr;
+    c->chunked->pending.clear();
+    c->chunked->limit.drained.notify_all();
+}
+
+void Worker::publish_stream_backlog_(Connection* c) {
+    if (c->sse) {
+        std::lock_guard<std::mutex> lk(c->sse->mu);
+        c->sse->limit.set_in_flight(c->out.size());
+    } else if (c->pulse) {
+        std::lock_guard<std::mutex> lk(c->pulse->mu);
+        c->pulse->limit.set_in_flight(c->out.size());
+    } else if (c->chunked) {
+        std::function<void()> drain;
+        {
+            std::lock_guard<std::mutex> lk(c->chunked->mu);
+            auto& limit = c->chunked->limit;
+            limit.set_in_flight(c->out.size());
+            if (c->chunked->pending.size() + limit.in_flight <= limit.low)
+                drain = std::exchange(c->chunked->drain, nullptr);
+        }
+        if (drain) drain();
+    }
 }
 
 void Worker::adopt_pulse_(Connection* c, std::shared_ptr<pulse::Channel::Impl> impl) {
     c->phase = Connection::Phase::Pulse;
     c->pulse = std::move(impl);
     c->close_after = true;
-    c->token = std::make_shared<ConnToken>(ConnToken{this, c});
-    c->deadline = steady_clock::time_point::max();
+    loop_.timers().cancel(c->deadline);
 
-    std::weak_ptr<ConnToken> wt = c->token;
-    EventLoop* loop = &loop_;
+    // The handle goes stale once the connection closes, so a late
+    // notification finds nothing to flush.
+    Worker* self = this;
+    const std::uint64_t h = c->handle;
     {
         std::lock_guard<std::mutex> lk(c->pulse->mu);
-        c->pulse->notify = [loop, wt]() {
-            loop->post([wt]() {
-                if (auto t = wt.lock()) {
-                    t->worker->flush_pulse_(t->conn);
-                }
+        c->pulse->limit.apply(stream_policy_);
+        c->pulse->notify = [self, h]() {
+            self->loop_.post([self, h]() {
+                if (Connection* conn = self->conns_.get(h)) self->flush_pulse_(conn);
             });
         };
     }
 
-    // Frames coalesced with the HTTP upgrade request.
-    if (!c->in.empty()) {
-        std::string chunk(c->in.data(), c->in.size());
+    // Frames coalesced with the HTTP upgrade request (which may still be
+    // pinned at the front of `in`).
+    if (c->has_unparsed_input()) {
+        const bool ok = pulse::feed_bytes(c->pulse, c->in.view().substr(c->msg_off));
         c->in.clear();
-        if (!pulse::feed_bytes(c->pulse, chunk)) {
+        c->msg_off = 0;
+        if (!ok) {
             // Defer close until after 101 is flushed.
             c->pulse->close_requested = true;
         }
@@ -812,26 +1708,21 @@ void Worker::flush_pulse_(Connection* c) {
     bool close_requested = false;
     {
         std::lock_guard<std::mutex> lk(c->pulse->mu);
-        if (!c->pulse->pending.empty()) {
-            if (c->out_off == c->out.size()) {
-                c->out.swap(c->pulse->pending);
-                c->out_off = 0;
-                c->pulse->pending.clear();
-            } else {
-                c->out.append(c->pulse->pending);
-                c->pulse->pending.clear();
-            }
+        auto& pending = c->pulse->pending;
+        if (pending.size() < OutputQueue::kInlineMax) {
+            c->out.append(pending); // keep pending's capacity for the next batch
+            pending.clear();
+        } else {
+            std::string batch;
+            batch.swap(pending);
+            c->out.push(std::move(batch));
         }
         close_requested = c->pulse->close_requested;
     }
 
-    while (c->out_off < c->out.size()) {
-        std::size_t n = 0;
-        auto r = c->sock.write(c->out.data() + c->out_off, c->out.size() - c->out_off, n);
-        if (r == IoResult::Ok) {
-            c->out_off += n;
-            continue;
-        }
+    auto r = write_out_(c);
+    publish_stream_backlog_(c);
+    if (r != IoResult::Ok) {
         if (r == IoResult::WantWrite || r == IoResult::WantRead) {
             update_interest_(c);
             return;
@@ -839,8 +1730,6 @@ void Worker::flush_pulse_(Connection* c) {
         close_conn_(c);
         return;
     }
-    c->out.clear();
-    c->out_off = 0;
 
     if (close_requested) {
         // Give the peer a moment to receive the close frame, then drop.
@@ -859,6 +1748,7 @@ void Worker::release_pulse_(Connection* c) {
         c->pulse->closed = true;
         c->pulse->notify = nullptr;
         c->pulse->pending.clear();
+        c->pulse->limit.drained.notify_all();
         if (!c->pulse->close_fired) {
             c->pulse->close_fired = true;
             fire = true;
@@ -874,21 +1764,36 @@ void Worker::release_pulse_(Connection* c) {
 }
 
 void Worker::update_interest_(Connection* c) {
-    bool want_write = c->has_pending_output();
-    if (want_write != c->registered_write) {
-        loop_.mod(c->sock.fd(), true, want_write, c);
+    bool want_read = !c->read_paused && !c->body_paused;
+    // Ring sends need no writability: the kernel waits for room itself.
+    bool want_write = c->has_pending_output() && !c->ring_output;
+    if (want_read != c->registered_read || want_write != c->registered_write) {
+        loop_.mod(c->sock.fd(), want_read, want_write, c->handle);
+        c->registered_read = want_read;
         c->registered_write = want_write;
     }
 }
 
 void Worker::set_deadline_(Connection* c) {
-    if (c->phase == Connection::Phase::Sse || c->phase == Connection::Phase::Pulse) {
-        c->deadline = steady_clock::time_point::max();
+    if (c->phase == Connection::Phase::Http2) {
+        // Streams waiting on a Deferred handle decide how long this takes;
+        // otherwise an idle timeout covers the whole connection.
+        if (c->h2_deferred.empty()) {
+            loop_.timers().arm_after(c->deadline, srv_.opts_.idle_timeout);
+        } else {
+            loop_.timers().cancel(c->deadline);
+        }
         return;
     }
-    auto now = steady_clock::now();
+    if (c->phase == Connection::Phase::Sse || c->phase == Connection::Phase::Pulse ||
+        c->phase == Connection::Phase::Chunked || c->awaiting() ||
+        (c->body_paused && !c->close_after)) {
+        loop_.timers().cancel(c->deadline); // the handle decides how long this takes
+        return;
+    }
+    auto timeout = srv_.opts_.header_timeout;
     if (!c->in_request) {
-        c->deadline = now + srv_.opts_.idle_timeout;
+        timeout = srv_.opts_.idle_timeout;
     } else {
         switch (c->parser.state()) {
             case ParseState::Body:
@@ -896,45 +1801,47 @@ void Worker::set_deadline_(Connection* c) {
             case ParseState::ChunkData:
             case ParseState::ChunkDataEnd:
             case ParseState::ChunkTrailer:
-                c->deadline = now + srv_.opts_.body_timeout;
+                timeout = srv_.opts_.body_timeout;
                 break;
             default:
-                c->deadline = now + srv_.opts_.header_timeout;
                 break;
         }
     }
+    loop_.timers().arm_after(c->deadline, timeout);
 }
 
-void Worker::sweep_deadlines_() {
-    auto now = steady_clock::now();
-    std::vector<Connection*> expired;
-    for (auto& kv : conns_) {
-        if (kv.first->deadline <= now) expired.push_back(kv.first);
-    }
-    for (auto* c : expired) {
-        if (c->in_request && c->phase == Connection::Phase::Http && !c->has_pending_output()) {
-            queue_error_response_(c, Status::RequestTimeout, "");
-            flush_output_(c); // may close; otherwise close on drain
-            // Force close even if flushing stalls: leave close_after set and
-            // give the flush one epoll round; the deadline stays in the past
-            // so the next sweep closes it for good.
-            if (conns_.find(c) != conns_.end()) {
-                c->deadline = now + srv_.opts_.header_timeout;
-            }
-        } else {
-            close_conn_(c);
+void Worker::on_deadline_(Connection* c) {
+    if (c->in_request && c->phase == Connection::Phase::Http && !c->has_pending_output()) {
+        queue_error_response_(c, Status::RequestTimeout, "");
+        const std::uint64_t h = c->handle;
+        flush_output_(c); // may close; otherwise close on drain
+        // Force close even if flushing stalls: close_after is set, so when
+        // the re-armed timer fires with the 408 still queued the branch
+        // below closes the connection for good.
+        if (c->handle == h) {
+            loop_.timers().arm_after(c->deadline, srv_.opts_.header_timeout);
         }
+    } else {
+        close_conn_(c);
     }
 }
 
 void Worker::close_conn_(Connection* c) {
     release_sse_(c);
+    release_chunked_(c);
     release_pulse_(c);
-    c->token.reset();
+    release_deferred_(c);
+    release_body_stream_(c);
+    loop_.timers().cancel(c->deadline);
     if (c->sock.valid()) {
         loop_.del(c->sock.fd());
     }
-    conns_.erase(c);
+    const std::uint64_t h = c->handle;
+    if (c->sending) {
+        retired_.emplace(h, Retired{std::move(c->out), std::move(c->file), std::move(c->sock)});
+    }
+    c->reset();
+    conns_.release(h);
 }
 
 } // namespace detail
@@ -961,6 +1868,9 @@ bool Server::Run(std::string_view ip, uint16_t port) {
     // reset would otherwise kill the process with SIGPIPE.
     ::signal(SIGPIPE, SIG_IGN);
 
+    // Workers only read the routing tree.
+    router_.build();
+
     // TLS setup (before any listener is up).
     tls_enabled_ = false;
     if (opts_.tls) {
@@ -970,6 +1880,9 @@ bool Server::Run(std::string_view ip, uint16_t port) {
             return false;
         }
         tls_enabled_ = true;
+        const std::vector<std::string> alpn =
+            opts_.http2 ? std::vector<std::string>{"h2", "http/1.1"} : std::vector<std::string>{"http/1.1"};
+        tls_ctx_.set_alpn(alpn);
     }
 
     unsigned n = opts_.workers ? opts_.workers
@@ -978,29 +1891,100 @@ bool Server::Run(std::string_view ip, uint16_t port) {
     std::string ip_str(ip);
     uint16_t bound = port;
 
+    // Worker i is pinned to cpus[i]; steering maps CPUs back to i.
+    std::vector<int> cpus;
+    if (opts_.pin_workers || opts_.reuseport_cpu_steering) {
+        cpus = detail::plan_worker_cpus(opts_.worker_cpus, n);
+    }
+
+    // Each Worker is built on its own thread, after pinning and MPOL_LOCAL,
+    // so its memory lands on the node it runs on. Threads are started one at
+    // a time and park until every listener is bound: the first may bind port
+    // 0 and the rest reuse the discovered port, in worker order.
+    struct Built {
+        std::unique_ptr<detail::Worker> worker;
+        uint16_t port = 0;
+        std::string err;
+    };
+    std::promise<bool> go;
+    std::shared_future<bool> started = go.get_future().share();
     workers_.clear();
+    threads_.clear();
+    threads_.reserve(n);
     for (unsigned i = 0; i < n; ++i) {
-        auto w = std::make_unique<detail::Worker>(*this);
-        std::string err;
-        // First worker may bind port 0; the rest reuse the discovered port.
-        if (!w->setup_listener(ip_str, bound, bound, err)) {
-            last_error_ = err;
-            for (auto& prev : workers_) prev->request_stop();
+        const int cpu = i < cpus.size() ? cpus[i] : -1;
+        std::promise<Built> built;
+        std::future<Built> ready = built.get_future();
+        threads_.emplace_back([this, cpu, ip_str, port = bound, started,
+                               built = std::move(built)]() mutable {
+            detail::Worker::place_thread(cpu, opts_.numa_local);
+            Built b;
+            b.port = port;
+            try {
+                b.worker = std::make_unique<detail::Worker>(*this, cpu);
+                if (!b.worker->setup_listener(ip_str, port, b.port, b.err)) b.worker.reset();
+            } catch (const std::exception& e) {
+                b.err = e.what();
+                b.worker.reset();
+            }
+            detail::Worker* w = b.worker.get();
+            built.set_value(std::move(b));
+            if (w && started.get()) w->run();
+        });
+        Built b = ready.get();
+        if (!b.worker) {
+            last_error_ = b.err;
+            go.set_value(false);
+            Wait();
+            threads_.clear();
             workers_.clear();
             running_ = false;
             return false;
         }
-        workers_.push_back(std::move(w));
+        bound = b.port;
+        workers_.push_back(std::move(b.worker));
     }
     port_ = bound;
 
-    threads_.reserve(n);
-    for (auto& w : workers_) {
-        threads_.emplace_back([wp = w.get()] { wp->run(); });
+    // The reuseport group indexes sockets in bind order, i.e. worker order.
+    // One program serves the whole group; on failure the kernel keeps
+    // hashing flows across workers.
+    cpu_steering_ = false;
+    if (opts_.reuseport_cpu_steering && cpus.size() == n) {
+        std::string err;
+        cpu_steering_ = detail::attach_reuseport_cpu_steering(workers_.front()->listen_fd(),
+                                                              cpus, err);
+    }
+
+    io_backend_ = workers_.front()->loop().backend() == detail::LoopBackend::IoUring
+                      ? IoBackend::IoUring
+                      : IoBackend::Epoll;
+
+    if (opts_.blocking_threads > 0) {
+        blocking_pool_ = std::make_unique<detail::ThreadPool>(opts_.blocking_threads,
+                                                              opts_.blocking_queue);
+    } else {
+        // offload() must not block the loop either way; started on first use.
+        offload_pool_ = std::make_unique<detail::LazyThreadPool>(
+            std::max(4u, std::thread::hardware_concurrency()), opts_.blocking_queue);
     }
+
+    go.set_value(true);
     return true;
 }
 
+ServerStats Server::stats() const {
+    ServerStats out;
+    for (const auto& w : workers_) w->add_stats(out);
+    return out;
+}
+
+std::vector<ServerStats> Server::worker_stats() const {
+    std::vector<ServerStats> out(workers_.size());
+    for (std::size_t i = 0; i < workers_.size(); ++i) workers_[i]->add_stats(out[i]);
+    return out;
+}
+
 void Server::Wait() {
     std::lock_guard<std::mutex> lk(join_mu_);
     for (auto& t : threads_) {
@@ -1013,6 +1997,9 @@ void Server::Stop() {
     for (auto& w : workers_) w->request_stop();
     Wait();
     threads_.clear();
+    // Connections are closed, so finishing jobs find nobody to deliver to.
+    blocking_pool_.reset();
+    offload_pool_.reset();
     // Workers stay alive so late SSE handles can still post harmlessly;
     // they are destroyed with the Server.
 }
@@ -12,8 +12,6 @@ namespace socketify::sessions {
 
 namespace {
 
-constexpr std::string_view kLocalKey = "socketify.session";
-
 std::string hmac_b64_(std::string_view secret, std::string_view msg) {
     auto mac = detail::hmac_sha256(secret, msg);
     return detail::base64url_encode(mac.data(), mac.size());
@@ -58,7 +56,7 @@ std::optional<nlohmann::json> unseal_payload_(const std::string& secret,
 }
 
 std::string_view bearer_token_(const Request& req) {
-    auto auth = req.header("Authorization");
+    auto auth = req.header(HeaderId::Authorization);
     if (auth.size() > 7 && detail::iequal_ascii(auth.substr(0, 7), "Bearer ")) {
         return detail::trim_view(auth.substr(7));
     }
@@ -300,7 +298,7 @@ Middleware middleware(Options opts) {
         if (!sess) {
             sess = std::make_shared<Session>(new_id_(), nlohmann::json::object(), true);
         }
-        req.set_local(std::string(kLocalKey), sess);
+        req.set_local(sess);
 
         next();
 
@@ -377,7 +375,7 @@ Middleware middleware(Options opts) {
 }
 
 std::shared_ptr<Session> get(const Request& req) {
-    return req.local<Session>(std::string(kLocalKey));
+    return req.local<Session>();
 }
 
 } // namespace socketify::sessions
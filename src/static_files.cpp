@@ -1,20 +1,33 @@
 /**
  * @file static_files.cpp
- * @brief Static file middleware: safe path resolution, conditional requests,
- *        range requests and zero-copy streaming via Response::send_file.
+ * @brief Static file middleware: safe path resolution, the per-worker file
+ *        cache, precompressed and background-gzipped variants, conditional
+ *        requests, range requests and zero-copy streaming via
+ *        Response::send_file_range.
  */
 
 #include "socketify/static_files.h"
+#include "socketify/compression.h"
+#include "socketify/detail/file_io.h"
+#include "socketify/detail/thread_pool.h"
 #include "socketify/detail/utils.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <sys/resource.h>
 
 namespace fs = std::filesystem;
 namespace socketify::static_files {
@@ -30,13 +43,6 @@ static inline bool contains_dot_segment(const std::vector<std::string_view>& par
     return false;
 }
 
-static inline std::time_t to_time_t(const fs::file_time_type& ftime) {
-    using namespace std::chrono;
-    auto sctp = time_point_cast<system_clock::duration>(ftime - fs::file_time_type::clock::now()
-                     + system_clock::now());
-    return system_clock::to_time_t(sctp);
-}
-
 static std::string normalize_mount(std::string m) {
     if (m.empty()) return "/";
     if (m[0] != '/') m.insert(m.begin(), '/');
@@ -44,6 +50,13 @@ static std::string normalize_mount(std::string m) {
     return m;
 }
 
+// True when canonical path @p norm is @p root_norm or below it (not
+// "/rootX" for a "/root").
+static bool within_root(const std::string& norm, const std::string& root_norm) {
+    if (!detail::starts_with(norm, root_norm)) return false;
+    return norm.size() == root_norm.size() || root_norm.back() == '/' || norm[root_norm.size()] == '/';
+}
+
 static std::string safe_join(const fs::path& root, std::string_view url_subpath,
                              bool allow_hidden, bool& ok) {
     ok = false;
@@ -59,16 +72,16 @@ static std::string safe_join(const fs::path& root, std::string_view url_subpath,
     auto root_norm = fs::weakly_canonical(root, ec);
     if (ec) return {};
     auto nstr = norm.string();
-    auto rstr = root_norm.string();
-    if (!detail::starts_with(nstr, rstr)) return {};
-    // Reject "/rootX" passing a "/root" prefix check.
-    if (nstr.size() > rstr.size() && rstr.back() != '/' && nstr[rstr.size()] != '/') return {};
+    if (!within_root(nstr, root_norm.string())) return {};
     ok = true;
     return nstr;
 }
 
-static std::string weak_etag(std::uintmax_t size, std::time_t mtime) {
-    return "W/\"" + std::to_string(size) + "-" + std::to_string(static_cast<long long>(mtime)) + "\"";
+// An encoded variant gets its own tag: "W/\"size-mtime-br\"".
+static std::string weak_etag(std::uintmax_t size, std::int64_t mtime, std::string_view coding = {}) {
+    std::string tag = "W/\"" + std::to_string(size) + "-" + std::to_string(static_cast<long long>(mtime));
+    if (!coding.empty()) tag.append("-").append(coding);
+    return tag + "\"";
 }
 
 static bool parse_single_range(std::string_view hval, std::uintmax_t size,
@@ -151,16 +164,364 @@ static std::string list_directory_html(const fs::path& dir, std::string_view url
     return oss.str();
 }
 
+// ---------- per-worker file cache ----------
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// A resolved file, ready to answer from: the open descriptor (shared with
+// the responses streaming it) and the headers that only depend on it.
+struct FileEntry {
+    // Another representation of the file: a precompressed sibling, or
+    // the background gzip copy.
+    struct Encoded {
+        std::shared_ptr<const detail::FileHandle> file; ///< null when absent
+        std::string path;
+        std::string etag; ///< empty unless Options::etag
+    };
+
+    std::shared_ptr<const detail::FileHandle> file;
+    std::string path; ///< resolved filesystem path
+    std::string_view content_type;
+    std::string last_modified; ///< empty unless Options::last_modified
+    std::string etag;          ///< empty unless Options::etag
+    Encoded br, gzip;
+    bool gzip_pending{false}; ///< ask the mount's GzipStore until it settles
+    Clock::time_point expires{};
+
+    /// The response depends on Accept-Encoding.
+    bool varies() const noexcept { return br.file || gzip.file || gzip_pending; }
+};
+
+// Descriptors held by every FileCache in the process. The caches are per
+// worker and mount and an entry pins up to three (the file and its
+// precompressed siblings), so cache_entries alone could take most of
+// RLIMIT_NOFILE; together they stay within a quarter of it, which leaves
+// the rest to sockets.
+std::atomic<std::size_t> g_cached_fds{0};
+
+std::size_t fd_budget_() {
+    rlimit rl{};
+    if (::getrlimit(RLIMIT_NOFILE, &rl) != 0 || rl.rlim_cur == RLIM_INFINITY) return 4096;
+    return static_cast<std::size_t>(rl.rlim_cur / 4);
+}
+
+// LRU of FileEntry by URL sub-path; one per mount and worker thread, so
+// it needs no lock (only the descriptor count is shared).
+class FileCache {
+public:
+    explicit FileCache(std::size_t capacity) : capacity_(capacity) {}
+    ~FileCache() {
+        while (!lru_.empty()) erase_(index_.find(lru_.back().key));
+    }
+    FileCache(const FileCache&) = delete;
+    FileCache& operator=(const FileCache&) = delete;
+
+    FileEntry* find(std::string_view key, Clock::time_point now) {
+        auto it = index_.find(key);
+        if (it == index_.end()) return nullptr;
+        if (now >= it->second->entry.expires) {
+            erase_(it);
+            return nullptr;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return &it->second->entry;
+    }
+
+    /// Take over @p entry, dropping least recently used entries past the
+    /// capacity or the descriptor budget. Null (and @p entry untouched)
+    /// when the other caches hold the whole budget.
+    FileEntry* insert(std::string_view key, FileEntry& entry) {
+        if (auto it = index_.find(key); it != index_.end()) erase_(it);
+        if (!lru_.empty() && lru_.size() >= capacity_) erase_(index_.find(lru_.back().key));
+        const std::size_t fds = std::size_t{entry.file != nullptr} + std::size_t{entry.br.file != nullptr} +
+                                std::size_t{entry.gzip.file != nullptr};
+        const std::size_t budget = fd_budget_();
+        std::size_t held = g_cached_fds.load(std::memory_order_relaxed);
+        do {
+            while (held + fds > budget) {
+                if (lru_.empty()) return nullptr;
+                erase_(index_.find(lru_.back().key));
+                held = g_cached_fds.load(std::memory_order_relaxed);
+            }
+        } while (!g_cached_fds.compare_exchange_weak(held, held + fds, std::memory_order_relaxed));
+        lru_.push_front({std::string(key), std::move(entry), fds});
+        index_.emplace(lru_.front().key, lru_.begin());
+        return &lru_.front().entry;
+    }
+
+private:
+    struct Node {
+        std::string key;
+        FileEntry entry;
+        std::size_t fds; ///< charged to g_cached_fds
+    };
+    using Index = std::unordered_map<std::string_view, std::list<Node>::iterator>;
+
+    void erase_(Index::iterator it) {
+        g_cached_fds.fetch_sub(it->second->fds, std::memory_order_relaxed);
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+    std::size_t capacity_;
+    std::list<Node> lru_;
+    Index index_; ///< keys view Node::key
+};
+
+// Gzip copies of a mount's files, made on a background thread and kept
+// in unnamed temp files, so they stream with sendfile like the originals.
+// Shared by the workers; bounded by total size, least recently used out.
+class GzipStore {
+public:
+    GzipStore(std::size_t max_bytes, std::string dir) : max_bytes_(max_bytes), dir_(std::move(dir)) {}
+
+    /**
+     * The copy of @p src (opened from @p path). `settled` is false while
+     * it is being made (the first call queues it); once settled, a null
+     * copy means gzip did not make the file smaller.
+     */
+    struct Lookup {
+        bool settled{false};
+        std::shared_ptr<const detail::FileHandle> copy;
+    };
+    Lookup find(const std::string& path, const std::shared_ptr<const detail::FileHandle>& src) {
+        std::string key = path;
+        key.append(1, '\0').append(std::to_string(src->size()));
+        key.append(1, ':').append(std::to_string(src->mtime()));
+
+        const std::lock_guard lock(mu_);
+        if (auto it = slots_.find(key); it != slots_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.lru);
+            return {it->second.done, it->second.copy};
+        }
+        if (!pool_) pool_ = std::make_unique<detail::ThreadPool>(1, kMaxQueued);
+        auto it = slots_.emplace(key, Slot{}).first;
+        lru_.push_front(key);
+        it->second.lru = lru_.begin();
+        if (!pool_->try_submit([this, key, src] { compress_(key, src); })) {
+            // Queue full: a later request asks again.
+            lru_.erase(it->second.lru);
+            slots_.erase(it);
+        }
+        evict_();
+        return {};
+    }
+
+private:
+    static constexpr std::size_t kMaxQueued = 256;
+    static constexpr std::size_t kMaxSlots = 4096;
+
+    struct Slot {
+        std::shared_ptr<const detail::FileHandle> copy;
+        bool done{false};
+        std::list<std::string>::iterator lru;
+    };
+
+    void compress_(const std::string& key, const std::shared_ptr<const detail::FileHandle>& src) {
+        std::shared_ptr<detail::FileHandle> copy;
+        std::string raw, gz;
+        if (detail::read_file_range(*src, 0, src->size(), raw) && raw.size() == src->size() &&
+            compression::gzip_compress(raw, gz, 9) && gz.size() < raw.size()) {
+            copy = std::make_shared<detail::FileHandle>();
+            if (!copy->open_temp(dir_) || !copy->append(gz.data(), gz.size())) copy.reset();
+        }
+
+        const std::lock_guard lock(mu_);
+        auto it = slots_.find(key);
+        if (it == slots_.end()) return; // evicted meanwhile
+        it->second.done = true;
+        it->second.copy = std::move(copy);
+        if (it->second.copy) bytes_ += it->second.copy->size();
+        evict_();
+    }
+
+    void evict_() {
+        while ((bytes_ > max_bytes_ || slots_.size() > kMaxSlots) && !lru_.empty()) {
+            auto it = slots_.find(lru_.back());
+            if (it->second.copy) bytes_ -= it->second.copy->size();
+            slots_.erase(it);
+            lru_.pop_back();
+        }
+    }
+
+    std::size_t max_bytes_;
+    std::string dir_;
+    std::mutex mu_;
+    std::unordered_map<std::string, Slot> slots_;
+    std::list<std::string> lru_; ///< keys, most recent first
+    std::size_t bytes_{0};       ///< size of the finished copies
+    std::unique_ptr<detail::ThreadPool> pool_; ///< last: joined before the rest goes
+};
+
+// One serve() instance: its options and what is derived from them once.
+struct Mount {
+    Options opts;
+    fs::path root;
+    std::string cache_control;       ///< empty when cache_max_age is 0
+    std::unique_ptr<GzipStore> gzip; ///< when Options::compress
+};
+
+// This thread's caches, one per live Mount. The weak_ptr keeps a dead
+// mount's control block, so a new mount can never be taken for it; dead
+// mounts' caches (and descriptors) go when the next mount is added.
+thread_local std::vector<std::pair<std::weak_ptr<const Mount>, std::unique_ptr<FileCache>>> t_caches;
+
+FileCache& cache_for_(const std::shared_ptr<const Mount>& m) {
+    for (auto& [owner, cache] : t_caches) {
+        if (!owner.owner_before(m) && !m.owner_before(owner)) return *cache;
+    }
+    std::erase_if(t_caches, [](const auto& c) { return c.first.expired(); });
+    t_caches.emplace_back(m, std::make_unique<FileCache>(m->opts.cache_entries));
+    return *t_caches.back().second;
+}
+
+} // namespace
+
+// An encoded sibling ("app.js.br") of @p path, if one is there and, like
+// the file, under the root.
+static FileEntry::Encoded open_sibling_(const Mount& m, const std::string& path,
+                                        std::string_view ext, std::string_view coding) {
+    FileEntry::Encoded v;
+    std::string sibling = path + std::string(ext);
+    auto fh = std::make_shared<detail::FileHandle>();
+    if (!fh->open(sibling)) return v;
+    std::error_code ec;
+    const auto norm = fs::weakly_canonical(sibling, ec);
+    if (ec) return v;
+    const auto root_norm = fs::weakly_canonical(m.root, ec);
+    if (ec || !within_root(norm.string(), root_norm.string())) return v;
+    if (m.opts.etag) v.etag = weak_etag(fh->size(), fh->mtime(), coding);
+    v.file = std::move(fh);
+    v.path = std::move(sibling);
+    return v;
+}
+
+// The representation for this request's Accept-Encoding: br, then gzip,
+// by q-value; null for the file as is.
+static const FileEntry::Encoded* pick_encoding_(const Mount& m, FileEntry& e, const Request& req,
+                                                std::string_view& coding) {
+    const auto ae = req.header(HeaderId::AcceptEncoding);
+    if (ae.empty()) return nullptr;
+    const double gzip_q = compression::accept_encoding_q(ae, "gzip");
+    if (e.gzip_pending && gzip_q > 0) {
+        const auto got = m.gzip->find(e.path, e.file);
+        if (got.settled) {
+            e.gzip_pending = false;
+            if (got.copy) {
+                e.gzip.file = got.copy;
+                e.gzip.path = e.path;
+                if (m.opts.etag) e.gzip.etag = weak_etag(e.file->size(), e.file->mtime(), "gzip");
+            }
+        }
+    }
+    const double br_q = e.br.file ? compression::accept_encoding_q(ae, "br") : 0;
+    if (br_q > 0 && (br_q >= gzip_q || !e.gzip.file)) {
+        coding = "br";
+        return &e.br;
+    }
+    if (gzip_q > 0 && e.gzip.file) {
+        coding = "gzip";
+        return &e.gzip;
+    }
+    return nullptr;
+}
+
+// Headers, conditional and range handling for a resolved file.
+static void send_entry_(const Mount& m, FileEntry& e, Request& req, Response& res,
+                        const Next& next) {
+    std::string_view coding;
+    const FileEntry::Encoded* enc = e.varies() ? pick_encoding_(m, e, req, coding) : nullptr;
+    const auto& file = enc ? enc->file : e.file;
+    const std::string& etag = enc ? enc->etag : e.etag;
+    const std::uint64_t fsize = file->size();
+
+    res.set_header(H_ContentType, e.content_type);
+    if (!m.cache_control.empty()) res.set_header(H_CacheControl, m.cache_control);
+    if (!e.last_modified.empty()) res.set_header(H_LastModified, e.last_modified);
+    if (!etag.empty()) res.set_header(H_ETag, etag);
+    if (e.varies()) res.set_header("Vary", "Accept-Encoding");
+    if (enc) res.set_header(H_ContentEncoding, coding);
+
+    // ---- Conditional requests ----
+    if (!etag.empty()) {
+        auto inm = req.header(HeaderId::IfNoneMatch);
+        if (!inm.empty() && inm == etag) {
+            res.status(Status::NotModified).end();
+            return;
+        }
+    }
+    if (m.opts.last_modified) {
+        auto ims = req.header(HeaderId::IfModifiedSince);
+        if (!ims.empty()) {
+            if (auto since = detail::parse_http_date(ims)) {
+                if (e.file->mtime() <= *since) {
+                    res.status(Status::NotModified).end();
+                    return;
+                }
+            }
+        }
+    }
+
+    res.set_header("Accept-Ranges", "bytes");
+
+    // ---- Range requests ----
+    std::uintmax_t start = 0;
+    std::uintmax_t end   = fsize ? fsize - 1 : 0;
+    bool ranged = false;
+
+    auto rng = req.header(HeaderId::Range);
+    if (!rng.empty()) {
+        std::uintmax_t rs = 0, re = 0;
+        if (parse_single_range(rng, fsize, rs, re)) {
+            start = rs; end = re;
+            ranged = true;
+        } else {
+            res.status(Status::RangeNotSatisfiable)
+               .set_header(H_ContentRange, "bytes */" + std::to_string(fsize))
+               .end();
+            return;
+        }
+    }
+
+    std::uintmax_t content_len = (fsize == 0) ? 0 : (end - start + 1);
+
+    if (ranged) {
+        res.status(Status::PartialContent);
+        res.set_header(H_ContentRange, "bytes " + std::to_string(start) + "-" +
+                                           std::to_string(end) + "/" + std::to_string(fsize));
+    }
+
+    // Stream from the open file (sendfile on plain sockets). HEAD responses
+    // send headers only; the server strips the body automatically.
+    if (!res.send_file_range(file, enc ? enc->path : e.path, start, content_len)) {
+        if (m.opts.fallthrough) { next(); return; }
+        res.status(Status::InternalServerError).send("Failed to read file\n");
+    }
+}
+
 // ---------- main middleware ----------
 
-Middleware serve(Options opts) {
-    opts.mount = normalize_mount(std::move(opts.mount));
+Middleware serve(Options options) {
+    auto m = std::make_shared<Mount>();
+    m->opts = std::move(options);
+    m->opts.mount = normalize_mount(std::move(m->opts.mount));
 
     std::error_code ec;
-    fs::path root = fs::absolute(opts.root, ec);
-    if (ec) root = fs::path(opts.root);
+    m->root = fs::absolute(m->opts.root, ec);
+    if (ec) m->root = fs::path(m->opts.root);
 
-    return [opts, root](Request& req, Response& res, Next next) {
+    if (m->opts.cache_max_age > 0) {
+        m->cache_control = "public, max-age=" + std::to_string(m->opts.cache_max_age);
+        if (m->opts.immutable) m->cache_control += ", immutable";
+    }
+    if (m->opts.compress) {
+        m->gzip = std::make_unique<GzipStore>(m->opts.compress_cache_bytes, m->opts.compress_dir);
+    }
+
+    return [m = std::shared_ptr<const Mount>(std::move(m))](Request& req, Response& res, Next next) {
+        const Options& opts = m->opts;
         if (!(req.method() == Method::GET || req.method() == Method::HEAD)) {
             if (opts.fallthrough) { next(); return; }
             res.status(Status::MethodNotAllowed)
@@ -169,7 +530,7 @@ Middleware serve(Options opts) {
             return;
         }
 
-        std::string path(req.path());
+        std::string_view path = req.path();
         if (path.empty()) path = "/";
 
         if (!detail::starts_with(path, opts.mount)) {
@@ -177,11 +538,20 @@ Middleware serve(Options opts) {
             return;
         }
 
-        std::string sub = path.substr(opts.mount.size());
-        if (!sub.empty() && sub.front() == '/') sub.erase(sub.begin());
+        std::string_view sub = path.substr(opts.mount.size());
+        if (!sub.empty() && sub.front() == '/') sub.remove_prefix(1);
+
+        FileCache* cache = opts.cache_entries > 0 ? &cache_for_(m) : nullptr;
+        const Clock::time_point now = cache ? Clock::now() : Clock::time_point{};
+        if (cache) {
+            if (FileEntry* e = cache->find(sub, now)) {
+                send_entry_(*m, *e, req, res, next);
+                return;
+            }
+        }
 
         bool ok = false;
-        std::string fullpath = safe_join(root, sub, opts.allow_hidden, ok);
+        std::string fullpath = safe_join(m->root, sub, opts.allow_hidden, ok);
         if (!ok) {
             if (opts.fallthrough) { next(); return; }
             res.status(Status::NotFound).send("Not Found\n");
@@ -214,93 +584,41 @@ Middleware serve(Options opts) {
                     return;
                 }
                 auto html = list_directory_html(fullpath, path);
-                if (opts.cache_max_age > 0) {
-                    std::string cc = "public, max-age=" + std::to_string(opts.cache_max_age);
-                    if (opts.immutable) cc += ", immutable";
-                    res.set_header(H_CacheControl, cc);
-                }
+                if (!m->cache_control.empty()) res.set_header(H_CacheControl, m->cache_control);
                 res.html(html);
                 return;
             }
         }
 
-        auto fsize = fs::file_size(fullpath, fec);
-        if (fec) { if (opts.fallthrough) { next(); return; } res.status(Status::NotFound).send("Not Found\n"); return; }
-
-        auto ftime = fs::last_write_time(fullpath, fec);
-        if (fec) { ftime = fs::file_time_type::clock::now(); }
-        std::time_t mtime = to_time_t(ftime);
-
-        res.set_header(H_ContentType, content_type_for_path(fullpath));
-
-        if (opts.cache_max_age > 0) {
-            std::string cc = "public, max-age=" + std::to_string(opts.cache_max_age);
-            if (opts.immutable) cc += ", immutable";
-            res.set_header(H_CacheControl, cc);
-        }
-        if (opts.last_modified) {
-            res.set_header(H_LastModified, detail::http_date(static_cast<std::int64_t>(mtime)));
-        }
-        std::string etag;
-        if (opts.etag) {
-            etag = weak_etag(fsize, mtime);
-            res.set_header(H_ETag, etag);
-        }
-
-        // ---- Conditional requests ----
-        if (opts.etag) {
-            auto inm = req.header("If-None-Match");
-            if (!inm.empty() && inm == etag) {
-                res.status(Status::NotModified).end();
-                return;
-            }
-        }
-        if (opts.last_modified) {
-            auto ims = req.header("If-Modified-Since");
-            if (!ims.empty()) {
-                if (auto since = detail::parse_http_date(ims)) {
-                    if (static_cast<std::int64_t>(mtime) <= *since) {
-                        res.status(Status::NotModified).end();
-                        return;
-                    }
-                }
-            }
+        auto fh = std::make_shared<detail::FileHandle>();
+        if (!fh->open(fullpath)) {
+            if (opts.fallthrough) { next(); return; }
+            res.status(Status::NotFound).send("Not Found\n");
+            return;
         }
 
-        res.set_header("Accept-Ranges", "bytes");
-
-        // ---- Range requests ----
-        std::uintmax_t start = 0;
-        std::uintmax_t end   = fsize ? fsize - 1 : 0;
-        bool ranged = false;
-
-        auto rng = req.header(H_Range);
-        if (!rng.empty()) {
-            std::uintmax_t rs = 0, re = 0;
-            if (parse_single_range(rng, fsize, rs, re)) {
-                start = rs; end = re;
-                ranged = true;
-            } else {
-                res.status(Status::RangeNotSatisfiable)
-                   .set_header(H_ContentRange, "bytes */" + std::to_string(fsize))
-                   .end();
-                return;
-            }
+        FileEntry e;
+        e.content_type = content_type_for_path(fullpath);
+        if (opts.last_modified) e.last_modified = detail::http_date(fh->mtime());
+        if (opts.etag) e.etag = weak_etag(fh->size(), fh->mtime());
+        e.file = std::move(fh);
+        e.path = std::move(fullpath);
+        if (opts.precompressed) {
+            e.br = open_sibling_(*m, e.path, ".br", "br");
+            e.gzip = open_sibling_(*m, e.path, ".gz", "gzip");
         }
-
-        std::uintmax_t content_len = (fsize == 0) ? 0 : (end - start + 1);
-
-        if (ranged) {
-            res.status(Status::PartialContent);
-            res.set_header(H_ContentRange, "bytes " + std::to_string(start) + "-" +
-                                               std::to_string(end) + "/" + std::to_string(fsize));
+        e.gzip_pending = m->gzip && !e.gzip.file && e.file->size() >= opts.compress_min_size &&
+                         e.file->size() <= opts.compress_cache_bytes &&
+                         compression::is_compressible_type(e.content_type, compression::Options{});
+        if (!cache) {
+            send_entry_(*m, e, req, res, next);
+            return;
         }
-
-        // Stream from disk (sendfile on plain sockets). HEAD responses send
-        // headers only; the server strips the body automatically.
-        if (!res.send_file_range(fullpath, start, content_len)) {
-            if (opts.fallthrough) { next(); return; }
-            res.status(Status::InternalServerError).send("Failed to read file\n");
+        e.expires = now + opts.cache_ttl;
+        if (FileEntry* cached = cache->insert(sub, e)) {
+            send_entry_(*m, *cached, req, res, next);
+        } else {
+            send_entry_(*m, e, req, res, next); // descriptor budget spent
         }
     };
 }
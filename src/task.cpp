@@ -0,0 +1,103 @@
+/**
+ * @file task.cpp
+ * @brief Coroutine handler plumbing: per-worker executor, timers, offload.
+ */
+
+#include "socketify/task.h"
+#include "socketify/detail/loop.h"
+#include "socketify/detail/thread_pool.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace socketify::detail {
+
+namespace {
+
+thread_local EventLoop* t_loop = nullptr;
+thread_local ThreadPool* t_pool = nullptr;
+thread_local LazyThreadPool* t_fallback = nullptr;
+
+/// One-shot timer that resumes a coroutine and frees itself.
+struct ResumeTimer {
+    Timer timer;
+    std::coroutine_handle<> handle;
+
+    static void fire(void* ctx) {
+        auto* self = static_cast<ResumeTimer*>(ctx);
+        std::coroutine_handle<> h = self->handle;
+        delete self;
+        h.resume();
+    }
+};
+
+Detached run_co_request(std::shared_ptr<CoRequest> ctx, Task<void> task) {
+    try {
+        co_await task;
+    } catch (...) {
+        ctx->error = std::current_exception();
+    }
+    ctx->done = true;
+    // Finished before the first suspension: start_co_request answers.
+    if (!ctx->deferred.valid()) co_return;
+
+    ctx->deferred.finish([&ctx](Response& out) {
+        if (!ctx->error) {
+            out = std::move(ctx->res);
+            return;
+        }
+        out = Response{};
+        try {
+            std::rethrow_exception(ctx->error);
+        } catch (const std::exception& e) {
+            out.status(Status::InternalServerError)
+                .send(std::string("Internal Server Error: ") + e.what() + "\n");
+        } catch (...) {
+            out.status(Status::InternalServerError).send("Internal Server Error\n");
+        }
+    });
+}
+
+} // namespace
+
+void set_coroutine_executor(EventLoop* loop, ThreadPool* pool, LazyThreadPool* fallback) noexcept {
+    t_loop = loop;
+    t_pool = pool;
+    t_fallback = fallback;
+}
+
+bool resume_after(std::chrono::milliseconds delay, std::coroutine_handle<> h) {
+    if (!t_loop) return false;
+    auto* rt = new ResumeTimer{};
+    rt->handle = h;
+    rt->timer.set_callback(&ResumeTimer::fire, rt);
+    t_loop->timers().arm_after(rt->timer, delay);
+    return true;
+}
+
+bool offload_resume(std::function<void()> work, std::coroutine_handle<> h) {
+    if (!t_loop) return false;
+    ThreadPool* pool = t_pool ? t_pool : t_fallback ? &t_fallback->get() : nullptr;
+    if (!pool) return false;
+    EventLoop* loop = t_loop;
+    auto job = [work = std::move(work), loop, h]() {
+        work();
+        loop->post([h]() { h.resume(); });
+    };
+    if (!pool->try_submit(std::move(job))) {
+        throw std::runtime_error("blocking pool queue is full");
+    }
+    return true;
+}
+
+void start_co_request(const std::shared_ptr<CoRequest>& ctx, Task<void> task, Response& res) {
+    run_co_request(ctx, std::move(task));
+    if (ctx->done) {
+        if (ctx->error) std::rethrow_exception(ctx->error);
+        res = std::move(ctx->res);
+        return;
+    }
+    ctx->deferred = defer(res);
+}
+
+} // namespace socketify::detail
@@ -6,6 +6,7 @@
 #include "socketify/tls.h"
 
 #include <cstdlib>
+#include <string_view>
 
 #if defined(SOCKETIFY_HAS_TLS) && SOCKETIFY_HAS_TLS
 #include <openssl/err.h>
@@ -97,6 +98,47 @@ SSL* TlsContext::new_session(int fd) const {
     return ssl;
 }
 
+bool TlsContext::set_alpn(const std::vector<std::string>& protocols) {
+    if (!ctx_) {
+        last_error_ = "set_alpn() called before init()";
+        return false;
+    }
+    std::string encoded;
+    for (const auto& p : protocols) {
+        if (p.empty() || p.size() > 255) {
+            last_error_ = "invalid ALPN protocol name";
+            return false;
+        }
+        encoded.push_back(static_cast<char>(p.size()));
+        encoded.append(p);
+    }
+    alpn_ = std::move(encoded);
+    SSL_CTX_set_alpn_select_cb(
+        ctx_,
+        [](SSL*, const unsigned char** out, unsigned char* outlen, const unsigned char* in,
+           unsigned int inlen, void* arg) -> int {
+            const std::string_view wire = static_cast<const TlsContext*>(arg)->alpn_;
+            const std::string_view client(reinterpret_cast<const char*>(in), inlen);
+            const auto next = [](std::string_view list, std::size_t at) {
+                return at + 1 + static_cast<unsigned char>(list[at]);
+            };
+            // Server preference: walk our list, look each name up in theirs.
+            for (std::size_t i = 0; i < wire.size(); i = next(wire, i)) {
+                const std::string_view ours = wire.substr(i, next(wire, i) - i);
+                for (std::size_t j = 0; j < client.size(); j = next(client, j)) {
+                    if (client.substr(j, ours.size()) == ours) {
+                        *out = in + j + 1;
+                        *outlen = static_cast<unsigned char>(ours.size() - 1);
+                        return SSL_TLSEXT_ERR_OK;
+                    }
+                }
+            }
+            return SSL_TLSEXT_ERR_NOACK;
+        },
+        this);
+    return true;
+}
+
 #else // !SOCKETIFY_HAS_TLS
 
 TlsContext::~TlsContext() = default;
@@ -108,6 +150,8 @@ bool TlsContext::init(const TlsOptions&) {
 
 SSL* TlsContext::new_session(int) const { return nullptr; }
 
+bool TlsContext::set_alpn(const std::vector<std::string>&) { return false; }
+
 #endif
 
 } // namespace tls
@@ -0,0 +1,175 @@
+// Integration tests for output backpressure: HTTP connections stop being
+// read above output_high_water and resume at the low mark; SSE streams
+// apply the configured SlowConsumer policy.
+
+#include "socketify/socketify.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "integration/test_client.h"
+
+using namespace socketify;
+using testclient::TcpClient;
+using testclient::eventually;
+using testclient::simple_get;
+
+namespace {
+
+constexpr std::size_t kBody = 64 * 1024;
+
+void expect_reading_pauses(bool edge) {
+    ServerOptions opts;
+    opts.workers = 1;
+    opts.output_high_water = 256 * 1024;
+    opts.output_low_water = 64 * 1024;
+    opts.edge_triggered = edge;
+    Server server(opts);
+    server.Get("/big", [](Request&, Response& res) { res.send(std::string(kBody, 'b')); });
+    ASSERT_TRUE(server.Run("127.0.0.1", 0));
+
+    constexpr int kCount = 400; // ~25 MiB of responses, well past socket buffers
+    std::string batch;
+    for (int i = 0; i < kCount; ++i) batch += simple_get("/big");
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(server.port()));
+    ASSERT_TRUE(c.send_all(batch));
+
+    // The client reads nothing, so the worker has to stop parsing.
+    ASSERT_TRUE(eventually([&] { return server.stats().read_pauses > 0; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_LT(server.stats().requests, static_cast<std::uint64_t>(kCount));
+
+    for (int i = 0; i < kCount; ++i) {
+        auto r = c.read_response(5000);
+        ASSERT_TRUE(r) << "response " << i;
+        ASSERT_EQ(r->body.size(), kBody);
+    }
+    EXPECT_EQ(server.stats().requests, static_cast<std::uint64_t>(kCount));
+    server.Stop();
+}
+
+} // namespace
+
+TEST(Backpressure, HttpReadingPausesAboveHighWater) { expect_reading_pauses(false); }
+
+TEST(Backpressure, HttpReadingPausesEdgeTriggered) { expect_reading_pauses(true); }
+
+class SlowConsumerTest : public ::testing::Test {
+protected:
+    void start(SlowConsumer policy) {
+        ServerOptions opts;
+        opts.workers = 1;
+        opts.output_high_water = 64 * 1024;
+        opts.output_low_water = 16 * 1024;
+        opts.stream_overflow = policy;
+        server_ = std::make_unique<Server>(opts);
+        server_->Get("/events", [this](Request& req, Response& res) {
+            auto s = sse::upgrade(req, res);
+            std::lock_guard<std::mutex> lk(mu_);
+            session_ = s;
+        });
+        // Sends from a worker's own event loop.
+        server_->Get("/flood", [this](Request&, Response& res) {
+            res.send(std::to_string(send_until_refused()));
+        });
+        ASSERT_TRUE(server_->Run("127.0.0.1", 0));
+        ASSERT_TRUE(client_.connect_to(server_->port()));
+        ASSERT_TRUE(client_.send_all(simple_get("/events")));
+        ASSERT_TRUE(eventually([this] { return session().alive(); }));
+    }
+
+    void TearDown() override {
+        if (server_) server_->Stop();
+    }
+
+    sse::Session session() {
+        std::lock_guard<std::mutex> lk(mu_);
+        return session_;
+    }
+
+    // Send 16 KiB events until one is refused; -1 when none was.
+    int send_until_refused(int max = 4000) {
+        auto s = session();
+        const std::string chunk(16 * 1024, 'e');
+        for (int i = 0; i < max; ++i) {
+            if (!s.send(chunk)) return i;
+        }
+        return -1;
+    }
+
+    std::unique_ptr<Server> server_;
+    TcpClient client_;
+    std::mutex mu_;
+    sse::Session session_;
+};
+
+TEST_F(SlowConsumerTest, DropKeepsStreamOpen) {
+    start(SlowConsumer::Drop);
+    EXPECT_GE(send_until_refused(), 0);
+    EXPECT_GE(server_->stats().stream_drops, 1u);
+    EXPECT_TRUE(session().alive());
+
+    // Once the client catches up, sends are accepted again.
+    std::string buf;
+    client_.read_until(buf, [](const std::string&) { return false; }, 200);
+    ASSERT_TRUE(eventually([this] { return session().send("after"); }));
+    EXPECT_TRUE(client_.read_until(buf, [](const std::string& b) {
+        return b.find("data: after") != std::string::npos;
+    }));
+}
+
+TEST_F(SlowConsumerTest, CloseDropsTheConnection) {
+    start(SlowConsumer::Close);
+    EXPECT_GE(send_until_refused(), 0);
+    ASSERT_TRUE(eventually([this] { return !session().alive(); }));
+    EXPECT_GE(server_->stats().stream_closes, 1u);
+    client_.read_all(2000); // drains what was written, then sees EOF
+}
+
+TEST_F(SlowConsumerTest, CloseIsCountedOncePerStream) {
+    start(SlowConsumer::Close);
+    EXPECT_GE(send_until_refused(), 0);
+    for (int i = 0; i < 10; ++i) session().send("more");
+    ASSERT_TRUE(eventually([this] { return !session().alive(); }));
+    EXPECT_EQ(server_->stats().stream_closes, 1u);
+}
+
+TEST_F(SlowConsumerTest, BlockWaitsForTheClient) {
+    start(SlowConsumer::Block);
+    constexpr int kEvents = 1000; // ~16 MiB
+    bool all_sent = true;
+    std::thread producer([&] {
+        auto s = session();
+        const std::string chunk(16 * 1024, 'e');
+        for (int i = 0; i < kEvents; ++i) all_sent = s.send(chunk) && all_sent;
+        all_sent = s.send("end") && all_sent;
+    });
+
+    ASSERT_TRUE(eventually([this] { return server_->stats().stream_blocks > 0; }));
+    std::string buf;
+    EXPECT_TRUE(client_.read_until(
+        buf,
+        [](const std::string& b) {
+            return b.size() > 11 && b.compare(b.size() - 11, 11, "data: end\n\n") == 0;
+        },
+        5000));
+    producer.join();
+    EXPECT_TRUE(all_sent);
+    EXPECT_GT(buf.size(), static_cast<std::size_t>(kEvents) * 16 * 1024);
+}
+
+// A handler on an event loop must not wait: Block closes the stream there.
+TEST_F(SlowConsumerTest, BlockNeverWaitsOnAnEventLoop) {
+    start(SlowConsumer::Block);
+    auto r = testclient::request(server_->port(), simple_get("/flood"));
+    ASSERT_TRUE(r);
+    EXPECT_GE(std::stoi(r->body), 0);
+    ASSERT_TRUE(eventually([this] { return !session().alive(); }));
+    EXPECT_EQ(server_->stats().stream_closes, 1u);
+    EXPECT_EQ(server_->stats().stream_blocks, 0u);
+}
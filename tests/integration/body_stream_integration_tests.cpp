@@ -0,0 +1,217 @@
+// Integration tests for request-body streaming and spooling: OnBody()
+// routes get the body in pieces under their own size limit, can pause and
+// resume reading, and large buffered bodies land in a temp file.
+
+#include "socketify/socketify.h"
+#include "socketify/detail/file_io.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include "integration/test_client.h"
+
+using namespace socketify;
+using testclient::TcpClient;
+using testclient::eventually;
+using testclient::request;
+
+namespace {
+
+std::string post(const std::string& target, const std::string& body,
+                 const std::string& extra = "") {
+    return "POST " + target + " HTTP/1.1\r\nHost: t\r\n" + extra +
+           "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+} // namespace
+
+class BodyStreamTest : public ::testing::TestWithParam<bool> {
+protected:
+    void SetUp() override {
+        ServerOptions opts;
+        opts.workers = 1;
+        opts.max_body_size = 1024;
+        opts.max_stream_body_size = 4 * 1024 * 1024;
+        opts.zero_copy_requests = GetParam();
+        server_ = std::make_unique<Server>(opts);
+
+        server_->Post("/upload/:name", [this](Request& req, Response& res) {
+            std::lock_guard<std::mutex> lk(mu_);
+            res.send(req.params().at("name") + "|" + std::string(req.header("X-Tag")) + "|" +
+                     std::to_string(received_.size()) + "|" + std::to_string(pieces_) + "|" +
+                     (req.has_body() ? "body" : "nobody"));
+        }).OnBody([this](Request& req, std::string_view chunk, BodyStream& s) {
+            if (chunk.find('!') != std::string_view::npos) throw std::runtime_error("bad byte");
+            std::lock_guard<std::mutex> lk(mu_);
+            received_.append(chunk);
+            ++pieces_;
+            if (req.header("X-Pause") == "1" && pieces_ == 1) {
+                s.pause();
+                paused_ = s;
+            }
+        });
+        server_->Post("/plain", [](Request& req, Response& res) {
+            res.send(std::to_string(req.body_view().size()));
+        });
+        ASSERT_TRUE(server_->Run("127.0.0.1", 0));
+        port_ = server_->port();
+    }
+
+    void TearDown() override { server_->Stop(); }
+
+    std::string received() {
+        std::lock_guard<std::mutex> lk(mu_);
+        return received_;
+    }
+    int pieces() {
+        std::lock_guard<std::mutex> lk(mu_);
+        return pieces_;
+    }
+
+    std::unique_ptr<Server> server_;
+    uint16_t port_{0};
+    std::mutex mu_;
+    std::string received_;
+    int pieces_{0};
+    BodyStream paused_;
+};
+
+TEST_P(BodyStreamTest, StreamsBodyPastMaxBodySize) {
+    std::string body(2 * 1024 * 1024, 'x');
+    for (std::size_t i = 0; i < body.size(); i += 4096) body[i] = static_cast<char>('a' + i % 26);
+    auto r = request(port_, post("/upload/f%20one", body, "X-Tag: t1\r\n"), 10000);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, 200);
+    EXPECT_EQ(r->body.rfind("f one|t1|2097152|", 0), 0u) << r->body;
+    EXPECT_TRUE(r->body.ends_with("|nobody")) << r->body;
+    EXPECT_EQ(received(), body);
+    EXPECT_GT(pieces(), 0);
+
+    // Routes without OnBody() keep max_body_size.
+    auto plain = request(port_, post("/plain", std::string(2048, 'p')));
+    ASSERT_TRUE(plain);
+    EXPECT_EQ(plain->status, 413);
+}
+
+TEST_P(BodyStreamTest, ChunkedBodyThenPipelinedRequest) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all("POST /upload/c HTTP/1.1\r\nHost: t\r\nTransfer-Encoding: chunked\r\n\r\n"
+                           "5\r\nhello\r\n"));
+    ASSERT_TRUE(eventually([&] { return received() == "hello"; }));
+    ASSERT_TRUE(c.send_all("6\r\n world\r\n0\r\n\r\n" + post("/plain", "abc")));
+    auto first = c.read_response(5000);
+    ASSERT_TRUE(first);
+    EXPECT_EQ(first->body, "c||11|2|nobody");
+    auto second = c.read_response(5000);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(second->body, "3");
+}
+
+TEST_P(BodyStreamTest, PauseStopsDeliveryUntilResume) {
+    const std::string rest(512 * 1024, 'z');
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all("POST /upload/p HTTP/1.1\r\nHost: t\r\nX-Pause: 1\r\nContent-Length: " +
+                           std::to_string(5 + rest.size()) + "\r\n\r\nfirst"));
+    ASSERT_TRUE(eventually([&] { return pieces() == 1; }));
+    // The worker is not reading, so this blocks once the socket buffers fill.
+    std::thread sender([&] { c.send_all(rest); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    EXPECT_EQ(pieces(), 1);
+    BodyStream s;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        s = paused_;
+    }
+    EXPECT_TRUE(s.paused());
+    EXPECT_EQ(s.received(), 5u);
+    std::thread([s]() mutable { s.resume(); }).join();
+    sender.join();
+
+    auto r = c.read_response(10000);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, 200);
+    EXPECT_EQ(received(), "first" + rest);
+    EXPECT_FALSE(s.paused());
+    s.pause(); // the stream is over: no effect
+    EXPECT_FALSE(s.paused());
+}
+
+TEST_P(BodyStreamTest, HandlerExceptionAnswers500) {
+    auto r = request(port_, post("/upload/e", "oops!"));
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, 500);
+}
+
+TEST_P(BodyStreamTest, StreamLimitRejectsBeforeContinue) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all("POST /upload/big HTTP/1.1\r\nHost: t\r\nExpect: 100-continue\r\n"
+                           "Content-Length: 5000000\r\n\r\n"));
+    auto r = c.read_response(3000);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, 413);
+
+    TcpClient ok;
+    ASSERT_TRUE(ok.connect_to(port_));
+    ASSERT_TRUE(ok.send_all("POST /upload/small HTTP/1.1\r\nHost: t\r\nExpect: 100-continue\r\n"
+                            "Content-Length: 3\r\n\r\n"));
+    auto cont = ok.read_response(3000);
+    ASSERT_TRUE(cont);
+    EXPECT_EQ(cont->status, 100);
+    ASSERT_TRUE(ok.send_all("abc"));
+    auto done = ok.read_response(3000);
+    ASSERT_TRUE(done);
+    EXPECT_EQ(done->body, "small||3|1|nobody");
+}
+
+INSTANTIATE_TEST_SUITE_P(Mode, BodyStreamTest, ::testing::Values(true, false),
+                         [](const ::testing::TestParamInfo<bool>& info) {
+                             return info.param ? "Borrowed" : "Copied";
+                         });
+
+TEST(BodySpool, LargeBodiesGoToAFile) {
+    ServerOptions opts;
+    opts.workers = 1;
+    opts.body_spool_threshold = 4096;
+    Server server(opts);
+    server.Post("/store", [](Request& req, Response& res) {
+        const detail::FileHandle* f = req.body_file();
+        if (!f) {
+            res.send("memory:" + std::to_string(req.body_view().size()));
+            return;
+        }
+        std::string data(static_cast<std::size_t>(f->size()), '\0');
+        const ssize_t n = ::pread(f->fd(), data.data(), data.size(), 0);
+        res.send("file:" + std::to_string(n) + ":" + data.substr(0, 3) +
+                 data.substr(data.size() - 3) + (req.body_view().empty() ? ":empty" : ":view"));
+    });
+    ASSERT_TRUE(server.Run("127.0.0.1", 0));
+
+    std::string big(100 * 1024, 'm');
+    big.replace(0, 3, "BEG");
+    big.replace(big.size() - 3, 3, "END");
+    auto r = request(server.port(), post("/store", big), 5000);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->body, "file:102400:BEGEND:empty");
+
+    auto small = request(server.port(), post("/store", "tiny"));
+    ASSERT_TRUE(small);
+    EXPECT_EQ(small->body, "memory:4");
+
+    auto chunked = request(server.port(),
+                           "POST /store HTTP/1.1\r\nHost: t\r\nTransfer-Encoding: chunked\r\n\r\n"
+                           "1000\r\n" + std::string(4096, 'c') + "\r\n3\r\nEND\r\n0\r\n\r\n",
+                           5000);
+    ASSERT_TRUE(chunked);
+    EXPECT_EQ(chunked->body, "file:4099:cccEND:empty");
+    server.Stop();
+}
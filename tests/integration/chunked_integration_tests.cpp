@@ -0,0 +1,334 @@
+// Integration tests for chunked::Writer responses: framing and trailers,
+// keep-alive and pipelining after the stream, producer backpressure, and
+// the HEAD / HTTP/1.0 / abandoned-writer cases.
+
+#include "socketify/socketify.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "integration/test_client.h"
+
+using namespace socketify;
+using testclient::TcpClient;
+using testclient::simple_get;
+
+namespace {
+
+struct ChunkedReply {
+    std::string head;
+    std::string body;
+    std::string trailers; ///< raw trailer lines
+    std::size_t size{0};  ///< bytes of the whole response
+};
+
+// Parse one chunked response at the front of @p raw; nullopt while incomplete.
+std::optional<ChunkedReply> parse_chunked(const std::string& raw) {
+    ChunkedReply r;
+    const auto head_end = raw.find("\r\n\r\n");
+    if (head_end == std::string::npos) return std::nullopt;
+    r.head = raw.substr(0, head_end + 2);
+    std::size_t pos = head_end + 4;
+    while (true) {
+        const auto eol = raw.find("\r\n", pos);
+        if (eol == std::string::npos) return std::nullopt;
+        const std::size_t n = std::strtoul(raw.c_str() + pos, nullptr, 16);
+        pos = eol + 2;
+        if (n == 0) break;
+        if (raw.size() < pos + n + 2) return std::nullopt;
+        r.body.append(raw, pos, n);
+        pos += n + 2;
+    }
+    const auto end = raw.find("\r\n\r\n", pos - 2);
+    if (end == std::string::npos) return std::nullopt;
+    r.trailers = raw.substr(pos, end + 2 - pos);
+    r.size = end + 4;
+    return r;
+}
+
+std::optional<ChunkedReply> read_chunked(TcpClient& c, int timeout_ms = 3000) {
+    std::string raw;
+    if (!c.read_until(raw, [](const std::string& b) { return parse_chunked(b).has_value(); },
+                      timeout_ms))
+        return std::nullopt;
+    return parse_chunked(raw);
+}
+
+bool has_line(const std::string& head, const std::string& line) {
+    return head.find("\r\n" + line + "\r\n") != std::string::npos;
+}
+
+std::string pattern(std::size_t n) {
+    std::string s(n, '\0');
+    for (std::size_t i = 0; i < n; ++i) s[i] = static_cast<char>('a' + i % 26);
+    return s;
+}
+
+} // namespace
+
+class ChunkedTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ServerOptions opts;
+        opts.workers = 1;
+        opts.output_high_water = 64 * 1024;
+        opts.output_low_water = 16 * 1024;
+        server_ = std::make_unique<Server>(opts);
+
+        server_->Get("/inline", [](Request& req, Response& res) {
+            res.set_content_type("application/x-ndjson");
+            chunked::Writer w = chunked::start(req, res);
+            EXPECT_TRUE(w.write("{\"n\":1}\n"));
+            EXPECT_TRUE(w.write(""));
+            EXPECT_TRUE(w.write("{\"n\":2}\n"));
+            EXPECT_TRUE(w.trailer("X-Count", "2"));
+            EXPECT_FALSE(w.trailer("Bad Name", "x"));
+            EXPECT_FALSE(w.trailer("X-Bad", "a\r\nb"));
+            EXPECT_TRUE(w.end());
+            EXPECT_FALSE(w.end());
+            EXPECT_FALSE(w.write("late"));
+        });
+
+        server_->Get("/fast", [](Request&, Response& res) { res.send("fast"); });
+
+        server_->Get("/held", [this](Request& req, Response& res) {
+            std::lock_guard<std::mutex> lk(mu_);
+            held_ = chunked::start(req, res);
+            held_.write("first;");
+        });
+
+        server_->Get("/big", [](Request& req, Response& res) {
+            const std::size_t total = std::strtoul(std::string(req.query_value("n")).c_str(), nullptr, 10);
+            std::thread([w = chunked::start(req, res), total]() mutable {
+                const std::string all = pattern(total);
+                for (std::size_t off = 0; off < total; off += 8192)
+                    if (!w.write(std::string_view(all).substr(off, 8192))) return;
+                w.end();
+            }).detach();
+        });
+
+        // Producer on the loop thread: fill to the high mark, continue on drain.
+        server_->Get("/pump", [](Request& req, Response& res) {
+            struct Pump {
+                chunked::Writer w;
+                std::string all = pattern(1 << 20);
+                std::size_t off = 0;
+                void run(const std::shared_ptr<Pump>& self) {
+                    while (off < all.size() && w.ready()) {
+                        w.write(std::string_view(all).substr(off, 4096));
+                        off += 4096;
+                    }
+                    if (off < all.size()) {
+                        w.on_drain([self] { self->run(self); });
+                    } else {
+                        w.end();
+                    }
+                }
+            };
+            auto p = std::make_shared<Pump>();
+            p->w = chunked::start(req, res);
+            p->run(p);
+            p->w.trailer("X-Inline", std::to_string(p->off)); // written before adoption
+        });
+
+        // Another handler writing to the held stream from an event loop.
+        server_->Get("/flood", [this](Request&, Response& res) {
+            chunked::Writer w = held();
+            int n = 0;
+            while (n < 1000 && w.write(std::string(16 * 1024, 'f'))) ++n;
+            res.send(std::to_string(n) + (w.alive() ? " alive" : " dead"));
+        });
+
+        server_->Get("/dropped", [](Request& req, Response& res) {
+            chunked::Writer w = chunked::start(req, res);
+            w.write("partial");
+        });
+
+        ASSERT_TRUE(server_->Run("127.0.0.1", 0));
+        port_ = server_->port();
+    }
+
+    void TearDown() override {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            held_ = chunked::Writer();
+        }
+        server_->Stop();
+    }
+
+    chunked::Writer held() {
+        for (int i = 0; i < 300; ++i) {
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                if (held_.valid()) return held_;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return {};
+    }
+
+    std::unique_ptr<Server> server_;
+    uint16_t port_{0};
+    std::mutex mu_;
+    chunked::Writer held_;
+};
+
+TEST_F(ChunkedTest, FramesChunksAndTrailersThenKeepsAlive) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all(simple_get("/inline")));
+    auto r = read_chunked(c);
+    ASSERT_TRUE(r);
+    EXPECT_TRUE(has_line(r->head, "Transfer-Encoding: chunked"));
+    EXPECT_TRUE(has_line(r->head, "Connection: keep-alive"));
+    EXPECT_TRUE(has_line(r->head, "Content-Type: application/x-ndjson"));
+    EXPECT_EQ(r->head.find("Content-Length"), std::string::npos);
+    EXPECT_EQ(r->body, "{\"n\":1}\n{\"n\":2}\n");
+    EXPECT_EQ(r->trailers, "X-Count: 2\r\n");
+
+    // Same connection serves the next request.
+    ASSERT_TRUE(c.send_all(simple_get("/fast")));
+    auto next = c.read_response();
+    ASSERT_TRUE(next);
+    EXPECT_EQ(next->body, "fast");
+}
+
+TEST_F(ChunkedTest, PipelinedRequestWaitsForTheStream) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all(simple_get("/held") + simple_get("/fast")));
+    chunked::Writer w = held();
+    ASSERT_TRUE(w.valid());
+    EXPECT_TRUE(w.alive());
+
+    std::string early;
+    c.read_until(early, [](const std::string& b) { return b.find("fast") != std::string::npos; }, 150);
+    EXPECT_EQ(early.find("fast"), std::string::npos);
+
+    EXPECT_TRUE(w.write("second"));
+    EXPECT_TRUE(w.end());
+    EXPECT_FALSE(w.alive());
+
+    std::string rest;
+    ASSERT_TRUE(c.read_until(rest, [](const std::string& b) {
+        return b.find("\r\n\r\nfast") != std::string::npos;
+    }));
+    const std::string all = early + rest;
+    auto r = parse_chunked(all);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->body, "first;second");
+    EXPECT_NE(all.find("HTTP/1.1 200", r->size), std::string::npos);
+}
+
+TEST_F(ChunkedTest, SlowClientBlocksTheProducer) {
+    const std::size_t total = 4 << 20;
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all(simple_get("/big?n=" + std::to_string(total))));
+    // Let the producer run into the high-water mark before reading.
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_GT(server_->stats().stream_blocks, 0u);
+
+    auto r = read_chunked(c, 5000);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->body.size(), total);
+    EXPECT_EQ(r->body, pattern(total));
+}
+
+TEST_F(ChunkedTest, LoopThreadProducerResumesOnDrain) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all(simple_get("/pump")));
+    auto r = read_chunked(c, 5000);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->body, pattern(1 << 20));
+    // ready() held the producer at the high mark (64 KiB) from start().
+    const std::size_t inline_bytes = std::strtoul(r->trailers.c_str() + 10, nullptr, 10);
+    EXPECT_EQ(r->trailers.rfind("X-Inline: ", 0), 0u);
+    EXPECT_LE(inline_bytes, 64u * 1024 + 4096);
+}
+
+TEST_F(ChunkedTest, EventLoopWriterIsRefusedInsteadOfBlocking) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all(simple_get("/held")));
+    ASSERT_TRUE(held().valid());
+
+    auto r = testclient::request(port_, simple_get("/flood"));
+    ASSERT_TRUE(r);
+    const int accepted = std::atoi(r->body.c_str());
+    EXPECT_GT(accepted, 0);
+    EXPECT_LT(accepted, 1000);
+    EXPECT_NE(r->body.find("alive"), std::string::npos);
+    EXPECT_EQ(server_->stats().stream_blocks, 0u);
+    EXPECT_GE(server_->stats().stream_drops, 1u);
+}
+
+TEST_F(ChunkedTest, DroppedWriterAbortsTheBody) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all(simple_get("/dropped")));
+    const std::string raw = c.read_all(); // returns at close
+    EXPECT_NE(raw.find("partial"), std::string::npos);
+    EXPECT_FALSE(parse_chunked(raw)); // no last chunk
+}
+
+TEST_F(ChunkedTest, HeadSendsOnlyTheHead) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all("HEAD /inline HTTP/1.1\r\nHost: test\r\n\r\n" + simple_get("/fast")));
+    std::string raw;
+    ASSERT_TRUE(c.read_until(raw, [](const std::string& b) {
+        return b.find("\r\n\r\nfast") != std::string::npos;
+    }));
+    const auto head_end = raw.find("\r\n\r\n");
+    EXPECT_TRUE(has_line(raw.substr(0, head_end + 2), "Transfer-Encoding: chunked"));
+    EXPECT_EQ(raw.compare(head_end + 4, 8, "HTTP/1.1"), 0); // no body before the next response
+}
+
+TEST_F(ChunkedTest, Http10GetsAnUnframedBodyAndClose) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all("GET /inline HTTP/1.0\r\n\r\n"));
+    const std::string raw = c.read_all();
+    const auto head_end = raw.find("\r\n\r\n");
+    ASSERT_NE(head_end, std::string::npos);
+    const std::string head = raw.substr(0, head_end + 2);
+    EXPECT_EQ(head.find("Transfer-Encoding"), std::string::npos);
+    EXPECT_TRUE(has_line(head, "Connection: close"));
+    EXPECT_EQ(raw.substr(head_end + 4), "{\"n\":1}\n{\"n\":2}\n");
+}
+
+TEST_F(ChunkedTest, Http10KeepAliveStillClosesAnUnframedBody) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all("GET /inline HTTP/1.0\r\nConnection: keep-alive\r\n\r\n"));
+    const std::string raw = c.read_all(); // returns at close
+    const auto head_end = raw.find("\r\n\r\n");
+    ASSERT_NE(head_end, std::string::npos);
+    const std::string head = raw.substr(0, head_end + 2);
+    EXPECT_TRUE(has_line(head, "Connection: close"));
+    EXPECT_FALSE(has_line(head, "Connection: keep-alive"));
+    EXPECT_EQ(raw.substr(head_end + 4), "{\"n\":1}\n{\"n\":2}\n");
+}
+
+TEST_F(ChunkedTest, ClientGoneMakesWriterDead) {
+    {
+        TcpClient c;
+        ASSERT_TRUE(c.connect_to(port_));
+        ASSERT_TRUE(c.send_all(simple_get("/held")));
+        ASSERT_TRUE(held().valid());
+    }
+    chunked::Writer w = held();
+    for (int i = 0; i < 300 && w.alive(); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_FALSE(w.alive());
+    EXPECT_FALSE(w.write("nobody listens"));
+}
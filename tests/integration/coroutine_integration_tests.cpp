@@ -0,0 +1,165 @@
+// Integration tests for coroutine (Task<void>) handlers: resumption on the
+// owning worker loop after timers, offload() and outbound client calls,
+// with a blocking pool and with the default offload pool.
+
+#include "socketify/socketify.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#include "integration/test_client.h"
+
+using namespace socketify;
+using testclient::TcpClient;
+using testclient::request;
+using testclient::simple_get;
+
+namespace {
+
+// True once @p n callers are inside at the same time (or false after 2 s).
+bool rendezvous(std::atomic<int>& inside, int n) {
+    inside.fetch_add(1);
+    auto until = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (inside.load() < n) {
+        if (std::chrono::steady_clock::now() > until) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+} // namespace
+
+class CoroutineTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ServerOptions opts;
+        opts.workers = 1;
+        opts.blocking_threads = blocking_threads();
+        server_ = std::make_unique<Server>(opts);
+
+        server_->Use([](Request&, Response& res, Next next) {
+            res.set_header("X-Mw", "1");
+            next();
+        });
+
+        server_->Get("/fast", [](Request&, Response& res) { res.send("fast"); });
+
+        server_->Get("/sync", [](Request& req, Response& res) -> Task<void> {
+            res.send("sync " + std::to_string(req.params().size()));
+            co_return;
+        });
+
+        server_->Get("/sleep/:ms", [](Request& req, Response& res) -> Task<void> {
+            int ms = std::stoi(req.params().at("ms"));
+            co_await sleep_for(std::chrono::milliseconds(ms));
+            res.send("slept " + req.params().at("ms"));
+        });
+
+        server_->Get("/fanout", [this](Request&, Response& res) -> Task<void> {
+            auto [a, b] = co_await when_all(offload([this] { return rendezvous(inside_, 2); }),
+                                            offload([this] { return rendezvous(inside_, 2); }));
+            res.send(a && b ? "concurrent" : "serial");
+        });
+
+        server_->Get("/throws", [](Request&, Response&) -> Task<void> {
+            co_await sleep_for(std::chrono::milliseconds(1));
+            throw std::runtime_error("late failure");
+        });
+
+        server_->Get("/proxy", [this](Request&, Response& res) -> Task<void> {
+            auto up = co_await http_client::async_get("http://127.0.0.1:" + std::to_string(port_) + "/fast");
+            res.status(up.ok() ? 200 : 502).send("upstream " + up.body);
+        });
+
+        ASSERT_TRUE(server_->Run("127.0.0.1", 0));
+        port_ = server_->port();
+    }
+
+    void TearDown() override { server_->Stop(); }
+
+    virtual unsigned blocking_threads() const { return 2; }
+
+    std::unique_ptr<Server> server_;
+    uint16_t port_{0};
+    std::atomic<int> inside_{0};
+};
+
+TEST_F(CoroutineTest, CompletesWithoutSuspending) {
+    auto r = request(port_, simple_get("/sync"));
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, 200);
+    EXPECT_EQ(r->body, "sync 0");
+    EXPECT_EQ(r->headers["x-mw"], "1");
+}
+
+TEST_F(CoroutineTest, SleepDoesNotBlockTheLoop) {
+    TcpClient slow;
+    ASSERT_TRUE(slow.connect_to(port_));
+    auto t0 = std::chrono::steady_clock::now();
+    ASSERT_TRUE(slow.send_all(simple_get("/sleep/300")));
+
+    // The single worker answers others while the handler sleeps.
+    auto fast = request(port_, simple_get("/fast"));
+    ASSERT_TRUE(fast);
+    EXPECT_EQ(fast->body, "fast");
+    EXPECT_LT(std::chrono::steady_clock::now() - t0, std::chrono::milliseconds(250));
+
+    auto r = slow.read_response();
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->body, "slept 300");
+    EXPECT_EQ(r->headers["x-mw"], "1");
+    EXPECT_GE(std::chrono::steady_clock::now() - t0, std::chrono::milliseconds(300));
+}
+
+TEST_F(CoroutineTest, WhenAllRunsOffloadsConcurrently) {
+    auto r = request(port_, simple_get("/fanout"), 5000);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->body, "concurrent");
+}
+
+TEST_F(CoroutineTest, ExceptionAfterSuspensionIs500) {
+    auto r = request(port_, simple_get("/throws"));
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, 500);
+    EXPECT_NE(r->body.find("late failure"), std::string::npos);
+}
+
+TEST_F(CoroutineTest, OutboundClientCallKeepsLoopFree) {
+    // The upstream is this same single-worker server: a blocking call on
+    // the loop would deadlock.
+    auto r = request(port_, simple_get("/proxy"), 5000);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, 200);
+    EXPECT_EQ(r->body, "upstream fast");
+}
+
+TEST_F(CoroutineTest, PipelinedAfterCoroutineStayInOrder) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all(simple_get("/sleep/50") + simple_get("/fast")));
+    auto r1 = c.read_response();
+    auto r2 = c.read_response();
+    ASSERT_TRUE(r1);
+    ASSERT_TRUE(r2);
+    EXPECT_EQ(r1->body, "slept 50");
+    EXPECT_EQ(r2->body, "fast");
+}
+
+// blocking_threads = 0: offload() still leaves the loop.
+class CoroutineDefaultPoolTest : public CoroutineTest {
+protected:
+    unsigned blocking_threads() const override { return 0; }
+};
+
+TEST_F(CoroutineDefaultPoolTest, OffloadRunsOffTheLoop) {
+    auto fan = request(port_, simple_get("/fanout"), 5000);
+    ASSERT_TRUE(fan);
+    EXPECT_EQ(fan->body, "concurrent");
+    auto proxy = request(port_, simple_get("/proxy"), 5000);
+    ASSERT_TRUE(proxy);
+    EXPECT_EQ(proxy->body, "upstream fast");
+}
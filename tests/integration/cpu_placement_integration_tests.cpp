@@ -0,0 +1,95 @@
+// Integration tests for pinned / NUMA-local workers with reuseport CPU
+// steering and the per-worker counters behind Server::stats().
+
+#include "socketify/detail/cpu_affinity.h"
+#include "socketify/socketify.h"
+
+#include <gtest/gtest.h>
+
+#include "integration/test_client.h"
+
+using namespace socketify;
+using testclient::TcpClient;
+using testclient::request;
+using testclient::simple_get;
+
+TEST(CpuPlacement, PinnedSteeredWorkersServeAndCount) {
+    ServerOptions opts;
+    opts.workers = 2;
+    opts.pin_workers = true;
+    opts.numa_local = true;
+    opts.reuseport_cpu_steering = true;
+    opts.track_cpu_locality = true;
+    Server server(opts);
+    server.Get("/hello", [](Request&, Response& res) { res.send("world"); });
+    ASSERT_TRUE(server.Run("127.0.0.1", 0));
+    EXPECT_TRUE(server.cpu_steering());
+
+    for (int i = 0; i < 10; ++i) {
+        auto r = request(server.port(), simple_get("/hello", "Connection: close\r\n"));
+        ASSERT_TRUE(r) << "iteration " << i;
+        EXPECT_EQ(r->body, "world");
+    }
+
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(server.port()));
+    ASSERT_TRUE(c.send_all(simple_get("/hello") + simple_get("/hello")));
+    ASSERT_TRUE(c.read_response());
+    ASSERT_TRUE(c.read_response());
+
+    ServerStats st = server.stats();
+    EXPECT_EQ(st.accepted, 11u);
+    EXPECT_EQ(st.requests, 12u);
+    EXPECT_GE(st.wakeups, 11u);
+    EXPECT_LE(st.cross_cpu_wakeups, st.wakeups);
+    server.Stop();
+}
+
+TEST(CpuPlacement, SteeringSpreadsWorkersSharingACpu) {
+    ServerOptions opts;
+    opts.workers = 4;
+    opts.worker_cpus = {detail::allowed_cpus().front()};
+    opts.reuseport_cpu_steering = true;
+    Server server(opts);
+    server.Get("/hello", [](Request&, Response& res) { res.send("world"); });
+    ASSERT_TRUE(server.Run("127.0.0.1", 0));
+    EXPECT_TRUE(server.cpu_steering());
+
+    for (int i = 0; i < 64; ++i) {
+        auto r = request(server.port(), simple_get("/hello", "Connection: close\r\n"));
+        ASSERT_TRUE(r) << "iteration " << i;
+    }
+
+    auto per = server.worker_stats();
+    ASSERT_EQ(per.size(), 4u);
+    for (std::size_t i = 0; i < per.size(); ++i) EXPECT_GT(per[i].accepted, 0u) << "worker " << i;
+    server.Stop();
+}
+
+TEST(CpuPlacement, LocalityIsNotSampledByDefault) {
+    Server server;
+    server.Get("/hello", [](Request&, Response& res) { res.send("world"); });
+    ASSERT_TRUE(server.Run("127.0.0.1", 0));
+    EXPECT_FALSE(server.cpu_steering());
+    ASSERT_TRUE(request(server.port(), simple_get("/hello")));
+    EXPECT_EQ(server.stats().wakeups, 0u);
+    EXPECT_EQ(server.stats().requests, 1u);
+    server.Stop();
+}
+
+TEST(CpuPlacement, FailedBindReleasesWorkersBuiltOnTheirThreads) {
+    ServerOptions opts;
+    opts.workers = 3;
+    opts.pin_workers = true;
+    opts.numa_local = true;
+    Server server(opts);
+    server.Get("/hello", [](Request&, Response& res) { res.send("world"); });
+    EXPECT_FALSE(server.Run("not-an-address", 0));
+    EXPECT_FALSE(server.last_error().empty());
+
+    ASSERT_TRUE(server.Run("127.0.0.1", 0));
+    auto r = request(server.port(), simple_get("/hello", "Connection: close\r\n"));
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->body, "world");
+    server.Stop();
+}
@@ -0,0 +1,248 @@
+// Integration tests for deferred responses and Route::Blocking() handlers
+// running on the blocking pool.
+
+#include "socketify/socketify.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "integration/test_client.h"
+
+using namespace socketify;
+using testclient::TcpClient;
+using testclient::request;
+using testclient::simple_get;
+
+namespace {
+
+// One-shot latch the tests use to hold a handler until they say so.
+class Gate {
+public:
+    void open() {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            open_ = true;
+        }
+        cv_.notify_all();
+    }
+    bool wait(std::chrono::milliseconds timeout = std::chrono::milliseconds(3000)) {
+        std::unique_lock<std::mutex> lk(mu_);
+        return cv_.wait_for(lk, timeout, [this] { return open_; });
+    }
+
+private:
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool open_{false};
+};
+
+} // namespace
+
+class DeferredTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ServerOptions opts;
+        opts.workers = 1; // slow and fast requests share one loop
+        opts.blocking_threads = 1;
+        opts.blocking_queue = 1;
+        server_ = std::make_unique<Server>(opts);
+
+        server_->Use([](Request&, Response& res, Next next) {
+            res.set_header("X-Mw", "1");
+            next();
+        });
+
+        server_->Get("/fast", [](Request&, Response& res) { res.send("fast"); });
+
+        server_->Get("/later", [this](Request&, Response& res) {
+            Deferred d = defer(res);
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                held_ = d;
+            }
+            ready_.open();
+        });
+
+        server_->Get("/thread", [](Request& req, Response& res) {
+            std::string who(req.query_value("who"));
+            std::thread([d = defer(res), who]() mutable {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                d.finish([&](Response& r) {
+                    r.status(Status::Created).send("hi " + who);
+                });
+            }).detach();
+        });
+
+        server_->Get("/dropped", [](Request&, Response& res) { (void)defer(res); });
+
+        server_->Get("/block/:id", [this](Request& req, Response& res) {
+            entered_.fetch_add(1);
+            release_.wait();
+            res.send("blocked " + req.params().at("id"));
+        }).Blocking();
+
+        ASSERT_TRUE(server_->Run("127.0.0.1", 0));
+        port_ = server_->port();
+    }
+
+    void TearDown() override {
+        release_.open();
+        server_->Stop();
+    }
+
+    Deferred held() {
+        std::lock_guard<std::mutex> lk(mu_);
+        return held_;
+    }
+
+    bool wait_entered(int n) {
+        for (int i = 0; i < 300 && entered_.load() < n; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return entered_.load() >= n;
+    }
+
+    std::unique_ptr<Server> server_;
+    uint16_t port_{0};
+    std::mutex mu_;
+    Deferred held_;
+    Gate ready_;
+    Gate release_;
+    std::atomic<int> entered_{0};
+};
+
+TEST_F(DeferredTest, FinishedFromAnotherThread) {
+    auto r = request(port_, simple_get("/thread?who=bob"));
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, 201);
+    EXPECT_EQ(r->body, "hi bob");
+    EXPECT_EQ(r->headers["x-mw"], "1"); // middleware headers survive defer()
+}
+
+TEST_F(DeferredTest, LoopKeepsServingWhileDeferred) {
+    TcpClient slow;
+    ASSERT_TRUE(slow.connect_to(port_));
+    ASSERT_TRUE(slow.send_all(simple_get("/later")));
+    ASSERT_TRUE(ready_.wait());
+
+    auto fast = request(port_, simple_get("/fast"));
+    ASSERT_TRUE(fast);
+    EXPECT_EQ(fast->body, "fast");
+
+    Deferred d = held();
+    ASSERT_TRUE(d.alive());
+    EXPECT_TRUE(d.send("done"));
+    EXPECT_FALSE(d.send("again"));
+    EXPECT_FALSE(d.alive());
+
+    auto r = slow.read_response();
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, 200);
+    EXPECT_EQ(r->body, "done");
+}
+
+TEST_F(DeferredTest, PipelinedRequestsWaitForDeferredOne) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all(simple_get("/later") + simple_get("/fast")));
+    ASSERT_TRUE(ready_.wait());
+
+    // Nothing may be written before the deferred response.
+    std::string early;
+    EXPECT_FALSE(c.read_until(early, [](const std::string& b) { return !b.empty(); }, 100));
+
+    held().send("first");
+    auto r1 = c.read_response();
+    auto r2 = c.read_response();
+    ASSERT_TRUE(r1);
+    ASSERT_TRUE(r2);
+    EXPECT_EQ(r1->body, "first");
+    EXPECT_EQ(r2->body, "fast");
+}
+
+TEST_F(DeferredTest, DroppedHandleAnswers500) {
+    auto r = request(port_, simple_get("/dropped"));
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, 500);
+}
+
+TEST_F(DeferredTest, ClientGoneMakesHandleDead) {
+    {
+        TcpClient c;
+        ASSERT_TRUE(c.connect_to(port_));
+        ASSERT_TRUE(c.send_all(simple_get("/later")));
+        ASSERT_TRUE(ready_.wait());
+    }
+    Deferred d = held();
+    for (int i = 0; i < 300 && d.alive(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_FALSE(d.alive());
+    EXPECT_FALSE(d.send("nobody listens"));
+}
+
+TEST_F(DeferredTest, BlockingRouteDoesNotStallLoop) {
+    TcpClient slow;
+    ASSERT_TRUE(slow.connect_to(port_));
+    ASSERT_TRUE(slow.send_all(simple_get("/block/7")));
+    ASSERT_TRUE(wait_entered(1));
+
+    // The only worker loop is free while the pool thread is blocked.
+    auto fast = request(port_, simple_get("/fast"));
+    ASSERT_TRUE(fast);
+    EXPECT_EQ(fast->body, "fast");
+
+    release_.open();
+    auto r = slow.read_response();
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, 200);
+    EXPECT_EQ(r->body, "blocked 7");
+    EXPECT_EQ(r->headers["x-mw"], "1");
+}
+
+TEST_F(DeferredTest, FullBlockingQueueSheds503) {
+    TcpClient running, queued;
+    ASSERT_TRUE(running.connect_to(port_));
+    ASSERT_TRUE(running.send_all(simple_get("/block/1")));
+    ASSERT_TRUE(wait_entered(1));
+    ASSERT_TRUE(queued.connect_to(port_));
+    ASSERT_TRUE(queued.send_all(simple_get("/block/2")));
+    // Give the loop time to queue it behind the running job.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    auto shed = request(port_, simple_get("/block/3"));
+    ASSERT_TRUE(shed);
+    EXPECT_EQ(shed->status, 503);
+
+    release_.open();
+    auto r1 = running.read_response();
+    auto r2 = queued.read_response();
+    ASSERT_TRUE(r1);
+    ASSERT_TRUE(r2);
+    EXPECT_EQ(r1->body, "blocked 1");
+    EXPECT_EQ(r2->body, "blocked 2");
+}
+
+TEST(DeferredInline, BlockingRouteRunsInlineWithoutPool) {
+    Server server;
+    server.Get("/b/:id", [](Request& req, Response& res) {
+        res.send("inline " + req.params().at("id"));
+    }).Blocking();
+    ASSERT_TRUE(server.Run("127.0.0.1", 0));
+
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(server.port()));
+    ASSERT_TRUE(c.send_all(simple_get("/b/1") + simple_get("/b/2")));
+    auto r1 = c.read_response();
+    auto r2 = c.read_response();
+    ASSERT_TRUE(r1);
+    ASSERT_TRUE(r2);
+    EXPECT_EQ(r1->body, "inline 1");
+    EXPECT_EQ(r2->body, "inline 2");
+    server.Stop();
+}
@@ -0,0 +1,98 @@
+// Integration tests for the per-connection read/request budgets and the
+// ready list that requeues a connection which used up its turn, in both
+// level- and edge-triggered modes.
+
+#include "socketify/socketify.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "integration/test_client.h"
+
+using namespace socketify;
+using testclient::TcpClient;
+using testclient::request;
+using testclient::simple_get;
+
+class FairnessTest : public ::testing::TestWithParam<bool> {
+protected:
+    void SetUp() override {
+        ServerOptions opts;
+        opts.workers = 1; // flood and victims share one loop
+        opts.read_budget = 4 * 1024;
+        opts.request_budget = 4;
+        opts.edge_triggered = GetParam();
+        server_ = std::make_unique<Server>(opts);
+        server_->Get("/ping/:n", [](Request& req, Response& res) {
+            res.send(req.params().at("n"));
+        });
+        server_->Post("/echo", [](Request& req, Response& res) {
+            res.send(std::to_string(req.body_view().size()));
+        });
+        ASSERT_TRUE(server_->Run("127.0.0.1", 0));
+        port_ = server_->port();
+    }
+
+    void TearDown() override { server_->Stop(); }
+
+    std::unique_ptr<Server> server_;
+    uint16_t port_{0};
+};
+
+TEST_P(FairnessTest, PipelinedRequestsSurviveRequeueing) {
+    constexpr int kCount = 300;
+    std::string batch;
+    for (int i = 0; i < kCount; ++i) batch += simple_get("/ping/" + std::to_string(i));
+
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all(batch));
+    for (int i = 0; i < kCount; ++i) {
+        auto r = c.read_response();
+        ASSERT_TRUE(r) << "response " << i;
+        EXPECT_EQ(r->body, std::to_string(i));
+    }
+}
+
+TEST_P(FairnessTest, LargeBodyReadAcrossTurns) {
+    std::string body(200 * 1024, 'x');
+    std::string raw = "POST /echo HTTP/1.1\r\nHost: t\r\nContent-Length: " +
+                      std::to_string(body.size()) + "\r\n\r\n" + body;
+    auto r = request(port_, raw, 5000);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, 200);
+    EXPECT_EQ(r->body, std::to_string(body.size()));
+}
+
+TEST_P(FairnessTest, FloodingClientDoesNotStarveOthers) {
+    constexpr int kFlood = 50000;
+    std::string flood;
+    for (int i = 0; i < kFlood; ++i) flood += simple_get("/ping/0");
+
+    // The abusive client never reads its responses.
+    TcpClient abuser;
+    ASSERT_TRUE(abuser.connect_to(port_));
+    std::thread sender([&] { abuser.send_all(flood); });
+
+    for (int i = 0; i < 300 && server_->stats().requests == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto r = request(port_, simple_get("/ping/ok"), 5000);
+    const auto handled = server_->stats().requests;
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->body, "ok");
+    // Served while the flood was still being worked through.
+    EXPECT_LT(handled, static_cast<std::uint64_t>(kFlood));
+
+    server_->Stop();
+    abuser.close();
+    sender.join();
+}
+
+INSTANTIATE_TEST_SUITE_P(Triggering, FairnessTest, ::testing::Values(false, true),
+                         [](const ::testing::TestParamInfo<bool>& info) {
+                             return info.param ? "Edge" : "Level";
+                         });
@@ -0,0 +1,297 @@
+#pragma once
+// Minimal HTTP/2 framing for the tests: build client frames, split server
+// output into frames, and a blocking h2c client over TcpClient that
+// collects whole responses per stream. HPACK comes from the library.
+
+#include "socketify/detail/hpack.h"
+#include "socketify/detail/http2.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "integration/test_client.h"
+
+namespace h2test {
+
+namespace hpack = socketify::detail::hpack;
+using socketify::detail::h2::kPreface;
+
+enum : std::uint8_t {
+    DATA = 0x0,
+    HEADERS = 0x1,
+    PRIORITY = 0x2,
+    RST_STREAM = 0x3,
+    SETTINGS = 0x4,
+    PUSH_PROMISE = 0x5,
+    PING = 0x6,
+    GOAWAY = 0x7,
+    WINDOW_UPDATE = 0x8,
+    CONTINUATION = 0x9,
+};
+
+enum : std::uint8_t { END_STREAM = 0x1, ACK = 0x1, END_HEADERS = 0x4, PADDED = 0x8 };
+
+using Fields = std::vector<std::pair<std::string, std::string>>;
+using Settings = std::vector<std::pair<std::uint16_t, std::uint32_t>>;
+
+struct Frame {
+    std::uint8_t type{0};
+    std::uint8_t flags{0};
+    std::uint32_t stream{0};
+    std::string payload;
+};
+
+inline std::string be32(std::uint32_t v) {
+    return {static_cast<char>(v >> 24), static_cast<char>(v >> 16), static_cast<char>(v >> 8),
+            static_cast<char>(v)};
+}
+
+inline std::uint32_t get32(std::string_view p) {
+    const auto* u = reinterpret_cast<const unsigned char*>(p.data());
+    return (std::uint32_t{u[0]} << 24) | (std::uint32_t{u[1]} << 16) | (std::uint32_t{u[2]} << 8) | u[3];
+}
+
+inline std::string frame(std::uint8_t type, std::uint8_t flags, std::uint32_t stream,
+                         std::string_view payload) {
+    std::string out;
+    out.push_back(static_cast<char>(payload.size() >> 16));
+    out.push_back(static_cast<char>(payload.size() >> 8));
+    out.push_back(static_cast<char>(payload.size()));
+    out.push_back(static_cast<char>(type));
+    out.push_back(static_cast<char>(flags));
+    out += be32(stream);
+    out.append(payload);
+    return out;
+}
+
+inline std::string settings(const Settings& s = {}) {
+    std::string payload;
+    for (auto [id, v] : s) {
+        payload.push_back(static_cast<char>(id >> 8));
+        payload.push_back(static_cast<char>(id));
+        payload += be32(v);
+    }
+    return frame(SETTINGS, 0, 0, payload);
+}
+
+inline std::string window_update(std::uint32_t stream, std::uint32_t inc) {
+    return frame(WINDOW_UPDATE, 0, stream, be32(inc));
+}
+
+inline std::string rst_stream(std::uint32_t stream, std::uint32_t code) {
+    return frame(RST_STREAM, 0, stream, be32(code));
+}
+
+// Pop the complete frames at the front of @p buf.
+inline std::vector<Frame> split(std::string& buf) {
+    std::vector<Frame> out;
+    std::size_t pos = 0;
+    while (buf.size() - pos >= 9) {
+        const auto* u = reinterpret_cast<const unsigned char*>(buf.data() + pos);
+        const std::size_t len = (std::size_t{u[0]} << 16) | (std::size_t{u[1]} << 8) | u[2];
+        if (buf.size() - pos - 9 < len) break;
+        Frame f;
+        f.type = u[3];
+        f.flags = u[4];
+        f.stream = get32(std::string_view(buf).substr(pos + 5)) & 0x7fffffff;
+        f.payload = buf.substr(pos + 9, len);
+        out.push_back(std::move(f));
+        pos += 9 + len;
+    }
+    buf.erase(0, pos);
+    return out;
+}
+
+inline std::string request_block(hpack::Encoder& enc, std::string_view method, std::string_view path,
+                                 const Fields& extra = {}, std::string_view authority = "test") {
+    std::string out;
+    enc.field(out, ":method", method);
+    enc.field(out, ":scheme", "http");
+    enc.field(out, ":path", path);
+    if (!authority.empty()) enc.field(out, ":authority", authority);
+    for (const auto& [n, v] : extra) enc.field(out, n, v);
+    return out;
+}
+
+inline Fields decode_block(hpack::Decoder& dec, std::string_view block) {
+    Fields out;
+    dec.decode(block, [&](std::string_view n, std::string_view v) {
+        out.emplace_back(n, v);
+        return true;
+    });
+    return out;
+}
+
+struct Reply {
+    int status{0};
+    Fields headers;
+    std::string body;
+    bool ended{false};
+    std::int64_t reset{-1}; ///< RST_STREAM error code, -1 when none
+
+    std::string header(std::string_view name) const {
+        for (const auto& [n, v] : headers)
+            if (n == name) return v;
+        return {};
+    }
+    bool has(std::string_view name) const {
+        for (const auto& kv : headers)
+            if (kv.first == name) return true;
+        return false;
+    }
+    bool done() const { return ended || reset >= 0; }
+};
+
+/// Blocking h2c (prior knowledge) client.
+class Client {
+public:
+    bool connect(std::uint16_t port, const Settings& s = {}) {
+        if (!tcp_.connect_to(port)) return false;
+        return tcp_.send_all(std::string(kPreface) + settings(s));
+    }
+
+    bool send(std::string_view bytes) { return tcp_.send_all(bytes); }
+
+    /// Open a stream: HEADERS, then the body as DATA when there is one.
+    std::uint32_t request(std::string_view method, std::string_view path, const Fields& extra = {},
+                          std::string_view body = {}) {
+        const std::uint32_t id = next_stream();
+        const std::string block = request_block(enc_, method, path, extra);
+        std::string out = frame(HEADERS, END_HEADERS | (body.empty() ? END_STREAM : 0), id, block);
+        for (std::size_t off = 0; off < body.size(); off += 16384) {
+            const auto piece = body.substr(off, 16384);
+            out += frame(DATA, off + piece.size() == body.size() ? END_STREAM : 0, id, piece);
+        }
+        replies_[id];
+        return send(out) ? id : 0;
+    }
+
+    std::uint32_t next_stream() {
+        const std::uint32_t id = next_;
+        next_ += 2;
+        return id;
+    }
+
+    /// Read until every stream in @p ids is ended or reset.
+    bool wait(const std::vector<std::uint32_t>& ids, int timeout_ms = 3000) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        auto all_done = [&] {
+            for (auto id : ids)
+                if (!replies_[id].done()) return false;
+            return true;
+        };
+        while (!all_done()) {
+            if (goaway_ || std::chrono::steady_clock::now() > deadline) return false;
+            if (!read_(50) && closed_) return all_done();
+        }
+        return true;
+    }
+
+    /// Read for @p ms and handle whatever arrives.
+    void drain(int ms) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+        while (std::chrono::steady_clock::now() < deadline && !closed_) read_(20);
+    }
+
+    Reply& reply(std::uint32_t id) { return replies_[id]; }
+
+    bool goaway() const { return goaway_; }
+    std::uint32_t goaway_code() const { return goaway_code_; }
+    bool closed() const { return closed_; }
+    const std::vector<std::uint32_t>& finish_order() const { return order_; }
+    std::uint32_t server_max_streams() const { return max_streams_; }
+
+    /// Send WINDOW_UPDATEs for received DATA (default), or let windows run dry.
+    bool auto_window{true};
+
+private:
+    bool read_(int timeout_ms) {
+        const std::size_t before = buf_.size();
+        tcp_.read_until(buf_, [before](const std::string& b) { return b.size() > before; }, timeout_ms);
+        if (buf_.size() == before) {
+            char probe;
+            if (::recv(tcp_.fd(), &probe, 1, MSG_PEEK | MSG_DONTWAIT) == 0) closed_ = true;
+            return false;
+        }
+        for (Frame& f : split(buf_)) on_frame_(f);
+        return true;
+    }
+
+    void on_frame_(Frame& f) {
+        switch (f.type) {
+        case SETTINGS:
+            if ((f.flags & ACK) == 0) {
+                for (std::size_t i = 0; i + 6 <= f.payload.size(); i += 6) {
+                    const auto id = (static_cast<unsigned char>(f.payload[i]) << 8) |
+                                    static_cast<unsigned char>(f.payload[i + 1]);
+                    if (id == 0x3) max_streams_ = get32(std::string_view(f.payload).substr(i + 2));
+                }
+                send(frame(SETTINGS, ACK, 0, {}));
+            }
+            break;
+        case PING:
+            if ((f.flags & ACK) == 0) send(frame(PING, ACK, 0, f.payload));
+            break;
+        case HEADERS:
+        case CONTINUATION:
+            block_ += f.payload;
+            if (f.type == HEADERS) block_flags_ = f.flags;
+            if ((f.flags & END_HEADERS) != 0) {
+                Reply& r = replies_[f.stream];
+                for (auto& kv : decode_block(dec_, block_)) {
+                    if (kv.first == ":status") r.status = std::stoi(kv.second);
+                    else r.headers.push_back(std::move(kv));
+                }
+                block_.clear();
+                if ((block_flags_ & END_STREAM) != 0) end_(f.stream);
+            }
+            break;
+        case DATA: {
+            Reply& r = replies_[f.stream];
+            r.body += f.payload;
+            if (auto_window && !f.payload.empty()) {
+                const auto n = static_cast<std::uint32_t>(f.payload.size());
+                send(window_update(0, n) + ((f.flags & END_STREAM) ? "" : window_update(f.stream, n)));
+            }
+            if ((f.flags & END_STREAM) != 0) end_(f.stream);
+            break;
+        }
+        case RST_STREAM:
+            replies_[f.stream].reset = get32(f.payload);
+            order_.push_back(f.stream);
+            break;
+        case GOAWAY:
+            goaway_ = true;
+            goaway_code_ = get32(std::string_view(f.payload).substr(4));
+            break;
+        default:
+            break;
+        }
+    }
+
+    void end_(std::uint32_t id) {
+        replies_[id].ended = true;
+        order_.push_back(id);
+    }
+
+    testclient::TcpClient tcp_;
+    hpack::Encoder enc_;
+    hpack::Decoder dec_;
+    std::string buf_;
+    std::string block_;
+    std::uint8_t block_flags_{0};
+    std::uint32_t next_{1};
+    std::map<std::uint32_t, Reply> replies_;
+    std::vector<std::uint32_t> order_;
+    bool goaway_{false};
+    std::uint32_t goaway_code_{0};
+    bool closed_{false};
+    std::uint32_t max_streams_{0};
+};
+
+} // namespace h2test
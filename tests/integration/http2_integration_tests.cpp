@@ -0,0 +1,245 @@
+// Integration tests for HTTP/2 over cleartext (prior knowledge): routing
+// through the usual handlers, multiplexing with deferred streams, request
+// bodies and fields, flow-controlled file and buffered bodies, the routes
+// that stay on HTTP/1.1, and cancelled streams ("rapid reset").
+
+#include "socketify/socketify.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "integration/h2_test_client.h"
+#include "integration/test_client.h"
+
+using namespace socketify;
+using h2test::Client;
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string pattern(std::size_t n) {
+    std::string s(n, '\0');
+    for (std::size_t i = 0; i < n; ++i) s[i] = static_cast<char>('a' + i % 26);
+    return s;
+}
+
+} // namespace
+
+class Http2Test : public ::testing::Test {
+protected:
+    void SetUp() override {
+        file_ = fs::temp_directory_path() / ("socketify_h2_" + std::to_string(::getpid()) + ".bin");
+        std::ofstream(file_, std::ios::binary) << pattern(1 << 20);
+
+        ServerOptions opts;
+        opts.workers = 1;
+        opts.http2 = true;
+        server_ = std::make_unique<Server>(opts);
+
+        server_->Get("/hello", [](Request& req, Response& res) {
+            res.set_header("X-Version", std::string(req.http_version()));
+            res.send("hello h2");
+        });
+        server_->Post("/echo", [](Request& req, Response& res) {
+            res.send(std::string(req.query_value("x")) + "|" + std::string(req.header("x-token")) + "|" +
+                     std::string(req.cookie("a")) + std::string(req.cookie("b")) + "|" +
+                     std::string(req.header("host")) + "|" + std::string(req.body_view()));
+        });
+        server_->Get("/slow", [](Request&, Response& res) {
+            std::thread([d = defer(res)]() mutable {
+                std::this_thread::sleep_for(std::chrono::milliseconds(150));
+                d.send("slow");
+            }).detach();
+        });
+        server_->Get("/file", [this](Request&, Response& res) { res.send_file(file_.string()); });
+        server_->Get("/text", [](Request&, Response& res) { res.send(pattern(5000)); });
+        server_->Get("/events", [](Request& req, Response& res) { sse::upgrade(req, res); });
+        server_->Post("/upload", [](Request&, Response& res) { res.send("done"); })
+            .OnBody([](Request&, std::string_view, BodyStream&) {});
+
+        ASSERT_TRUE(server_->Run("127.0.0.1", 0));
+        port_ = server_->port();
+    }
+
+    void TearDown() override {
+        server_->Stop();
+        std::error_code ec;
+        fs::remove(file_, ec);
+    }
+
+    fs::path file_;
+    std::unique_ptr<Server> server_;
+    uint16_t port_{0};
+};
+
+TEST_F(Http2Test, ServesRoutesWithPriorKnowledge) {
+    Client c;
+    ASSERT_TRUE(c.connect(port_));
+    const auto id = c.request("GET", "/hello");
+    ASSERT_TRUE(c.wait({id}));
+    const auto& r = c.reply(id);
+    EXPECT_EQ(r.status, 200);
+    EXPECT_EQ(r.body, "hello h2");
+    EXPECT_EQ(r.header("x-version"), "HTTP/2");
+    EXPECT_EQ(r.header("content-length"), "8");
+    EXPECT_EQ(r.header("server"), "socketify");
+    EXPECT_TRUE(r.has("date"));
+    EXPECT_FALSE(r.has("connection"));
+    EXPECT_EQ(c.server_max_streams(), 100u);
+
+    const auto missing = c.request("GET", "/nope");
+    ASSERT_TRUE(c.wait({missing}));
+    EXPECT_EQ(c.reply(missing).status, 404);
+
+    // HTTP/1.1 is unaffected on the same listener.
+    auto res = testclient::request(port_, testclient::simple_get("/hello"));
+    ASSERT_TRUE(res);
+    EXPECT_EQ(res->body, "hello h2");
+    EXPECT_EQ(res->headers["x-version"], "HTTP/1.1");
+}
+
+TEST_F(Http2Test, FastStreamsOvertakeADeferredOne) {
+    Client c;
+    ASSERT_TRUE(c.connect(port_));
+    const auto slow = c.request("GET", "/slow");
+    const auto a = c.request("GET", "/hello");
+    const auto b = c.request("GET", "/hello");
+    ASSERT_TRUE(c.wait({slow, a, b}));
+    EXPECT_EQ(c.reply(slow).body, "slow");
+    EXPECT_EQ(c.reply(a).body, "hello h2");
+    EXPECT_EQ(c.reply(b).body, "hello h2");
+    ASSERT_EQ(c.finish_order().size(), 3u);
+    EXPECT_EQ(c.finish_order().back(), slow);
+}
+
+TEST_F(Http2Test, CarriesBodyQueryFieldsAndCookies) {
+    Client c;
+    ASSERT_TRUE(c.connect(port_));
+    const std::string body = pattern(40000); // spans several DATA frames
+    const auto id = c.request("POST", "/echo?x=42",
+                              {{"x-token", "t0k"}, {"cookie", "a=1"}, {"cookie", "b=2"}}, body);
+    ASSERT_TRUE(c.wait({id}));
+    EXPECT_EQ(c.reply(id).body, "42|t0k|12|test|" + body);
+}
+
+TEST_F(Http2Test, FileBodyFlowsUnderTheWindows) {
+    Client c;
+    ASSERT_TRUE(c.connect(port_));
+    const auto get = c.request("GET", "/file");
+    const auto head = c.request("HEAD", "/file");
+    ASSERT_TRUE(c.wait({get, head}, 5000));
+    EXPECT_EQ(c.reply(get).header("content-length"), "1048576");
+    EXPECT_EQ(c.reply(get).body, pattern(1 << 20));
+    EXPECT_EQ(c.reply(head).header("content-length"), "1048576");
+    EXPECT_TRUE(c.reply(head).body.empty());
+}
+
+TEST_F(Http2Test, StalledWindowWaitsForWindowUpdate) {
+    Client c;
+    c.auto_window = false;
+    ASSERT_TRUE(c.connect(port_, {{0x4, 1000}}));
+    const auto id = c.request("GET", "/text");
+    c.drain(200);
+    EXPECT_EQ(c.reply(id).status, 200);
+    EXPECT_EQ(c.reply(id).body.size(), 1000u);
+    EXPECT_FALSE(c.reply(id).ended);
+
+    ASSERT_TRUE(c.send(h2test::window_update(id, 10000)));
+    ASSERT_TRUE(c.wait({id}));
+    EXPECT_EQ(c.reply(id).body, pattern(5000));
+}
+
+TEST_F(Http2Test, CompressesLikeHttp1) {
+    Client c;
+    ASSERT_TRUE(c.connect(port_));
+    const auto id = c.request("GET", "/text", {{"accept-encoding", "gzip"}});
+    ASSERT_TRUE(c.wait({id}));
+    EXPECT_EQ(c.reply(id).header("content-encoding"), "gzip");
+    EXPECT_EQ(c.reply(id).header("vary"), "Accept-Encoding");
+    EXPECT_LT(c.reply(id).body.size(), 5000u);
+}
+
+TEST_F(Http2Test, StreamingRoutesAskForHttp11) {
+    Client c;
+    ASSERT_TRUE(c.connect(port_));
+    const auto sse = c.request("GET", "/events");
+    const auto upload = c.request("POST", "/upload", {}, "data");
+    const auto ok = c.request("GET", "/hello");
+    ASSERT_TRUE(c.wait({sse, upload, ok}));
+    EXPECT_EQ(c.reply(sse).reset, 0xd); // HTTP_1_1_REQUIRED
+    EXPECT_EQ(c.reply(upload).reset, 0xd);
+    EXPECT_EQ(c.reply(ok).body, "hello h2");
+}
+
+TEST(Http2Disabled, PrefaceIsJustABadRequest) {
+    ServerOptions opts;
+    opts.workers = 1;
+    Server server(opts);
+    server.Get("/", [](Request&, Response& res) { res.send("x"); });
+    ASSERT_TRUE(server.Run("127.0.0.1", 0));
+    Client c;
+    ASSERT_TRUE(c.connect(server.port()));
+    c.drain(200);
+    EXPECT_FALSE(c.reply(1).done());
+    EXPECT_TRUE(c.closed());
+    server.Stop();
+}
+
+TEST(Http2RapidReset, CancelledHandlersKeepTheirSlotsAndFloodsGetGoaway) {
+    ServerOptions opts;
+    opts.workers = 1;
+    opts.http2 = true;
+    opts.http2_max_streams = 4;
+    Server server(opts);
+    auto running = std::make_shared<std::atomic<int>>(0);
+    server.Get("/hang", [running](Request&, Response& res) {
+        ++*running;
+        std::thread([d = defer(res), running]() mutable {
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            d.send("late");
+            --*running;
+        }).detach();
+    });
+    server.Get("/fast", [](Request&, Response& res) { res.send("fast"); });
+    ASSERT_TRUE(server.Run("127.0.0.1", 0));
+
+    const auto cancel = 0x8u;
+    Client c;
+    ASSERT_TRUE(c.connect(server.port()));
+    for (int i = 0; i < 4; ++i) {
+        const auto id = c.request("GET", "/hang");
+        ASSERT_TRUE(c.send(h2test::rst_stream(id, cancel)));
+    }
+    // Four handlers still run for cancelled streams: the fifth is refused.
+    const auto refused = c.request("GET", "/hang");
+    ASSERT_TRUE(c.wait({refused}));
+    EXPECT_EQ(c.reply(refused).reset, 0x7); // REFUSED_STREAM
+    EXPECT_LE(running->load(), 4);
+
+    // Once they answer, the slots come back.
+    for (int i = 0; i < 100 && running->load() > 0; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    c.drain(50);
+    const auto ok = c.request("GET", "/fast");
+    ASSERT_TRUE(c.wait({ok}));
+    EXPECT_EQ(c.reply(ok).body, "fast");
+
+    // A reset flood ends the connection.
+    Client flood;
+    ASSERT_TRUE(flood.connect(server.port()));
+    for (int i = 0; i < 300 && !flood.closed(); ++i) {
+        const auto id = flood.request("GET", "/fast");
+        if (id == 0 || !flood.send(h2test::rst_stream(id, cancel))) break;
+    }
+    flood.drain(300);
+    EXPECT_TRUE(flood.goaway());
+    EXPECT_EQ(flood.goaway_code(), 0xbu); // ENHANCE_YOUR_CALM
+    server.Stop();
+}
@@ -0,0 +1,268 @@
+// Integration tests for the io_uring event-loop backend. The same wire
+// behaviour as the epoll backend is expected; when the kernel refuses
+// io_uring the server falls back to epoll and the tests are skipped.
+
+#include "socketify/socketify.h"
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include "integration/test_client.h"
+
+using namespace socketify;
+using testclient::TcpClient;
+using testclient::request;
+using testclient::simple_get;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string pattern(std::size_t n) {
+    std::string s(n, '\0');
+    for (std::size_t i = 0; i < n; ++i) s[i] = static_cast<char>('a' + (i * 7 + i / 4093) % 26);
+    return s;
+}
+
+} // namespace
+
+class UringServerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        file_ = fs::temp_directory_path() / ("socketify_uring_" + std::to_string(::getpid()) + ".bin");
+        std::ofstream(file_, std::ios::binary) << pattern(kFileSize);
+
+        ServerOptions opts;
+        opts.workers = 2;
+        opts.io_backend = IoBackend::IoUring;
+        server_ = std::make_unique<Server>(opts);
+
+        server_->Get("/hello", [](Request&, Response& res) { res.send("world"); });
+        server_->Get("/users/:id", [](Request& req, Response& res) {
+            res.send(req.params().at("id"));
+        });
+        server_->Get("/large", [](Request&, Response& res) {
+            res.send(std::string(4 * 1024 * 1024, 'u'), "application/octet-stream");
+        });
+        server_->Post("/sum", [](Request& req, Response& res) {
+            std::uint64_t sum = 0;
+            for (unsigned char ch : req.body_view()) sum += ch;
+            res.send(std::to_string(req.body_view().size()) + ":" + std::to_string(sum));
+        });
+        server_->Get("/file", [this](Request&, Response& res) { res.send_file(file_.string()); });
+        server_->Get("/range", [this](Request&, Response& res) {
+            res.send_file_range(file_.string(), 1000, 70000);
+        });
+        server_->Get("/peer", [](Request& req, Response& res) { res.send(req.remote_ip()); });
+        server_->Get("/events", [this](Request& req, Response& res) {
+            auto s = sse::upgrade(req, res);
+            std::lock_guard<std::mutex> lk(mu_);
+            session_ = s;
+        });
+
+        ASSERT_TRUE(server_->Run("127.0.0.1", 0)) << server_->last_error();
+        port_ = server_->port();
+        if (server_->io_backend() != IoBackend::IoUring) {
+            GTEST_SKIP() << "io_uring unavailable; server fell back to epoll";
+        }
+    }
+
+    void TearDown() override {
+        server_->Stop();
+        std::error_code ec;
+        fs::remove(file_, ec);
+    }
+
+    sse::Session session() {
+        std::lock_guard<std::mutex> lk(mu_);
+        return session_;
+    }
+
+    // Several times the 256 KiB splice pipe, so file sends take many rounds.
+    static constexpr std::size_t kFileSize = 3 * 1024 * 1024 + 17;
+
+    fs::path file_;
+    std::unique_ptr<Server> server_;
+    uint16_t port_{0};
+    std::mutex mu_;
+    sse::Session session_;
+};
+
+TEST_F(UringServerTest, BasicGet) {
+    auto r = request(port_, simple_get("/hello"));
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->status, 200);
+    EXPECT_EQ(r->body, "world");
+}
+
+TEST_F(UringServerTest, PipelinedKeepAlive) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all(simple_get("/hello") + simple_get("/users/9")));
+    auto r1 = c.read_response();
+    ASSERT_TRUE(r1.has_value());
+    EXPECT_EQ(r1->body, "world");
+    auto r2 = c.read_response();
+    ASSERT_TRUE(r2.has_value());
+    EXPECT_EQ(r2->body, "9");
+
+    ASSERT_TRUE(c.send_all(simple_get("/users/10")));
+    auto r3 = c.read_response();
+    ASSERT_TRUE(r3.has_value());
+    EXPECT_EQ(r3->body, "10");
+}
+
+TEST_F(UringServerTest, LargeResponseWaitsForWritability) {
+    auto r = request(port_, simple_get("/large"), 10000);
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->status, 200);
+    EXPECT_EQ(r->body.size(), 4u * 1024 * 1024);
+}
+
+TEST_F(UringServerTest, ManyShortConnectionsRecycleFds) {
+    for (int i = 0; i < 50; ++i) {
+        auto r = request(port_, simple_get("/hello", "Connection: close\r\n"));
+        ASSERT_TRUE(r.has_value()) << "iteration " << i;
+        EXPECT_EQ(r->body, "world");
+    }
+}
+
+TEST_F(UringServerTest, CrossThreadWakeupDeliversSseEvent) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all(simple_get("/events")));
+    std::string buf;
+    ASSERT_TRUE(c.read_until(buf, [](const std::string& b) {
+        return b.find("\r\n\r\n") != std::string::npos;
+    }));
+
+    sse::Session s;
+    for (int i = 0; i < 100 && !s.valid(); ++i) {
+        s = session();
+        if (!s.valid()) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(s.valid());
+    ASSERT_TRUE(s.send_event("tick", "from-test-thread"));
+    EXPECT_TRUE(c.read_until(buf, [](const std::string& b) {
+        return b.find("data: from-test-thread") != std::string::npos;
+    }));
+}
+
+TEST_F(UringServerTest, KernelAcceptKnowsThePeer) {
+    auto r = request(port_, simple_get("/peer"));
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->body, "127.0.0.1");
+}
+
+// 6 MiB outruns the loop's 2 MiB buffer ring within one batch; the recv is
+// re-armed after the buffers come back and nothing is lost or reordered.
+TEST_F(UringServerTest, UploadLargerThanTheBufferRing) {
+    std::string body(6 * 1024 * 1024, '\0');
+    std::uint64_t sum = 0;
+    for (std::size_t i = 0; i < body.size(); ++i) {
+        body[i] = static_cast<char>('a' + (i * 7 + i / 8191) % 26);
+        sum += static_cast<unsigned char>(body[i]);
+    }
+    auto r = request(port_,
+                     "POST /sum HTTP/1.1\r\nHost: test\r\nContent-Length: " +
+                         std::to_string(body.size()) + "\r\n\r\n" + body,
+                     10000);
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->status, 200);
+    EXPECT_EQ(r->body, std::to_string(body.size()) + ":" + std::to_string(sum));
+}
+
+// Backlogged output pauses reading (the recv is cancelled) and resumes it
+// as the client drains; every pipelined request is still answered in order.
+TEST_F(UringServerTest, PausedReadingResumesTheRecv) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    std::string pipeline;
+    for (int i = 0; i < 6; ++i) pipeline += simple_get("/large");
+    pipeline += simple_get("/users/last");
+    ASSERT_TRUE(c.send_all(pipeline));
+    for (int i = 0; i < 6; ++i) {
+        auto r = c.read_response(10000);
+        ASSERT_TRUE(r.has_value()) << "response " << i;
+        EXPECT_EQ(r->body.size(), 4u * 1024 * 1024);
+    }
+    auto last = c.read_response();
+    ASSERT_TRUE(last.has_value());
+    EXPECT_EQ(last->body, "last");
+    EXPECT_GT(server_->stats().read_pauses, 0u);
+}
+
+// Files go out through a spliced pipe in linked submissions, a pipe's worth
+// per round; every byte arrives in order.
+TEST_F(UringServerTest, FileResponseSpansManySplices) {
+    auto r = request(port_, simple_get("/file"), 10000);
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->status, 200);
+    EXPECT_TRUE(r->body == pattern(kFileSize)) << "body of " << r->body.size() << " bytes differs";
+
+    auto part = request(port_, simple_get("/range"));
+    ASSERT_TRUE(part.has_value());
+    EXPECT_EQ(part->body, pattern(kFileSize).substr(1000, 70000));
+}
+
+// Responses queued while a send is in flight follow it, including ones
+// behind a file body.
+TEST_F(UringServerTest, PipelinedResponsesAroundAFileStayInOrder) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all(simple_get("/hello") + simple_get("/file") + simple_get("/users/1") +
+                           simple_get("/large") + simple_get("/range") + simple_get("/users/2")));
+    auto hello = c.read_response();
+    ASSERT_TRUE(hello.has_value());
+    EXPECT_EQ(hello->body, "world");
+    auto file = c.read_response(10000);
+    ASSERT_TRUE(file.has_value());
+    EXPECT_EQ(file->body.size(), kFileSize);
+    auto one = c.read_response();
+    ASSERT_TRUE(one.has_value());
+    EXPECT_EQ(one->body, "1");
+    auto large = c.read_response(10000);
+    ASSERT_TRUE(large.has_value());
+    EXPECT_EQ(large->body.size(), 4u * 1024 * 1024);
+    auto range = c.read_response();
+    ASSERT_TRUE(range.has_value());
+    EXPECT_EQ(range->body.size(), 70000u);
+    auto two = c.read_response();
+    ASSERT_TRUE(two.has_value());
+    EXPECT_EQ(two->body, "2");
+}
+
+// A client that leaves with sends still in flight: the connection is torn
+// down when the kernel hands the buffers back and the worker keeps serving.
+TEST_F(UringServerTest, DisconnectMidResponseKeepsServing) {
+    for (int i = 0; i < 20; ++i) {
+        TcpClient c;
+        ASSERT_TRUE(c.connect_to(port_));
+        ASSERT_TRUE(c.send_all(simple_get(i % 2 ? "/file" : "/large")));
+        std::string buf;
+        ASSERT_TRUE(c.read_until(buf, [](const std::string& b) { return b.size() > 4096; }));
+        c.close();
+    }
+    auto r = request(port_, simple_get("/hello"));
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->body, "world");
+}
+
+// A peer that half-closes after its request still gets the whole response.
+TEST_F(UringServerTest, HalfClosedPeerGetsTheWholeResponse) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all(simple_get("/file")));
+    ASSERT_EQ(::shutdown(c.fd(), SHUT_WR), 0);
+    auto r = c.read_response(10000);
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->body.size(), kFileSize);
+}
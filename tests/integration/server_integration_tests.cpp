@@ -165,6 +165,22 @@ TEST_F(ServerTest, PipelinedRequests) {
     EXPECT_EQ(r2->body, "9");
 }
 
+TEST_F(ServerTest, PipelinedLargeBodyKeepsOrder) {
+    // /big travels as its own output segment between two head blocks.
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all(simple_get("/hello") + simple_get("/big") + simple_get("/users/3")));
+    auto r1 = c.read_response();
+    ASSERT_TRUE(r1.has_value());
+    EXPECT_EQ(r1->body, "world");
+    auto r2 = c.read_response();
+    ASSERT_TRUE(r2.has_value());
+    EXPECT_EQ(r2->body, std::string(8192, 'x'));
+    auto r3 = c.read_response();
+    ASSERT_TRUE(r3.has_value());
+    EXPECT_EQ(r3->body, "3");
+}
+
 TEST_F(ServerTest, ConnectionCloseHonored) {
     TcpClient c;
     ASSERT_TRUE(c.connect_to(port_));
@@ -8,9 +8,11 @@
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <chrono>
 #include <cstring>
 #include <optional>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 namespace testclient {
@@ -170,4 +172,14 @@ inline std::string simple_get(std::string_view path, std::string_view extra_head
     return r;
 }
 
+// Polls pred every 5 ms until it holds or ms elapse.
+template <typename Pred>
+bool eventually(Pred pred, int ms = 3000) {
+    for (int i = 0; i < ms / 5; ++i) {
+        if (pred()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return pred();
+}
+
 } // namespace testclient
@@ -45,7 +45,8 @@ public:
         if (fd_ >= 0) ::close(fd_);
     }
 
-    bool connect_to(uint16_t port) {
+    /// @p alpn is the wire-format protocol list to offer (none when empty).
+    bool connect_to(uint16_t port, std::string_view alpn = {}) {
         fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
         if (fd_ < 0) return false;
         sockaddr_in addr{};
@@ -59,6 +60,9 @@ public:
         // Self-signed test cert: skip verification.
         SSL_CTX_set_verify(ctx_, SSL_VERIFY_NONE, nullptr);
         ssl_ = SSL_new(ctx_);
+        if (!alpn.empty())
+            SSL_set_alpn_protos(ssl_, reinterpret_cast<const unsigned char*>(alpn.data()),
+                                static_cast<unsigned>(alpn.size()));
         SSL_set_fd(ssl_, fd_);
         return SSL_connect(ssl_) == 1;
     }
@@ -93,8 +97,22 @@ public:
         return out;
     }
 
+    /// Whatever one SSL_read returns.
+    std::string read_once() {
+        char buf[4096];
+        const int n = SSL_read(ssl_, buf, sizeof(buf));
+        return n > 0 ? std::string(buf, static_cast<std::size_t>(n)) : std::string();
+    }
+
     const char* tls_version() const { return SSL_get_version(ssl_); }
 
+    std::string alpn() const {
+        const unsigned char* p = nullptr;
+        unsigned len = 0;
+        SSL_get0_alpn_selected(ssl_, &p, &len);
+        return p ? std::string(reinterpret_cast<const char*>(p), len) : std::string();
+    }
+
 private:
     int fd_{-1};
     SSL_CTX* ctx_{nullptr};
@@ -116,12 +134,18 @@ protected:
 
         ServerOptions opts;
         opts.tls = TlsOptions{.cert_file = cert_.string(), .key_file = key_.string()};
+        configure(opts);
         server_ = std::make_unique<Server>(opts);
         server_->Get("/secure", [](Request&, Response& res) { res.send("tls ok"); });
+        server_->Get("/big", [](Request&, Response& res) {
+            res.send(std::string(1024 * 1024, 'b'), "application/octet-stream");
+        });
         ASSERT_TRUE(server_->Run("127.0.0.1", 0)) << server_->last_error();
         port_ = server_->port();
     }
 
+    virtual void configure(ServerOptions&) {}
+
     void TearDown() override {
         if (server_) server_->Stop();
         std::error_code ec;
@@ -142,6 +166,18 @@ TEST_F(TlsTest, HandshakeAndRequest) {
     EXPECT_NE(resp.find("tls ok"), std::string::npos);
 }
 
+TEST_F(TlsTest, LargeBufferedResponseSpansRecords) {
+    TlsClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all("GET /big HTTP/1.1\r\nHost: t\r\nConnection: close\r\n\r\n"));
+    std::string resp = c.read_some(2 * 1024 * 1024);
+    auto hdr_end = resp.find("\r\n\r\n");
+    ASSERT_NE(hdr_end, std::string::npos);
+    EXPECT_NE(resp.find("Content-Length: 1048576"), std::string::npos);
+    EXPECT_EQ(resp.size() - hdr_end - 4, 1024u * 1024u);
+    EXPECT_EQ(resp.find_first_not_of('b', hdr_end + 4), std::string::npos);
+}
+
 TEST_F(TlsTest, NegotiatesModernTls) {
     TlsClient c;
     ASSERT_TRUE(c.connect_to(port_));
@@ -149,6 +185,36 @@ TEST_F(TlsTest, NegotiatesModernTls) {
     EXPECT_TRUE(v == "TLSv1.2" || v == "TLSv1.3") << v;
 }
 
+TEST_F(TlsTest, AlpnOffersOnlyHttp11ByDefault) {
+    TlsClient c;
+    ASSERT_TRUE(c.connect_to(port_, std::string_view("\x02h2\x08http/1.1", 12)));
+    EXPECT_EQ(c.alpn(), "http/1.1");
+    ASSERT_TRUE(c.send_all("GET /secure HTTP/1.1\r\nHost: t\r\nConnection: close\r\n\r\n"));
+    EXPECT_NE(c.read_some().find("tls ok"), std::string::npos);
+}
+
+/// Same server with HTTP/2 enabled; clients that offer no ALPN still get HTTP/1.1.
+class TlsH2Test : public TlsTest {
+protected:
+    void configure(ServerOptions& opts) override { opts.http2 = true; }
+};
+
+TEST_F(TlsH2Test, AlpnSelectsH2OrHttp11) {
+    TlsClient h2;
+    ASSERT_TRUE(h2.connect_to(port_, std::string_view("\x08http/1.1\x02h2", 12)));
+    EXPECT_EQ(h2.alpn(), "h2"); // server preference wins
+    ASSERT_TRUE(h2.send_all(std::string("PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n") + std::string(9, '\0')));
+    const std::string first = h2.read_once();
+    ASSERT_GE(first.size(), 9u);
+    EXPECT_EQ(first[3], '\x04'); // the server's SETTINGS come first
+
+    TlsClient h1;
+    ASSERT_TRUE(h1.connect_to(port_, std::string_view("\x08http/1.1", 9)));
+    EXPECT_EQ(h1.alpn(), "http/1.1");
+    ASSERT_TRUE(h1.send_all("GET /secure HTTP/1.1\r\nHost: t\r\nConnection: close\r\n\r\n"));
+    EXPECT_NE(h1.read_some().find("tls ok"), std::string::npos);
+}
+
 TEST(TlsConfig, InitFailsWithMissingFiles) {
     ServerOptions opts;
     opts.tls = TlsOptions{.cert_file = "/nonexistent.crt", .key_file = "/nonexistent.key"};
@@ -0,0 +1,116 @@
+// Integration tests for zero-copy requests: handlers see the same path,
+// target, headers and body whether the Request borrows the receive buffer
+// or owns copies, including when the request arrives in pieces and when a
+// blocking handler keeps its Request while the buffer grows underneath.
+
+#include "socketify/socketify.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "integration/test_client.h"
+
+using namespace socketify;
+using testclient::TcpClient;
+using testclient::request;
+
+class ZeroCopyTest : public ::testing::TestWithParam<bool> {
+protected:
+    void SetUp() override {
+        ServerOptions opts;
+        opts.workers = 1;
+        opts.blocking_threads = 1;
+        opts.zero_copy_requests = GetParam();
+        server_ = std::make_unique<Server>(opts);
+
+        auto describe = [](Request& req, Response& res) {
+            std::string out;
+            out.append(req.path()).append("|");
+            out.append(req.raw_target()).append("|");
+            out.append(req.http_version()).append("|");
+            out.append(req.header("x-tag")).append("|");
+            out.append(req.header("X-Multi")).append("|");
+            out.append(req.cookie("sid")).append("|");
+            out.append(std::to_string(req.headers().size())).append("|");
+            out.append(req.body_view());
+            res.send(out);
+        };
+        server_->Post("/files/:name", describe);
+        server_->Post("/slow/:name", [describe](Request& req, Response& res) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            describe(req, res);
+        }).Blocking();
+        server_->Post("/sink", [](Request& req, Response& res) {
+            res.send(std::to_string(req.body_view().size()));
+        });
+        server_->Post("/string", [](Request& req, Response& res) {
+            res.send(req.body_string() + "|" + std::string(req.body_view()));
+        });
+        ASSERT_TRUE(server_->Run("127.0.0.1", 0));
+        port_ = server_->port();
+    }
+
+    void TearDown() override { server_->Stop(); }
+
+    static std::string post(const std::string& target, const std::string& body) {
+        return "POST " + target + " HTTP/1.1\r\nHost: t\r\nX-Tag: abc\r\n"
+               "X-Multi: 1\r\nCookie: sid=s42\r\nX-Multi: 2\r\nContent-Length: " +
+               std::to_string(body.size()) + "\r\n\r\n" + body;
+    }
+
+    std::unique_ptr<Server> server_;
+    uint16_t port_{0};
+};
+
+TEST_P(ZeroCopyTest, HandlerSeesFullRequest) {
+    auto r = request(port_, post("/files/a%20b?x=1", "payload"));
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, 200);
+    EXPECT_EQ(r->body, "/files/a b|/files/a%20b?x=1|HTTP/1.1|abc|1, 2|s42|5|payload");
+}
+
+TEST_P(ZeroCopyTest, RequestArrivingInPieces) {
+    const std::string raw = post("/files/plain", "0123456789");
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    for (std::size_t off = 0; off < raw.size(); off += 7) {
+        ASSERT_TRUE(c.send_all(raw.substr(off, 7)));
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    auto r = c.read_response();
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->body, "/files/plain|/files/plain|HTTP/1.1|abc|1, 2|s42|5|0123456789");
+}
+
+// The blocking handler runs on the pool while a large pipelined request
+// makes the connection's input buffer grow and move.
+TEST_P(ZeroCopyTest, BlockingHandlerOutlivesBufferGrowth) {
+    TcpClient c;
+    ASSERT_TRUE(c.connect_to(port_));
+    ASSERT_TRUE(c.send_all(post("/slow/x", "first")));
+    const std::string big(300 * 1024, 'b');
+    ASSERT_TRUE(c.send_all("POST /sink HTTP/1.1\r\nHost: t\r\nContent-Length: " +
+                           std::to_string(big.size()) + "\r\n\r\n" + big));
+
+    auto first = c.read_response(5000);
+    ASSERT_TRUE(first);
+    EXPECT_EQ(first->body, "/slow/x|/slow/x|HTTP/1.1|abc|1, 2|s42|5|first");
+    auto second = c.read_response(5000);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(second->body, std::to_string(big.size()));
+}
+
+TEST_P(ZeroCopyTest, BodyStringHoldsTheBody) {
+    auto r = request(port_, "POST /string HTTP/1.1\r\nHost: t\r\nContent-Length: 5\r\n\r\nhello");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, 200);
+    EXPECT_EQ(r->body, "hello|hello");
+}
+
+INSTANTIATE_TEST_SUITE_P(Mode, ZeroCopyTest, ::testing::Values(true, false),
+                         [](const ::testing::TestParamInfo<bool>& info) {
+                             return info.param ? "Borrowed" : "Copied";
+                         });
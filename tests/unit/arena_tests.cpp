@@ -0,0 +1,99 @@
+// Unit tests for the per-worker request arena and the Request/Response
+// members allocated from it.
+
+#include "socketify/detail/arena.h"
+#include "socketify/request.h"
+#include "socketify/response.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <utility>
+
+using namespace socketify;
+namespace du = socketify::detail;
+
+TEST(RequestArena, ReleaseRewindsToTheFirstBlock) {
+    du::RequestArena arena(4096);
+    std::pmr::memory_resource* mem = arena.resource();
+    EXPECT_NE(mem, std::pmr::get_default_resource());
+    void* first = mem->allocate(64);
+    EXPECT_NE(mem->allocate(128), first);
+    arena.release();
+    EXPECT_EQ(arena.resource(), mem);
+    EXPECT_EQ(mem->allocate(64), first);
+
+    // Past the first block it spills, and still rewinds.
+    for (int i = 0; i < 16; ++i) EXPECT_NE(mem->allocate(1024), nullptr);
+    arena.release();
+    EXPECT_EQ(mem->allocate(64), first);
+}
+
+TEST(RequestArena, ZeroSizeIsTheDefaultResource) {
+    du::RequestArena arena(0);
+    EXPECT_EQ(arena.resource(), std::pmr::get_default_resource());
+    arena.release(); // no-op
+}
+
+TEST(RequestArena, OutermostScopeReleases) {
+    du::RequestArena arena(4096);
+    std::pmr::memory_resource* mem = arena.resource();
+    void* first = nullptr;
+    {
+        const du::RequestArena::Scope outer(arena);
+        first = mem->allocate(64);
+        {
+            const du::RequestArena::Scope inner(arena);
+            EXPECT_NE(mem->allocate(64), first);
+        }
+        EXPECT_NE(mem->allocate(64), first); // inner scope kept it
+    }
+    EXPECT_EQ(mem->allocate(64), first);
+}
+
+TEST(RequestArena, RequestAndResponseAllocateFromIt) {
+    du::RequestArena arena(4096);
+    Request req(arena.resource());
+    EXPECT_EQ(req.arena(), arena.resource());
+    EXPECT_EQ(Request{}.arena(), std::pmr::get_default_resource());
+
+    Response res(req.arena());
+    EXPECT_EQ(res.headers().get_allocator().resource(), arena.resource());
+    EXPECT_EQ(res.set_cookies().get_allocator().resource(), arena.resource());
+}
+
+TEST(RequestArena, CopiesAndMovesLeaveTheArena) {
+    du::RequestArena arena(4096);
+    Response moved;
+    Request kept;
+    {
+        const du::RequestArena::Scope scope(arena);
+        Request req(arena.resource());
+        req.set_local(std::make_shared<std::string>("local"));
+        Response res(req.arena());
+        res.set_header("X-Long-Header-Name-Past-SSO", "value");
+        res.set_cookie("a=1; Path=/");
+        res.send("body");
+
+        Response copy(res);
+        EXPECT_EQ(copy.headers().get_allocator().resource(), std::pmr::get_default_resource());
+        moved = std::move(res);
+        Request moved_req(std::move(req));
+        EXPECT_EQ(moved_req.arena(), std::pmr::get_default_resource());
+        kept = std::move(moved_req);
+    }
+    // The arena is rewound; overwrite it so stale pointers would show.
+    std::pmr::memory_resource* mem = arena.resource();
+    std::memset(mem->allocate(2048), 0xab, 2048);
+
+    EXPECT_EQ(moved.headers().get_allocator().resource(), std::pmr::get_default_resource());
+    EXPECT_EQ(moved.headers().find("X-Long-Header-Name-Past-SSO")->second, "value");
+    ASSERT_EQ(moved.set_cookies().size(), 1u);
+    EXPECT_EQ(moved.set_cookies()[0], "a=1; Path=/");
+    EXPECT_EQ(moved.body_view(), "body");
+    ASSERT_NE(kept.local<std::string>(), nullptr);
+    EXPECT_EQ(*kept.local<std::string>(), "local");
+}
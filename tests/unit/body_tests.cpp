@@ -1,9 +1,17 @@
-// Unit tests for body parsers: JSON, urlencoded forms and multipart.
+// Unit tests for body parsers: JSON, urlencoded forms, multipart (buffered
+// and push parser) and saving uploads to disk.
 
 #include "socketify/body.h"
+#include "socketify/detail/http_scan.h"
 
 #include <gtest/gtest.h>
 
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
 using namespace socketify;
 
 namespace {
@@ -124,3 +132,132 @@ TEST(BodyMultipart, RejectsTruncatedPayload) {
     auto req = req_with("multipart/form-data; boundary=b", payload);
     EXPECT_FALSE(body::multipart(req).has_value());
 }
+
+namespace {
+
+// Event log of a MultipartParser run: "<name|file>" per begin, the data,
+// "</>" per end.
+struct Recorder {
+    std::string log;
+    std::vector<std::string_view> views;
+    body::MultipartParser::Callbacks callbacks() {
+        body::MultipartParser::Callbacks cb;
+        cb.on_part_begin = [this](const body::PartInfo& p) {
+            log += "<" + p.name + (p.is_file() ? "|" + p.filename + "|" + p.content_type : "") + ">";
+        };
+        cb.on_part_data = [this](const body::PartInfo&, std::string_view d) {
+            log.append(d);
+            views.push_back(d);
+            return true;
+        };
+        cb.on_part_end = [this](const body::PartInfo&) { log += "</>"; };
+        return cb;
+    }
+};
+
+const std::string kBoundary = "XyZzy";
+const std::string kPayload =
+    "preamble is ignored\r\n"
+    "--XyZzy\r\n"
+    "Content-Disposition: form-data; name=\"title\"\r\n"
+    "\r\n"
+    "Hello\r\n"
+    "--XyZzy\r\n"
+    "content-disposition: form-data; name=\"up\"; filename=\"a.bin\"\r\n"
+    "Content-Type: application/octet-stream\r\n"
+    "\r\n"
+    "\r\n--XyZz\r\n--XyZzX\r\r\n-\r\n--XyZzy\r\n"
+    "Content-Disposition: form-data; name=\"empty\"\r\n"
+    "\r\n"
+    "\r\n"
+    "--XyZzy--\r\n"
+    "epilogue";
+const std::string kExpected =
+    "<title>Hello</><up|a.bin|application/octet-stream>\r\n--XyZz\r\n--XyZzX\r\r\n-</><empty></>";
+
+} // namespace
+
+TEST(MultipartParser, WholeBody) {
+    Recorder r;
+    body::MultipartParser p(kBoundary, r.callbacks());
+    EXPECT_TRUE(p.feed(kPayload));
+    EXPECT_TRUE(p.done());
+    EXPECT_TRUE(p.finish());
+    EXPECT_EQ(p.parts(), 3u);
+    EXPECT_EQ(r.log, kExpected);
+    // Part data is handed on as views into the fed bytes.
+    for (std::string_view v : r.views) {
+        EXPECT_GE(v.data(), kPayload.data());
+        EXPECT_LE(v.data() + v.size(), kPayload.data() + kPayload.size());
+    }
+}
+
+TEST(MultipartParser, AnySplitGivesTheSameParts) {
+    for (auto isa : {socketify::detail::ScanIsa::Scalar, socketify::detail::best_scan_isa()}) {
+        socketify::detail::set_scan_isa(isa);
+        for (std::size_t cut = 0; cut <= kPayload.size(); ++cut) {
+            Recorder r;
+            body::MultipartParser p(kBoundary, r.callbacks());
+            EXPECT_TRUE(p.feed(std::string_view(kPayload).substr(0, cut)));
+            EXPECT_TRUE(p.feed(std::string_view(kPayload).substr(cut)));
+            EXPECT_TRUE(p.finish()) << cut << ": " << p.error();
+            EXPECT_EQ(r.log, kExpected) << "cut at " << cut;
+        }
+    }
+    socketify::detail::set_scan_isa(socketify::detail::best_scan_isa());
+
+    Recorder bytes;
+    body::MultipartParser p(kBoundary, bytes.callbacks());
+    for (char c : kPayload) ASSERT_TRUE(p.feed(std::string_view(&c, 1)));
+    EXPECT_TRUE(p.finish());
+    EXPECT_EQ(bytes.log, kExpected);
+}
+
+TEST(MultipartParser, Errors) {
+    Recorder r;
+    EXPECT_TRUE(body::MultipartParser("bad\r\nboundary", r.callbacks()).failed());
+
+    body::MultipartParser truncated(kBoundary, r.callbacks());
+    EXPECT_TRUE(truncated.feed(kPayload.substr(0, 100)));
+    EXPECT_FALSE(truncated.finish());
+    EXPECT_EQ(truncated.error(), "Truncated multipart body");
+
+    body::MultipartParser bad(kBoundary, r.callbacks());
+    EXPECT_FALSE(bad.feed("--XyZzy?\r\n"));
+    EXPECT_EQ(bad.error(), "Malformed multipart delimiter");
+
+    body::MultipartParser big(kBoundary, r.callbacks(), 32);
+    EXPECT_FALSE(big.feed("--XyZzy\r\nContent-Disposition: form-data; name=\"long\"\r\n"));
+    EXPECT_EQ(big.error(), "Part headers too large");
+
+    auto cb = r.callbacks();
+    cb.on_part_data = [](const body::PartInfo&, std::string_view) { return false; };
+    body::MultipartParser stopped(kBoundary, cb);
+    EXPECT_FALSE(stopped.feed(kPayload));
+    EXPECT_TRUE(stopped.failed());
+}
+
+TEST(MultipartParser, SaveMultipartWritesFiles) {
+    body::MultipartUpload up;
+    body::MultipartParser p(kBoundary, body::save_multipart("/tmp", up));
+    for (std::size_t off = 0; off < kPayload.size(); off += 7) {
+        ASSERT_TRUE(p.feed(std::string_view(kPayload).substr(off, 7))) << p.error();
+    }
+    ASSERT_TRUE(p.finish());
+    EXPECT_EQ(up.fields.at("title"), "Hello");
+    EXPECT_EQ(up.fields.at("empty"), "");
+    ASSERT_EQ(up.files.size(), 1u);
+    const body::SavedFile& f = up.files[0];
+    EXPECT_EQ(f.name, "up");
+    EXPECT_EQ(f.filename, "a.bin");
+    EXPECT_EQ(f.size, 21u);
+    std::ifstream in(f.path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    EXPECT_EQ(ss.str(), "\r\n--XyZz\r\n--XyZzX\r\r\n-");
+    std::remove(f.path.c_str());
+
+    body::MultipartUpload limited;
+    body::MultipartParser q(kBoundary, body::save_multipart("/tmp", limited, 3));
+    EXPECT_FALSE(q.feed(kPayload)); // "Hello" is over the field limit
+}
@@ -28,6 +28,18 @@ TEST(Compression, NoneWhenNothingAcceptable) {
     EXPECT_EQ(comp::negotiate_accept_encoding("", o), comp::Encoding::None);
 }
 
+TEST(Compression, AcceptEncodingQValues) {
+    EXPECT_DOUBLE_EQ(comp::accept_encoding_q("gzip, deflate, br", "br"), 1.0);
+    EXPECT_DOUBLE_EQ(comp::accept_encoding_q("gzip;q=0.8, BR;q=0.5", "br"), 0.5);
+    EXPECT_DOUBLE_EQ(comp::accept_encoding_q("gzip;q=0.8, br;q=0.5", "gzip"), 0.8);
+    EXPECT_DOUBLE_EQ(comp::accept_encoding_q("x-gzip", "gzip"), 1.0);
+    EXPECT_DOUBLE_EQ(comp::accept_encoding_q("br;q=0, *", "br"), 0.0); // explicit beats *
+    EXPECT_DOUBLE_EQ(comp::accept_encoding_q("*;q=0.3", "gzip"), 0.3);
+    EXPECT_DOUBLE_EQ(comp::accept_encoding_q("gzip", "br"), 0.0);
+    EXPECT_DOUBLE_EQ(comp::accept_encoding_q("", "gzip"), 0.0);
+    EXPECT_DOUBLE_EQ(comp::accept_encoding_q("brotli, gzip;q=x", "br"), 0.0);
+}
+
 TEST(Compression, CompressibleTypes) {
     comp::Options o;
     EXPECT_TRUE(comp::is_compressible_type("text/html; charset=utf-8", o));
@@ -0,0 +1,71 @@
+// Unit tests for worker CPU planning, pinning and reuseport CPU steering.
+
+#include "socketify/detail/cpu_affinity.h"
+
+#include <gtest/gtest.h>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <thread>
+
+namespace du = socketify::detail;
+
+TEST(CpuAffinity, PlanReusesRequestedCpusRoundRobin) {
+    auto plan = du::plan_worker_cpus({3, 5}, 5);
+    EXPECT_EQ(plan, (std::vector<int>{3, 5, 3, 5, 3}));
+}
+
+TEST(CpuAffinity, PlanDefaultsToAllowedCpus) {
+    auto allowed = du::allowed_cpus();
+    ASSERT_FALSE(allowed.empty());
+    auto plan = du::plan_worker_cpus({}, static_cast<unsigned>(allowed.size()) + 1);
+    ASSERT_EQ(plan.size(), allowed.size() + 1);
+    for (std::size_t i = 0; i < allowed.size(); ++i) EXPECT_EQ(plan[i], allowed[i]);
+    EXPECT_EQ(plan.back(), allowed.front());
+}
+
+TEST(CpuAffinity, PinMovesThreadToCpu) {
+    int target = du::allowed_cpus().back();
+    int seen = -2;
+    bool pinned = false;
+    std::thread t([&] {
+        pinned = du::pin_current_thread(target);
+        seen = du::current_cpu();
+    });
+    t.join();
+    ASSERT_TRUE(pinned);
+    EXPECT_EQ(seen, target);
+    EXPECT_FALSE(du::pin_current_thread(-1));
+}
+
+TEST(CpuAffinity, SteeringProgramAttachesToReuseportGroup) {
+    int fds[2];
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int i = 0; i < 2; ++i) {
+        fds[i] = ::socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_GE(fds[i], 0);
+        int yes = 1;
+        ::setsockopt(fds[i], SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes));
+        ASSERT_EQ(::bind(fds[i], reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+        ASSERT_EQ(::listen(fds[i], 8), 0);
+        if (i == 0) {
+            socklen_t len = sizeof(addr);
+            ::getsockname(fds[0], reinterpret_cast<sockaddr*>(&addr), &len);
+        }
+    }
+
+    std::string err;
+    EXPECT_TRUE(du::attach_reuseport_cpu_steering(fds[0], {0, 1}, err)) << err;
+    EXPECT_FALSE(du::attach_reuseport_cpu_steering(fds[0], {}, err));
+
+    // A connection still lands on one of the group's listeners.
+    int c = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_EQ(::connect(c, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    EXPECT_GE(du::incoming_cpu(c), 0);
+    ::close(c);
+    for (int fd : fds) ::close(fd);
+}
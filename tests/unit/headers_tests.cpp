@@ -0,0 +1,149 @@
+// Unit tests for the known-header table (header_id / header_name) and the
+// Headers container: slots, unknown names, joining, ownership.
+
+#include "socketify/headers.h"
+
+#include <gtest/gtest.h>
+
+#include <cctype>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace socketify;
+
+static_assert(header_id("Content-Length") == HeaderId::ContentLength);
+static_assert(header_id("x-forwarded-for") == HeaderId::XForwardedFor);
+static_assert(header_id("X-Unknown") == HeaderId::Unknown);
+
+TEST(HeaderId, EveryKnownNameRoundTrips) {
+    for (std::size_t i = 0; i < kKnownHeaderCount; ++i) {
+        const auto id = static_cast<HeaderId>(i);
+        const std::string name(header_name(id));
+        ASSERT_FALSE(name.empty());
+        EXPECT_EQ(header_id(name), id) << name;
+        std::string upper = name;
+        for (char& c : upper) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        EXPECT_EQ(header_id(upper), id) << upper;
+    }
+    EXPECT_EQ(header_name(HeaderId::Unknown), "");
+}
+
+TEST(HeaderId, NearMissesAreUnknown) {
+    for (const char* n : {"", "H", "Hosts", "Hos", "Content-Lengthx", "Cookie2", "X-Request-Ids",
+                          "Content_Length", "Set-Cookie", "Location"}) {
+        EXPECT_EQ(header_id(n), HeaderId::Unknown) << n;
+    }
+}
+
+TEST(Headers, KnownAndUnknownLookups) {
+    const std::string host = "example.com";
+    const std::string tenant = "acme";
+    Headers h;
+    h.add("host", host);
+    h.add("X-Tenant", tenant);
+    EXPECT_EQ(h.size(), 2u);
+    EXPECT_EQ(h.get(HeaderId::Host), "example.com");
+    EXPECT_EQ(h.get(HeaderId::Host).data(), host.data()); // borrowed
+    EXPECT_EQ(h.get("HOST"), "example.com");
+    EXPECT_EQ(h.get("x-tenant"), "acme");
+    EXPECT_TRUE(h.contains("X-TENANT"));
+    EXPECT_FALSE(h.contains(HeaderId::Cookie));
+    EXPECT_EQ(h.get("Missing"), "");
+    EXPECT_EQ(h.at("Host"), "example.com");
+    EXPECT_THROW((void)h.at("Missing"), std::out_of_range);
+}
+
+TEST(Headers, RepeatsAreJoined) {
+    Headers h;
+    h.add("Accept", "a");
+    h.add("accept", "b");
+    h.add("X-Dup", "1");
+    h.add_copy("x-dup", "2");
+    EXPECT_EQ(h.get(HeaderId::Accept), "a, b");
+    EXPECT_EQ(h.get("X-Dup"), "1, 2");
+    EXPECT_EQ(h.size(), 2u);
+}
+
+TEST(Headers, SetReplaces) {
+    Headers h;
+    h.add("Range", "bytes=0-1");
+    h.set("range", "bytes=2-3");
+    h["X-Id"] = "1";
+    h["x-id"] = std::string("2");
+    h.set(HeaderId::XRequestId, "r");
+    EXPECT_EQ(h.get(HeaderId::Range), "bytes=2-3");
+    EXPECT_EQ(h.get("X-Id"), "2");
+    EXPECT_EQ(h.get("X-Request-Id"), "r");
+    EXPECT_EQ(h.size(), 3u);
+}
+
+TEST(Headers, CopyAndOwnDetachFromSource) {
+    std::string wire = "hX-Av";
+    Headers h;
+    h.add("Host", std::string_view(wire).substr(0, 1));
+    h.add(std::string_view(wire).substr(1, 3), std::string_view(wire).substr(4, 1));
+    Headers copy = h;
+    Headers owned = h;
+    h.own();
+    wire.assign(wire.size(), '#');
+    for (const Headers* x : {&h, &copy, &owned}) {
+        EXPECT_EQ(x->get("Host"), "h");
+        EXPECT_EQ(x->get("x-a"), "v");
+    }
+}
+
+TEST(Headers, MoveKeepsViewsAndEmptiesSource) {
+    const std::string value = "v";
+    Headers h;
+    h.add("Origin", value);
+    h.add_copy("X-Copy", "c");
+    Headers moved = std::move(h);
+    EXPECT_TRUE(h.empty()); // NOLINT(bugprone-use-after-move)
+    EXPECT_EQ(moved.get(HeaderId::Origin).data(), value.data());
+    EXPECT_EQ(moved.get("X-Copy"), "c");
+    moved.clear();
+    EXPECT_TRUE(moved.empty());
+    EXPECT_EQ(moved.get(HeaderId::Origin), "");
+}
+
+TEST(Headers, ForEachVisitsKnownThenUnknown) {
+    Headers h;
+    h.add("X-B", "2");
+    h.add("content-type", "t");
+    h.add("Accept", "a");
+    std::string seen;
+    h.for_each([&](HeaderId id, std::string_view k, std::string_view v) {
+        seen.append(id == HeaderId::Unknown ? "?" : "").append(k).append("=").append(v).append(";");
+    });
+    EXPECT_EQ(seen, "Accept=a;Content-Type=t;?X-B=2;");
+    std::size_t n = 0;
+    h.for_each([&](std::string_view, std::string_view) { ++n; });
+    EXPECT_EQ(n, 3u);
+}
+
+TEST(Headers, IteratesAndFindsLikeAMap) {
+    Headers h;
+    h.add("X-B", "2");
+    h.add("content-type", "t");
+    h.add("Accept", "a");
+    std::string seen;
+    for (const auto& [k, v] : h) seen.append(k).append("=").append(v).append(";");
+    EXPECT_EQ(seen, "Accept=a;Content-Type=t;X-B=2;");
+    EXPECT_EQ(std::distance(h.begin(), h.end()), 3);
+
+    auto it = h.find("CONTENT-TYPE");
+    ASSERT_NE(it, h.end());
+    EXPECT_EQ(it->first, "Content-Type");
+    EXPECT_EQ(it->second, "t");
+    EXPECT_EQ((++it)->first, "X-B");
+    EXPECT_EQ(++it, h.end());
+    EXPECT_EQ(h.find("x-b")->second, "2");
+    EXPECT_EQ(h.find(HeaderId::Accept)->second, "a");
+    EXPECT_EQ(h.find("X-Missing"), h.end());
+    EXPECT_EQ(h.find(HeaderId::Host), h.end());
+    EXPECT_EQ(h.count("accept"), 1u);
+    EXPECT_EQ(h.count("Host"), 0u);
+    const Headers none;
+    EXPECT_EQ(none.begin(), none.end());
+}
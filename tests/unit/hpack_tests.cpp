@@ -0,0 +1,215 @@
+// Unit tests for detail/hpack: integer and Huffman primitives, the RFC 7541
+// Appendix C decoding examples, and encoder/decoder round trips.
+
+#include "socketify/detail/hpack.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace socketify::detail::hpack;
+
+namespace {
+
+std::string unhex(std::string_view hex) {
+    std::string out;
+    int hi = -1;
+    for (char c : hex) {
+        int v = -1;
+        if (c >= '0' && c <= '9') v = c - '0';
+        else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+        if (v < 0) continue;
+        if (hi < 0) {
+            hi = v;
+        } else {
+            out.push_back(static_cast<char>(hi * 16 + v));
+            hi = -1;
+        }
+    }
+    return out;
+}
+
+using Fields = std::vector<std::pair<std::string, std::string>>;
+
+bool decode(Decoder& d, std::string_view block, Fields& out) {
+    out.clear();
+    return d.decode(block, [&](std::string_view n, std::string_view v) {
+        out.emplace_back(n, v);
+        return true;
+    });
+}
+
+} // namespace
+
+TEST(Hpack, IntegersFromTheRfc) {
+    std::string out;
+    encode_integer(out, 10, 5, 0);
+    EXPECT_EQ(out, unhex("0a"));
+    out.clear();
+    encode_integer(out, 1337, 5, 0);
+    EXPECT_EQ(out, unhex("1f 9a 0a"));
+    out.clear();
+    encode_integer(out, 42, 8, 0);
+    EXPECT_EQ(out, unhex("2a"));
+
+    for (std::uint64_t v : {0ull, 30ull, 31ull, 127ull, 128ull, 16383ull, 0xffffffffull}) {
+        for (int prefix : {4, 5, 6, 7, 8}) {
+            std::string s;
+            encode_integer(s, v, prefix, 0);
+            auto* p = reinterpret_cast<const std::uint8_t*>(s.data());
+            std::uint64_t got = 0;
+            ASSERT_TRUE(decode_integer(p, p + s.size(), prefix, got)) << v << "/" << prefix;
+            EXPECT_EQ(got, v);
+            EXPECT_EQ(p, reinterpret_cast<const std::uint8_t*>(s.data() + s.size()));
+            // Any truncation fails.
+            auto* q = reinterpret_cast<const std::uint8_t*>(s.data());
+            if (s.size() > 1) EXPECT_FALSE(decode_integer(q, q + s.size() - 1, prefix, got));
+        }
+    }
+    const std::string huge = unhex("1f ff ff ff ff 7f");
+    auto* p = reinterpret_cast<const std::uint8_t*>(huge.data());
+    std::uint64_t v = 0;
+    EXPECT_FALSE(decode_integer(p, p + huge.size(), 5, v));
+}
+
+TEST(Hpack, HuffmanMatchesTheRfcAndRoundTrips) {
+    const std::pair<const char*, const char*> known[] = {
+        {"www.example.com", "f1e3 c2e5 f23a 6ba0 ab90 f4ff"},
+        {"no-cache", "a8eb 1064 9cbf"},
+        {"custom-key", "25a8 49e9 5ba9 7d7f"},
+        {"custom-value", "25a8 49e9 5bb8 e8b4 bf"},
+        {"Mon, 21 Oct 2013 20:13:21 GMT", "d07a be94 1054 d444 a820 0595 040b 8166 e082 a62d 1bff"},
+    };
+    for (auto [plain, hex] : known) {
+        std::string enc;
+        huffman_encode(enc, plain);
+        EXPECT_EQ(enc, unhex(hex)) << plain;
+        EXPECT_EQ(huffman_length(plain), enc.size());
+        std::string dec;
+        ASSERT_TRUE(huffman_decode(enc, dec));
+        EXPECT_EQ(dec, plain);
+    }
+
+    std::string all;
+    for (int c = 0; c < 256; ++c) all.push_back(static_cast<char>(c));
+    std::string enc, dec;
+    huffman_encode(enc, all);
+    ASSERT_TRUE(huffman_decode(enc, dec));
+    EXPECT_EQ(dec, all);
+}
+
+TEST(Hpack, HuffmanRejectsBadPadding) {
+    std::string out;
+    EXPECT_FALSE(huffman_decode(unhex("ff ff ff ff"), out)); // EOS (30 ones)
+    out.clear();
+    EXPECT_TRUE(huffman_decode(unhex("1f"), out)); // 'a' (00011) + 111
+    EXPECT_EQ(out, "a");
+    out.clear();
+    EXPECT_FALSE(huffman_decode(unhex("18"), out)); // 'a' + padding of zeros
+    out.clear();
+    EXPECT_FALSE(huffman_decode(unhex("ff"), out)); // 8 bits of padding
+}
+
+TEST(Hpack, DecodesRfcRequestsWithoutHuffman) {
+    Decoder d;
+    Fields f;
+    ASSERT_TRUE(decode(d, unhex("8286 8441 0f77 7777 2e65 7861 6d70 6c65 2e63 6f6d"), f));
+    EXPECT_EQ(f, (Fields{{":method", "GET"}, {":scheme", "http"}, {":path", "/"},
+                         {":authority", "www.example.com"}}));
+    EXPECT_EQ(d.table_size(), 57u);
+
+    ASSERT_TRUE(decode(d, unhex("8286 84be 5808 6e6f 2d63 6163 6865"), f));
+    EXPECT_EQ(f, (Fields{{":method", "GET"}, {":scheme", "http"}, {":path", "/"},
+                         {":authority", "www.example.com"}, {"cache-control", "no-cache"}}));
+    EXPECT_EQ(d.table_size(), 110u);
+
+    ASSERT_TRUE(decode(d, unhex("8287 85bf 400a 6375 7374 6f6d 2d6b 6579 0c63 7573 746f 6d2d "
+                                "7661 6c75 65"),
+                       f));
+    EXPECT_EQ(f, (Fields{{":method", "GET"}, {":scheme", "https"}, {":path", "/index.html"},
+                         {":authority", "www.example.com"}, {"custom-key", "custom-value"}}));
+    EXPECT_EQ(d.table_size(), 164u);
+}
+
+TEST(Hpack, DecodesRfcRequestsWithHuffman) {
+    Decoder d;
+    Fields f;
+    ASSERT_TRUE(decode(d, unhex("8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff"), f));
+    EXPECT_EQ(f.back(), (std::pair<std::string, std::string>{":authority", "www.example.com"}));
+    ASSERT_TRUE(decode(d, unhex("8286 84be 5886 a8eb 1064 9cbf"), f));
+    EXPECT_EQ(f.back(), (std::pair<std::string, std::string>{"cache-control", "no-cache"}));
+    ASSERT_TRUE(decode(d, unhex("8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf"), f));
+    EXPECT_EQ(f.back(), (std::pair<std::string, std::string>{"custom-key", "custom-value"}));
+    EXPECT_EQ(d.table_size(), 164u);
+}
+
+TEST(Hpack, EvictsFromASmallTable) {
+    // RFC 7541 C.6: Huffman-coded responses with a 256-byte table.
+    Decoder d(256);
+    Fields f;
+    ASSERT_TRUE(decode(d, unhex("4882 6402 5885 aec3 771a 4b61 96d0 7abe 9410 54d4 44a8 2005 "
+                                "9504 0b81 66e0 82a6 2d1b ff6e 919d 29ad 1718 63c7 8f0b 97c8 e9ae "
+                                "82ae 43d3"),
+                       f));
+    EXPECT_EQ(f, (Fields{{":status", "302"}, {"cache-control", "private"},
+                         {"date", "Mon, 21 Oct 2013 20:13:21 GMT"},
+                         {"location", "https://www.example.com"}}));
+    EXPECT_EQ(d.table_size(), 222u);
+    ASSERT_TRUE(decode(d, unhex("4883 640e ffc1 c0bf"), f));
+    EXPECT_EQ(f.front(), (std::pair<std::string, std::string>{":status", "307"}));
+    EXPECT_EQ(d.table_size(), 222u); // ":status 302" was evicted
+}
+
+TEST(Hpack, DecoderRejectsMalformedBlocks) {
+    Decoder d(256);
+    Fields f;
+    EXPECT_FALSE(decode(d, unhex("80"), f));          // index 0
+    EXPECT_FALSE(decode(d, unhex("be"), f));          // past the (empty) dynamic table
+    EXPECT_FALSE(decode(d, unhex("41 8c f1e3"), f));  // truncated string
+    EXPECT_FALSE(decode(d, unhex("3f e2 1f"), f));    // size update above our limit
+    EXPECT_FALSE(decode(d, unhex("82 20"), f));       // size update after a field
+    EXPECT_TRUE(decode(d, unhex("20 82"), f));        // ... but fine at the start
+    EXPECT_FALSE(d.decode(unhex("82"), [](std::string_view, std::string_view) { return false; }));
+}
+
+TEST(Hpack, EncoderRoundTripsThroughTheDecoder) {
+    Encoder e;
+    Decoder d;
+    const Fields blocks[] = {
+        {{"content-type", "text/html; charset=utf-8"}, {"server", "socketify"}, {"x-id", "1"}},
+        {{"content-type", "text/html; charset=utf-8"}, {"server", "socketify"}, {"x-id", "2"},
+         {"set-cookie", "sid=secret"}},
+        {{"content-length", "12345"}, {"x-big", std::string(3000, 'v')}, {"x-id", "2"}},
+    };
+    std::size_t sizes[3] = {};
+    for (int round = 0; round < 2; ++round) {
+        for (std::size_t i = 0; i < std::size(blocks); ++i) {
+            std::string out;
+            e.status(out, i == 2 ? 418u : 200u);
+            for (const auto& [n, v] : blocks[i]) e.field(out, n, v, n == "set-cookie");
+            Fields got;
+            ASSERT_TRUE(decode(d, out, got));
+            ASSERT_EQ(got.size(), blocks[i].size() + 1);
+            EXPECT_EQ(got[0].second, i == 2 ? "418" : "200");
+            EXPECT_TRUE(std::equal(blocks[i].begin(), blocks[i].end(), got.begin() + 1));
+            EXPECT_EQ(e.table_size(), d.table_size());
+            if (round == 0) sizes[i] = out.size();
+            else if (i == 0) EXPECT_LT(out.size(), 10u); // all indexed now
+            else if (i == 1) EXPECT_LT(out.size(), sizes[i]); // all but the set-cookie
+        }
+    }
+    EXPECT_GT(sizes[0], 10u);
+
+    // A smaller table from the peer's settings is announced and honoured.
+    e.set_max_table_size(0);
+    std::string out;
+    e.status(out, 200);
+    e.field(out, "x-id", "3");
+    Fields got;
+    ASSERT_TRUE(decode(d, out, got));
+    EXPECT_EQ(got.back().second, "3");
+    EXPECT_EQ(d.table_size(), 0u);
+    EXPECT_EQ(e.table_size(), 0u);
+}
@@ -0,0 +1,355 @@
+// Unit tests for detail/http2: the connection preface and SETTINGS exchange,
+// request assembly (CONTINUATION, DATA, cookie crumbs), flow-controlled
+// responses, stream limits and the stream/connection error paths.
+
+#include "socketify/detail/http2.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "integration/h2_test_client.h"
+
+using namespace socketify::detail;
+using namespace h2test;
+
+namespace {
+
+// A Session plus the client-side HPACK state needed to talk to it.
+struct Harness {
+    explicit Harness(h2::SessionLimits limits = {}, const Settings& s = {}) : session(limits) {
+        take(); // our SETTINGS + WINDOW_UPDATE
+        feed(std::string(kPreface) + settings(s));
+    }
+
+    void feed(const std::string& bytes) {
+        pending += bytes;
+        pending.erase(0, session.feed(pending));
+    }
+
+    std::vector<Frame> take() {
+        std::string out = std::move(session.output());
+        session.output().clear();
+        return split(out);
+    }
+
+    std::string headers(std::uint32_t id, std::string_view method, std::string_view path,
+                        const Fields& extra = {}, bool end_stream = true) {
+        return frame(HEADERS, END_HEADERS | (end_stream ? END_STREAM : 0), id,
+                     request_block(enc, method, path, extra));
+    }
+
+    const Frame* find(const std::vector<Frame>& frames, std::uint8_t type, std::uint32_t stream = 0) {
+        for (const auto& f : frames)
+            if (f.type == type && (stream == 0 || f.stream == stream)) return &f;
+        return nullptr;
+    }
+
+    h2::Session session;
+    hpack::Encoder enc;
+    hpack::Decoder dec;
+    std::string pending;
+};
+
+} // namespace
+
+TEST(Http2Session, AdvertisesSettingsAndAcknowledgesThePeers) {
+    h2::SessionLimits limits;
+    limits.max_concurrent_streams = 7;
+    h2::Session s(limits);
+    std::string out = std::move(s.output());
+    auto frames = split(out);
+    ASSERT_GE(frames.size(), 2u);
+    EXPECT_EQ(frames[0].type, SETTINGS);
+    EXPECT_EQ(frames[0].flags, 0);
+    EXPECT_NE(frames[0].payload.find(std::string("\x00\x03", 2) + be32(7)), std::string::npos);
+    EXPECT_EQ(frames[1].type, WINDOW_UPDATE); // connection window up to initial_window
+
+    // The preface may arrive in pieces.
+    const std::string hello = std::string(kPreface) + settings({{0x4, 1000}});
+    EXPECT_EQ(s.feed(hello.substr(0, 10)), 0u);
+    EXPECT_EQ(s.feed(hello), hello.size());
+    out = std::move(s.output());
+    frames = split(out);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].type, SETTINGS);
+    EXPECT_EQ(frames[0].flags, ACK);
+    EXPECT_FALSE(s.failed());
+}
+
+TEST(Http2Session, RejectsAnHttp1ClientWithGoaway) {
+    h2::Session s;
+    s.output().clear();
+    const std::string http1 = "GET / HTTP/1.1\r\nHost: x\r\n\r\n";
+    EXPECT_EQ(s.feed(http1), http1.size());
+    EXPECT_TRUE(s.failed());
+    std::string out = std::move(s.output());
+    auto frames = split(out);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].type, GOAWAY);
+    EXPECT_EQ(get32(std::string_view(frames[0].payload).substr(4)),
+              static_cast<std::uint32_t>(h2::ErrorCode::ProtocolError));
+}
+
+TEST(Http2Session, AssemblesHeadersContinuationAndBody) {
+    Harness h;
+    const std::string block = request_block(h.enc, "POST", "/up?x=1",
+                                            {{"cookie", "a=1"}, {"content-type", "text/plain"},
+                                             {"cookie", "b=2"}});
+    // Header block split over HEADERS + CONTINUATION, body over two DATA frames.
+    h.feed(frame(HEADERS, 0, 1, block.substr(0, 5)) + frame(CONTINUATION, END_HEADERS, 1, block.substr(5)) +
+           frame(DATA, 0, 1, "hello ") + frame(DATA, END_STREAM, 1, "world"));
+
+    h2::IncomingRequest req;
+    ASSERT_TRUE(h.session.next_request(req));
+    EXPECT_EQ(req.stream, 1u);
+    EXPECT_EQ(req.method, "POST");
+    EXPECT_EQ(req.path, "/up?x=1");
+    EXPECT_EQ(req.authority, "test");
+    EXPECT_EQ(req.body, "hello world");
+    EXPECT_EQ(req.fields, (std::vector<std::pair<std::string, std::string>>{
+                              {"content-type", "text/plain"}, {"cookie", "a=1; b=2"}}));
+    EXPECT_FALSE(h.session.next_request(req));
+}
+
+TEST(Http2Session, InterruptedHeaderBlockIsAConnectionError) {
+    Harness h;
+    const std::string block = request_block(h.enc, "GET", "/");
+    h.feed(frame(HEADERS, 0, 1, block) + frame(PING, 0, 0, std::string(8, 'p')));
+    EXPECT_TRUE(h.session.failed());
+    EXPECT_NE(h.find(h.take(), GOAWAY), nullptr);
+}
+
+TEST(Http2Session, ResponseBodyFollowsTheFlowControlWindows) {
+    Harness h({}, {{0x4, 100}}); // the peer's streams start with 100 bytes
+    h.take();
+    h.feed(h.headers(1, "GET", "/big"));
+    h2::IncomingRequest req;
+    ASSERT_TRUE(h.session.next_request(req));
+
+    h2::ResponseBody body;
+    body.data = std::string(1000, 'x');
+    ASSERT_TRUE(h.session.respond(1, 200, {{"Content-Type", "text/plain"}, {"Connection", "close"}},
+                                  std::move(body)));
+    h.session.pump(1 << 20);
+    auto frames = h.take();
+    ASSERT_EQ(frames.size(), 2u);
+    EXPECT_EQ(frames[0].type, HEADERS);
+    const Fields fields = decode_block(h.dec, frames[0].payload);
+    EXPECT_EQ(fields, (Fields{{":status", "200"}, {"content-type", "text/plain"}}));
+    EXPECT_EQ(frames[1].type, DATA);
+    EXPECT_EQ(frames[1].payload.size(), 100u);
+    EXPECT_EQ(frames[1].flags & END_STREAM, 0);
+    EXPECT_FALSE(h.session.can_pump());
+    EXPECT_EQ(h.session.open_streams(), 1u);
+
+    h.feed(window_update(1, 5000));
+    EXPECT_TRUE(h.session.can_pump());
+    h.session.pump(1 << 20);
+    frames = h.take();
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].payload.size(), 900u);
+    EXPECT_EQ(frames[0].flags & END_STREAM, END_STREAM);
+    EXPECT_EQ(h.session.open_streams(), 0u);
+}
+
+TEST(Http2Session, EmptyBodyEndsTheStreamWithHeaders) {
+    Harness h;
+    h.take();
+    h.feed(h.headers(1, "HEAD", "/"));
+    ASSERT_TRUE(h.session.respond(1, 204, {}, {}));
+    auto frames = h.take();
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].flags, END_HEADERS | END_STREAM);
+    EXPECT_EQ(h.session.open_streams(), 0u);
+    EXPECT_FALSE(h.session.respond(1, 200, {}, {})); // already answered
+}
+
+TEST(Http2Session, RefusesStreamsPastTheLimit) {
+    h2::SessionLimits limits;
+    limits.max_concurrent_streams = 1;
+    Harness h(limits);
+    h.take();
+    h.feed(h.headers(1, "GET", "/a"));
+    h.feed(h.headers(3, "GET", "/b"));
+    auto frames = h.take();
+    const Frame* rst = h.find(frames, RST_STREAM, 3);
+    ASSERT_NE(rst, nullptr);
+    EXPECT_EQ(get32(rst->payload), static_cast<std::uint32_t>(h2::ErrorCode::RefusedStream));
+
+    // Once stream 1 is answered, a new one fits; HPACK state stayed in step.
+    ASSERT_TRUE(h.session.respond(1, 200, {}, {}));
+    h.feed(h.headers(5, "GET", "/c"));
+    h2::IncomingRequest req;
+    ASSERT_TRUE(h.session.next_request(req));
+    ASSERT_TRUE(h.session.next_request(req));
+    EXPECT_EQ(req.stream, 5u);
+    EXPECT_EQ(req.path, "/c");
+}
+
+TEST(Http2Session, OversizedBodyGets413AndStops) {
+    h2::SessionLimits limits;
+    limits.max_body = 10;
+    Harness h(limits);
+    h.take();
+    h.feed(h.headers(1, "POST", "/", {}, false) + frame(DATA, 0, 1, std::string(20, 'b')));
+    auto frames = h.take();
+    const Frame* head = h.find(frames, HEADERS, 1);
+    ASSERT_NE(head, nullptr);
+    EXPECT_EQ(decode_block(h.dec, head->payload).front().second, "413");
+    const Frame* rst = h.find(frames, RST_STREAM, 1);
+    ASSERT_NE(rst, nullptr);
+    EXPECT_EQ(get32(rst->payload), 0u); // NO_ERROR: stop sending
+
+    // The rest of the body is dropped without a connection error.
+    h.feed(frame(DATA, END_STREAM, 1, "more"));
+    h2::IncomingRequest req;
+    EXPECT_FALSE(h.session.next_request(req));
+    EXPECT_FALSE(h.session.failed());
+}
+
+TEST(Http2Session, MalformedRequestsResetOnlyTheirStream) {
+    Harness h;
+    h.take();
+    h.feed(h.headers(1, "GET", "/", {{"Upper", "x"}}));
+    h.feed(h.headers(3, "GET", "/", {{"connection", "close"}}));
+    h.feed(h.headers(5, "GET", "/", {{"content-length", "5"}}));
+    h.feed(h.headers(7, "GET", "/ok"));
+    auto frames = h.take();
+    for (std::uint32_t id : {1u, 3u, 5u}) {
+        const Frame* rst = h.find(frames, RST_STREAM, id);
+        ASSERT_NE(rst, nullptr) << id;
+        EXPECT_EQ(get32(rst->payload), static_cast<std::uint32_t>(h2::ErrorCode::ProtocolError));
+    }
+    h2::IncomingRequest req;
+    ASSERT_TRUE(h.session.next_request(req));
+    EXPECT_EQ(req.stream, 7u);
+    EXPECT_FALSE(h.session.failed());
+}
+
+TEST(Http2Session, PingIsEchoedAndWindowOverflowFails) {
+    Harness h;
+    h.take();
+    h.feed(frame(PING, 0, 0, "12345678"));
+    auto frames = h.take();
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].flags, ACK);
+    EXPECT_EQ(frames[0].payload, "12345678");
+
+    h.feed(window_update(0, 0x7fffffff)); // past 2^31-1 on top of the initial 65535
+    EXPECT_TRUE(h.session.failed());
+    frames = h.take();
+    const Frame* goaway = h.find(frames, GOAWAY);
+    ASSERT_NE(goaway, nullptr);
+    EXPECT_EQ(get32(std::string_view(goaway->payload).substr(4)),
+              static_cast<std::uint32_t>(h2::ErrorCode::FlowControlError));
+}
+
+TEST(Http2Session, PeerResetCancelsTheResponse) {
+    Harness h;
+    h.take();
+    h.feed(h.headers(1, "GET", "/"));
+    h.feed(rst_stream(1, static_cast<std::uint32_t>(h2::ErrorCode::Cancel)));
+    EXPECT_EQ(h.session.open_streams(), 0u);
+    EXPECT_FALSE(h.session.respond(1, 200, {}, {}));
+    EXPECT_TRUE(h.take().empty());
+}
+
+TEST(Http2Session, CancelledRequestsHoldTheirSlotUntilAnswered) {
+    h2::SessionLimits limits;
+    limits.max_concurrent_streams = 2;
+    Harness h(limits);
+    h.take();
+    const auto cancel = static_cast<std::uint32_t>(h2::ErrorCode::Cancel);
+    h.feed(h.headers(1, "GET", "/") + rst_stream(1, cancel));
+    h.feed(h.headers(3, "GET", "/") + rst_stream(3, cancel));
+    EXPECT_EQ(h.session.open_streams(), 0u);
+    EXPECT_EQ(h.session.cancelled_unanswered(), 2u);
+
+    h.feed(h.headers(5, "GET", "/"));
+    auto frames = h.take();
+    const Frame* rst = h.find(frames, RST_STREAM, 5);
+    ASSERT_NE(rst, nullptr);
+    EXPECT_EQ(get32(rst->payload), static_cast<std::uint32_t>(h2::ErrorCode::RefusedStream));
+
+    // The handler of stream 1 answers (into the void): its slot frees up.
+    EXPECT_FALSE(h.session.respond(1, 200, {}, {}));
+    h.session.reset(3, h2::ErrorCode::InternalError);
+    EXPECT_EQ(h.session.cancelled_unanswered(), 0u);
+    EXPECT_TRUE(h.take().empty());
+    h.feed(h.headers(7, "GET", "/"));
+    EXPECT_EQ(h.session.open_streams(), 1u);
+}
+
+TEST(Http2Session, RapidResetEndsTheConnection) {
+    h2::SessionLimits limits;
+    limits.max_resets_per_second = 10;
+    Harness h(limits);
+    h.take();
+    std::string flood;
+    for (std::uint32_t id = 1; id <= 2 * 11; id += 2)
+        flood += h.headers(id, "GET", "/") + rst_stream(id, static_cast<std::uint32_t>(h2::ErrorCode::Cancel));
+    h.feed(flood);
+    EXPECT_TRUE(h.session.failed());
+    const auto frames = h.take();
+    const Frame* goaway = h.find(frames, GOAWAY);
+    ASSERT_NE(goaway, nullptr);
+    EXPECT_EQ(get32(std::string_view(goaway->payload).substr(4)),
+              static_cast<std::uint32_t>(h2::ErrorCode::EnhanceYourCalm));
+}
+
+TEST(Http2Session, ConnectionWindowReopensAsBodiesAreHandedOff) {
+    h2::SessionLimits limits;
+    limits.initial_window = 65535;
+    limits.max_buffered = 60000; // the connection window; updates come in halves
+    Harness h(limits);
+    h.take();
+    auto conn_updates = [&h](const std::vector<Frame>& frames) {
+        std::uint32_t sum = 0;
+        for (const auto& f : frames)
+            if (f.type == WINDOW_UPDATE && f.stream == 0) sum += get32(f.payload);
+        return sum;
+    };
+
+    const std::string part(16000, 'b');
+    h.feed(h.headers(1, "POST", "/a", {}, false) + frame(DATA, 0, 1, part) + frame(DATA, 0, 1, part));
+    h.feed(h.headers(3, "POST", "/b", {}, false) + frame(DATA, 0, 3, part));
+    h.feed(frame(DATA, END_STREAM, 1, "!"));
+    EXPECT_EQ(conn_updates(h.take()), 0u); // 48001 bytes held, none handed off
+
+    h2::IncomingRequest req;
+    ASSERT_TRUE(h.session.next_request(req));
+    EXPECT_EQ(req.body.size(), 32001u);
+    EXPECT_EQ(conn_updates(h.take()), 32001u);
+    EXPECT_FALSE(h.session.failed());
+}
+
+TEST(Http2Session, StreamPastTheSessionBufferIsRefused) {
+    h2::SessionLimits limits;
+    limits.initial_window = 65535;
+    limits.max_buffered = 70000;
+    Harness h(limits);
+    h.take();
+
+    const std::string part(16000, 'b');
+    h.feed(h.headers(1, "POST", "/a", {}, false) + frame(DATA, 0, 1, part) + frame(DATA, 0, 1, part));
+    h.feed(h.headers(3, "POST", "/b", {}, false) + frame(DATA, 0, 3, part) + frame(DATA, 0, 3, part));
+    h.take();
+    h.feed(frame(DATA, 0, 3, std::string(6000, 'b'))); // 70000 held, neither body complete
+    auto frames = h.take();
+    const Frame* rst = h.find(frames, RST_STREAM, 3);
+    ASSERT_NE(rst, nullptr);
+    EXPECT_EQ(get32(rst->payload), static_cast<std::uint32_t>(h2::ErrorCode::RefusedStream));
+    const Frame* update = h.find(frames, WINDOW_UPDATE, 0);
+    ASSERT_NE(update, nullptr);
+    EXPECT_EQ(get32(update->payload), 38000u); // stream 3's bytes are released
+
+    // Stream 1 carries on and completes.
+    h.feed(frame(DATA, END_STREAM, 1, "!"));
+    h2::IncomingRequest req;
+    ASSERT_TRUE(h.session.next_request(req));
+    EXPECT_EQ(req.stream, 1u);
+    EXPECT_EQ(req.body.size(), 32001u);
+    EXPECT_FALSE(h.session.failed());
+}
@@ -0,0 +1,138 @@
+// Unit tests for detail/http_scan: every ISA agrees with the scalar
+// scanners (and string find, for delimiters) at every offset and length,
+// including the vector tails.
+
+#include "socketify/detail/http_scan.h"
+
+#include <gtest/gtest.h>
+
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace socketify::detail;
+
+namespace {
+
+std::vector<ScanIsa> available_isas() {
+    std::vector<ScanIsa> out{ScanIsa::Scalar};
+    if (best_scan_isa() >= ScanIsa::Sse42) out.push_back(ScanIsa::Sse42);
+    if (best_scan_isa() >= ScanIsa::Avx2) out.push_back(ScanIsa::Avx2);
+    return out;
+}
+
+// Restores the default ISA when a test ends.
+struct IsaGuard {
+    ~IsaGuard() { set_scan_isa(best_scan_isa()); }
+};
+
+// Position of the first byte matching @p bad, computed the slow way.
+template <class Pred>
+std::size_t reference(const std::string& s, std::size_t from, std::size_t to, Pred bad) {
+    for (std::size_t i = from; i < to; ++i) {
+        if (bad(static_cast<unsigned char>(s[i]))) return i;
+    }
+    return to;
+}
+
+bool is_tchar(unsigned char c) {
+    if (std::isalnum(c)) return true;
+    return std::string_view("!#$%&'*+-.^_`|~").find(static_cast<char>(c)) != std::string_view::npos;
+}
+
+} // namespace
+
+TEST(HttpScan, ReportsIsaNames) {
+    EXPECT_STREQ(scan_isa_name(ScanIsa::Scalar), "scalar");
+    EXPECT_STREQ(scan_isa_name(ScanIsa::Sse42), "sse4.2");
+    EXPECT_STREQ(scan_isa_name(ScanIsa::Avx2), "avx2");
+    EXPECT_EQ(scan_isa(), best_scan_isa());
+}
+
+TEST(HttpScan, SetIsaClampsToBest) {
+    IsaGuard g;
+    set_scan_isa(ScanIsa::Avx2);
+    EXPECT_EQ(scan_isa(), best_scan_isa());
+    set_scan_isa(ScanIsa::Scalar);
+    EXPECT_EQ(scan_isa(), ScanIsa::Scalar);
+}
+
+TEST(HttpScan, FindNewlineMatchesReferenceAtEveryOffset) {
+    IsaGuard g;
+    std::string s(100, 'a');
+    for (ScanIsa isa : available_isas()) {
+        set_scan_isa(isa);
+        for (std::size_t at = 0; at <= s.size(); ++at) {
+            std::string t = s;
+            if (at < t.size()) t[at] = '\n';
+            for (std::size_t from : {std::size_t{0}, std::size_t{1}, std::size_t{7}}) {
+                for (std::size_t to = from; to <= t.size(); to += 13) {
+                    const char* r = find_newline(t.data() + from, t.data() + to);
+                    EXPECT_EQ(static_cast<std::size_t>(r - t.data()),
+                              reference(t, from, to, [](unsigned char c) { return c == '\n'; }))
+                        << scan_isa_name(isa) << " at=" << at << " from=" << from << " to=" << to;
+                }
+            }
+        }
+    }
+}
+
+TEST(HttpScan, FindNonTokenAgreesForEveryByte) {
+    IsaGuard g;
+    for (ScanIsa isa : available_isas()) {
+        set_scan_isa(isa);
+        for (int c = 0; c < 256; ++c) {
+            for (std::size_t at : {std::size_t{0}, std::size_t{5}, std::size_t{16}, std::size_t{40}}) {
+                std::string s(48, 'x');
+                s[at] = static_cast<char>(c);
+                const char* r = find_non_token(s.data(), s.data() + s.size());
+                EXPECT_EQ(static_cast<std::size_t>(r - s.data()),
+                          reference(s, 0, s.size(), [](unsigned char b) { return !is_tchar(b); }))
+                    << scan_isa_name(isa) << " byte=" << c << " at=" << at;
+            }
+        }
+    }
+}
+
+TEST(HttpScan, FindInvalidValueAgreesForEveryByte) {
+    IsaGuard g;
+    auto bad = [](unsigned char b) { return (b < 0x20 && b != '\t') || b == 0x7f; };
+    for (ScanIsa isa : available_isas()) {
+        set_scan_isa(isa);
+        for (int c = 0; c < 256; ++c) {
+            for (std::size_t at : {std::size_t{3}, std::size_t{17}, std::size_t{33}, std::size_t{70}}) {
+                std::string s(72, 'v');
+                s[at] = static_cast<char>(c);
+                const char* r = find_invalid_value(s.data(), s.data() + s.size());
+                EXPECT_EQ(static_cast<std::size_t>(r - s.data()), reference(s, 0, s.size(), bad))
+                    << scan_isa_name(isa) << " byte=" << c << " at=" << at;
+            }
+        }
+    }
+}
+
+TEST(HttpScan, FindDelimiterMatchesStringFind) {
+    IsaGuard g;
+    const std::string needle = "\r\n--XyZ-boundary";
+    for (ScanIsa isa : available_isas()) {
+        set_scan_isa(isa);
+        for (std::size_t at = 0; at <= 120; ++at) {
+            // Near misses (first and last byte right, middle wrong) everywhere.
+            std::string s;
+            while (s.size() < 120) s += "\r\n--XyZ-boundarX\r\n-xXyZ-boundary";
+            s.resize(120);
+            if (at + needle.size() <= s.size()) s.replace(at, needle.size(), needle);
+            for (std::size_t from : {std::size_t{0}, std::size_t{3}}) {
+                for (std::size_t to = from; to <= s.size(); to += 11) {
+                    const char* r = find_delimiter(s.data() + from, s.data() + to, needle.data(),
+                                                   needle.size());
+                    const std::size_t want = std::string_view(s).substr(0, to).find(needle, from);
+                    EXPECT_EQ(static_cast<std::size_t>(r - s.data()),
+                              want == std::string_view::npos ? to : want)
+                        << scan_isa_name(isa) << " at=" << at << " from=" << from << " to=" << to;
+                }
+            }
+        }
+    }
+}
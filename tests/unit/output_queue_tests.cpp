@@ -0,0 +1,128 @@
+// Unit tests for the scatter-gather output queue: coalescing, moved and
+// shared segments, partial consumption, pinned in-flight sends, memory of a
+// never-draining stream.
+
+#include "socketify/detail/output_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <string>
+
+namespace du = socketify::detail;
+
+namespace {
+
+std::string drain(const du::OutputQueue& q) {
+    iovec iov[16];
+    std::size_t n = q.gather(iov, std::size(iov));
+    std::string out;
+    for (std::size_t i = 0; i < n; ++i) out.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+    return out;
+}
+
+} // namespace
+
+TEST(OutputQueue, SmallWritesCoalesce) {
+    du::OutputQueue q;
+    q.append("HTTP/1.1 200 OK\r\n\r\n");
+    q.push(std::string("tiny"));
+    iovec iov[4];
+    EXPECT_EQ(q.gather(iov, 4), 1u);
+    EXPECT_EQ(drain(q), "HTTP/1.1 200 OK\r\n\r\ntiny");
+    EXPECT_EQ(q.size(), 23u);
+}
+
+TEST(OutputQueue, LargeBodyMovedNotCopied) {
+    du::OutputQueue q;
+    q.append("head\r\n\r\n");
+    std::string body(64 * 1024, 'z');
+    const char* data = body.data();
+    q.push(std::move(body));
+    q.append("next-head");
+
+    iovec iov[4];
+    ASSERT_EQ(q.gather(iov, 4), 3u);
+    EXPECT_EQ(iov[1].iov_base, data); // same storage: no memcpy
+    EXPECT_EQ(iov[1].iov_len, 64u * 1024u);
+    EXPECT_EQ(q.size(), 8u + 64u * 1024u + 9u);
+}
+
+TEST(OutputQueue, SharedSegment) {
+    du::OutputQueue q;
+    auto shared = std::make_shared<const std::string>("shared-bytes");
+    q.append("a");
+    q.push(shared);
+    EXPECT_EQ(drain(q), "ashared-bytes");
+}
+
+TEST(OutputQueue, PartialConsumeAcrossSegments) {
+    du::OutputQueue q;
+    q.append("0123");
+    q.push(std::string(du::OutputQueue::kInlineMax, 'x'));
+    q.append("tail");
+
+    q.consume(2);
+    EXPECT_EQ(drain(q).substr(0, 3), "23x");
+    q.consume(2 + du::OutputQueue::kInlineMax - 1);
+    EXPECT_EQ(drain(q), "xtail");
+    q.consume(5);
+    EXPECT_TRUE(q.empty());
+    iovec iov[2];
+    EXPECT_EQ(q.gather(iov, 2), 0u);
+
+    q.append("again");
+    EXPECT_EQ(drain(q), "again");
+}
+
+TEST(OutputQueue, GatherRespectsMax) {
+    du::OutputQueue q;
+    for (int i = 0; i < 5; ++i) q.push(std::string(du::OutputQueue::kInlineMax, 'a'));
+    iovec iov[3];
+    EXPECT_EQ(q.gather(iov, 3), 3u);
+}
+
+TEST(OutputQueue, NeverDrainingStreamStaysBounded) {
+    // An SSE-style stream whose socket always keeps a little unsent: the
+    // sent bytes must be freed without the queue ever running empty.
+    du::OutputQueue q;
+    auto shared = std::make_shared<const std::string>(du::OutputQueue::kInlineMax, 's');
+    std::size_t peak = 0;
+    for (int i = 0; i < 20000; ++i) {
+        q.append("data: tick\n\n");
+        if (i % 10 == 0) q.push(std::string(du::OutputQueue::kInlineMax * 2, 'b'));
+        if (i % 7 == 0) q.push(shared);
+        q.consume(q.size() - 5);
+        ASSERT_EQ(q.size(), 5u);
+        ASSERT_LE(shared.use_count(), 2); // only a still-pending push holds it
+        peak = std::max(peak, q.footprint());
+    }
+    EXPECT_LT(peak, 64u * 1024u);
+    q.consume(5);
+    EXPECT_EQ(shared.use_count(), 1);
+}
+
+TEST(OutputQueue, PinnedBytesStayPutUntilConsumed) {
+    du::OutputQueue q;
+    q.append("head\r\n\r\n"); // short enough to sit inside the segment
+    q.pin();
+    iovec iov[4];
+    ASSERT_EQ(q.gather(iov, 4), 1u);
+    const void* sent = iov[0].iov_base;
+
+    // Appends while the send is in flight go to a new segment...
+    q.append(std::string(1024, 'x'));
+    for (int i = 0; i < 32; ++i) q.push(std::string(du::OutputQueue::kInlineMax, 'y'));
+    EXPECT_EQ(q.gather(iov, 4), 4u);
+    EXPECT_EQ(iov[0].iov_base, sent);
+    EXPECT_EQ(iov[0].iov_len, 8u);
+
+    // ...and coalesce again once the pinned bytes are gone.
+    q.consume(8 + 1024 + 32 * du::OutputQueue::kInlineMax);
+    q.append("more");
+    q.append("tail");
+    EXPECT_EQ(q.gather(iov, 4), 1u);
+    EXPECT_EQ(drain(q), "moretail");
+}
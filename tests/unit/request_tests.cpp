@@ -0,0 +1,176 @@
+// Unit tests for Request: borrowed (zero-copy) views, borrowed headers,
+// ownership on copy and move, lazy query/cookie parsing (also from several
+// threads) and locals.
+
+#include "socketify/request.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace socketify;
+
+namespace {
+
+// A Request borrowing from @p wire the way the server builds one.
+Request borrowing(const std::string& wire) {
+    Request r;
+    const std::string_view w(wire);
+    r.set_target_view(w.substr(0, 6));  // "/p?q=1"
+    r.set_path_view(w.substr(0, 2));    // "/p"
+    r.set_version_view(w.substr(7, 8)); // "HTTP/1.1"
+    Headers h;
+    h.add(w.substr(16, 4), w.substr(22, 1)); // Host: h
+    h.add(w.substr(24, 3), w.substr(29, 1)); // X-A: 1
+    h.add(w.substr(31, 3), w.substr(36, 1)); // x-a: 2
+    r.set_headers(std::move(h));
+    r.set_body_view(w.substr(38));
+    return r;
+}
+
+const std::string kWire = "/p?q=1 HTTP/1.1 Host: h X-A: 1 x-a: 2 body!";
+
+} // namespace
+
+TEST(Request, BorrowedViewsPointIntoSource) {
+    Request r;
+    r.set_path_view(std::string_view(kWire).substr(0, 2));
+    r.set_body_view(std::string_view(kWire).substr(38));
+    EXPECT_EQ(r.path(), "/p");
+    EXPECT_EQ(r.path().data(), kWire.data());
+    EXPECT_EQ(r.body_view(), "body!");
+    EXPECT_EQ(r.body_view().data(), kWire.data() + 38);
+}
+
+TEST(Request, HeaderLookupBorrows) {
+    std::string wire = kWire;
+    Request r = borrowing(wire);
+    EXPECT_EQ(r.header("host"), "h");
+    EXPECT_EQ(r.header(HeaderId::Host).data(), wire.data() + 22); // no copy
+    EXPECT_EQ(r.header("missing"), "");
+}
+
+TEST(Request, RepeatedBorrowedHeadersAreJoined) {
+    std::string wire = kWire;
+    Request r = borrowing(wire);
+    EXPECT_EQ(r.header("X-A"), "1, 2");
+    EXPECT_EQ(r.headers().size(), 2u);
+}
+
+TEST(Request, CopyAndMoveOwnBorrowedData) {
+    std::string wire = kWire;
+    Request copy;
+    Request moved;
+    {
+        Request r = borrowing(wire);
+        copy = r;
+        moved = std::move(r);
+    }
+    wire.assign(wire.size(), '#'); // the "receive buffer" is reused
+
+    for (const Request* r : {&copy, &moved}) {
+        EXPECT_EQ(r->raw_target(), "/p?q=1");
+        EXPECT_EQ(r->path(), "/p");
+        EXPECT_EQ(r->http_version(), "HTTP/1.1");
+        EXPECT_EQ(r->header("Host"), "h");
+        EXPECT_EQ(r->header("x-a"), "1, 2");
+        EXPECT_EQ(r->body_view(), "body!");
+    }
+}
+
+TEST(Request, BodyStringCopiesABorrowedBody) {
+    std::string wire = kWire;
+    Request r = borrowing(wire);
+    EXPECT_EQ(r.body_string(), "body!");
+    EXPECT_EQ(&r.body_string(), &r.body_string()); // copied once
+    EXPECT_EQ(r.body_view().data(), wire.data() + 38); // the view still borrows
+
+    Request owned;
+    owned.set_body_storage("owned");
+    EXPECT_EQ(owned.body_string(), "owned");
+    EXPECT_EQ(owned.body_view().data(), owned.body_string().data());
+    EXPECT_TRUE(Request().body_string().empty());
+}
+
+TEST(Request, MutableHeadersMixBorrowedAndOwned) {
+    std::string wire = kWire;
+    Request r = borrowing(wire);
+    r.mutable_headers()["X-New"] = "n";
+    EXPECT_EQ(r.header("Host"), "h");
+    EXPECT_EQ(r.header("X-New"), "n");
+    EXPECT_EQ(r.headers().size(), 3u);
+    EXPECT_EQ(r.header("Host").data(), wire.data() + 22);
+    EXPECT_TRUE(r.take_headers().empty());
+    EXPECT_TRUE(r.headers().empty());
+}
+
+TEST(Request, QueryAndCookiesParseOnFirstUse) {
+    std::string wire = "/p?a=1&b=x%20y HTTP/1.1";
+    Request r;
+    r.set_target_view(std::string_view(wire).substr(0, 14));
+    r.mutable_headers().add("Cookie", "s=1; t=two");
+
+    Request early = r; // copied before anything was parsed
+    EXPECT_EQ(r.query_value("b"), "x y");
+    EXPECT_EQ(r.query().size(), 2u);
+    EXPECT_EQ(r.cookie("t"), "two");
+    r.mutable_query()["c"] = "3"; // adds to the parsed values
+    EXPECT_EQ(r.query().size(), 3u);
+
+    Request late = r;
+    wire.assign(wire.size(), '#');
+    EXPECT_EQ(early.query_value("a"), "1");
+    EXPECT_EQ(early.cookies().size(), 2u);
+    EXPECT_EQ(late.query_value("c"), "3");
+    EXPECT_EQ(late.cookie("s"), "1");
+
+    Request none;
+    none.set_target("/plain");
+    EXPECT_TRUE(none.query().empty());
+    EXPECT_TRUE(none.cookies().empty());
+}
+
+TEST(Request, LazyAccessorsFillOnceAcrossThreads) {
+    std::string wire = kWire;
+    Request r = borrowing(wire);
+    r.mutable_headers().add("Cookie", "s=1");
+    const Request& shared = r;
+    std::vector<const void*> seen(12);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&shared, &seen, t] {
+            seen[t * 3] = &shared.query().at("q");
+            seen[t * 3 + 1] = &shared.cookies().at("s");
+            seen[t * 3 + 2] = shared.body_string().data();
+        });
+    }
+    for (auto& t : threads) t.join();
+    for (std::size_t i = 3; i < seen.size(); ++i) EXPECT_EQ(seen[i], seen[i % 3]) << i;
+    EXPECT_EQ(r.query_value("q"), "1");
+    EXPECT_EQ(r.cookie("s"), "1");
+    EXPECT_EQ(r.body_string(), "body!");
+    EXPECT_EQ(Request(r).body_string(), "body!");
+}
+
+TEST(Request, LocalsHaveASlotPerType) {
+    struct A { int v; };
+    struct B { int v; };
+    Request r;
+    EXPECT_EQ(r.local<A>(), nullptr);
+    r.set_local(std::make_shared<A>(A{1}));
+    r.set_local(std::make_shared<B>(B{2}));
+    r.set_local("other", std::make_shared<A>(A{3}));
+    ASSERT_NE(r.local<A>(), nullptr);
+    EXPECT_EQ(r.local<A>()->v, 1);
+    EXPECT_EQ(r.local<B>()->v, 2);
+    EXPECT_EQ(r.local<A>("other")->v, 3);
+    EXPECT_EQ(r.local<A>("missing"), nullptr);
+
+    r.set_local(std::make_shared<A>(A{4})); // replaces
+    const Request copy = r;
+    EXPECT_EQ(copy.local<A>()->v, 4);
+    EXPECT_EQ(copy.local<A>("other")->v, 3);
+}
@@ -92,3 +92,28 @@ TEST(Response, StatusChaining) {
     EXPECT_EQ(res.status_code(), 201);
     EXPECT_EQ(res.headers().find("X-Custom")->second, "v");
 }
+
+TEST(Response, KnownHeaderFlagsAreCaseInsensitive) {
+    Response res;
+    EXPECT_FALSE(res.has_known_header(Response::KnownHeader::ContentType));
+    res.set_header("content-TYPE", "text/css");
+    res.set_header("CONNECTION", "close");
+    res.set_header("X-Other", "1");
+    EXPECT_TRUE(res.has_known_header(Response::KnownHeader::ContentType));
+    EXPECT_TRUE(res.has_known_header(Response::KnownHeader::Connection));
+    EXPECT_FALSE(res.has_known_header(Response::KnownHeader::ContentLength));
+    EXPECT_FALSE(res.has_known_header(Response::KnownHeader::Vary));
+    res.send("body");
+    EXPECT_EQ(res.headers().find("Content-Type")->second, "text/css");
+}
+
+TEST(Response, MoveAndCopyKeepShortBodyView) {
+    Response a;
+    a.send("tiny"); // fits the string's inline buffer
+    Response b(std::move(a));
+    EXPECT_EQ(b.body_view(), "tiny");
+    Response c;
+    c = b;
+    b = Response{};
+    EXPECT_EQ(c.body_view(), "tiny");
+}
@@ -0,0 +1,101 @@
+// Unit tests for the response head writer: cached Date, status-line
+// table, header filtering and body queueing.
+
+#include "socketify/detail/output_queue.h"
+#include "socketify/detail/response_writer.h"
+#include "socketify/detail/utils.h"
+#include "socketify/request.h"
+#include "socketify/response.h"
+#include "socketify/server.h"
+
+#include <gtest/gtest.h>
+
+#include <iterator>
+
+using namespace socketify;
+namespace du = socketify::detail;
+
+namespace {
+
+std::string serialize(Response& res, bool head = false, bool close = false) {
+    Request req;
+    ServerOptions opts;
+    du::OutputQueue q;
+    du::serialize_response(q, req, res, opts, "Thu, 01 Jan 1970 00:00:00 GMT", head, close);
+    iovec iov[8];
+    std::size_t n = q.gather(iov, std::size(iov));
+    std::string out;
+    for (std::size_t i = 0; i < n; ++i) out.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+    return out;
+}
+
+} // namespace
+
+TEST(ResponseWriter, DateCacheMatchesHttpDate) {
+    du::DateCache cache;
+    for (std::int64_t t : {0LL, 784111777LL, 951782400LL, 1700000000LL, 4102444799LL}) {
+        EXPECT_EQ(cache.at(t), du::http_date(t)) << t;
+    }
+    EXPECT_EQ(cache.now().size(), 29u);
+}
+
+TEST(ResponseWriter, StatusLineTableMatchesReasonPhrases) {
+    for (unsigned code = 100; code < 600; ++code) {
+        auto line = du::status_line(code);
+        auto phrase = reason(static_cast<Status>(code));
+        if (phrase == "Unknown") {
+            EXPECT_TRUE(line.empty()) << code;
+            continue;
+        }
+        EXPECT_EQ(line, "HTTP/1.1 " + std::to_string(code) + " " + std::string(phrase) + "\r\n");
+    }
+    EXPECT_TRUE(du::status_line(999).empty());
+}
+
+TEST(ResponseWriter, UnknownStatusFallsBack) {
+    Response res;
+    res.status(299).send("x");
+    EXPECT_EQ(serialize(res).rfind("HTTP/1.1 299 Unknown\r\n", 0), 0u);
+}
+
+TEST(ResponseWriter, FiltersUserContentLengthAndConnection) {
+    Response res;
+    res.set_header("content-length", "999");
+    res.set_header("Connection", "close");
+    res.set_header("X-Keep", "yes");
+    res.send("hello");
+    std::string out = serialize(res);
+    EXPECT_EQ(out.find("999"), std::string::npos);
+    EXPECT_EQ(out.find("Connection: close"), std::string::npos);
+    EXPECT_NE(out.find("Content-Length: 5\r\n"), std::string::npos);
+    EXPECT_NE(out.find("Connection: keep-alive\r\n"), std::string::npos);
+    EXPECT_NE(out.find("X-Keep: yes\r\n"), std::string::npos);
+    EXPECT_EQ(out.substr(out.size() - 9), "\r\n\r\nhello");
+}
+
+TEST(ResponseWriter, HeadRequestOmitsBody) {
+    Response res;
+    res.send(std::string(10000, 'a'));
+    std::string out = serialize(res, /*head=*/true);
+    EXPECT_NE(out.find("Content-Length: 10000\r\n"), std::string::npos);
+    EXPECT_EQ(out.substr(out.size() - 4), "\r\n\r\n");
+}
+
+TEST(ResponseWriter, ChunkedStreamDropsContentLength) {
+    Response res;
+    res.set_header("Content-Length", "5");
+    res.mark_chunked(nullptr);
+    std::string out = serialize(res);
+    EXPECT_NE(out.find("Transfer-Encoding: chunked\r\n"), std::string::npos);
+    EXPECT_EQ(out.find("Content-Length"), std::string::npos);
+    EXPECT_EQ(out.substr(out.size() - 4), "\r\n\r\n");
+}
+
+TEST(ResponseWriter, WantsCloseUsesFlags) {
+    Request req;
+    req.set_version("HTTP/1.1");
+    Response res;
+    EXPECT_FALSE(du::wants_close(req, res));
+    res.set_header("connection", "Close");
+    EXPECT_TRUE(du::wants_close(req, res));
+}
@@ -5,6 +5,9 @@
 
 #include <gtest/gtest.h>
 
+#include <string>
+#include <tuple>
+
 using namespace socketify;
 
 namespace {
@@ -251,3 +254,207 @@ TEST(Router, TrailingSlashIsIgnoredInSegments) {
     Response res;
     EXPECT_TRUE(r.dispatch(req, res));
 }
+
+TEST(Router, MatchFindsRouteWithoutDispatching) {
+    Router r;
+    bool ran = false;
+    r.AddRoute(Method::GET, "/files/:name", [&](Request&, Response&) { ran = true; });
+    EXPECT_FALSE(r.streams_bodies());
+    r.AddRoute(Method::PUT, "/files/:name", [&](Request&, Response&) { ran = true; })
+        .OnBody([](Request&, std::string_view, BodyStream&) {});
+    EXPECT_TRUE(r.streams_bodies());
+
+    ParamMap params;
+    const Route* put = r.match(Method::PUT, "/files/a.txt", &params);
+    ASSERT_NE(put, nullptr);
+    EXPECT_TRUE(put->streams_body());
+    EXPECT_EQ(params["name"], "a.txt");
+    const Route* head = r.match(Method::HEAD, "/files/a.txt");
+    ASSERT_NE(head, nullptr);
+    EXPECT_FALSE(head->streams_body());
+    EXPECT_EQ(r.match(Method::POST, "/files/a.txt"), nullptr);
+    EXPECT_EQ(r.match(Method::PUT, "/other"), nullptr);
+    EXPECT_FALSE(ran);
+}
+
+TEST(Router, FirstRegisteredRouteWins) {
+    auto body_for = [](const Router& r, const char* path) {
+        auto req = make_req(Method::GET, path);
+        Response res;
+        EXPECT_TRUE(r.dispatch(req, res)) << path;
+        return std::string(res.body_view());
+    };
+
+    Router specific_first;
+    specific_first.AddRoute(Method::GET, "/users/me", [](Request&, Response& rs) { rs.send("static"); });
+    specific_first.AddRoute(Method::GET, "/users/:id", [](Request&, Response& rs) { rs.send("param"); });
+    specific_first.AddRoute(Method::GET, "/users/*rest", [](Request&, Response& rs) { rs.send("wild"); });
+    EXPECT_EQ(body_for(specific_first, "/users/me"), "static");
+    EXPECT_EQ(body_for(specific_first, "/users/42"), "param");
+    EXPECT_EQ(body_for(specific_first, "/users/42/posts"), "wild");
+    EXPECT_EQ(body_for(specific_first, "/users"), "wild");
+
+    // Registered least specific first: the wildcard shadows the rest, as a
+    // linear scan over the routes would.
+    Router wild_first;
+    wild_first.AddRoute(Method::GET, "/users/*rest", [](Request&, Response& rs) { rs.send("wild"); });
+    wild_first.AddRoute(Method::GET, "/users/:id", [](Request&, Response& rs) { rs.send("param"); });
+    wild_first.AddRoute(Method::GET, "/users/me", [](Request&, Response& rs) { rs.send("static"); });
+    EXPECT_EQ(body_for(wild_first, "/users/me"), "wild");
+    EXPECT_EQ(body_for(wild_first, "/users/42"), "wild");
+
+    Router param_first;
+    param_first.AddRoute(Method::GET, "/users/:id", [](Request&, Response& rs) { rs.send("param"); });
+    param_first.AddRoute(Method::GET, "/users/me", [](Request&, Response& rs) { rs.send("static"); });
+    param_first.AddRoute(Method::GET, "/users/*rest", [](Request&, Response& rs) { rs.send("wild"); });
+    EXPECT_EQ(body_for(param_first, "/users/me"), "param");
+    EXPECT_EQ(body_for(param_first, "/users/42/posts"), "wild");
+}
+
+TEST(Router, BacktracksOutOfDeadBranches) {
+    Router r;
+    std::string id;
+    r.AddRoute(Method::GET, "/a/b/c", [](Request&, Response& rs) { rs.send("abc"); });
+    r.AddRoute(Method::GET, "/a/:id/d", [&](Request& rq, Response& rs) {
+        id = rq.params().at("id");
+        rs.send("param");
+    });
+    // "/users/me" exists, but only for POST: GET falls through to :id.
+    r.AddRoute(Method::POST, "/users/me", [](Request&, Response& rs) { rs.send("me"); });
+    r.AddRoute(Method::GET, "/users/:id", [](Request&, Response& rs) { rs.send("user"); });
+
+    auto req = make_req(Method::GET, "/a/b/d");
+    Response res;
+    EXPECT_TRUE(r.dispatch(req, res));
+    EXPECT_EQ(res.body_view(), "param");
+    EXPECT_EQ(id, "b");
+
+    auto req2 = make_req(Method::GET, "/users/me");
+    Response res2;
+    EXPECT_TRUE(r.dispatch(req2, res2));
+    EXPECT_EQ(res2.body_view(), "user");
+}
+
+TEST(Router, AllowListsEveryRouteOnThePath) {
+    Router r;
+    r.AddRoute(Method::GET, "/items/:id", [](Request&, Response& rs) { rs.send("g"); });
+    r.AddRoute(Method::PUT, "/items/special", [](Request&, Response& rs) { rs.send("p"); });
+    r.AddRoute(Method::DELETE_, "/items/*rest", [](Request&, Response& rs) { rs.send("d"); });
+
+    auto req = make_req(Method::POST, "/items/special");
+    Response res;
+    EXPECT_TRUE(r.dispatch(req, res));
+    EXPECT_EQ(res.status_code(), 405);
+    EXPECT_EQ(res.headers().at("Allow"), "GET, PUT, DELETE, HEAD");
+}
+
+TEST(Router, HeadTakesTheFirstOfGetAndAny) {
+    Router r;
+    r.AddRoute(Method::ANY, "/x", [](Request&, Response& rs) { rs.send("any"); });
+    r.AddRoute(Method::GET, "/x", [](Request&, Response& rs) { rs.send("get"); });
+    r.AddRoute(Method::GET, "/y", [](Request&, Response& rs) { rs.send("get"); });
+    r.AddRoute(Method::ANY, "/y", [](Request&, Response& rs) { rs.send("any"); });
+
+    for (const auto& [method, path, body] :
+         {std::tuple{Method::HEAD, "/x", "any"}, std::tuple{Method::GET, "/x", "any"},
+          std::tuple{Method::HEAD, "/y", "get"}, std::tuple{Method::POST, "/y", "any"}}) {
+        auto req = make_req(method, path);
+        Response res;
+        EXPECT_TRUE(r.dispatch(req, res)) << path;
+        EXPECT_EQ(res.body_view(), body) << path;
+    }
+}
+
+TEST(Router, CompressedChainsAndLateRoutes) {
+    Router r;
+    r.AddRoute(Method::GET, "/api/v1/users/list", [](Request&, Response& rs) { rs.send("list"); });
+    r.build();
+    auto req = make_req(Method::GET, "/api/v1/users/list");
+    Response res;
+    EXPECT_TRUE(r.dispatch(req, res));
+    EXPECT_EQ(res.body_view(), "list");
+    auto partial = make_req(Method::GET, "/api/v1");
+    Response res_partial;
+    EXPECT_FALSE(r.dispatch(partial, res_partial));
+
+    // A route added later splits the merged edge on the next lookup.
+    r.AddRoute(Method::GET, "/api/v1", [](Request&, Response& rs) { rs.send("v1"); });
+    r.AddRoute(Method::GET, "/api/v2/:x", [](Request&, Response& rs) { rs.send("v2"); });
+    for (const auto& [path, body] : {std::pair{"/api/v1", "v1"}, std::pair{"/api/v1/users/list", "list"},
+                                     std::pair{"/api/v2/y", "v2"}}) {
+        auto rq = make_req(Method::GET, path);
+        Response rs;
+        EXPECT_TRUE(r.dispatch(rq, rs)) << path;
+        EXPECT_EQ(rs.body_view(), body) << path;
+    }
+}
+
+TEST(Router, ChainRunsGlobalGroupRouteThenHandler) {
+    Router r;
+    std::vector<std::string> order;
+    auto mw = [&](std::string name) {
+        return [&order, name](Request&, Response&, Next next) {
+            order.push_back(name);
+            next();
+        };
+    };
+    r.Use(mw("global"));
+    auto& api = r.Group("/api");
+    api.Use(mw("group"));
+    api.Get("/x", [&](Request&, Response& rs) {
+        order.push_back("handler");
+        rs.send("ok");
+    }).Use(mw("route"));
+    r.build();
+    // Added after build(): the chains are rebuilt on the next dispatch.
+    r.Use(mw("global2"));
+
+    auto req = make_req(Method::GET, "/api/x");
+    Response res;
+    EXPECT_TRUE(r.dispatch(req, res));
+    EXPECT_EQ(order, (std::vector<std::string>{"global", "global2", "group", "route", "handler"}));
+
+    // Unrouted paths still see the global middleware, and only that.
+    order.clear();
+    auto miss = make_req(Method::GET, "/api/none");
+    Response res_miss;
+    EXPECT_FALSE(r.dispatch(miss, res_miss));
+    EXPECT_EQ(order, (std::vector<std::string>{"global", "global2"}));
+}
+
+TEST(Router, ParameterlessPathsResolveThroughTheIndex) {
+    Router r;
+    for (int i = 0; i < 300; ++i) {
+        const std::string base = "/svc" + std::to_string(i % 7) + "/item" + std::to_string(i);
+        r.AddRoute(Method::GET, base, [](Request&, Response&) {});
+        r.AddRoute(Method::PUT, base + "/:field", [](Request&, Response&) {});
+    }
+    r.AddRoute(Method::GET, "/", [](Request&, Response&) {});
+    r.AddRoute(Method::POST, "/svc1/:item", [](Request&, Response&) {});
+    r.build();
+
+    for (int i = 0; i < 300; ++i) {
+        const std::string base = "/svc" + std::to_string(i % 7) + "/item" + std::to_string(i);
+        const Route* hit = r.match(Method::GET, base);
+        ASSERT_NE(hit, nullptr) << base;
+        EXPECT_EQ(hit->pattern(), base);
+    }
+    EXPECT_EQ(r.match(Method::GET, "/")->pattern(), "/");
+    EXPECT_EQ(r.match(Method::GET, "//svc1//item1/")->pattern(), "/svc1/item1");
+    EXPECT_EQ(r.match(Method::HEAD, "/svc1/item1")->pattern(), "/svc1/item1");
+    // The path is indexed, the method is not: the tree takes over.
+    EXPECT_EQ(r.match(Method::POST, "/svc1/item1")->pattern(), "/svc1/:item");
+
+    // An earlier pattern that also matches an indexed path still wins.
+    Router shadowed;
+    shadowed.AddRoute(Method::ANY, "/svc/:name", [](Request&, Response&) {});
+    shadowed.AddRoute(Method::GET, "/svc/status", [](Request&, Response&) {});
+    shadowed.build();
+    EXPECT_EQ(shadowed.match(Method::GET, "/svc/status")->pattern(), "/svc/:name");
+    EXPECT_EQ(r.match(Method::GET, "/svc1/item2"), nullptr);
+
+    auto req = make_req(Method::DELETE_, "/svc1/item1");
+    Response res;
+    EXPECT_TRUE(r.dispatch(req, res));
+    EXPECT_EQ(res.status_code(), 405);
+}
@@ -0,0 +1,83 @@
+// Unit tests for the generation-checked object slab used for pooled
+// connections.
+
+#include "socketify/detail/slab.h"
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <string>
+
+namespace du = socketify::detail;
+
+TEST(Slab, AcquireGetRelease) {
+    du::Slab<std::string, 4> slab;
+    std::uint64_t h = 0;
+    std::string* s = slab.acquire(h);
+    ASSERT_NE(s, nullptr);
+    EXPECT_NE(h, 0u);
+    EXPECT_EQ(slab.get(h), s);
+    EXPECT_EQ(slab.size(), 1u);
+
+    slab.release(h);
+    EXPECT_EQ(slab.get(h), nullptr);
+    EXPECT_EQ(slab.size(), 0u);
+    slab.release(h); // stale: ignored
+    EXPECT_EQ(slab.size(), 0u);
+}
+
+TEST(Slab, ReuseBumpsGenerationAndKeepsAddress) {
+    du::Slab<int, 4> slab;
+    std::uint64_t h1 = 0, h2 = 0;
+    int* a = slab.acquire(h1);
+    slab.release(h1);
+    int* b = slab.acquire(h2);
+    EXPECT_EQ(a, b);         // LIFO reuse of the warm slot
+    EXPECT_NE(h1, h2);       // but a new generation
+    EXPECT_EQ(slab.get(h1), nullptr);
+    EXPECT_EQ(slab.get(h2), b);
+}
+
+TEST(Slab, GrowsByChunksWithStableAddresses) {
+    du::Slab<int, 4> slab;
+    std::vector<std::pair<std::uint64_t, int*>> items;
+    for (int i = 0; i < 10; ++i) {
+        std::uint64_t h = 0;
+        int* p = slab.acquire(h);
+        *p = i;
+        items.emplace_back(h, p);
+    }
+    EXPECT_EQ(slab.capacity(), 12u);
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(slab.get(items[i].first), items[i].second);
+        EXPECT_EQ(*items[i].second, i);
+    }
+
+    std::set<std::uint64_t> live;
+    for (auto h : slab.live_handles()) live.insert(h);
+    EXPECT_EQ(live.size(), 10u);
+}
+
+TEST(Slab, ForeignHandlesRejected) {
+    du::Slab<int, 4> slab;
+    std::uint64_t h = 0;
+    slab.acquire(h);
+    EXPECT_EQ(slab.get(0), nullptr);
+    EXPECT_EQ(slab.get(1), nullptr);                 // generation 0 never issued
+    EXPECT_EQ(slab.get((std::uint64_t{1} << 32) | 999), nullptr); // out of range
+}
+
+TEST(Slab, ReserveAllocatesWholeChunks) {
+    du::Slab<int, 4> slab;
+    slab.reserve(9);
+    EXPECT_EQ(slab.capacity(), 12u);
+    EXPECT_EQ(slab.size(), 0u);
+    slab.reserve(3); // never shrinks
+    EXPECT_EQ(slab.capacity(), 12u);
+
+    for (int i = 0; i < 12; ++i) {
+        std::uint64_t h = 0;
+        ASSERT_NE(slab.acquire(h), nullptr);
+    }
+    EXPECT_EQ(slab.capacity(), 12u);
+}
@@ -2,11 +2,16 @@
 // conditional requests, ranges and file responses.
 
 #include "socketify/static_files.h"
+#include "socketify/detail/file_io.h"
 
 #include <gtest/gtest.h>
+#include <sys/resource.h>
+#include <zlib.h>
 
+#include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <thread>
 
 using namespace socketify;
 namespace fs = std::filesystem;
@@ -190,3 +195,237 @@ TEST_F(StaticFilesTest, NestedDirectories) {
     EXPECT_TRUE(res.ended());
     EXPECT_EQ(res.file_length(), 6u);
 }
+
+TEST_F(StaticFilesTest, CacheHitsShareTheOpenFile) {
+    auto mw = static_files::serve(root_.string());
+    auto req1 = make_req(Method::GET, "/data.txt");
+    Response res1;
+    mw(req1, res1, [] {});
+    ASSERT_NE(res1.file_handle(), nullptr);
+
+    auto req2 = make_req(Method::GET, "/data.txt");
+    req2.mutable_headers()["Range"] = "bytes=2-4";
+    Response res2;
+    mw(req2, res2, [] {});
+    EXPECT_EQ(res2.file_handle(), res1.file_handle()); // not reopened
+    EXPECT_EQ(res2.status_code(), 206);
+    EXPECT_EQ(res2.file_offset(), 2u);
+    EXPECT_EQ(res2.file_length(), 3u);
+    EXPECT_EQ(res2.file_path(), res1.file_path());
+    EXPECT_EQ(res2.headers().find("ETag")->second, res1.headers().find("ETag")->second);
+    EXPECT_EQ(res2.headers().find("Content-Type")->second, "text/plain; charset=utf-8");
+
+    // Without the cache every request opens the file.
+    auto uncached = static_files::serve(root_.string(), {.cache_entries = 0});
+    Response res3, res4;
+    auto req3 = make_req(Method::GET, "/data.txt");
+    auto req4 = make_req(Method::GET, "/data.txt");
+    uncached(req3, res3, [] {});
+    uncached(req4, res4, [] {});
+    EXPECT_NE(res3.file_handle(), res4.file_handle());
+}
+
+TEST_F(StaticFilesTest, CacheTtlBoundsStaleness) {
+    auto fresh = static_files::serve(root_.string(), {.cache_ttl = std::chrono::milliseconds(0)});
+    auto stale = static_files::serve(root_.string(), {.cache_ttl = std::chrono::hours(1)});
+    auto get = [&](Middleware& mw) {
+        auto req = make_req(Method::GET, "/data.txt");
+        Response res;
+        mw(req, res, [] {});
+        return res;
+    };
+    const Response before = get(stale);
+    get(fresh);
+
+    // Replace the file, as deploys do.
+    write_file(root_ / "data.new", "replaced");
+    fs::rename(root_ / "data.new", root_ / "data.txt");
+
+    EXPECT_EQ(get(fresh).file_length(), 8u);
+    const Response cached = get(stale);
+    EXPECT_EQ(cached.file_handle(), before.file_handle());
+    EXPECT_EQ(cached.file_length(), 10u); // the old file, still open
+
+    // Deleted: an expired entry is resolved again and falls through.
+    fs::remove(root_ / "data.txt");
+    bool fell_through = false;
+    auto req = make_req(Method::GET, "/data.txt");
+    Response res;
+    fresh(req, res, [&] { fell_through = true; });
+    EXPECT_TRUE(fell_through);
+}
+
+TEST_F(StaticFilesTest, CacheEvictsLeastRecentlyUsed) {
+    auto mw = static_files::serve(root_.string(), {.cache_entries = 2});
+    auto handle = [&](std::string path) {
+        auto req = make_req(Method::GET, std::move(path));
+        Response res;
+        mw(req, res, [] {});
+        return res.file_handle();
+    };
+    const auto data = handle("/data.txt");
+    const auto index = handle("/");
+    EXPECT_EQ(handle("/data.txt"), data); // now most recent
+    handle("/sub/nested.txt");             // evicts "/"
+    EXPECT_EQ(handle("/data.txt"), data);
+    EXPECT_NE(handle("/"), index);
+}
+
+TEST_F(StaticFilesTest, CachedDescriptorsStayWithinTheFdBudget) {
+    auto open_fds = [] {
+        std::size_t n = 0;
+        for (const auto& e : fs::directory_iterator("/proc/self/fd")) {
+            (void)e;
+            ++n;
+        }
+        return n;
+    };
+    if (open_fds() > 64) GTEST_SKIP() << "too many descriptors open to lower RLIMIT_NOFILE";
+    for (int i = 0; i < 48; ++i) write_file(root_ / ("f" + std::to_string(i)), "x");
+
+    rlimit saved{};
+    ASSERT_EQ(::getrlimit(RLIMIT_NOFILE, &saved), 0);
+    rlimit low = saved;
+    low.rlim_cur = 128; // the caches may hold 32
+    ASSERT_EQ(::setrlimit(RLIMIT_NOFILE, &low), 0);
+    {
+        auto mw = static_files::serve(root_.string());
+        auto handle = [&](int i) {
+            auto req = make_req(Method::GET, "/f" + std::to_string(i));
+            Response res;
+            mw(req, res, [] {});
+            return res.file_handle();
+        };
+        const std::size_t before = open_fds();
+        for (int i = 0; i < 48; ++i) EXPECT_NE(handle(i), nullptr) << i;
+        EXPECT_LE(open_fds(), before + 32);
+        EXPECT_EQ(handle(47), handle(47)); // recent entries stay cached
+
+        // Another worker finds the budget taken: served, not cached.
+        std::thread([&] {
+            const auto first = handle(0);
+            ASSERT_NE(first, nullptr);
+            EXPECT_NE(handle(0), first);
+        }).join();
+    }
+    ::setrlimit(RLIMIT_NOFILE, &saved);
+}
+
+TEST_F(StaticFilesTest, PrecompressedSiblingsFollowAcceptEncoding) {
+    write_file(root_ / "app.js", std::string(2000, 'a'));
+    write_file(root_ / "app.js.br", "brotli-bytes");
+    write_file(root_ / "app.js.gz", "gzip-bytes!");
+    auto mw = static_files::serve(root_.string(), {.precompressed = true});
+    auto get = [&](std::string_view accept) {
+        auto req = make_req(Method::GET, "/app.js");
+        if (!accept.empty()) req.mutable_headers()["Accept-Encoding"] = std::string(accept);
+        Response res;
+        mw(req, res, [] { FAIL() << "next() should not be called"; });
+        return res;
+    };
+    auto header = [](const Response& res, const char* name) {
+        auto it = res.headers().find(name);
+        return it == res.headers().end() ? std::string() : it->second;
+    };
+
+    const Response br = get("gzip, deflate, br");
+    EXPECT_EQ(header(br, "Content-Encoding"), "br");
+    EXPECT_EQ(br.file_length(), 12u);
+    EXPECT_EQ(header(br, "Content-Type"), "application/javascript; charset=utf-8");
+    EXPECT_EQ(header(br, "Vary"), "Accept-Encoding");
+
+    const Response gz = get("gzip;q=1, br;q=0.5");
+    EXPECT_EQ(header(gz, "Content-Encoding"), "gzip");
+    EXPECT_EQ(gz.file_length(), 11u);
+
+    const Response plain = get("");
+    EXPECT_EQ(header(plain, "Content-Encoding"), "");
+    EXPECT_EQ(plain.file_length(), 2000u);
+    EXPECT_EQ(header(plain, "Vary"), "Accept-Encoding");
+    EXPECT_EQ(header(get("br;q=0, gzip;q=0"), "Content-Encoding"), "");
+
+    // Each representation has its own validator.
+    const std::string tags[] = {header(br, "ETag"), header(gz, "ETag"), header(plain, "ETag")};
+    EXPECT_NE(tags[0], tags[1]);
+    EXPECT_NE(tags[0], tags[2]);
+    EXPECT_NE(tags[1], tags[2]);
+    auto req = make_req(Method::GET, "/app.js");
+    req.mutable_headers()["Accept-Encoding"] = "br";
+    req.mutable_headers()["If-None-Match"] = tags[0];
+    Response res;
+    mw(req, res, [] {});
+    EXPECT_EQ(res.status_code(), 304);
+
+    // Off by default, and files without siblings do not vary.
+    auto off = static_files::serve(root_.string());
+    auto req2 = make_req(Method::GET, "/app.js");
+    req2.mutable_headers()["Accept-Encoding"] = "br";
+    Response res2;
+    off(req2, res2, [] {});
+    EXPECT_EQ(header(res2, "Content-Encoding"), "");
+    auto req3 = make_req(Method::GET, "/data.txt");
+    req3.mutable_headers()["Accept-Encoding"] = "br";
+    Response res3;
+    mw(req3, res3, [] {});
+    EXPECT_EQ(header(res3, "Vary"), "");
+}
+
+TEST_F(StaticFilesTest, SiblingMustStayUnderTheRoot) {
+    const fs::path outside = root_.string() + "_outside.br";
+    write_file(outside, "secret");
+    write_file(root_ / "page.html", "<p>page</p>");
+    fs::create_symlink(outside, root_ / "page.html.br");
+    auto mw = static_files::serve(root_.string(), {.precompressed = true});
+    auto req = make_req(Method::GET, "/page.html");
+    req.mutable_headers()["Accept-Encoding"] = "br";
+    Response res;
+    mw(req, res, [] {});
+    EXPECT_EQ(res.headers().find("Content-Encoding"), res.headers().end());
+    EXPECT_EQ(res.file_length(), 11u);
+    fs::remove(outside);
+}
+
+TEST_F(StaticFilesTest, CompressesInTheBackground) {
+    std::string js;
+    for (int i = 0; i < 200; ++i) js += "function f" + std::to_string(i) + "() { return " + std::to_string(i) + "; }\n";
+    write_file(root_ / "bundle.js", js);
+    auto mw = static_files::serve(root_.string(), {.compress = true});
+    auto get = [&](std::string_view path, std::string_view accept) {
+        auto req = make_req(Method::GET, std::string(path));
+        req.mutable_headers()["Accept-Encoding"] = std::string(accept);
+        Response res;
+        mw(req, res, [] {});
+        return res;
+    };
+
+    // Served as is until the copy is ready.
+    Response res = get("/bundle.js", "gzip");
+    EXPECT_EQ(res.file_length(), js.size());
+    EXPECT_EQ(res.headers().find("Vary")->second, "Accept-Encoding");
+    for (int i = 0; i < 200 && res.headers().find("Content-Encoding") == res.headers().end(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        res = get("/bundle.js", "gzip");
+    }
+    ASSERT_NE(res.headers().find("Content-Encoding"), res.headers().end());
+    EXPECT_EQ(res.headers().find("Content-Encoding")->second, "gzip");
+    EXPECT_LT(res.file_length(), js.size());
+    EXPECT_TRUE(res.headers().find("ETag")->second.ends_with("-gzip\""));
+
+    // The copy is a gzip stream of the file.
+    std::string gz;
+    ASSERT_TRUE(detail::read_file_range(*res.file_handle(), 0, res.file_length(), gz));
+    std::string round(js.size(), '\0');
+    z_stream zs{};
+    ASSERT_EQ(inflateInit2(&zs, 15 + 16), Z_OK);
+    zs.next_in = reinterpret_cast<Bytef*>(gz.data());
+    zs.avail_in = static_cast<uInt>(gz.size());
+    zs.next_out = reinterpret_cast<Bytef*>(round.data());
+    zs.avail_out = static_cast<uInt>(round.size());
+    EXPECT_EQ(inflate(&zs, Z_FINISH), Z_STREAM_END);
+    inflateEnd(&zs);
+    EXPECT_EQ(round, js);
+
+    // Clients without gzip, small files and incompressible types get the file.
+    EXPECT_EQ(get("/bundle.js", "br").file_length(), js.size());
+    EXPECT_EQ(get("/data.txt", "gzip").headers().count("Vary"), 0u);
+}
@@ -0,0 +1,94 @@
+// Unit tests for coroutine Task composition. Off a worker loop every
+// awaitable completes inline, so tasks can be driven synchronously.
+
+#include "socketify/task.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace socketify;
+
+namespace {
+
+template <class T>
+T run(Task<T> task) {
+    std::optional<T> out;
+    [](Task<T> t, std::optional<T>& o) -> detail::Detached {
+        o.emplace(co_await t);
+    }(std::move(task), out);
+    EXPECT_TRUE(out.has_value());
+    return std::move(*out);
+}
+
+Task<int> answer() { co_return 42; }
+
+Task<int> add_one(int v) {
+    int x = co_await answer();
+    co_return x + v;
+}
+
+Task<void> fail() {
+    throw std::runtime_error("boom");
+    co_return;
+}
+
+Task<std::string> catches() {
+    try {
+        co_await fail();
+    } catch (const std::exception& e) {
+        co_return std::string(e.what());
+    }
+    co_return std::string("no throw");
+}
+
+} // namespace
+
+TEST(Task, IsLazyAndComposes) {
+    Task<int> t = add_one(1);
+    EXPECT_TRUE(t.valid());
+    EXPECT_FALSE(t.done());
+    EXPECT_EQ(run(std::move(t)), 43);
+}
+
+TEST(Task, ExceptionsPropagateToAwaiter) {
+    EXPECT_EQ(run(catches()), "boom");
+}
+
+TEST(Task, WhenAllCollectsInOrder) {
+    auto [a, b, c] = run(when_all(answer(), add_one(2), []() -> Task<void> { co_return; }()));
+    EXPECT_EQ(a, 42);
+    EXPECT_EQ(b, 44);
+    (void)c;
+
+    std::vector<Task<int>> list;
+    for (int i = 0; i < 5; ++i) list.push_back(add_one(i));
+    auto all = run(when_all(std::move(list)));
+    ASSERT_EQ(all.size(), 5u);
+    EXPECT_EQ(all[4], 46);
+}
+
+TEST(Task, WhenAllRethrowsFirstError) {
+    auto t = []() -> Task<std::string> {
+        try {
+            co_await when_all(answer(), fail());
+        } catch (const std::exception& e) {
+            co_return std::string(e.what());
+        }
+        co_return std::string();
+    };
+    EXPECT_EQ(run(t()), "boom");
+}
+
+TEST(Task, OffloadAndSleepRunInlineOffLoop) {
+    auto t = []() -> Task<int> {
+        co_await sleep_for(std::chrono::milliseconds(1));
+        int v = co_await offload([] { return 7; });
+        co_await offload([] {});
+        co_return v;
+    };
+    EXPECT_EQ(run(t()), 7);
+}
@@ -0,0 +1,55 @@
+// Unit tests for the bounded pool that runs blocking route handlers.
+
+#include "socketify/detail/thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+namespace du = socketify::detail;
+
+TEST(ThreadPool, RunsSubmittedJobs) {
+    std::atomic<int> n{0};
+    {
+        du::ThreadPool pool(2, 0);
+        EXPECT_EQ(pool.threads(), 2u);
+        std::promise<void> last;
+        for (int i = 0; i < 99; ++i) ASSERT_TRUE(pool.try_submit([&] { n.fetch_add(1); }));
+        ASSERT_TRUE(pool.try_submit([&] { last.set_value(); }));
+        last.get_future().wait();
+    }
+    EXPECT_EQ(n.load(), 99);
+}
+
+TEST(ThreadPool, RejectsWhenQueueIsFull) {
+    du::ThreadPool pool(1, 1);
+    std::promise<void> started, release;
+    auto gate = release.get_future().share();
+    ASSERT_TRUE(pool.try_submit([&, gate] { started.set_value(); gate.wait(); }));
+    started.get_future().wait();
+
+    EXPECT_TRUE(pool.try_submit([] {}));  // waits in the queue
+    EXPECT_EQ(pool.pending(), 1u);
+    EXPECT_FALSE(pool.try_submit([] {})); // over capacity
+    release.set_value();
+}
+
+TEST(ThreadPool, DestructionDropsQueuedJobs) {
+    std::atomic<bool> ran{false};
+    std::promise<void> started, release;
+    {
+        du::ThreadPool pool(1, 0);
+        auto gate = release.get_future().share();
+        ASSERT_TRUE(pool.try_submit([&, gate] { started.set_value(); gate.wait(); }));
+        started.get_future().wait();
+        ASSERT_TRUE(pool.try_submit([&] { ran = true; }));
+        std::thread([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            release.set_value();
+        }).detach();
+    }
+    EXPECT_FALSE(ran.load());
+}
@@ -0,0 +1,181 @@
+// Unit tests for the hierarchical timer wheel: arm/re-arm/cancel, firing
+// order across levels, long timers, and the next-timeout hint.
+
+#include "socketify/detail/timer_wheel.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+namespace du = socketify::detail;
+using Clock = du::TimerWheel::Clock;
+using std::chrono::milliseconds;
+
+namespace {
+
+struct Probe {
+    std::vector<int>* log;
+    int id;
+    du::Timer timer;
+
+    Probe(std::vector<int>* l, int i) : log(l), id(i) {
+        timer.set_callback([](void* ctx) {
+            auto* p = static_cast<Probe*>(ctx);
+            p->log->push_back(p->id);
+        }, this);
+    }
+};
+
+} // namespace
+
+TEST(TimerWheel, FiresAtOrAfterDeadline) {
+    auto t0 = Clock::now();
+    du::TimerWheel w(t0);
+    std::vector<int> log;
+    Probe a(&log, 1);
+    w.arm(a.timer, t0 + milliseconds(10));
+    EXPECT_TRUE(a.timer.armed());
+    EXPECT_EQ(w.size(), 1u);
+
+    EXPECT_EQ(w.advance(t0 + milliseconds(9)), 0u);
+    EXPECT_TRUE(log.empty());
+    EXPECT_EQ(w.advance(t0 + milliseconds(10)), 1u);
+    EXPECT_EQ(log, std::vector<int>{1});
+    EXPECT_FALSE(a.timer.armed());
+    EXPECT_TRUE(w.empty());
+}
+
+TEST(TimerWheel, OrderAcrossLevels) {
+    auto t0 = Clock::now();
+    du::TimerWheel w(t0);
+    std::vector<int> log;
+    Probe a(&log, 1), b(&log, 2), c(&log, 3), d(&log, 4);
+    w.arm(d.timer, t0 + milliseconds(300000)); // level 3
+    w.arm(c.timer, t0 + milliseconds(5000));   // level 2
+    w.arm(b.timer, t0 + milliseconds(100));    // level 1
+    w.arm(a.timer, t0 + milliseconds(3));      // level 0
+
+    for (int ms = 0; ms <= 300000; ms += 7) w.advance(t0 + milliseconds(ms));
+    w.advance(t0 + milliseconds(300000));
+    EXPECT_EQ(log, (std::vector<int>{1, 2, 3, 4}));
+}
+
+TEST(TimerWheel, CascadedTimerNotEarly) {
+    auto t0 = Clock::now();
+    du::TimerWheel w(t0);
+    std::vector<int> log;
+    Probe a(&log, 1);
+    w.arm(a.timer, t0 + milliseconds(4100));
+    w.advance(t0 + milliseconds(4096)); // cascade boundary
+    EXPECT_TRUE(log.empty());
+    w.advance(t0 + milliseconds(4099));
+    EXPECT_TRUE(log.empty());
+    w.advance(t0 + milliseconds(4100));
+    EXPECT_EQ(log.size(), 1u);
+}
+
+TEST(TimerWheel, RearmAndCancel) {
+    auto t0 = Clock::now();
+    du::TimerWheel w(t0);
+    std::vector<int> log;
+    Probe a(&log, 1), b(&log, 2);
+    w.arm(a.timer, t0 + milliseconds(10));
+    w.arm(b.timer, t0 + milliseconds(10));
+    w.arm(a.timer, t0 + milliseconds(50)); // re-arm moves it
+    w.cancel(b.timer);
+    EXPECT_EQ(w.size(), 1u);
+
+    w.advance(t0 + milliseconds(20));
+    EXPECT_TRUE(log.empty());
+    w.advance(t0 + milliseconds(50));
+    EXPECT_EQ(log, std::vector<int>{1});
+}
+
+TEST(TimerWheel, DestroyingArmedTimerCancels) {
+    auto t0 = Clock::now();
+    du::TimerWheel w(t0);
+    std::vector<int> log;
+    {
+        Probe a(&log, 1);
+        w.arm(a.timer, t0 + milliseconds(5));
+    }
+    EXPECT_TRUE(w.empty());
+    w.advance(t0 + milliseconds(10));
+    EXPECT_TRUE(log.empty());
+}
+
+TEST(TimerWheel, CallbackMayDestroyOwnAndSiblingTimers) {
+    auto t0 = Clock::now();
+    du::TimerWheel w(t0);
+    struct Owner {
+        du::Timer timer;
+        std::unique_ptr<Owner>* self{nullptr};
+        std::unique_ptr<Owner>* sibling{nullptr};
+    };
+    std::unique_ptr<Owner> x = std::make_unique<Owner>();
+    std::unique_ptr<Owner> y = std::make_unique<Owner>();
+    x->self = &x;
+    x->sibling = &y;
+    x->timer.set_callback([](void* ctx) {
+        auto* o = static_cast<Owner*>(ctx);
+        auto* sib = o->sibling;
+        auto* self = o->self;
+        sib->reset();  // sibling due in the same slot
+        self->reset(); // and ourselves
+    }, x.get());
+    y->timer.set_callback([](void*) { FAIL() << "cancelled timer fired"; }, nullptr);
+    w.arm(x->timer, t0 + milliseconds(7));
+    w.arm(y->timer, t0 + milliseconds(7));
+
+    EXPECT_EQ(w.advance(t0 + milliseconds(7)), 1u);
+    EXPECT_FALSE(x);
+    EXPECT_FALSE(y);
+    EXPECT_TRUE(w.empty());
+}
+
+TEST(TimerWheel, PastDeadlineFiresOnNextAdvance) {
+    auto t0 = Clock::now();
+    du::TimerWheel w(t0);
+    std::vector<int> log;
+    Probe a(&log, 1);
+    w.advance(t0 + milliseconds(100));
+    w.arm(a.timer, t0 + milliseconds(50));
+    w.advance(t0 + milliseconds(101));
+    EXPECT_EQ(log.size(), 1u);
+}
+
+TEST(TimerWheel, VeryLongTimerIsRecascaded) {
+    auto t0 = Clock::now();
+    du::TimerWheel w(t0);
+    std::vector<int> log;
+    Probe a(&log, 1);
+    auto far = std::chrono::hours(10); // beyond the 4-level span
+    w.arm(a.timer, t0 + far);
+    w.advance(t0 + far - milliseconds(1));
+    EXPECT_TRUE(log.empty());
+    w.advance(t0 + far);
+    EXPECT_EQ(log.size(), 1u);
+}
+
+TEST(TimerWheel, NextTimeoutNeverOvershoots) {
+    auto t0 = Clock::now();
+    du::TimerWheel w(t0);
+    EXPECT_EQ(w.next_timeout_ms(t0), -1);
+
+    std::vector<int> log;
+    Probe a(&log, 1);
+    w.arm(a.timer, t0 + milliseconds(30));
+    EXPECT_EQ(w.next_timeout_ms(t0), 30);
+
+    w.arm(a.timer, t0 + milliseconds(70000));
+    auto now = t0;
+    for (int i = 0; i < 100 && log.empty(); ++i) {
+        int to = w.next_timeout_ms(now);
+        ASSERT_GE(to, 0);
+        ASSERT_LE(now + milliseconds(to), t0 + milliseconds(70000));
+        now += milliseconds(to);
+        w.advance(now);
+    }
+    EXPECT_EQ(now, t0 + milliseconds(70000));
+}
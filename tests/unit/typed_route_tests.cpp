@@ -0,0 +1,162 @@
+// Unit tests for compile-time route patterns: pattern parsing, typed
+// parameter conversion, rejection, groups and mixing with runtime routes.
+
+#include "socketify/router.h"
+#include "socketify/typed_route.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using namespace socketify;
+namespace du = socketify::detail;
+
+namespace {
+
+Request make_req(Method m, std::string path) {
+    Request r;
+    r.set_method(m);
+    r.set_path(std::move(path));
+    return r;
+}
+
+} // namespace
+
+TEST(TypedRoute, PatternIsParsedAtCompileTime) {
+    using P = du::RoutePattern<"/users/:id/files/*rest">;
+    static_assert(P::size == 2);
+    static_assert(P::params[0].segment == 1 && P::params[0].name == "id" && !P::params[0].wildcard);
+    static_assert(P::params[1].segment == 3 && P::params[1].name == "rest" && P::params[1].wildcard);
+    static_assert(du::RoutePattern<"//a//:b">::params[0].segment == 1);
+    static_assert(du::RoutePattern<"/">::size == 0);
+    SUCCEED();
+}
+
+TEST(TypedRoute, HandlerGetsConvertedParameters) {
+    Router r;
+    std::int64_t got_id = 0;
+    std::string_view got_slug;
+    double got_ratio = 0;
+    r.route<"/users/:id/posts/:slug/:ratio">(
+        [&](Request& req, Response& res, std::int64_t id, std::string_view slug, double ratio) {
+            got_id = id;
+            got_slug = slug;
+            got_ratio = ratio;
+            EXPECT_TRUE(req.params().empty()); // no ParamMap on this path
+            res.send("ok");
+        });
+
+    auto req = make_req(Method::GET, "/users/-42/posts/hello-world/0.5");
+    Response res;
+    EXPECT_TRUE(r.dispatch(req, res));
+    EXPECT_EQ(res.body_view(), "ok");
+    EXPECT_EQ(got_id, -42);
+    EXPECT_EQ(got_slug, "hello-world");
+    EXPECT_DOUBLE_EQ(got_ratio, 0.5);
+}
+
+TEST(TypedRoute, UnconvertibleSegmentIsBadRequest) {
+    Router r;
+    int calls = 0;
+    r.route<"/items/:id">(Method::DELETE_,
+                          [&](Request&, Response&, std::uint16_t) { ++calls; });
+
+    for (const char* path : {"/items/abc", "/items/12x", "/items/70000", "/items/-1"}) {
+        auto req = make_req(Method::DELETE_, path);
+        Response res;
+        EXPECT_TRUE(r.dispatch(req, res)) << path;
+        EXPECT_EQ(res.status_code(), 400) << path;
+    }
+    EXPECT_EQ(calls, 0);
+
+    auto req = make_req(Method::DELETE_, "/items/65535");
+    Response res;
+    EXPECT_TRUE(r.dispatch(req, res));
+    EXPECT_EQ(calls, 1);
+}
+
+TEST(TypedRoute, WildcardTakesTheRestOfThePath) {
+    Router r;
+    std::string rest = "unset";
+    r.route<"/files/:owner/*path">([&](Request&, Response& res, std::string owner, std::string path) {
+        rest = owner + "|" + path;
+        res.send("");
+    });
+
+    auto req = make_req(Method::GET, "/files/ann/a/b/c.txt/");
+    Response res;
+    EXPECT_TRUE(r.dispatch(req, res));
+    EXPECT_EQ(rest, "ann|a/b/c.txt");
+
+    auto bare = make_req(Method::GET, "/files/bob");
+    Response res2;
+    EXPECT_TRUE(r.dispatch(bare, res2));
+    EXPECT_EQ(rest, "bob|");
+}
+
+TEST(TypedRoute, MixesWithRuntimeRoutesAndGroups) {
+    Router r;
+    std::string seen;
+    r.AddRoute(Method::GET, "/users/me", [&](Request&, Response& res) {
+        seen = "me";
+        res.send("");
+    });
+    r.route<"/users/:id">([&](Request&, Response& res, std::int64_t id) {
+        seen = "id " + std::to_string(id);
+        res.send("");
+    });
+    auto& tenants = r.Group("/t/:tenant");
+    tenants.Use([&](Request&, Response&, Next next) {
+        seen += "mw ";
+        next();
+    });
+    tenants.route<"/orders/:n">(Method::POST, [&](Request&, Response& res, unsigned n) {
+        seen += "order " + std::to_string(n);
+        res.send("");
+    });
+
+    auto me = make_req(Method::GET, "/users/me");
+    Response res1;
+    EXPECT_TRUE(r.dispatch(me, res1));
+    EXPECT_EQ(seen, "me");
+
+    auto id = make_req(Method::GET, "/users/7");
+    Response res2;
+    EXPECT_TRUE(r.dispatch(id, res2));
+    EXPECT_EQ(seen, "id 7");
+
+    seen.clear();
+    auto order = make_req(Method::POST, "/t/acme/orders/12");
+    Response res3;
+    EXPECT_TRUE(r.dispatch(order, res3));
+    EXPECT_EQ(seen, "mw order 12");
+
+    // Only the method is wrong: the usual 405.
+    auto get = make_req(Method::GET, "/t/acme/orders/12");
+    Response res4;
+    EXPECT_TRUE(r.dispatch(get, res4));
+    EXPECT_EQ(res4.status_code(), 405);
+}
+
+TEST(TypedRoute, CoroutineHandler) {
+    Router r;
+    std::int64_t got = 0;
+    r.route<"/jobs/:id">([&](Request&, Response& res, std::int64_t id) -> Task<void> {
+        got = id;
+        res.send("done");
+        co_return;
+    });
+
+    auto req = make_req(Method::GET, "/jobs/9");
+    Response res;
+    EXPECT_TRUE(r.dispatch(req, res));
+    EXPECT_EQ(got, 9);
+    EXPECT_EQ(res.body_view(), "done");
+
+    auto bad = make_req(Method::GET, "/jobs/x");
+    Response res2;
+    EXPECT_TRUE(r.dispatch(bad, res2));
+    EXPECT_EQ(res2.status_code(), 400);
+}
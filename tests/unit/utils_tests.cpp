@@ -7,6 +7,10 @@
 
 #include <gtest/gtest.h>
 
+#include <cstring>
+#include <memory>
+#include <string>
+
 using namespace socketify;
 namespace du = socketify::detail;
 
@@ -119,6 +123,62 @@ TEST(Buffer, CompactsLargeDeadPrefix) {
     EXPECT_EQ(b.view().substr(1000), "tail");
 }
 
+TEST(Buffer, EraseClosesTheGap) {
+    du::Buffer b;
+    b.append("xxheadBODYnext");
+    b.consume(2);
+    b.erase(4, 4);
+    EXPECT_EQ(b.view(), "headnext");
+    b.erase(4, 99); // clamps
+    EXPECT_EQ(b.view(), "head");
+    b.erase(9, 1); // past the end: no-op
+    b.erase(0, 4);
+    EXPECT_TRUE(b.empty());
+}
+
+TEST(Buffer, PrepareCommitFillsTailInPlace) {
+    du::Buffer b;
+    b.append("ab");
+    char* w = b.prepare(100);
+    ASSERT_GE(b.writable(), 100u);
+    std::memcpy(w, "cdef", 4);
+    b.commit(4);
+    EXPECT_EQ(b.view(), "abcdef");
+    b.commit(b.writable() + 10); // clamps to the prepared room
+    EXPECT_EQ(b.size(), b.capacity());
+}
+
+TEST(Buffer, PrepareZeroNeverAllocates) {
+    du::Buffer b;
+    b.prepare(0);
+    EXPECT_EQ(b.capacity(), 0u);
+    EXPECT_EQ(b.writable(), 0u);
+    b.append("abc");
+    const std::size_t cap = b.capacity();
+    b.prepare(0);
+    EXPECT_EQ(b.capacity(), cap);
+    EXPECT_EQ(b.writable(), cap - 3);
+}
+
+TEST(Buffer, GrowthKeepsUnreadBytes) {
+    du::Buffer b;
+    b.append("0123456789");
+    b.consume(4);
+    b.prepare(1 << 20);
+    EXPECT_GE(b.capacity(), (1u << 20) + 6);
+    EXPECT_EQ(b.view(), "456789");
+}
+
+TEST(Buffer, PrepareSlidesConsumedPrefixBeforeGrowing) {
+    du::Buffer b;
+    b.append(std::string(4000, 'x'));
+    const std::size_t cap = b.capacity();
+    b.consume(3990);
+    b.prepare(cap - 100); // fits once the dead prefix is dropped
+    EXPECT_EQ(b.capacity(), cap);
+    EXPECT_EQ(b.view(), std::string(10, 'x'));
+}
+
 TEST(CaseInsensitiveHeaderMap, Lookup) {
     HeaderMap h;
     h["Content-Type"] = "text/plain";